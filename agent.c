@@ -0,0 +1,447 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2025 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "agent.h"
+#include "codec.h"
+#include "infiniband.h"
+#include "utils.h"
+#include "wire.h"
+
+/* batches are sent earlier once this many bytes are queued */
+#define AGENT_BATCH_SIZE (64U << 10)
+
+/* an aggregator this far behind is disconnected; the stream starts over with the next connection */
+#define AGENT_BACKLOG_MAX (4U << 20)
+
+/* delay between connection attempts */
+#define AGENT_RETRY_NS (NSEC_PER_SEC)
+
+/* frame length and type */
+#define AGENT_FRAME_HEADER_SIZE 5
+
+enum agent_state {
+    AGENT_DISCONNECTED,
+    AGENT_CONNECTING,
+    AGENT_CONNECTED
+};
+
+/* everything is touched on the collector thread only */
+struct agent {
+    char address[256];
+    char host_name[AGENT_HOST_NAME_MAX];
+
+    int fd;
+    enum agent_state state;
+    uint64_t retry_ns;
+
+    /* frames of the batch being filled, then the bytes queued for the aggregator; the first sent bytes are on the wire already */
+    struct string_buffer frames;
+    struct string_buffer batch;
+    size_t sent;
+    size_t batch_samples;
+    size_t queued_samples;
+    enum codec_compression compression;
+
+    /* ports and counters the last PORTS frame described */
+    struct interface *ports;
+    size_t port_count;
+    size_t port_capacity;
+    size_t counter_count;
+    int ports_flag;
+
+    /* what the aggregator decoded last, which the next SAMPLE frame is coded against */
+    struct sample_codec codec;
+};
+
+struct agent *agent_open(const char *address, const char *host_name, uint64_t interval_ns) {
+    char host[256];
+    const char *port;
+    struct agent *new_agent;
+
+    if (strlen(address) >= sizeof(new_agent->address)) {
+        fprintf(stderr, "ERROR: aggregator address is too long: %s\n", address);
+        return NULL;
+    }
+
+    if (parse_socket_address(address, host, sizeof(host), &port) < 0) {
+        return NULL;
+    }
+
+    new_agent = calloc(1, sizeof(*new_agent));
+    if (new_agent == NULL) {
+        fprintf(stderr, "ERROR: failed to allocate agent\n");
+        return NULL;
+    }
+
+    strcpy(new_agent->address, address);
+    new_agent->fd = -1;
+    new_agent->state = AGENT_DISCONNECTED;
+    new_agent->batch_samples = interval_ns < AGENT_FLUSH_NS ? (size_t)(AGENT_FLUSH_NS / interval_ns) : 1;
+    new_agent->compression = codec_default_compression();
+
+    /* the short host name tells the ports of different hosts apart */
+    if (host_name != NULL) {
+        snprintf(new_agent->host_name, sizeof(new_agent->host_name), "%s", host_name);
+    } else {
+        char full_name[256] = {0};
+        if (gethostname(full_name, sizeof(full_name) - 1) < 0) {
+            strcpy(full_name, "localhost");
+        }
+        full_name[strcspn(full_name, ".")] = '\0';
+        snprintf(new_agent->host_name, sizeof(new_agent->host_name), "%.*s", AGENT_HOST_NAME_MAX - 1, full_name);
+    }
+
+    return new_agent;
+}
+
+/* queue a frame header; the length is filled in by end_frame() */
+static int begin_frame(struct string_buffer *buffer, enum agent_frame_type type, size_t *frame_start) {
+    if (string_buffer_reserve(buffer, AGENT_FRAME_HEADER_SIZE) < 0) {
+        return -1;
+    }
+
+    *frame_start = buffer->length;
+    memset(buffer->data + buffer->length, 0, AGENT_FRAME_HEADER_SIZE - 1);
+    buffer->data[buffer->length + AGENT_FRAME_HEADER_SIZE - 1] = (char)type;
+    buffer->length += AGENT_FRAME_HEADER_SIZE;
+
+    return 0;
+}
+
+static void end_frame(struct string_buffer *buffer, size_t frame_start) {
+    size_t payload_length = buffer->length - frame_start - AGENT_FRAME_HEADER_SIZE;
+    unsigned char *header = (unsigned char *)buffer->data + frame_start;
+
+    for (int i = 0; i < 4; ++i) {
+        header[i] = (unsigned char)(payload_length >> (8 * i));
+    }
+}
+
+static int append_hello(struct agent *input_agent) {
+    size_t frame_start;
+
+    if (begin_frame(&input_agent->frames, AGENT_FRAME_HELLO, &frame_start) < 0 ||
+        wire_put_varint(&input_agent->frames, AGENT_PROTOCOL_VERSION) < 0 ||
+        wire_put_string(&input_agent->frames, input_agent->host_name) < 0) {
+        return -1;
+    }
+
+    end_frame(&input_agent->frames, frame_start);
+
+    return 0;
+}
+
+/* drop the connection along with everything queued, and retry later */
+static void agent_disconnect(struct agent *input_agent, uint64_t now_ns) {
+    if (input_agent->fd >= 0) {
+        close(input_agent->fd);
+    }
+
+    input_agent->fd = -1;
+    input_agent->state = AGENT_DISCONNECTED;
+    input_agent->retry_ns = now_ns + AGENT_RETRY_NS;
+    input_agent->frames.length = 0;
+    input_agent->batch.length = 0;
+    input_agent->sent = 0;
+    input_agent->queued_samples = 0;
+}
+
+/* move the connection forward without blocking; return 1 once it is established */
+static int agent_connect(struct agent *input_agent, uint64_t now_ns) {
+    if (input_agent->state == AGENT_DISCONNECTED) {
+        if (now_ns < input_agent->retry_ns) {
+            return 0;
+        }
+
+        input_agent->fd = open_connect_socket(input_agent->address);
+        if (input_agent->fd < 0) {
+            agent_disconnect(input_agent, now_ns);
+            return 0;
+        }
+
+        input_agent->state = AGENT_CONNECTING;
+    }
+
+    if (input_agent->state == AGENT_CONNECTING) {
+        struct pollfd poll_fd = {input_agent->fd, POLLOUT, 0};
+        int error_value = 0;
+        socklen_t error_length = sizeof(error_value);
+
+        if (poll(&poll_fd, 1, 0) == 0) {
+            return 0;
+        }
+
+        if (getsockopt(input_agent->fd, SOL_SOCKET, SO_ERROR, &error_value, &error_length) < 0 || error_value != 0) {
+            agent_disconnect(input_agent, now_ns);
+            return 0;
+        }
+
+        /* frames are batched already; do not hold the tail of a batch back */
+        int nodelay_value = 1;
+        setsockopt(input_agent->fd, IPPROTO_TCP, TCP_NODELAY, &nodelay_value, sizeof(nodelay_value));
+
+        /* every connection starts a new stream, so the aggregator learns the ports again */
+        input_agent->state = AGENT_CONNECTED;
+        input_agent->ports_flag = 1;
+        if (append_hello(input_agent) < 0) {
+            agent_disconnect(input_agent, now_ns);
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/* return 1 if the ports or counters of the sample differ from the ones the aggregator knows */
+static int ports_changed(const struct agent *input_agent, const struct infiniband_metrics *input_infiniband_metrics, size_t port_count, size_t counter_count) {
+    if (port_count != input_agent->port_count || counter_count != input_agent->counter_count) {
+        return 1;
+    }
+
+    for (size_t i = 0; i < port_count; ++i) {
+        const struct interface *port = &input_infiniband_metrics->infiniband[i];
+        const struct interface *known_port = &input_agent->ports[i];
+
+        if (port->name_id != known_port->name_id || port->rate_id != known_port->rate_id || port->lid != known_port->lid || port->link_layer != known_port->link_layer) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static int append_ports(struct agent *input_agent, const struct infiniband_metrics *input_infiniband_metrics, size_t port_count, size_t counter_count) {
+    struct string_buffer *frames = &input_agent->frames;
+    size_t frame_start;
+
+    if (port_count > input_agent->port_capacity) {
+        struct interface *new_ports = realloc(input_agent->ports, port_count * sizeof(*new_ports));
+        if (new_ports == NULL) {
+            return -1;
+        }
+        input_agent->ports = new_ports;
+        input_agent->port_capacity = port_count;
+    }
+
+    /* a PORTS frame resets the codec on both ends, so the next SAMPLE frame is a keyframe */
+    if (codec_init(&input_agent->codec, port_count, counter_count) < 0) {
+        return -1;
+    }
+
+    memcpy(input_agent->ports, input_infiniband_metrics->infiniband, port_count * sizeof(*input_agent->ports));
+    input_agent->port_count = port_count;
+    input_agent->counter_count = counter_count;
+    input_agent->ports_flag = 0;
+
+    if (begin_frame(frames, AGENT_FRAME_PORTS, &frame_start) < 0 || wire_put_varint(frames, port_count) < 0) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < port_count; ++i) {
+        const struct interface *port = &input_agent->ports[i];
+
+        if (wire_put_string(frames, infiniband_interface_name(port->name_id)) < 0 || wire_put_string(frames, infiniband_rate_name(port->rate_id)) < 0 ||
+            wire_put_varint(frames, port->lid) < 0 || wire_put_byte(frames, port->link_layer) < 0) {
+            return -1;
+        }
+    }
+
+    if (wire_put_varint(frames, counter_count) < 0) {
+        return -1;
+    }
+
+    for (size_t k = 0; k < counter_count; ++k) {
+        if (wire_put_string(frames, infiniband_counter_name((enum infiniband_counter)k)) < 0) {
+            return -1;
+        }
+    }
+
+    end_frame(frames, frame_start);
+
+    return 0;
+}
+
+/* counters mostly advance at a steady rate between samples, so most of them cost a byte or two (see codec.h) */
+static int append_sample(struct agent *input_agent, const struct infiniband_metrics *input_infiniband_metrics) {
+    struct sample_codec *codec = &input_agent->codec;
+    size_t port_count = input_agent->port_count;
+    size_t frame_start;
+
+    codec->next_realtime_ns = input_infiniband_metrics->realtime_ns;
+
+    for (size_t i = 0; i < port_count; ++i) {
+        codec->next_states[2 * i] = input_infiniband_metrics->infiniband[i].state;
+        codec->next_states[2 * i + 1] = input_infiniband_metrics->infiniband[i].phys_state;
+    }
+
+    for (size_t k = 0; k < input_agent->counter_count; ++k) {
+        memcpy(codec->next_values + k * port_count, input_infiniband_metrics->counters[k], port_count * sizeof(uint64_t));
+    }
+
+    if (begin_frame(&input_agent->frames, AGENT_FRAME_SAMPLE, &frame_start) < 0 || codec_encode(codec, &input_agent->frames) < 0) {
+        return -1;
+    }
+
+    end_frame(&input_agent->frames, frame_start);
+
+    return 0;
+}
+
+/* queue the frames of the batch, wrapped in a compressed BATCH frame if that is smaller */
+static int queue_frames(struct agent *input_agent) {
+    struct string_buffer *frames = &input_agent->frames;
+    struct string_buffer *batch = &input_agent->batch;
+    size_t batch_length = batch->length;
+    size_t frame_start;
+
+    if (frames->length == 0) {
+        return 0;
+    }
+
+    if (input_agent->compression != CODEC_COMPRESSION_NONE) {
+        if (begin_frame(batch, AGENT_FRAME_BATCH, &frame_start) < 0 || wire_put_byte(batch, input_agent->compression) < 0 ||
+            wire_put_varint(batch, frames->length) < 0 || codec_compress(input_agent->compression, frames->data, frames->length, batch) < 0) {
+            return -1;
+        }
+
+        if (batch->length - frame_start < frames->length) {
+            end_frame(batch, frame_start);
+            frames->length = 0;
+            return 0;
+        }
+
+        batch->length = batch_length;
+    }
+
+    if (string_buffer_append(batch, frames->data, frames->length) < 0) {
+        return -1;
+    }
+
+    frames->length = 0;
+
+    return 0;
+}
+
+/* send as much of the batch as the socket takes without blocking */
+static void agent_flush(struct agent *input_agent, uint64_t now_ns) {
+    struct string_buffer *batch = &input_agent->batch;
+
+    if (queue_frames(input_agent) < 0) {
+        agent_disconnect(input_agent, now_ns);
+        return;
+    }
+
+    while (input_agent->sent < batch->length) {
+        ssize_t ret_send = send(input_agent->fd, batch->data + input_agent->sent, batch->length - input_agent->sent, MSG_NOSIGNAL);
+        if (ret_send < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+
+            agent_disconnect(input_agent, now_ns);
+            return;
+        }
+
+        input_agent->sent += (size_t)ret_send;
+    }
+
+    input_agent->queued_samples = 0;
+
+    if (input_agent->sent == batch->length) {
+        batch->length = 0;
+        input_agent->sent = 0;
+        return;
+    }
+
+    if (batch->length - input_agent->sent > AGENT_BACKLOG_MAX) {
+        agent_disconnect(input_agent, now_ns);
+        return;
+    }
+
+    /* keep the unsent tail at the front so the buffer does not grow with every batch */
+    memmove(batch->data, batch->data + input_agent->sent, batch->length - input_agent->sent);
+    batch->length -= input_agent->sent;
+    input_agent->sent = 0;
+}
+
+/* queue the sample for the aggregator and send a batch once it is full; runs on the collector thread */
+void agent_publish(const struct infiniband_metrics *input_infiniband_metrics, void *agent) {
+    struct agent *input_agent = agent;
+    uint64_t now_ns = get_monotonic_ns();
+
+    /* samples taken while disconnected are not kept; counters are cumulative, so nothing is lost but resolution */
+    if (input_infiniband_metrics->interface_count <= 0 || agent_connect(input_agent, now_ns) == 0) {
+        return;
+    }
+
+    size_t port_count = (size_t)input_infiniband_metrics->interface_count;
+    size_t counter_count = input_infiniband_metrics->counter_count;
+    if (port_count > AGENT_PORT_MAX) {
+        port_count = AGENT_PORT_MAX;
+    }
+    if (counter_count > AGENT_COUNTER_MAX) {
+        counter_count = AGENT_COUNTER_MAX;
+    }
+
+    if ((input_agent->ports_flag > 0 || ports_changed(input_agent, input_infiniband_metrics, port_count, counter_count) > 0) &&
+        append_ports(input_agent, input_infiniband_metrics, port_count, counter_count) < 0) {
+        agent_disconnect(input_agent, now_ns);
+        return;
+    }
+
+    if (append_sample(input_agent, input_infiniband_metrics) < 0) {
+        agent_disconnect(input_agent, now_ns);
+        return;
+    }
+
+    if (++input_agent->queued_samples >= input_agent->batch_samples || input_agent->frames.length >= AGENT_BATCH_SIZE) {
+        agent_flush(input_agent, now_ns);
+    }
+}
+
+/* send what is queued if the socket takes it right away; the collector must be stopped first */
+void agent_close(struct agent *input_agent) {
+    if (input_agent == NULL) {
+        return;
+    }
+
+    if (input_agent->state == AGENT_CONNECTED) {
+        agent_flush(input_agent, get_monotonic_ns());
+    }
+
+    if (input_agent->fd >= 0) {
+        close(input_agent->fd);
+    }
+
+    string_buffer_free(&input_agent->frames);
+    string_buffer_free(&input_agent->batch);
+    free(input_agent->ports);
+    codec_free(&input_agent->codec);
+    free(input_agent);
+}
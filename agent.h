@@ -0,0 +1,64 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2025 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AGENT_H
+#define AGENT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "infiniband.h"
+#include "utils.h"
+
+/*
+ * agent stream: frames of a little-endian uint32_t payload length, a frame type byte and the payload.
+ * integers in payloads are varints (see wire.h) and strings a varint length and the characters
+ *   AGENT_FRAME_HELLO:  varint AGENT_PROTOCOL_VERSION, string host name
+ *   AGENT_FRAME_PORTS:  varint port count, then per port string name, string rate, varint lid and
+ *                       byte link layer; varint counter count, then the counter names as strings
+ *   AGENT_FRAME_SAMPLE: one sample of every port and counter, coded as in codec.h
+ *   AGENT_FRAME_BATCH:  byte enum codec_compression, varint length of the frames it holds, then those
+ *                       frames compressed; it never holds another BATCH frame
+ * a PORTS frame resets the codec, so the first SAMPLE after it is a keyframe
+ */
+#define AGENT_PROTOCOL_VERSION 2
+
+/* samples are sent in batches covering about this long */
+#define AGENT_FLUSH_NS (NSEC_PER_SEC)
+
+/* largest frame an aggregator accepts */
+#define AGENT_FRAME_MAX (16U << 20)
+
+#define AGENT_PORT_MAX 4096
+#define AGENT_COUNTER_MAX 1024
+
+/* host names are cut to fit port names of INTERN_STRING_MAX characters */
+#define AGENT_HOST_NAME_MAX 32
+
+enum agent_frame_type {
+    AGENT_FRAME_HELLO = 1,
+    AGENT_FRAME_PORTS,
+    AGENT_FRAME_SAMPLE,
+    AGENT_FRAME_BATCH
+};
+
+struct agent;
+
+extern struct agent *agent_open(const char *address, const char *host_name, uint64_t interval_ns);
+extern void agent_publish(const struct infiniband_metrics *input_infiniband_metrics, void *agent);
+extern void agent_close(struct agent *input_agent);
+
+#endif /* AGENT_H */
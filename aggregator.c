@@ -0,0 +1,860 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2025 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "agent.h"
+#include "aggregator.h"
+#include "codec.h"
+#include "infiniband.h"
+#include "intern.h"
+#include "utils.h"
+#include "wire.h"
+
+/* concurrent agent connections; further agents are closed right after accept */
+#define MAX_CONNECTIONS 4096
+
+/* bytes read from one agent before the others get their turn */
+#define READ_CHUNK_SIZE (64U << 10)
+#define READ_CHUNKS_PER_EVENT 16
+
+/* frame length and type */
+#define FRAME_HEADER_SIZE 5
+
+/*
+ * agents send their samples in batches, so the newest values of a host are up to a batch old and
+ * arrive in bursts. every host is shown as of AGENT_FLUSH_NS plus its sample interval plus POINT_STEP_NS
+ * ago instead, interpolated between recent points kept at least POINT_STEP_NS apart, which keeps rates
+ * steady at any refresh period. points carry the agent's clock, so that instant is taken on the
+ * aggregator's clock and moved to the agent's by the host's clock offset
+ */
+#define POINT_COUNT 16
+#define POINT_STEP_NS (250 * NSEC_PER_MSEC)
+
+/* markers stored in epoll data for the two non-connection descriptors */
+#define LISTEN_MARKER ((void *)1)
+#define WAKE_MARKER ((void *)2)
+
+/* a port of an agent, named <host>/<port> (e.g.: node01/mlx5_0:1) so that hosts do not collide */
+struct aggregator_port {
+    char name[IB_DEVICE_NAME_MAX];
+    char rate[IB_DEVICE_NAME_MAX];
+    uint32_t lid;
+    uint8_t link_layer;
+
+    /* interned on the collector thread, which owns the name tables */
+    uint16_t name_id;
+    uint16_t rate_id;
+};
+
+struct aggregator_point {
+    uint64_t realtime_ns;
+    uint64_t *counters;
+};
+
+/* what an agent reported last; kept across reconnections, but only sampled while connected */
+struct aggregator_host {
+    char name[AGENT_HOST_NAME_MAX];
+    struct aggregator_connection *connection;
+
+    /* ports and counters of the last PORTS frame */
+    struct aggregator_port *ports;
+    size_t port_count;
+    char (*counter_names)[IB_DEVICE_NAME_MAX];
+    int *counter_ids;
+    size_t counter_count;
+
+    /* newest values, counters[counter * port_count + port], port states and time, decoded from the SAMPLE frames */
+    struct sample_codec codec;
+
+    /* the usual time between samples */
+    uint64_t interval_ns;
+
+    /*
+     * aggregator clock minus agent clock, plus the transit time of a batch: the time a batch arrived at
+     * minus the time of its newest sample, which the agent sent right away. the lowest of these is
+     * followed at once and higher ones slowly, so clock steps and drift are followed but not jitter
+     */
+    int64_t clock_offset_ns;
+    int clock_offset_flag;
+
+    /* set when a SAMPLE frame was applied since the clock offset was last updated */
+    int sample_flag;
+
+    /* ring of recent values; the newest point always holds the newest values. empty until a SAMPLE arrives */
+    uint64_t *point_counters;
+    struct aggregator_point points[POINT_COUNT];
+    size_t point_count;
+    size_t newest_point;
+
+    /* set when the names still have to be interned */
+    int intern_flag;
+};
+
+struct aggregator_connection {
+    int fd;
+
+    /* NULL until the HELLO frame, or after another connection took the host over */
+    struct aggregator_host *host;
+
+    /* received bytes that do not make a complete frame yet */
+    struct string_buffer input;
+
+    struct aggregator_connection *prev;
+    struct aggregator_connection *next;
+};
+
+struct aggregator {
+    int listen_fd;
+    int epoll_fd;
+    int wake_fd;
+    pthread_t thread;
+
+    /* guards the hosts between the server thread and the collector thread sampling them */
+    pthread_mutex_t host_mutex;
+
+    /* hosts in order of appearance, found by name through an open addressing index of host slots */
+    struct aggregator_host **hosts;
+    size_t host_count;
+    size_t host_capacity;
+    uint32_t *host_index;
+    size_t host_index_size;
+
+    /* only touched by the server thread */
+    struct aggregator_connection *connections;
+    int connection_count;
+
+    /* frames of the BATCH frame being applied, decompressed */
+    struct string_buffer batch;
+};
+
+#define HOST_INDEX_EMPTY UINT32_MAX
+
+/* FNV-1a */
+static uint32_t host_hash(const char *name) {
+    uint32_t hash = 2166136261U;
+
+    for (const char *p = name; *p != '\0'; ++p) {
+        hash ^= (uint8_t)*p;
+        hash *= 16777619U;
+    }
+
+    return hash;
+}
+
+/* find the index position holding name, or the empty position it would go to */
+static size_t host_probe(const struct aggregator *input_aggregator, const char *name) {
+    size_t mask = input_aggregator->host_index_size - 1;
+    size_t position = host_hash(name) & mask;
+
+    while (input_aggregator->host_index[position] != HOST_INDEX_EMPTY) {
+        if (strcmp(input_aggregator->hosts[input_aggregator->host_index[position]]->name, name) == 0) {
+            break;
+        }
+
+        position = (position + 1) & mask;
+    }
+
+    return position;
+}
+
+/* keep the index at most half full */
+static int grow_host_index(struct aggregator *input_aggregator) {
+    size_t new_size = input_aggregator->host_index_size == 0 ? 64 : input_aggregator->host_index_size * 2;
+    uint32_t *new_index = malloc(new_size * sizeof(*new_index));
+    if (new_index == NULL) {
+        return -1;
+    }
+
+    memset(new_index, 0xff, new_size * sizeof(*new_index));
+
+    free(input_aggregator->host_index);
+    input_aggregator->host_index = new_index;
+    input_aggregator->host_index_size = new_size;
+
+    for (size_t i = 0; i < input_aggregator->host_count; ++i) {
+        input_aggregator->host_index[host_probe(input_aggregator, input_aggregator->hosts[i]->name)] = (uint32_t)i;
+    }
+
+    return 0;
+}
+
+/* return the host called name, adding it if unseen; NULL if it cannot be allocated */
+static struct aggregator_host *find_host(struct aggregator *input_aggregator, const char *name) {
+    if (input_aggregator->host_index_size > 0) {
+        uint32_t slot = input_aggregator->host_index[host_probe(input_aggregator, name)];
+        if (slot != HOST_INDEX_EMPTY) {
+            return input_aggregator->hosts[slot];
+        }
+    }
+
+    if ((input_aggregator->host_count + 1) * 2 > input_aggregator->host_index_size && grow_host_index(input_aggregator) < 0) {
+        return NULL;
+    }
+
+    if (input_aggregator->host_count == input_aggregator->host_capacity) {
+        size_t new_capacity = input_aggregator->host_capacity == 0 ? 64 : input_aggregator->host_capacity * 2;
+        struct aggregator_host **new_hosts = realloc(input_aggregator->hosts, new_capacity * sizeof(*new_hosts));
+        if (new_hosts == NULL) {
+            return NULL;
+        }
+        input_aggregator->hosts = new_hosts;
+        input_aggregator->host_capacity = new_capacity;
+    }
+
+    struct aggregator_host *host = calloc(1, sizeof(*host));
+    if (host == NULL) {
+        return NULL;
+    }
+
+    snprintf(host->name, sizeof(host->name), "%s", name);
+    input_aggregator->hosts[input_aggregator->host_count] = host;
+    input_aggregator->host_index[host_probe(input_aggregator, host->name)] = (uint32_t)input_aggregator->host_count;
+    ++input_aggregator->host_count;
+
+    return host;
+}
+
+static void free_host_ports(struct aggregator_host *host) {
+    free(host->ports);
+    free(host->counter_names);
+    free(host->counter_ids);
+    free(host->point_counters);
+    codec_free(&host->codec);
+    host->ports = NULL;
+    host->counter_names = NULL;
+    host->counter_ids = NULL;
+    host->point_counters = NULL;
+    host->port_count = 0;
+    host->counter_count = 0;
+}
+
+static int apply_hello(struct aggregator *input_aggregator, struct aggregator_connection *connection, struct wire_reader *reader) {
+    char name[AGENT_HOST_NAME_MAX];
+    uint64_t version;
+
+    if (connection->host != NULL || wire_get_varint(reader, &version) < 0 || version != AGENT_PROTOCOL_VERSION ||
+        wire_get_string(reader, name, sizeof(name)) < 0 || name[0] == '\0') {
+        return -1;
+    }
+
+    struct aggregator_host *host = find_host(input_aggregator, name);
+    if (host == NULL) {
+        return -1;
+    }
+
+    /* the newest connection of a host wins; the one it replaces is closed on its next frame */
+    if (host->connection != NULL) {
+        host->connection->host = NULL;
+    }
+
+    host->connection = connection;
+    host->point_count = 0;
+    host->clock_offset_flag = 0;
+    connection->host = host;
+
+    return 0;
+}
+
+static int apply_ports(struct aggregator_host *host, struct wire_reader *reader) {
+    struct aggregator_port *ports = NULL;
+    char (*counter_names)[IB_DEVICE_NAME_MAX] = NULL;
+    int *counter_ids = NULL;
+    uint64_t *point_counters = NULL;
+    struct sample_codec codec = {0};
+    uint64_t port_count;
+    uint64_t counter_count;
+
+    if (wire_get_varint(reader, &port_count) < 0 || port_count == 0 || port_count > AGENT_PORT_MAX) {
+        return -1;
+    }
+
+    ports = calloc((size_t)port_count, sizeof(*ports));
+    if (ports == NULL) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < port_count; ++i) {
+        char port_name[IB_DEVICE_NAME_MAX];
+        uint64_t lid;
+
+        if (wire_get_string(reader, port_name, sizeof(port_name)) < 0 || wire_get_string(reader, ports[i].rate, sizeof(ports[i].rate)) < 0 ||
+            wire_get_varint(reader, &lid) < 0 || lid > UINT32_MAX || wire_get_byte(reader, &ports[i].link_layer) < 0) {
+            goto handle_error;
+        }
+
+        snprintf(ports[i].name, sizeof(ports[i].name), "%s/%.*s", host->name, (int)(sizeof(ports[i].name) - strlen(host->name) - 2), port_name);
+        ports[i].lid = (uint32_t)lid;
+    }
+
+    if (wire_get_varint(reader, &counter_count) < 0 || counter_count > AGENT_COUNTER_MAX) {
+        goto handle_error;
+    }
+
+    counter_names = calloc((size_t)counter_count + 1, sizeof(*counter_names));
+    counter_ids = calloc((size_t)counter_count + 1, sizeof(*counter_ids));
+    point_counters = calloc(POINT_COUNT * (size_t)(counter_count * port_count) + 1, sizeof(*point_counters));
+    if (counter_names == NULL || counter_ids == NULL || point_counters == NULL || codec_init(&codec, (size_t)port_count, (size_t)counter_count) < 0) {
+        goto handle_error;
+    }
+
+    for (size_t k = 0; k < counter_count; ++k) {
+        if (wire_get_string(reader, counter_names[k], sizeof(counter_names[k])) < 0) {
+            goto handle_error;
+        }
+    }
+
+    free_host_ports(host);
+    host->ports = ports;
+    host->port_count = (size_t)port_count;
+    host->counter_names = counter_names;
+    host->counter_ids = counter_ids;
+    host->counter_count = (size_t)counter_count;
+    host->point_counters = point_counters;
+    host->codec = codec;
+    host->interval_ns = 0;
+    host->point_count = 0;
+    host->intern_flag = 1;
+
+    for (size_t p = 0; p < POINT_COUNT; ++p) {
+        host->points[p].counters = point_counters + p * host->counter_count * host->port_count;
+    }
+
+    return 0;
+
+handle_error:
+    free(ports);
+    free(counter_names);
+    free(counter_ids);
+    free(point_counters);
+    codec_free(&codec);
+
+    return -1;
+}
+
+/* keep the newest values as the newest point, opening a new one once the one before is POINT_STEP_NS old */
+static void add_point(struct aggregator_host *host) {
+    size_t before_point = (host->newest_point + POINT_COUNT - 1) % POINT_COUNT;
+
+    if (host->point_count < 2 || host->codec.realtime_ns - host->points[before_point].realtime_ns >= POINT_STEP_NS) {
+        host->newest_point = (host->newest_point + 1) % POINT_COUNT;
+        if (host->point_count < POINT_COUNT) {
+            ++host->point_count;
+        }
+    }
+
+    struct aggregator_point *point = &host->points[host->newest_point];
+    point->realtime_ns = host->codec.realtime_ns;
+    memcpy(point->counters, host->codec.values, host->counter_count * host->port_count * sizeof(uint64_t));
+}
+
+static int apply_sample(struct aggregator_host *host, struct wire_reader *reader) {
+    if (host->ports == NULL) {
+        return -1;
+    }
+
+    int keyframe_flag = host->codec.keyframe_flag;
+    uint64_t last_realtime_ns = host->codec.realtime_ns;
+
+    if (codec_decode(&host->codec, reader) < 0) {
+        return -1;
+    }
+
+    /* follow the longest recent interval, so that jitter does not move the instant a host is shown at */
+    if (keyframe_flag == 0) {
+        uint64_t elapsed_ns = host->codec.realtime_ns - last_realtime_ns;
+        host->interval_ns = elapsed_ns > host->interval_ns ? elapsed_ns : host->interval_ns - (host->interval_ns - elapsed_ns) / 16;
+    }
+
+    add_point(host);
+    host->sample_flag = 1;
+
+    return 0;
+}
+
+/* update the clock offset of a host from the newest sample of the frames that arrived at arrival_realtime_ns */
+static void update_clock_offset(struct aggregator_host *host, uint64_t arrival_realtime_ns) {
+    int64_t offset_ns = (int64_t)(arrival_realtime_ns - host->codec.realtime_ns);
+
+    if (host->clock_offset_flag == 0 || offset_ns < host->clock_offset_ns) {
+        host->clock_offset_ns = offset_ns;
+    } else {
+        host->clock_offset_ns += (offset_ns - host->clock_offset_ns) / 16;
+    }
+
+    host->clock_offset_flag = 1;
+    host->sample_flag = 0;
+}
+
+static uint32_t frame_payload_length(const unsigned char *header) {
+    return (uint32_t)header[0] | (uint32_t)header[1] << 8 | (uint32_t)header[2] << 16 | (uint32_t)header[3] << 24;
+}
+
+static int apply_frame(struct aggregator *input_aggregator, struct aggregator_connection *connection, uint8_t type, struct wire_reader *reader);
+
+/* decompress a BATCH frame and apply the frames it holds, which must be complete */
+static int apply_batch(struct aggregator *input_aggregator, struct aggregator_connection *connection, struct wire_reader *reader) {
+    struct string_buffer *batch = &input_aggregator->batch;
+    uint8_t compression;
+    uint64_t batch_length;
+
+    if (wire_get_byte(reader, &compression) < 0 || wire_get_varint(reader, &batch_length) < 0 || batch_length > AGENT_FRAME_MAX) {
+        return -1;
+    }
+
+    batch->length = 0;
+    if (string_buffer_reserve(batch, (size_t)batch_length) < 0 ||
+        codec_decompress((enum codec_compression)compression, (const char *)reader->data + reader->position, reader->length - reader->position, batch->data, (size_t)batch_length) < 0) {
+        return -1;
+    }
+
+    const unsigned char *data = (const unsigned char *)batch->data;
+    size_t position = 0;
+
+    while (position < batch_length) {
+        const unsigned char *header = data + position;
+
+        if (batch_length - position < FRAME_HEADER_SIZE) {
+            return -1;
+        }
+
+        uint32_t payload_length = frame_payload_length(header);
+        if (batch_length - position - FRAME_HEADER_SIZE < payload_length || header[FRAME_HEADER_SIZE - 1] == AGENT_FRAME_BATCH) {
+            return -1;
+        }
+
+        struct wire_reader frame_reader = {header + FRAME_HEADER_SIZE, payload_length, 0};
+        if (apply_frame(input_aggregator, connection, header[FRAME_HEADER_SIZE - 1], &frame_reader) < 0) {
+            return -1;
+        }
+
+        position += FRAME_HEADER_SIZE + payload_length;
+    }
+
+    return 0;
+}
+
+/* apply one frame under host_mutex; return -1 if the agent broke the protocol */
+static int apply_frame(struct aggregator *input_aggregator, struct aggregator_connection *connection, uint8_t type, struct wire_reader *reader) {
+    switch (type) {
+        case AGENT_FRAME_HELLO:
+            return apply_hello(input_aggregator, connection, reader);
+        case AGENT_FRAME_PORTS:
+            return connection->host != NULL ? apply_ports(connection->host, reader) : -1;
+        case AGENT_FRAME_SAMPLE:
+            return connection->host != NULL ? apply_sample(connection->host, reader) : -1;
+        case AGENT_FRAME_BATCH:
+            return apply_batch(input_aggregator, connection, reader);
+        default:
+            /* frames of later protocol versions are skipped */
+            return 0;
+    }
+}
+
+/* apply every complete frame received so far; return -1 if the agent broke the protocol */
+static int apply_frames(struct aggregator *input_aggregator, struct aggregator_connection *connection) {
+    const unsigned char *data = (const unsigned char *)connection->input.data;
+    size_t length = connection->input.length;
+    size_t position = 0;
+    int ret = 0;
+    uint64_t arrival_realtime_ns = get_realtime_ns();
+
+    pthread_mutex_lock(&input_aggregator->host_mutex);
+
+    while (length - position >= FRAME_HEADER_SIZE) {
+        const unsigned char *header = data + position;
+        uint32_t payload_length = frame_payload_length(header);
+
+        if (payload_length > AGENT_FRAME_MAX) {
+            ret = -1;
+            break;
+        }
+
+        if (length - position - FRAME_HEADER_SIZE < payload_length) {
+            break;
+        }
+
+        struct wire_reader reader = {header + FRAME_HEADER_SIZE, payload_length, 0};
+        if (apply_frame(input_aggregator, connection, header[FRAME_HEADER_SIZE - 1], &reader) < 0) {
+            ret = -1;
+            break;
+        }
+
+        position += FRAME_HEADER_SIZE + payload_length;
+    }
+
+    if (connection->host != NULL && connection->host->sample_flag > 0) {
+        update_clock_offset(connection->host, arrival_realtime_ns);
+    }
+
+    pthread_mutex_unlock(&input_aggregator->host_mutex);
+
+    /* keep the partial frame at the front */
+    memmove(connection->input.data, connection->input.data + position, length - position);
+    connection->input.length = length - position;
+
+    return ret;
+}
+
+static void close_connection(struct aggregator *input_aggregator, struct aggregator_connection *connection) {
+    if (connection->prev != NULL) {
+        connection->prev->next = connection->next;
+    } else {
+        input_aggregator->connections = connection->next;
+    }
+    if (connection->next != NULL) {
+        connection->next->prev = connection->prev;
+    }
+
+    /* the host drops out of the next snapshot */
+    pthread_mutex_lock(&input_aggregator->host_mutex);
+    if (connection->host != NULL) {
+        connection->host->connection = NULL;
+    }
+    pthread_mutex_unlock(&input_aggregator->host_mutex);
+
+    close(connection->fd);
+    string_buffer_free(&connection->input);
+    free(connection);
+    --input_aggregator->connection_count;
+}
+
+static void accept_connections(struct aggregator *input_aggregator) {
+    while (1) {
+        int fd = accept4(input_aggregator->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            return;
+        }
+
+        struct aggregator_connection *connection = NULL;
+        if (input_aggregator->connection_count < MAX_CONNECTIONS) {
+            connection = calloc(1, sizeof(*connection));
+        }
+        if (connection == NULL) {
+            close(fd);
+            continue;
+        }
+
+        connection->fd = fd;
+
+        struct epoll_event event = {.events = EPOLLIN | EPOLLRDHUP, .data.ptr = connection};
+        if (epoll_ctl(input_aggregator->epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) {
+            close(fd);
+            free(connection);
+            continue;
+        }
+
+        connection->next = input_aggregator->connections;
+        if (input_aggregator->connections != NULL) {
+            input_aggregator->connections->prev = connection;
+        }
+        input_aggregator->connections = connection;
+        ++input_aggregator->connection_count;
+    }
+}
+
+/* return 1 when the connection is finished and should be closed */
+static int handle_connection(struct aggregator *input_aggregator, struct aggregator_connection *connection) {
+    /* epoll is level-triggered, so an agent with more to send is back on the next wait */
+    for (int i = 0; i < READ_CHUNKS_PER_EVENT; ++i) {
+        if (string_buffer_reserve(&connection->input, READ_CHUNK_SIZE) < 0) {
+            return 1;
+        }
+
+        ssize_t ret_recv = recv(connection->fd, connection->input.data + connection->input.length, READ_CHUNK_SIZE, 0);
+        if (ret_recv < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : 1;
+        }
+        if (ret_recv == 0) {
+            return 1;
+        }
+
+        connection->input.length += (size_t)ret_recv;
+
+        if (apply_frames(input_aggregator, connection) < 0) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static void *aggregator_main(void *arg) {
+    struct aggregator *input_aggregator = arg;
+    struct epoll_event events[64];
+
+    while (1) {
+        int ret_epoll = epoll_wait(input_aggregator->epoll_fd, events, SIZEOF(events), -1);
+        if (ret_epoll < 0 && errno != EINTR) {
+            break;
+        }
+
+        for (int i = 0; i < ret_epoll; ++i) {
+            if (events[i].data.ptr == WAKE_MARKER) {
+                return NULL;
+            }
+
+            if (events[i].data.ptr == LISTEN_MARKER) {
+                accept_connections(input_aggregator);
+                continue;
+            }
+
+            struct aggregator_connection *connection = events[i].data.ptr;
+            if (handle_connection(input_aggregator, connection) > 0) {
+                close_connection(input_aggregator, connection);
+            }
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * intern the names of a host's ports and counters on the collector thread; -1 if the name table has no room for a port, e.g.: an
+ * agent sending ever new port names. a rate or counter the tables have no room for is shown empty instead
+ */
+static int intern_host_names(struct aggregator_host *host) {
+    for (size_t i = 0; i < host->port_count; ++i) {
+        host->ports[i].name_id = infiniband_intern_interface_name(host->ports[i].name);
+        host->ports[i].rate_id = infiniband_intern_rate_name(host->ports[i].rate);
+        if (host->ports[i].name_id == INTERN_ID_INVALID) {
+            return -1;
+        }
+    }
+
+    for (size_t k = 0; k < host->counter_count; ++k) {
+        host->counter_ids[k] = infiniband_intern_counter_name(host->counter_names[k]);
+    }
+
+    host->intern_flag = 0;
+
+    return 0;
+}
+
+/* copy a host's counters as of realtime_ns, interpolated between the two points around it */
+static void interpolate_host(const struct aggregator_host *host, uint64_t realtime_ns, struct infiniband_metrics *input_infiniband_metrics, size_t offset) {
+    size_t value_count = host->counter_count * host->port_count;
+    const struct aggregator_point *after_point = &host->points[host->newest_point];
+    const struct aggregator_point *before_point = after_point;
+
+    for (size_t n = 1; n < host->point_count && before_point->realtime_ns > realtime_ns; ++n) {
+        after_point = before_point;
+        before_point = &host->points[(host->newest_point + POINT_COUNT - n) % POINT_COUNT];
+    }
+
+    /* before the oldest point or after the newest one, the closest point is used as is */
+    double fraction = 0.0;
+    if (before_point->realtime_ns <= realtime_ns && realtime_ns < after_point->realtime_ns) {
+        fraction = (double)(realtime_ns - before_point->realtime_ns) / (double)(after_point->realtime_ns - before_point->realtime_ns);
+    } else if (before_point->realtime_ns <= realtime_ns) {
+        before_point = after_point;
+    }
+
+    for (size_t j = 0; j < value_count; ++j) {
+        uint64_t value = before_point->counters[j];
+
+        /* a counter that went backwards is reset already at the later point */
+        if (fraction > 0.0 && after_point->counters[j] >= value) {
+            uint64_t delta = after_point->counters[j] - value;
+            uint64_t step = (uint64_t)((double)delta * fraction);
+            value += step < delta ? step : delta;
+        }
+
+        size_t k = j / host->port_count;
+        if (host->counter_ids[k] >= 0) {
+            input_infiniband_metrics->counters[host->counter_ids[k]][offset + j % host->port_count] = value;
+        }
+    }
+}
+
+/*
+ * merge the ports of every connected agent into one snapshot; a collector_read_cb, so the fabric
+ * is sampled, shown and exported like local ports. skip the period until an agent reported
+ */
+int aggregator_read(struct infiniband_metrics *input_infiniband_metrics, void *aggregator) {
+    struct aggregator *input_aggregator = aggregator;
+    size_t port_count = 0;
+
+    pthread_mutex_lock(&input_aggregator->host_mutex);
+
+    for (size_t h = 0; h < input_aggregator->host_count; ++h) {
+        struct aggregator_host *host = input_aggregator->hosts[h];
+
+        if (host->connection != NULL && host->point_count > 0) {
+            /* a host whose ports cannot be named is dropped; its next sample closes the connection */
+            if (host->intern_flag > 0 && intern_host_names(host) < 0) {
+                free_host_ports(host);
+                host->point_count = 0;
+                host->intern_flag = 0;
+                continue;
+            }
+            port_count += host->port_count;
+        }
+    }
+
+    if (port_count == 0) {
+        pthread_mutex_unlock(&input_aggregator->host_mutex);
+        return 0;
+    }
+
+    size_t counter_count = infiniband_counter_count();
+    if (infiniband_metrics_reserve(input_infiniband_metrics, port_count, counter_count) < 0) {
+        pthread_mutex_unlock(&input_aggregator->host_mutex);
+        input_infiniband_metrics->interface_count = -1;
+        return 1;
+    }
+
+    input_infiniband_metrics->counter_count = counter_count;
+    for (size_t k = 0; k < counter_count; ++k) {
+        memset(input_infiniband_metrics->counters[k], 0, port_count * sizeof(uint64_t));
+    }
+
+    uint64_t now_realtime_ns = get_realtime_ns();
+    size_t offset = 0;
+    for (size_t h = 0; h < input_aggregator->host_count; ++h) {
+        struct aggregator_host *host = input_aggregator->hosts[h];
+
+        if (host->connection == NULL || host->point_count == 0) {
+            continue;
+        }
+
+        for (size_t i = 0; i < host->port_count; ++i) {
+            struct interface *port = &input_infiniband_metrics->infiniband[offset + i];
+
+            port->lid = host->ports[i].lid;
+            port->name_id = host->ports[i].name_id;
+            port->rate_id = host->ports[i].rate_id;
+            port->link_layer = host->ports[i].link_layer;
+            port->state = host->codec.states[2 * i];
+            port->phys_state = host->codec.states[2 * i + 1];
+        }
+
+        /* counters the host does not have stay zero */
+        uint64_t shown_realtime_ns = now_realtime_ns - (AGENT_FLUSH_NS + host->interval_ns + POINT_STEP_NS);
+        interpolate_host(host, shown_realtime_ns - (uint64_t)host->clock_offset_ns, input_infiniband_metrics, offset);
+
+        offset += host->port_count;
+    }
+
+    pthread_mutex_unlock(&input_aggregator->host_mutex);
+
+    input_infiniband_metrics->interface_count = (int)port_count;
+    input_infiniband_metrics->timestamp_ns = get_monotonic_ns();
+    input_infiniband_metrics->realtime_ns = now_realtime_ns;
+
+    return 1;
+}
+
+static void aggregator_free(struct aggregator *input_aggregator) {
+    while (input_aggregator->connections != NULL) {
+        close_connection(input_aggregator, input_aggregator->connections);
+    }
+
+    for (size_t h = 0; h < input_aggregator->host_count; ++h) {
+        free_host_ports(input_aggregator->hosts[h]);
+        free(input_aggregator->hosts[h]);
+    }
+    free(input_aggregator->hosts);
+    free(input_aggregator->host_index);
+    string_buffer_free(&input_aggregator->batch);
+
+    if (input_aggregator->listen_fd >= 0) {
+        close(input_aggregator->listen_fd);
+    }
+    if (input_aggregator->epoll_fd >= 0) {
+        close(input_aggregator->epoll_fd);
+    }
+    if (input_aggregator->wake_fd >= 0) {
+        close(input_aggregator->wake_fd);
+    }
+
+    pthread_mutex_destroy(&input_aggregator->host_mutex);
+    free(input_aggregator);
+}
+
+struct aggregator *aggregator_start(const char *listen_address) {
+    struct aggregator *input_aggregator = calloc(1, sizeof(*input_aggregator));
+    if (input_aggregator == NULL) {
+        fprintf(stderr, "ERROR: failed to allocate aggregator\n");
+        return NULL;
+    }
+
+    input_aggregator->epoll_fd = -1;
+    input_aggregator->wake_fd = -1;
+    pthread_mutex_init(&input_aggregator->host_mutex, NULL);
+
+    input_aggregator->listen_fd = open_listen_socket(listen_address);
+    if (input_aggregator->listen_fd < 0) {
+        goto handle_error;
+    }
+
+    input_aggregator->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    input_aggregator->wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (input_aggregator->epoll_fd < 0 || input_aggregator->wake_fd < 0) {
+        fprintf(stderr, "ERROR: failed to create aggregator descriptors: %s\n", strerror(errno));
+        goto handle_error;
+    }
+
+    struct epoll_event listen_event = {.events = EPOLLIN, .data.ptr = LISTEN_MARKER};
+    struct epoll_event wake_event = {.events = EPOLLIN, .data.ptr = WAKE_MARKER};
+    if (epoll_ctl(input_aggregator->epoll_fd, EPOLL_CTL_ADD, input_aggregator->listen_fd, &listen_event) < 0 ||
+        epoll_ctl(input_aggregator->epoll_fd, EPOLL_CTL_ADD, input_aggregator->wake_fd, &wake_event) < 0) {
+        fprintf(stderr, "ERROR: failed to register aggregator descriptors: %s\n", strerror(errno));
+        goto handle_error;
+    }
+
+    if (pthread_create(&input_aggregator->thread, NULL, aggregator_main, input_aggregator) != 0) {
+        fprintf(stderr, "ERROR: failed to create aggregator thread\n");
+        goto handle_error;
+    }
+
+    return input_aggregator;
+
+handle_error:
+    aggregator_free(input_aggregator);
+
+    return NULL;
+}
+
+/* stop serving agents; the collector reading the aggregator must be stopped first */
+void aggregator_stop(struct aggregator *input_aggregator) {
+    uint64_t event_value = 1;
+
+    if (input_aggregator == NULL) {
+        return;
+    }
+
+    if (write(input_aggregator->wake_fd, &event_value, sizeof(event_value)) < 0) {
+        /* the counter is already non-zero, so the thread is woken anyway */
+    }
+
+    pthread_join(input_aggregator->thread, NULL);
+
+    aggregator_free(input_aggregator);
+}
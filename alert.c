@@ -0,0 +1,756 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2025 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <regex.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "alert.h"
+#include "delta.h"
+#include "infiniband.h"
+#include "intern.h"
+#include "utils.h"
+#include "window.h"
+
+extern char **environ;
+
+/* shortest window accepted after "over" */
+#define ALERT_MIN_WINDOW_NS (NSEC_PER_SEC)
+
+/* hook commands running at once; later events wait in a queue, and are dropped while it is full */
+#define ALERT_HOOK_MAX 4
+#define ALERT_QUEUE_MAX 256
+
+/* variables a hook command is given, and the room each has */
+#define ALERT_HOOK_VARIABLES 7
+#define ALERT_VARIABLE_MAX 256
+
+enum alert_metric {
+    ALERT_METRIC_RATE,
+    ALERT_METRIC_INCREASE,
+    ALERT_METRIC_VALUE,
+    ALERT_METRIC_COUNT
+};
+
+enum alert_operator {
+    ALERT_OPERATOR_GREATER,
+    ALERT_OPERATOR_GREATER_EQUAL,
+    ALERT_OPERATOR_LESS,
+    ALERT_OPERATOR_LESS_EQUAL,
+    ALERT_OPERATOR_COUNT
+};
+
+static const char *alert_metrics[ALERT_METRIC_COUNT] = {"rate", "increase", "value"};
+static const char *alert_operators[ALERT_OPERATOR_COUNT] = {">", ">=", "<", "<="};
+
+struct alert_rule {
+    char name[ALERT_NAME_MAX];
+    char condition[ALERT_CONDITION_MAX];
+
+    /* group of the rule's counter */
+    size_t group;
+
+    enum alert_metric metric;
+    enum alert_operator op;
+    double threshold;
+
+    /* 0 evaluates the interval since the previous sample */
+    uint64_t window_ns;
+
+    /* the rule only applies to ports whose name matches, if ports_flag is set */
+    regex_t ports;
+    int ports_flag;
+};
+
+/* rules on the same counter, which share its delta */
+struct alert_group {
+    char counter_name[INTERN_STRING_MAX];
+
+    /* catalog id; -1 for an extended counter no sample has carried yet */
+    int counter;
+
+    size_t rule_count;
+    size_t rules[ALERT_RULE_MAX];
+};
+
+/* a rule on one port */
+struct alert_state {
+    struct window_ring ring;
+
+    /* increases the window holds, in total and per slot */
+    uint64_t sum;
+    uint64_t slots[WINDOW_SLOT_COUNT];
+
+    int active_flag;
+};
+
+struct alert_port {
+    /* timestamp of the newest sample; an older one (e.g.: a replay seeking back) starts over */
+    uint64_t timestamp_ns;
+
+    /* timestamp the port has been watched since; a window is only full after its duration */
+    uint64_t start_ns;
+
+    /* rules raised on the port */
+    int active_count;
+
+    /* whether each rule applies to the port, from its ports pattern */
+    unsigned char applies[ALERT_RULE_MAX];
+
+    /*
+     * rules of each group whose outcome may change while the counter does not: a window still
+     * holding increases, or a rule not evaluated yet. a group is skipped if the counter stood
+     * still and it has none, so a sample costs the rules whose counter moved
+     */
+    unsigned char unsettled[ALERT_RULE_MAX];
+
+    /* states[rule] */
+    struct alert_state states[];
+};
+
+struct alerts {
+    struct alert_rule rules[ALERT_RULE_MAX];
+    size_t rule_count;
+
+    struct alert_group groups[ALERT_RULE_MAX];
+    size_t group_count;
+
+    /* counter ids below this were matched against the groups' counter names */
+    size_t resolved_count;
+
+    /* per interface name id, allocated when the port first has a previous sample */
+    struct alert_port **ports;
+    size_t port_capacity;
+
+    /* ports with at least one rule raised */
+    size_t active_port_count;
+
+    /* position of every interface name id in the previous snapshot */
+    int *prev_positions;
+    size_t prev_positions_size;
+
+    /* events of the last alerts_update() */
+    struct alert_event *events;
+    size_t event_count;
+    size_t event_capacity;
+
+    /* shell command run per event, if not NULL, the ones running and the events waiting for them */
+    char *command;
+    pid_t hooks[ALERT_HOOK_MAX];
+    size_t hook_count;
+    struct alert_event queue[ALERT_QUEUE_MAX];
+    size_t queue_head;
+    size_t queue_count;
+};
+
+/* group of counter_name, added if the rules have none yet */
+static size_t rule_group(struct alerts *input_alerts, const char *counter_name) {
+    for (size_t g = 0; g < input_alerts->group_count; ++g) {
+        if (strcmp(input_alerts->groups[g].counter_name, counter_name) == 0) {
+            return g;
+        }
+    }
+
+    struct alert_group *group = &input_alerts->groups[input_alerts->group_count];
+    snprintf(group->counter_name, sizeof(group->counter_name), "%s", counter_name);
+
+    /* the standard counters are known up front, the extended ones once sampled */
+    group->counter = -1;
+    for (int k = 0; k < IB_COUNTER_COUNT; ++k) {
+        if (strcmp(infiniband_counter_name((enum infiniband_counter)k), counter_name) == 0) {
+            group->counter = k;
+        }
+    }
+
+    return input_alerts->group_count++;
+}
+
+/*
+ * parse one line of a rules file, split into its tokens:
+ * <name> <counter> rate|increase|value <operator> <threshold> [over <window>] [ports <regex>]
+ */
+static int parse_rule(struct alerts *input_alerts, char **tokens, size_t token_count, const char *path, unsigned int line_number) {
+    struct alert_rule *rule = &input_alerts->rules[input_alerts->rule_count];
+
+    if (token_count < 5 || token_count % 2 == 0) {
+        fprintf(stderr, "ERROR: %s:%u: expected <name> <counter> rate|increase|value <operator> <threshold> [over <window>] [ports <regex>]\n", path, line_number);
+        return -1;
+    }
+
+    if (input_alerts->rule_count == ALERT_RULE_MAX) {
+        fprintf(stderr, "ERROR: %s:%u: more than %d rules\n", path, line_number, ALERT_RULE_MAX);
+        return -1;
+    }
+
+    if (strlen(tokens[0]) >= sizeof(rule->name)) {
+        fprintf(stderr, "ERROR: %s:%u: rule name longer than %zu characters: %s\n", path, line_number, sizeof(rule->name) - 1, tokens[0]);
+        return -1;
+    }
+
+    for (size_t r = 0; r < input_alerts->rule_count; ++r) {
+        if (strcmp(input_alerts->rules[r].name, tokens[0]) == 0) {
+            fprintf(stderr, "ERROR: %s:%u: duplicate rule name: %s\n", path, line_number, tokens[0]);
+            return -1;
+        }
+    }
+
+    if (strlen(tokens[1]) >= INTERN_STRING_MAX) {
+        fprintf(stderr, "ERROR: %s:%u: counter name longer than %d characters: %s\n", path, line_number, INTERN_STRING_MAX - 1, tokens[1]);
+        return -1;
+    }
+
+    size_t metric = 0;
+    while (metric < ALERT_METRIC_COUNT && strcmp(tokens[2], alert_metrics[metric]) != 0) {
+        ++metric;
+    }
+
+    size_t op = 0;
+    while (op < ALERT_OPERATOR_COUNT && strcmp(tokens[3], alert_operators[op]) != 0) {
+        ++op;
+    }
+
+    if (metric == ALERT_METRIC_COUNT) {
+        fprintf(stderr, "ERROR: %s:%u: expected rate, increase or value: %s\n", path, line_number, tokens[2]);
+        return -1;
+    }
+
+    if (op == ALERT_OPERATOR_COUNT) {
+        fprintf(stderr, "ERROR: %s:%u: expected >, >=, < or <=: %s\n", path, line_number, tokens[3]);
+        return -1;
+    }
+
+    char *end;
+    errno = 0;
+    rule->threshold = strtod(tokens[4], &end);
+    if (errno != 0 || end == tokens[4] || *end != '\0' || !isfinite(rule->threshold)) {
+        fprintf(stderr, "ERROR: %s:%u: invalid threshold: %s\n", path, line_number, tokens[4]);
+        return -1;
+    }
+
+    rule->metric = (enum alert_metric)metric;
+    rule->op = (enum alert_operator)op;
+    rule->window_ns = 0;
+    rule->ports_flag = 0;
+
+    const char *ports_pattern = NULL;
+    for (size_t t = 5; t < token_count; t += 2) {
+        if (strcmp(tokens[t], "over") == 0 && rule->window_ns == 0 && rule->metric != ALERT_METRIC_VALUE) {
+            if (parse_duration_ns(tokens[t + 1], &rule->window_ns) < 0 || rule->window_ns < ALERT_MIN_WINDOW_NS) {
+                fprintf(stderr, "ERROR: %s:%u: window must be a duration of at least 1s: %s\n", path, line_number, tokens[t + 1]);
+                return -1;
+            }
+        } else if (strcmp(tokens[t], "ports") == 0 && ports_pattern == NULL) {
+            ports_pattern = tokens[t + 1];
+        } else {
+            fprintf(stderr, "ERROR: %s:%u: unexpected %s; a value rule takes no window, and over and ports are given at most once\n", path, line_number, tokens[t]);
+            return -1;
+        }
+    }
+
+    /* events carry the condition as written, with single spaces */
+    size_t length = 0;
+    rule->condition[0] = '\0';
+    for (size_t t = 1; t < token_count && length < sizeof(rule->condition); ++t) {
+        int ret_snprintf = snprintf(rule->condition + length, sizeof(rule->condition) - length, "%s%s", t > 1 ? " " : "", tokens[t]);
+        length = ret_snprintf < 0 ? sizeof(rule->condition) : length + (size_t)ret_snprintf;
+    }
+
+    if (length >= sizeof(rule->condition)) {
+        fprintf(stderr, "ERROR: %s:%u: condition longer than %d characters\n", path, line_number, ALERT_CONDITION_MAX - 1);
+        return -1;
+    }
+
+    /* compiled last, so a rule that fails to parse holds no pattern */
+    if (ports_pattern != NULL) {
+        if (regcomp(&rule->ports, ports_pattern, REG_EXTENDED | REG_NOSUB) != 0) {
+            fprintf(stderr, "ERROR: %s:%u: invalid ports pattern: %s\n", path, line_number, ports_pattern);
+            return -1;
+        }
+        rule->ports_flag = 1;
+    }
+
+    snprintf(rule->name, sizeof(rule->name), "%s", tokens[0]);
+
+    struct alert_group *group = &input_alerts->groups[rule_group(input_alerts, tokens[1])];
+    rule->group = (size_t)(group - input_alerts->groups);
+    group->rules[group->rule_count++] = input_alerts->rule_count++;
+
+    return 0;
+}
+
+/* load the rules of path, one per line with # starting a comment; command, if not NULL, is run per event */
+struct alerts *alerts_load(const char *path, const char *command) {
+    FILE *rules_file = fopen(path, "r");
+    if (rules_file == NULL) {
+        fprintf(stderr, "ERROR: failed to open rules file %s: %s\n", path, strerror(errno));
+        return NULL;
+    }
+
+    struct alerts *new_alerts = calloc(1, sizeof(*new_alerts));
+    if (new_alerts == NULL || (command != NULL && (new_alerts->command = strdup(command)) == NULL)) {
+        fprintf(stderr, "ERROR: failed to allocate alert rules\n");
+        fclose(rules_file);
+        alerts_free(new_alerts);
+        return NULL;
+    }
+
+    char *line = NULL;
+    size_t line_size = 0;
+    unsigned int line_number = 0;
+    int ret = 0;
+
+    while (ret == 0 && getline(&line, &line_size, rules_file) >= 0) {
+        char *tokens[10];
+        size_t token_count = 0;
+        char *saveptr;
+
+        ++line_number;
+        line[strcspn(line, "#")] = '\0';
+
+        for (char *token = strtok_r(line, " \t\r\n", &saveptr); token != NULL; token = strtok_r(NULL, " \t\r\n", &saveptr)) {
+            if (token_count == SIZEOF(tokens)) {
+                break;
+            }
+            tokens[token_count++] = token;
+        }
+
+        if (token_count > 0) {
+            ret = parse_rule(new_alerts, tokens, token_count, path, line_number);
+        }
+    }
+
+    if (ret == 0 && ferror(rules_file)) {
+        fprintf(stderr, "ERROR: failed to read rules file %s\n", path);
+        ret = -1;
+    }
+
+    if (ret == 0 && new_alerts->rule_count == 0) {
+        fprintf(stderr, "ERROR: no rules in %s\n", path);
+        ret = -1;
+    }
+
+    free(line);
+    fclose(rules_file);
+
+    if (ret < 0) {
+        alerts_free(new_alerts);
+        return NULL;
+    }
+
+    return new_alerts;
+}
+
+/* match the extended counters sampled since the last call against the groups still waiting for theirs */
+static void resolve_groups(struct alerts *input_alerts, size_t counter_count) {
+    size_t first = input_alerts->resolved_count > IB_COUNTER_COUNT ? input_alerts->resolved_count : IB_COUNTER_COUNT;
+
+    for (size_t k = first; k < counter_count; ++k) {
+        const char *counter_name = infiniband_counter_name((enum infiniband_counter)k);
+
+        for (size_t g = 0; g < input_alerts->group_count; ++g) {
+            if (input_alerts->groups[g].counter < 0 && strcmp(input_alerts->groups[g].counter_name, counter_name) == 0) {
+                input_alerts->groups[g].counter = (int)k;
+            }
+        }
+    }
+
+    if (counter_count > input_alerts->resolved_count) {
+        input_alerts->resolved_count = counter_count;
+    }
+}
+
+/* forget everything seen on port, without events, and watch it again from start_ns */
+static void reset_port(struct alerts *input_alerts, struct alert_port *port, uint64_t start_ns) {
+    if (port->active_count > 0) {
+        --input_alerts->active_port_count;
+    }
+
+    port->start_ns = start_ns;
+    port->active_count = 0;
+    memset(port->states, 0, input_alerts->rule_count * sizeof(struct alert_state));
+
+    /* every rule that applies is evaluated on the next sample */
+    memset(port->unsettled, 0, sizeof(port->unsettled));
+    for (size_t r = 0; r < input_alerts->rule_count; ++r) {
+        port->unsettled[input_alerts->rules[r].group] = (unsigned char)(port->unsettled[input_alerts->rules[r].group] + port->applies[r]);
+    }
+}
+
+static struct alert_port *alert_port_get(struct alerts *input_alerts, uint16_t name_id, uint64_t start_ns) {
+    if (name_id >= input_alerts->port_capacity) {
+        size_t new_capacity = infiniband_interface_id_count();
+        if (name_id >= new_capacity) {
+            return NULL;
+        }
+
+        struct alert_port **new_ports = realloc(input_alerts->ports, new_capacity * sizeof(*new_ports));
+        if (new_ports == NULL) {
+            return NULL;
+        }
+
+        memset(new_ports + input_alerts->port_capacity, 0, (new_capacity - input_alerts->port_capacity) * sizeof(*new_ports));
+        input_alerts->ports = new_ports;
+        input_alerts->port_capacity = new_capacity;
+    }
+
+    if (input_alerts->ports[name_id] == NULL) {
+        struct alert_port *port = calloc(1, sizeof(struct alert_port) + input_alerts->rule_count * sizeof(struct alert_state));
+        if (port == NULL) {
+            return NULL;
+        }
+
+        /* names never change, so the patterns are matched once */
+        for (size_t r = 0; r < input_alerts->rule_count; ++r) {
+            const struct alert_rule *rule = &input_alerts->rules[r];
+            port->applies[r] = rule->ports_flag == 0 || regexec(&rule->ports, infiniband_interface_name(name_id), 0, NULL, 0) == 0;
+        }
+
+        reset_port(input_alerts, port, start_ns);
+        input_alerts->ports[name_id] = port;
+    }
+
+    return input_alerts->ports[name_id];
+}
+
+/* a window_expire_cb */
+static void expire_slot(void *ctx, size_t k) {
+    struct alert_state *state = ctx;
+
+    state->sum -= state->slots[k];
+    state->slots[k] = 0;
+}
+
+/* add delta at now_ns to the window of rule and return the increases it holds */
+static uint64_t window_add(const struct alert_rule *rule, struct alert_state *state, uint64_t now_ns, uint64_t delta) {
+    state->slots[window_advance(&state->ring, rule->window_ns, now_ns, expire_slot, state)] += delta;
+    state->sum += delta;
+
+    return state->sum;
+}
+
+static int rule_holds(const struct alert_rule *rule, double value) {
+    switch (rule->op) {
+        case ALERT_OPERATOR_GREATER:
+            return value > rule->threshold;
+        case ALERT_OPERATOR_GREATER_EQUAL:
+            return value >= rule->threshold;
+        case ALERT_OPERATOR_LESS:
+            return value < rule->threshold;
+        default:
+            return value <= rule->threshold;
+    }
+}
+
+static int add_event(struct alerts *input_alerts, const struct infiniband_metrics *cur_metrics, int i, const struct alert_rule *rule, int active_flag, double value) {
+    if (input_alerts->event_count == input_alerts->event_capacity) {
+        size_t new_capacity = input_alerts->event_capacity > 0 ? input_alerts->event_capacity * 2 : 16;
+        struct alert_event *new_events = realloc(input_alerts->events, new_capacity * sizeof(*new_events));
+        if (new_events == NULL) {
+            return -1;
+        }
+
+        input_alerts->events = new_events;
+        input_alerts->event_capacity = new_capacity;
+    }
+
+    struct alert_event *event = &input_alerts->events[input_alerts->event_count++];
+    event->timestamp_ns = cur_metrics->timestamp_ns;
+    event->realtime_ns = cur_metrics->realtime_ns;
+    event->name_id = cur_metrics->infiniband[i].name_id;
+    event->active_flag = active_flag;
+    event->value = value;
+    event->rule = rule->name;
+    event->counter = input_alerts->groups[rule->group].counter_name;
+    event->condition = rule->condition;
+
+    return 0;
+}
+
+/*
+ * evaluate the rules of group on the port at position i of cur_metrics, whose counter advanced by
+ * delta in elapsed_ns, and record the rules that start or stop to hold
+ */
+static int evaluate_group(struct alerts *input_alerts, struct alert_port *port, size_t g, const struct infiniband_metrics *cur_metrics, int i, uint64_t elapsed_ns,
+                          uint64_t delta, uint64_t value) {
+    const struct alert_group *group = &input_alerts->groups[g];
+    uint64_t now_ns = cur_metrics->timestamp_ns;
+    unsigned char unsettled = 0;
+
+    for (size_t k = 0; k < group->rule_count; ++k) {
+        size_t r = group->rules[k];
+        const struct alert_rule *rule = &input_alerts->rules[r];
+        struct alert_state *state = &port->states[r];
+
+        if (port->applies[r] == 0) {
+            continue;
+        }
+
+        double input;
+        int settled_flag;
+
+        if (rule->metric == ALERT_METRIC_VALUE) {
+            input = (double)value;
+            settled_flag = 1;
+        } else if (rule->window_ns > 0) {
+            uint64_t sum = window_add(rule, state, now_ns, delta);
+            input = rule->metric == ALERT_METRIC_RATE ? (double)sum / ((double)rule->window_ns / 1e9) : (double)sum;
+            settled_flag = sum == 0;
+
+            /* a window not full yet only underestimates, which can raise a > rule but not a < one */
+            if ((rule->op == ALERT_OPERATOR_LESS || rule->op == ALERT_OPERATOR_LESS_EQUAL) && now_ns - port->start_ns < rule->window_ns) {
+                ++unsettled;
+                continue;
+            }
+        } else {
+            input = rule->metric == ALERT_METRIC_RATE ? (double)delta / ((double)elapsed_ns / 1e9) : (double)delta;
+            settled_flag = delta == 0;
+        }
+
+        if (settled_flag == 0) {
+            ++unsettled;
+        }
+
+        int active_flag = rule_holds(rule, input);
+        if (active_flag == state->active_flag) {
+            continue;
+        }
+
+        state->active_flag = active_flag;
+        port->active_count += active_flag > 0 ? 1 : -1;
+        if (port->active_count == (active_flag > 0 ? 1 : 0)) {
+            input_alerts->active_port_count = active_flag > 0 ? input_alerts->active_port_count + 1 : input_alerts->active_port_count - 1;
+        }
+
+        if (add_event(input_alerts, cur_metrics, i, rule, active_flag, input) < 0) {
+            return -1;
+        }
+    }
+
+    port->unsettled[g] = unsettled;
+
+    return 0;
+}
+
+static int evaluate_rules(struct alerts *input_alerts, const struct infiniband_metrics *cur_metrics, const struct infiniband_metrics *prev_metrics) {
+    if (infiniband_metrics_positions(prev_metrics, &input_alerts->prev_positions, &input_alerts->prev_positions_size) < 0) {
+        return -1;
+    }
+
+    resolve_groups(input_alerts, cur_metrics->counter_count);
+
+    uint64_t now_ns = cur_metrics->timestamp_ns;
+    uint64_t elapsed_ns = now_ns - prev_metrics->timestamp_ns;
+
+    for (int i = 0; i < cur_metrics->interface_count; ++i) {
+        int j = input_alerts->prev_positions[cur_metrics->infiniband[i].name_id];
+        if (j < 0) {
+            continue;
+        }
+
+        struct alert_port *port = alert_port_get(input_alerts, cur_metrics->infiniband[i].name_id, prev_metrics->timestamp_ns);
+        if (port == NULL) {
+            return -1;
+        }
+
+        if (window_starts_over(&port->timestamp_ns, now_ns)) {
+            reset_port(input_alerts, port, prev_metrics->timestamp_ns);
+        }
+
+        double link_gbps = infiniband_rate_gbps(cur_metrics->infiniband[i].rate_id);
+        unsigned int port_flags = port_delta_flags(cur_metrics, prev_metrics, i, j);
+
+        for (size_t g = 0; g < input_alerts->group_count; ++g) {
+            int counter = input_alerts->groups[g].counter;
+            if (counter < 0 || (size_t)counter >= prev_metrics->counter_count) {
+                continue;
+            }
+
+            uint64_t cur_value = cur_metrics->counters[counter][i];
+            uint64_t prev_value = prev_metrics->counters[counter][j];
+            if (cur_value == prev_value && port->unsettled[g] == 0) {
+                continue;
+            }
+
+            /* a delta that does not describe the interval counts as no increase */
+            uint64_t delta;
+            unsigned int flags = port_flags | counter_delta((enum infiniband_counter)counter, cur_value, prev_value, elapsed_ns, link_gbps, &delta);
+            if (flags & DELTA_UNUSABLE) {
+                delta = 0;
+            }
+
+            if (evaluate_group(input_alerts, port, g, cur_metrics, i, elapsed_ns, delta, cur_value) < 0) {
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/* run the hook command for event with its details in IBTM_* variables; output is discarded */
+static pid_t spawn_hook(const struct alerts *input_alerts, const struct alert_event *event) {
+    char variables[ALERT_HOOK_VARIABLES][ALERT_VARIABLE_MAX];
+    snprintf(variables[0], ALERT_VARIABLE_MAX, "IBTM_ALERT=%s", event->rule);
+    snprintf(variables[1], ALERT_VARIABLE_MAX, "IBTM_STATE=%s", event->active_flag > 0 ? "raised" : "cleared");
+    snprintf(variables[2], ALERT_VARIABLE_MAX, "IBTM_INTERFACE=%s", infiniband_interface_name(event->name_id));
+    snprintf(variables[3], ALERT_VARIABLE_MAX, "IBTM_COUNTER=%s", event->counter);
+    snprintf(variables[4], ALERT_VARIABLE_MAX, "IBTM_VALUE=%.3f", event->value);
+    snprintf(variables[5], ALERT_VARIABLE_MAX, "IBTM_CONDITION=%s", event->condition);
+    snprintf(variables[6], ALERT_VARIABLE_MAX, "IBTM_REALTIME_NS=%llu", (unsigned long long)event->realtime_ns);
+
+    /* the IBTM_* variables come first, so they win over inherited ones */
+    size_t environ_count = 0;
+    while (environ[environ_count] != NULL) {
+        ++environ_count;
+    }
+
+    char **envp = malloc((ALERT_HOOK_VARIABLES + environ_count + 1) * sizeof(*envp));
+    if (envp == NULL) {
+        return -1;
+    }
+
+    for (size_t k = 0; k < ALERT_HOOK_VARIABLES; ++k) {
+        envp[k] = variables[k];
+    }
+    memcpy(envp + ALERT_HOOK_VARIABLES, environ, (environ_count + 1) * sizeof(*envp));
+
+    /* the signals blocked for sigwaitinfo() would stay blocked in the command */
+    sigset_t signal_empty_set;
+    posix_spawnattr_t attr;
+    posix_spawn_file_actions_t file_actions;
+    pid_t pid = -1;
+
+    if (sigemptyset(&signal_empty_set) == 0 && posix_spawnattr_init(&attr) == 0) {
+        if (posix_spawn_file_actions_init(&file_actions) == 0) {
+            char shell_name[] = "sh";
+            char command_flag[] = "-c";
+            char *argv[] = {shell_name, command_flag, input_alerts->command, NULL};
+
+            if (posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK) == 0 && posix_spawnattr_setsigmask(&attr, &signal_empty_set) == 0 &&
+                posix_spawn_file_actions_addopen(&file_actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0) == 0 &&
+                posix_spawn_file_actions_addopen(&file_actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0) == 0 &&
+                posix_spawn_file_actions_addopen(&file_actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0) == 0 &&
+                posix_spawn(&pid, "/bin/sh", &file_actions, &attr, argv, envp) != 0) {
+                pid = -1;
+            }
+
+            posix_spawn_file_actions_destroy(&file_actions);
+        }
+        posix_spawnattr_destroy(&attr);
+    }
+
+    free(envp);
+
+    return pid;
+}
+
+/* reap the hook commands that exited, queue the new events and start as many waiting ones as there is room for */
+static void run_hooks(struct alerts *input_alerts) {
+    for (size_t k = 0; k < input_alerts->hook_count;) {
+        if (waitpid(input_alerts->hooks[k], NULL, WNOHANG) != 0) {
+            input_alerts->hooks[k] = input_alerts->hooks[--input_alerts->hook_count];
+        } else {
+            ++k;
+        }
+    }
+
+    for (size_t e = 0; e < input_alerts->event_count && input_alerts->queue_count < ALERT_QUEUE_MAX; ++e) {
+        input_alerts->queue[(input_alerts->queue_head + input_alerts->queue_count++) % ALERT_QUEUE_MAX] = input_alerts->events[e];
+    }
+
+    /* an event whose command fails to start is not retried */
+    while (input_alerts->queue_count > 0 && input_alerts->hook_count < ALERT_HOOK_MAX) {
+        pid_t pid = spawn_hook(input_alerts, &input_alerts->queue[input_alerts->queue_head]);
+
+        input_alerts->queue_head = (input_alerts->queue_head + 1) % ALERT_QUEUE_MAX;
+        --input_alerts->queue_count;
+
+        if (pid > 0) {
+            input_alerts->hooks[input_alerts->hook_count++] = pid;
+        }
+    }
+}
+
+/*
+ * evaluate the rules on the change between prev_metrics and cur_metrics; prev_metrics may be NULL.
+ * the rules that start or stop to hold are the events until the next call
+ */
+int alerts_update(struct alerts *input_alerts, const struct infiniband_metrics *cur_metrics, const struct infiniband_metrics *prev_metrics) {
+    input_alerts->event_count = 0;
+
+    if (prev_metrics != NULL && cur_metrics->timestamp_ns > prev_metrics->timestamp_ns && evaluate_rules(input_alerts, cur_metrics, prev_metrics) < 0) {
+        return -1;
+    }
+
+    if (input_alerts->command != NULL) {
+        run_hooks(input_alerts);
+    }
+
+    return 0;
+}
+
+size_t alerts_event_count(const struct alerts *input_alerts) {
+    return input_alerts->event_count;
+}
+
+const struct alert_event *alerts_event(const struct alerts *input_alerts, size_t index) {
+    return &input_alerts->events[index];
+}
+
+/* number of rules raised on the interface with name_id */
+int alerts_port_active(const struct alerts *input_alerts, uint16_t name_id) {
+    if (name_id >= input_alerts->port_capacity || input_alerts->ports[name_id] == NULL) {
+        return 0;
+    }
+
+    return input_alerts->ports[name_id]->active_count;
+}
+
+size_t alerts_active_port_count(const struct alerts *input_alerts) {
+    return input_alerts->active_port_count;
+}
+
+/* hook commands still running are left to finish on their own */
+void alerts_free(struct alerts *input_alerts) {
+    if (input_alerts == NULL) {
+        return;
+    }
+
+    for (size_t r = 0; r < input_alerts->rule_count; ++r) {
+        if (input_alerts->rules[r].ports_flag > 0) {
+            regfree(&input_alerts->rules[r].ports);
+        }
+    }
+
+    for (size_t i = 0; i < input_alerts->port_capacity; ++i) {
+        free(input_alerts->ports[i]);
+    }
+
+    free(input_alerts->ports);
+    free(input_alerts->prev_positions);
+    free(input_alerts->events);
+    free(input_alerts->command);
+    free(input_alerts);
+}
@@ -0,0 +1,62 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2025 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ALERT_H
+#define ALERT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "infiniband.h"
+
+/* at most this many rules can be loaded at once */
+#define ALERT_RULE_MAX 64
+
+/* longest rule name, and longest condition as written in the rules file */
+#define ALERT_NAME_MAX 32
+#define ALERT_CONDITION_MAX 160
+
+/* a rule starting or stopping to hold on a port */
+struct alert_event {
+    /* CLOCK_MONOTONIC and CLOCK_REALTIME time of the sample the rule was evaluated on */
+    uint64_t timestamp_ns;
+    uint64_t realtime_ns;
+
+    uint16_t name_id;
+
+    /* 1 if the rule started to hold (raised), 0 if it stopped (cleared) */
+    int active_flag;
+
+    /* rate, increase or counter value the rule was evaluated on */
+    double value;
+
+    /* owned by the rule set and valid until alerts_free() */
+    const char *rule;
+    const char *counter;
+    const char *condition;
+};
+
+struct alerts;
+
+extern struct alerts *alerts_load(const char *path, const char *command);
+extern int alerts_update(struct alerts *input_alerts, const struct infiniband_metrics *cur_metrics, const struct infiniband_metrics *prev_metrics);
+extern size_t alerts_event_count(const struct alerts *input_alerts);
+extern const struct alert_event *alerts_event(const struct alerts *input_alerts, size_t index);
+extern int alerts_port_active(const struct alerts *input_alerts, uint16_t name_id);
+extern size_t alerts_active_port_count(const struct alerts *input_alerts);
+extern void alerts_free(struct alerts *input_alerts);
+
+#endif /* ALERT_H */
@@ -0,0 +1,291 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2025 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_LZ4
+#include <lz4.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+#include "codec.h"
+#include "utils.h"
+#include "wire.h"
+
+/* zstd level; the fast end, as blocks are compressed on the collector thread */
+#define CODEC_ZSTD_LEVEL 1
+
+/* size the codec for port_count ports of counter_count counters and reset it; may be called again to resize */
+int codec_init(struct sample_codec *codec, size_t port_count, size_t counter_count) {
+    size_t value_count = port_count * counter_count;
+
+    /* one allocation: the values, deltas and next values, then both state arrays */
+    void *storage = realloc(codec->values, 3 * value_count * sizeof(uint64_t) + 4 * port_count + 1);
+    if (storage == NULL) {
+        return -1;
+    }
+
+    codec->port_count = port_count;
+    codec->counter_count = counter_count;
+    codec->values = storage;
+    codec->deltas = codec->values + value_count;
+    codec->next_values = codec->deltas + value_count;
+    codec->states = (uint8_t *)(codec->next_values + value_count);
+    codec->next_states = codec->states + 2 * port_count;
+
+    codec_reset(codec);
+
+    return 0;
+}
+
+/* code the next sample as a keyframe */
+void codec_reset(struct sample_codec *codec) {
+    size_t value_count = codec->port_count * codec->counter_count;
+
+    codec->realtime_ns = 0;
+    codec->realtime_delta_ns = 0;
+    memset(codec->values, 0, value_count * sizeof(uint64_t));
+    memset(codec->deltas, 0, value_count * sizeof(uint64_t));
+    memset(codec->states, 0, 2 * codec->port_count);
+    codec->keyframe_flag = 1;
+}
+
+void codec_free(struct sample_codec *codec) {
+    free(codec->values);
+    memset(codec, 0, sizeof(*codec));
+}
+
+/* upper bound of the coded size of one sample */
+size_t codec_max_sample_size(size_t port_count, size_t counter_count) {
+    size_t value_count = port_count * counter_count;
+
+    return WIRE_VARINT_MAX + (port_count + 7) / 8 + 2 * port_count + (value_count + 7) / 8 + WIRE_VARINT_MAX * value_count;
+}
+
+/* append the next sample to buffer and make it the last one */
+int codec_encode(struct sample_codec *codec, struct string_buffer *buffer) {
+    size_t port_count = codec->port_count;
+    size_t value_count = port_count * codec->counter_count;
+
+    if (string_buffer_reserve(buffer, codec_max_sample_size(port_count, codec->counter_count)) < 0) {
+        return -1;
+    }
+
+    unsigned char *output = (unsigned char *)buffer->data + buffer->length;
+    size_t length = 0;
+
+    uint64_t realtime_delta_ns = codec->next_realtime_ns - codec->realtime_ns;
+    length += wire_encode_varint(output, wire_zigzag_encode(realtime_delta_ns - codec->realtime_delta_ns));
+    codec->realtime_ns = codec->next_realtime_ns;
+    codec->realtime_delta_ns = codec->keyframe_flag > 0 ? 0 : realtime_delta_ns;
+
+    unsigned char *port_bitmap = output + length;
+    memset(port_bitmap, 0, (port_count + 7) / 8);
+    length += (port_count + 7) / 8;
+
+    for (size_t i = 0; i < port_count; ++i) {
+        if (codec->next_states[2 * i] != codec->states[2 * i] || codec->next_states[2 * i + 1] != codec->states[2 * i + 1]) {
+            port_bitmap[i / 8] |= (unsigned char)(1U << (i % 8));
+            output[length++] = codec->next_states[2 * i];
+            output[length++] = codec->next_states[2 * i + 1];
+        }
+    }
+    memcpy(codec->states, codec->next_states, 2 * port_count);
+
+    unsigned char *value_bitmap = output + length;
+    memset(value_bitmap, 0, (value_count + 7) / 8);
+    length += (value_count + 7) / 8;
+
+    for (size_t j = 0; j < value_count; ++j) {
+        uint64_t delta = codec->next_values[j] - codec->values[j];
+        uint64_t delta_of_delta = delta - codec->deltas[j];
+
+        if (delta_of_delta != 0) {
+            value_bitmap[j / 8] |= (unsigned char)(1U << (j % 8));
+            length += wire_encode_varint(output + length, wire_zigzag_encode(delta_of_delta));
+        }
+
+        codec->values[j] = codec->next_values[j];
+        codec->deltas[j] = codec->keyframe_flag > 0 ? 0 : delta;
+    }
+
+    codec->keyframe_flag = 0;
+    buffer->length += length;
+
+    return 0;
+}
+
+/*
+ * decode only the timestamp at the start of a coded sample, given the timestamp and delta of the one
+ * before; lets record files be searched by time without decoding the counters
+ */
+int codec_decode_realtime(struct wire_reader *reader, uint64_t *realtime_ns, uint64_t *realtime_delta_ns) {
+    uint64_t value;
+
+    if (wire_get_varint(reader, &value) < 0) {
+        return -1;
+    }
+
+    uint64_t delta = *realtime_delta_ns + wire_zigzag_decode(value);
+    *realtime_ns += delta;
+    *realtime_delta_ns = delta;
+
+    return 0;
+}
+
+/* decode one sample into the last one; return -1 if it is truncated */
+int codec_decode(struct sample_codec *codec, struct wire_reader *reader) {
+    size_t port_count = codec->port_count;
+    size_t value_count = port_count * codec->counter_count;
+    uint64_t value;
+
+    if (codec_decode_realtime(reader, &codec->realtime_ns, &codec->realtime_delta_ns) < 0) {
+        return -1;
+    }
+    if (codec->keyframe_flag > 0) {
+        codec->realtime_delta_ns = 0;
+    }
+
+    if (reader->length - reader->position < (port_count + 7) / 8) {
+        return -1;
+    }
+    const unsigned char *port_bitmap = reader->data + reader->position;
+    reader->position += (port_count + 7) / 8;
+
+    for (size_t i = 0; i < port_count; ++i) {
+        if ((port_bitmap[i / 8] & (1U << (i % 8))) != 0 && (wire_get_byte(reader, &codec->states[2 * i]) < 0 || wire_get_byte(reader, &codec->states[2 * i + 1]) < 0)) {
+            return -1;
+        }
+    }
+
+    if (reader->length - reader->position < (value_count + 7) / 8) {
+        return -1;
+    }
+    const unsigned char *value_bitmap = reader->data + reader->position;
+    reader->position += (value_count + 7) / 8;
+
+    for (size_t j = 0; j < value_count; ++j) {
+        uint64_t delta = codec->deltas[j];
+
+        if ((value_bitmap[j / 8] & (1U << (j % 8))) != 0) {
+            if (wire_get_varint(reader, &value) < 0) {
+                return -1;
+            }
+            delta += wire_zigzag_decode(value);
+        }
+
+        codec->values[j] += delta;
+        codec->deltas[j] = codec->keyframe_flag > 0 ? 0 : delta;
+    }
+
+    codec->keyframe_flag = 0;
+
+    return 0;
+}
+
+/* compression new blocks are written with: zstd if built with HAVE_ZSTD, else lz4 if built with HAVE_LZ4 */
+enum codec_compression codec_default_compression(void) {
+#if defined(HAVE_ZSTD)
+    return CODEC_COMPRESSION_ZSTD;
+#elif defined(HAVE_LZ4)
+    return CODEC_COMPRESSION_LZ4;
+#else
+    return CODEC_COMPRESSION_NONE;
+#endif
+}
+
+const char *codec_compression_name(enum codec_compression compression) {
+    switch (compression) {
+        case CODEC_COMPRESSION_LZ4:
+            return "lz4";
+        case CODEC_COMPRESSION_ZSTD:
+            return "zstd";
+        default:
+            return "none";
+    }
+}
+
+/* append data compressed with compression to buffer; return -1 if it fails or the compression is not built in */
+int codec_compress(enum codec_compression compression, const char *data, size_t length, struct string_buffer *buffer) {
+    switch (compression) {
+#ifdef HAVE_LZ4
+        case CODEC_COMPRESSION_LZ4: {
+            if (length > LZ4_MAX_INPUT_SIZE) {
+                return -1;
+            }
+
+            int bound = LZ4_compressBound((int)length);
+            if (string_buffer_reserve(buffer, (size_t)bound) < 0) {
+                return -1;
+            }
+
+            int ret_compress = LZ4_compress_default(data, buffer->data + buffer->length, (int)length, bound);
+            if (ret_compress <= 0) {
+                return -1;
+            }
+
+            buffer->length += (size_t)ret_compress;
+            return 0;
+        }
+#endif
+#ifdef HAVE_ZSTD
+        case CODEC_COMPRESSION_ZSTD: {
+            size_t bound = ZSTD_compressBound(length);
+            if (string_buffer_reserve(buffer, bound) < 0) {
+                return -1;
+            }
+
+            size_t ret_compress = ZSTD_compress(buffer->data + buffer->length, bound, data, length, CODEC_ZSTD_LEVEL);
+            if (ZSTD_isError(ret_compress)) {
+                return -1;
+            }
+
+            buffer->length += ret_compress;
+            return 0;
+        }
+#endif
+        default:
+            (void)data;
+            (void)length;
+            (void)buffer;
+            return -1;
+    }
+}
+
+/* decompress data into exactly output_length bytes; return -1 if it is corrupt or the compression is not built in */
+int codec_decompress(enum codec_compression compression, const char *data, size_t length, char *output, size_t output_length) {
+    switch (compression) {
+#ifdef HAVE_LZ4
+        case CODEC_COMPRESSION_LZ4:
+            if (length > INT32_MAX || output_length > INT32_MAX) {
+                return -1;
+            }
+            return LZ4_decompress_safe(data, output, (int)length, (int)output_length) == (int)output_length ? 0 : -1;
+#endif
+#ifdef HAVE_ZSTD
+        case CODEC_COMPRESSION_ZSTD:
+            return ZSTD_decompress(output, output_length, data, length) == output_length ? 0 : -1;
+#endif
+        default:
+            (void)data;
+            (void)length;
+            (void)output;
+            (void)output_length;
+            return -1;
+    }
+}
@@ -0,0 +1,76 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2025 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CODEC_H
+#define CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "utils.h"
+#include "wire.h"
+
+/*
+ * compact coding of consecutive samples of the same ports and counters, shared by the record file
+ * and the agent stream. a sample is coded against the two before it:
+ *   zigzag varint delta-of-delta of the timestamp
+ *   bitmap of the ports whose state or phys_state changed, then both bytes of each of them
+ *   bitmap of the counters whose delta differs from the one before, then the zigzag varint
+ *   delta-of-delta of each of them
+ * bitmaps take (n + 7) / 8 bytes, lowest bit first. counters at a steady rate cost a byte or two and
+ * idle counters their bit only. after a reset the next sample is coded against zeroes, so it is a
+ * keyframe that decodes on its own
+ */
+struct sample_codec {
+    size_t port_count;
+    size_t counter_count;
+
+    /* the sample to encode, filled in by the caller: states[2 * port] holds state and phys_state */
+    uint64_t next_realtime_ns;
+    uint8_t *next_states;
+    uint64_t *next_values;
+
+    /* the last sample coded, values[counter * port_count + port] */
+    uint64_t realtime_ns;
+    uint8_t *states;
+    uint64_t *values;
+
+    /* what the dod of the next sample is taken against */
+    uint64_t realtime_delta_ns;
+    uint64_t *deltas;
+    int keyframe_flag;
+};
+
+/* block compression of record file blocks and agent batches; which ones are built in is chosen at build time */
+enum codec_compression {
+    CODEC_COMPRESSION_NONE,
+    CODEC_COMPRESSION_LZ4,
+    CODEC_COMPRESSION_ZSTD
+};
+
+extern int codec_init(struct sample_codec *codec, size_t port_count, size_t counter_count);
+extern void codec_reset(struct sample_codec *codec);
+extern void codec_free(struct sample_codec *codec);
+extern size_t codec_max_sample_size(size_t port_count, size_t counter_count);
+extern int codec_encode(struct sample_codec *codec, struct string_buffer *buffer);
+extern int codec_decode(struct sample_codec *codec, struct wire_reader *reader);
+extern int codec_decode_realtime(struct wire_reader *reader, uint64_t *realtime_ns, uint64_t *realtime_delta_ns);
+extern enum codec_compression codec_default_compression(void);
+extern const char *codec_compression_name(enum codec_compression compression);
+extern int codec_compress(enum codec_compression compression, const char *data, size_t length, struct string_buffer *buffer);
+extern int codec_decompress(enum codec_compression compression, const char *data, size_t length, char *output, size_t output_length);
+
+#endif /* CODEC_H */
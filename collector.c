@@ -0,0 +1,245 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2025 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <unistd.h>
+#include "collector.h"
+#include "infiniband.h"
+#include "utils.h"
+
+#define COLLECTOR_RING_MASK (COLLECTOR_RING_SIZE - 1)
+
+/*
+ * single-producer/single-consumer ring of snapshot pointers
+ * the collector thread owns slots in [tail, head) until it publishes head;
+ * the UI thread owns the slot at tail until it publishes tail
+ */
+struct collector {
+    struct infiniband_metrics *slots[COLLECTOR_RING_SIZE];
+
+    /* sample read while the ring is full; it is only seen by the sample callback */
+    struct infiniband_metrics *overflow;
+    _Atomic uint64_t head;
+    _Atomic uint64_t tail;
+
+    /* samples dropped so far; only touched on the collector thread */
+    uint64_t dropped_count;
+
+    uint64_t interval_ns;
+    int event_fd;
+
+    collector_read_cb read_cb;
+    void *read_ctx;
+
+    collector_sample_cb sample_cb;
+    void *sample_ctx;
+
+    pthread_t thread;
+    pthread_mutex_t stop_mutex;
+    pthread_cond_t stop_cond;
+    int stop_flag;
+};
+
+/* sleep until deadline_ns on CLOCK_MONOTONIC; return 1 if the collector is asked to stop */
+static int collector_sleep(struct collector *input_collector, uint64_t deadline_ns) {
+    struct timespec ts = ns_to_timespec(deadline_ns);
+    int stop_flag;
+
+    pthread_mutex_lock(&input_collector->stop_mutex);
+    while (input_collector->stop_flag == 0) {
+        if (pthread_cond_timedwait(&input_collector->stop_cond, &input_collector->stop_mutex, &ts) == ETIMEDOUT) {
+            break;
+        }
+    }
+    stop_flag = input_collector->stop_flag;
+    pthread_mutex_unlock(&input_collector->stop_mutex);
+
+    return stop_flag;
+}
+
+static void *collector_main(void *arg) {
+    struct collector *input_collector = arg;
+    uint64_t next_sample_ns = get_monotonic_ns();
+    uint64_t event_value = 1;
+
+    while (1) {
+        uint64_t head = atomic_load_explicit(&input_collector->head, memory_order_relaxed);
+        uint64_t tail = atomic_load_explicit(&input_collector->tail, memory_order_acquire);
+
+        /* the sample callback sees every sample; a UI a full ring behind only misses them itself */
+        int ring_full_flag = head - tail >= COLLECTOR_RING_SIZE;
+        struct infiniband_metrics *slot = ring_full_flag > 0 ? input_collector->overflow : input_collector->slots[head & COLLECTOR_RING_MASK];
+
+        if (input_collector->read_cb(slot, input_collector->read_ctx) > 0) {
+            if (ring_full_flag > 0) {
+                ++input_collector->dropped_count;
+            }
+            slot->dropped_count = input_collector->dropped_count;
+
+            if (input_collector->sample_cb != NULL) {
+                input_collector->sample_cb(slot, input_collector->sample_ctx);
+            }
+
+            /* publish the snapshot and wake the UI, unless it is the one dropped */
+            if (ring_full_flag == 0) {
+                atomic_store_explicit(&input_collector->head, head + 1, memory_order_release);
+                if (write(input_collector->event_fd, &event_value, sizeof(event_value)) < 0) {
+                    /* eventfd counter overflow only delays the wakeup */
+                }
+            }
+        }
+
+        /* schedule the next sample; skip missed periods instead of bursting to catch up */
+        next_sample_ns += input_collector->interval_ns;
+        if (next_sample_ns < get_monotonic_ns()) {
+            next_sample_ns = get_monotonic_ns() + input_collector->interval_ns;
+        }
+
+        if (collector_sleep(input_collector, next_sample_ns) > 0) {
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+static void collector_free(struct collector *input_collector) {
+    for (size_t i = 0; i < COLLECTOR_RING_SIZE; ++i) {
+        infiniband_metrics_free(input_collector->slots[i]);
+    }
+    infiniband_metrics_free(input_collector->overflow);
+
+    if (input_collector->event_fd >= 0) {
+        close(input_collector->event_fd);
+    }
+
+    free(input_collector);
+}
+
+struct collector *collector_start(uint64_t interval_ns, collector_read_cb read_cb, void *read_ctx, collector_sample_cb sample_cb, void *sample_ctx) {
+    struct collector *input_collector;
+    pthread_condattr_t cond_attr;
+
+    input_collector = calloc(1, sizeof(*input_collector));
+    if (input_collector == NULL) {
+        fprintf(stderr, "ERROR: failed to allocate collector\n");
+        return NULL;
+    }
+
+    input_collector->interval_ns = interval_ns;
+    input_collector->read_cb = read_cb;
+    input_collector->read_ctx = read_ctx;
+    input_collector->sample_cb = sample_cb;
+    input_collector->sample_ctx = sample_ctx;
+    atomic_init(&input_collector->head, 0);
+    atomic_init(&input_collector->tail, 0);
+
+    input_collector->event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (input_collector->event_fd < 0) {
+        fprintf(stderr, "ERROR: failed to create collector eventfd: %s\n", strerror(errno));
+        goto handle_error;
+    }
+
+    for (size_t i = 0; i < COLLECTOR_RING_SIZE; ++i) {
+        /* slots grow to the discovered port count on first use */
+        input_collector->slots[i] = infiniband_metrics_alloc(0);
+        if (input_collector->slots[i] == NULL) {
+            fprintf(stderr, "ERROR: failed to allocate collector ring\n");
+            goto handle_error;
+        }
+    }
+
+    input_collector->overflow = infiniband_metrics_alloc(0);
+    if (input_collector->overflow == NULL) {
+        fprintf(stderr, "ERROR: failed to allocate collector ring\n");
+        goto handle_error;
+    }
+
+    /* the stop condition is waited on with CLOCK_MONOTONIC deadlines */
+    pthread_mutex_init(&input_collector->stop_mutex, NULL);
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&input_collector->stop_cond, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
+
+    if (pthread_create(&input_collector->thread, NULL, collector_main, input_collector) != 0) {
+        fprintf(stderr, "ERROR: failed to create collector thread\n");
+        pthread_cond_destroy(&input_collector->stop_cond);
+        pthread_mutex_destroy(&input_collector->stop_mutex);
+        goto handle_error;
+    }
+
+    return input_collector;
+
+handle_error:
+    collector_free(input_collector);
+
+    return NULL;
+}
+
+void collector_stop(struct collector *input_collector) {
+    if (input_collector == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&input_collector->stop_mutex);
+    input_collector->stop_flag = 1;
+    pthread_cond_signal(&input_collector->stop_cond);
+    pthread_mutex_unlock(&input_collector->stop_mutex);
+
+    pthread_join(input_collector->thread, NULL);
+
+    pthread_cond_destroy(&input_collector->stop_cond);
+    pthread_mutex_destroy(&input_collector->stop_mutex);
+
+    collector_free(input_collector);
+}
+
+int collector_event_fd(const struct collector *input_collector) {
+    return input_collector->event_fd;
+}
+
+/*
+ * take the oldest queued snapshot without copying: the caller's buffer is
+ * exchanged with the ring slot, so *input_infiniband_metrics must point to a
+ * buffer the caller owns; return 1 if a snapshot was taken, 0 if the ring is empty
+ */
+int collector_take(struct collector *input_collector, struct infiniband_metrics **input_infiniband_metrics) {
+    uint64_t tail = atomic_load_explicit(&input_collector->tail, memory_order_relaxed);
+    uint64_t head = atomic_load_explicit(&input_collector->head, memory_order_acquire);
+    struct infiniband_metrics *slot;
+
+    if (tail == head) {
+        return 0;
+    }
+
+    slot = input_collector->slots[tail & COLLECTOR_RING_MASK];
+    input_collector->slots[tail & COLLECTOR_RING_MASK] = *input_infiniband_metrics;
+    *input_infiniband_metrics = slot;
+
+    atomic_store_explicit(&input_collector->tail, tail + 1, memory_order_release);
+
+    return 1;
+}
@@ -0,0 +1,43 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2025 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COLLECTOR_H
+#define COLLECTOR_H
+
+#include <stdint.h>
+#include "infiniband.h"
+
+/* number of snapshots the collector can queue ahead of the UI; must be a power of two */
+#define COLLECTOR_RING_SIZE 256
+
+struct collector;
+
+/*
+ * called on the collector thread once per period to fill a snapshot, including its interface_count;
+ * return 0 to skip the period without queueing a snapshot
+ */
+typedef int (*collector_read_cb)(struct infiniband_metrics *input_infiniband_metrics, void *ctx);
+
+/* called on the collector thread with every sample before it is queued, including the ones dropped because the ring is full */
+typedef void (*collector_sample_cb)(const struct infiniband_metrics *input_infiniband_metrics, void *ctx);
+
+extern struct collector *collector_start(uint64_t interval_ns, collector_read_cb read_cb, void *read_ctx, collector_sample_cb sample_cb, void *sample_ctx);
+extern void collector_stop(struct collector *input_collector);
+extern int collector_event_fd(const struct collector *input_collector);
+extern int collector_take(struct collector *input_collector, struct infiniband_metrics **input_infiniband_metrics);
+
+#endif /* COLLECTOR_H */
@@ -0,0 +1,177 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2025 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include "delta.h"
+
+/* what a counter counts, which decides the most it can advance at link speed */
+enum counter_kind {
+    COUNTER_KIND_EVENTS,
+    COUNTER_KIND_WORDS,
+    COUNTER_KIND_PACKETS
+};
+
+/*
+ * width each counter has in the PortCounters attribute (IBA 16.1.3.5); those counters stop at
+ * their maximum. PortCountersExtended widens data and packet counters to 64 bits and adds the
+ * unicast / multicast ones; a counter holding a value beyond its PortCounters width is taken as 64 bits,
+ * as are the extended counters drivers expose under hw_counters
+ */
+static const struct {
+    uint8_t width;
+    uint8_t kind;
+} counter_widths[IB_COUNTER_COUNT] = {
+    [IB_COUNTER_SYMBOL_ERROR] = {16, COUNTER_KIND_EVENTS},
+    [IB_COUNTER_PORT_RCV_ERRORS] = {16, COUNTER_KIND_EVENTS},
+    [IB_COUNTER_PORT_RCV_REMOTE_PHYSICAL_ERRORS] = {16, COUNTER_KIND_EVENTS},
+    [IB_COUNTER_PORT_RCV_SWITCH_RELAY_ERRORS] = {16, COUNTER_KIND_EVENTS},
+    [IB_COUNTER_LINK_ERROR_RECOVERY] = {8, COUNTER_KIND_EVENTS},
+    [IB_COUNTER_PORT_XMIT_CONSTRAINT_ERRORS] = {8, COUNTER_KIND_EVENTS},
+    [IB_COUNTER_PORT_RCV_CONSTRAINT_ERRORS] = {8, COUNTER_KIND_EVENTS},
+    [IB_COUNTER_LOCAL_LINK_INTEGRITY_ERRORS] = {4, COUNTER_KIND_EVENTS},
+    [IB_COUNTER_EXCESSIVE_BUFFER_OVERRUN_ERRORS] = {4, COUNTER_KIND_EVENTS},
+    [IB_COUNTER_PORT_XMIT_DATA] = {32, COUNTER_KIND_WORDS},
+    [IB_COUNTER_PORT_RCV_DATA] = {32, COUNTER_KIND_WORDS},
+    [IB_COUNTER_PORT_XMIT_PACKETS] = {32, COUNTER_KIND_PACKETS},
+    [IB_COUNTER_PORT_RCV_PACKETS] = {32, COUNTER_KIND_PACKETS},
+    [IB_COUNTER_UNICAST_RCV_PACKETS] = {64, COUNTER_KIND_PACKETS},
+    [IB_COUNTER_UNICAST_XMIT_PACKETS] = {64, COUNTER_KIND_PACKETS},
+    [IB_COUNTER_MULTICAST_RCV_PACKETS] = {64, COUNTER_KIND_PACKETS},
+    [IB_COUNTER_MULTICAST_XMIT_PACKETS] = {64, COUNTER_KIND_PACKETS},
+    [IB_COUNTER_LINK_DOWNED] = {8, COUNTER_KIND_EVENTS},
+    [IB_COUNTER_PORT_XMIT_DISCARDS] = {16, COUNTER_KIND_EVENTS},
+    [IB_COUNTER_VL15_DROPPED] = {16, COUNTER_KIND_EVENTS}
+};
+
+/* smallest packet on the wire: LRH, BTH, ICRC and VCRC */
+#define MIN_PACKET_BYTES 26
+
+/* headroom over the link speed for sampling jitter; the rate string is never below the data rate */
+#define LINK_SPEED_SLACK 1.25
+
+/* maximum value of a counter width bits wide */
+static uint64_t width_max(unsigned int width) {
+    return width >= 64 ? UINT64_MAX : (1ULL << width) - 1;
+}
+
+/* width in bits the counter has, judged by its PortCounters width and the values it holds */
+unsigned int counter_width(enum infiniband_counter counter, uint64_t cur_value, uint64_t prev_value) {
+    if (counter >= IB_COUNTER_COUNT) {
+        return 64;
+    }
+
+    unsigned int width = counter_widths[counter].width;
+
+    if (cur_value > width_max(width) || prev_value > width_max(width)) {
+        return 64;
+    }
+
+    return width;
+}
+
+/* most the counter can advance in elapsed_ns at link_gbps; 0 if there is no such limit */
+static double counter_ceiling(enum infiniband_counter counter, uint64_t elapsed_ns, double link_gbps) {
+    double link_bytes = link_gbps * 1e9 / 8.0 * (double)elapsed_ns / 1e9;
+
+    if (counter >= IB_COUNTER_COUNT) {
+        return 0.0;
+    }
+
+    switch (counter_widths[counter].kind) {
+        case COUNTER_KIND_WORDS:
+            return link_bytes / 4.0;
+        case COUNTER_KIND_PACKETS:
+            return link_bytes / MIN_PACKET_BYTES;
+        default:
+            return 0.0;
+    }
+}
+
+/*
+ * store in *delta how far a counter advanced from prev_value to cur_value over elapsed_ns and
+ * return the delta_flag bits describing how it was obtained. link_gbps (0 if unknown) bounds
+ * what the link can carry: a decrease is a wrap only if the wrapped delta fits in that bound,
+ * otherwise it is a reset and the delta is cur_value
+ */
+unsigned int counter_delta(enum infiniband_counter counter, uint64_t cur_value, uint64_t prev_value, uint64_t elapsed_ns, double link_gbps, uint64_t *delta) {
+    unsigned int width = counter_width(counter, cur_value, prev_value);
+    uint64_t max_value = width_max(width);
+    double ceiling = counter_ceiling(counter, elapsed_ns, link_gbps);
+    unsigned int flags = 0;
+
+    if (cur_value >= prev_value) {
+        *delta = cur_value - prev_value;
+    } else if (width < 64 && counter_widths[counter].kind != COUNTER_KIND_EVENTS &&
+               (ceiling <= 0.0 || (double)(max_value - prev_value) + (double)cur_value + 1.0 <= ceiling * LINK_SPEED_SLACK)) {
+        /* error counters never wrap; data and packet counters of some drivers do */
+        *delta = max_value - prev_value + cur_value + 1;
+        flags |= DELTA_WRAPPED;
+    } else {
+        *delta = cur_value;
+        flags |= DELTA_RESET;
+    }
+
+    if (width < 64 && cur_value == max_value) {
+        flags |= DELTA_SATURATED;
+    }
+
+    if (width < 64 && ceiling > (double)max_value) {
+        flags |= DELTA_AMBIGUOUS;
+    }
+
+    if (ceiling > 0.0 && (double)*delta > ceiling * LINK_SPEED_SLACK) {
+        flags |= DELTA_IMPLAUSIBLE;
+    }
+
+    return flags;
+}
+
+/*
+ * delta_flag bits that hold for every counter of the port at position i of cur_metrics and j of
+ * prev_metrics: a reset clears all counters at once, so one counter that has certainly been reset
+ * marks all of them, including those whose decrease would pass as a wrap
+ */
+unsigned int port_delta_flags(const struct infiniband_metrics *cur_metrics, const struct infiniband_metrics *prev_metrics, int i, int j) {
+    uint64_t elapsed_ns = cur_metrics->timestamp_ns - prev_metrics->timestamp_ns;
+    double link_gbps = infiniband_rate_gbps(cur_metrics->infiniband[i].rate_id);
+    size_t counter_count = cur_metrics->counter_count < prev_metrics->counter_count ? cur_metrics->counter_count : prev_metrics->counter_count;
+
+    for (size_t k = 0; k < counter_count; ++k) {
+        uint64_t delta;
+
+        /* only a decrease can be a reset */
+        if (cur_metrics->counters[k][i] < prev_metrics->counters[k][j] &&
+            (counter_delta((enum infiniband_counter)k, cur_metrics->counters[k][i], prev_metrics->counters[k][j], elapsed_ns, link_gbps, &delta) & DELTA_RESET)) {
+            return DELTA_RESET;
+        }
+    }
+
+    return 0;
+}
+
+/* short text for the most severe of flags, e.g. to stand in for a rate; NULL if the delta is usable as is */
+const char *delta_flag_label(unsigned int flags) {
+    if (flags & DELTA_RESET) {
+        return "reset";
+    }
+
+    if (flags & DELTA_IMPLAUSIBLE) {
+        return "invalid";
+    }
+
+    return NULL;
+}
@@ -0,0 +1,53 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2025 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef DELTA_H
+#define DELTA_H
+
+#include <stdint.h>
+#include "infiniband.h"
+
+/* how counter_delta() obtained a delta; 0 means a plain difference */
+enum delta_flag {
+    /* the counter wrapped around its width once */
+    DELTA_WRAPPED = 0x01,
+
+    /* the counter went backwards (e.g.: perfquery -R, driver reload); the delta counts from zero */
+    DELTA_RESET = 0x02,
+
+    /* the counter stopped at its maximum; the delta is a lower bound */
+    DELTA_SATURATED = 0x04,
+
+    /* at link speed the counter can wrap more than once per interval; the delta is a lower bound */
+    DELTA_AMBIGUOUS = 0x08,
+
+    /* the delta is more than the link can carry in the interval */
+    DELTA_IMPLAUSIBLE = 0x10
+};
+
+/* flags after which a delta does not describe the interval and must not be shown as a rate */
+#define DELTA_UNUSABLE (DELTA_RESET | DELTA_IMPLAUSIBLE)
+
+/* flags after which a delta only tells how much was counted at least */
+#define DELTA_LOWER_BOUND (DELTA_SATURATED | DELTA_AMBIGUOUS)
+
+extern unsigned int counter_width(enum infiniband_counter counter, uint64_t cur_value, uint64_t prev_value);
+extern unsigned int counter_delta(enum infiniband_counter counter, uint64_t cur_value, uint64_t prev_value, uint64_t elapsed_ns, double link_gbps, uint64_t *delta);
+extern unsigned int port_delta_flags(const struct infiniband_metrics *cur_metrics, const struct infiniband_metrics *prev_metrics, int i, int j);
+extern const char *delta_flag_label(unsigned int flags);
+
+#endif /* DELTA_H */
@@ -0,0 +1,216 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2025 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "event_log.h"
+#include "infiniband.h"
+#include "utils.h"
+
+static const char *port_attribute_names[PORT_ATTRIBUTE_COUNT] = {
+    [PORT_ATTRIBUTE_PRESENCE] = "port",
+    [PORT_ATTRIBUTE_STATE] = "state",
+    [PORT_ATTRIBUTE_PHYS_STATE] = "phys_state",
+    [PORT_ATTRIBUTE_RATE] = "rate",
+    [PORT_ATTRIBUTE_LID] = "lid",
+};
+
+struct event_log {
+    /* ring of the newest events; next is where the next one goes */
+    struct port_event events[EVENT_LOG_LENGTH];
+    size_t next;
+    size_t count;
+
+    /* file every event is appended to, -1 for none; the events of a sample go out in a single write */
+    int fd;
+    struct string_buffer buffer;
+
+    /* position of every interface name id in the previous and the current snapshot */
+    int *prev_positions;
+    size_t prev_positions_size;
+    int *cur_positions;
+    size_t cur_positions_size;
+};
+
+/* keep the events in memory, and append them to path if it is not NULL */
+struct event_log *event_log_open(const char *path) {
+    struct event_log *new_log = calloc(1, sizeof(*new_log));
+    if (new_log == NULL) {
+        fprintf(stderr, "ERROR: failed to allocate port event log\n");
+        return NULL;
+    }
+
+    new_log->fd = -1;
+
+    if (path != NULL) {
+        new_log->fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (new_log->fd < 0) {
+            fprintf(stderr, "ERROR: unable to open %s: %s\n", path, strerror(errno));
+            free(new_log);
+            return NULL;
+        }
+    }
+
+    return new_log;
+}
+
+const char *port_attribute_name(enum port_attribute attribute) {
+    return attribute < PORT_ATTRIBUTE_COUNT ? port_attribute_names[attribute] : "";
+}
+
+/* text of value, the from or to of event; buffer holds it when it is not a name */
+const char *port_event_value(const struct port_event *event, uint32_t value, char *buffer, size_t buffer_size) {
+    switch (event->attribute) {
+        case PORT_ATTRIBUTE_PRESENCE:
+            return value > 0 ? "present" : "absent";
+        case PORT_ATTRIBUTE_STATE:
+            return infiniband_state_name((uint8_t)value);
+        case PORT_ATTRIBUTE_PHYS_STATE:
+            return infiniband_phys_state_name((uint8_t)value);
+        case PORT_ATTRIBUTE_RATE:
+            return infiniband_rate_name((uint16_t)value);
+        default:
+            snprintf(buffer, buffer_size, "%" PRIu32, value);
+            return buffer;
+    }
+}
+
+/* e.g.: "2026-10-16T12:00:00.100000000Z 5285556071202 mlx5_0:1 state 4: ACTIVE -> 2: INIT" */
+static int format_event(struct string_buffer *buffer, const struct port_event *event) {
+    time_t seconds = (time_t)(event->realtime_ns / NSEC_PER_SEC);
+    struct tm utc_time;
+    char time_text[32] = "";
+    char from_text[16];
+    char to_text[16];
+
+    if (gmtime_r(&seconds, &utc_time) != NULL) {
+        strftime(time_text, sizeof(time_text), "%Y-%m-%dT%H:%M:%S", &utc_time);
+    }
+
+    return string_buffer_printf(buffer, "%s.%09" PRIu64 "Z %" PRIu64 " %s %s %s -> %s\n", time_text, (uint64_t)(event->realtime_ns % NSEC_PER_SEC), event->timestamp_ns,
+                                infiniband_interface_name(event->name_id), port_attribute_name((enum port_attribute)event->attribute),
+                                port_event_value(event, event->from, from_text, sizeof(from_text)), port_event_value(event, event->to, to_text, sizeof(to_text)));
+}
+
+static int add_event(struct event_log *input_log, const struct infiniband_metrics *cur_metrics, uint16_t name_id, enum port_attribute attribute, uint32_t from, uint32_t to) {
+    struct port_event *event = &input_log->events[input_log->next];
+
+    event->timestamp_ns = cur_metrics->timestamp_ns;
+    event->realtime_ns = cur_metrics->realtime_ns;
+    event->from = from;
+    event->to = to;
+    event->name_id = name_id;
+    event->attribute = (uint8_t)attribute;
+
+    input_log->next = (input_log->next + 1) % EVENT_LOG_LENGTH;
+    input_log->count += input_log->count < EVENT_LOG_LENGTH;
+
+    return input_log->fd >= 0 ? format_event(&input_log->buffer, event) : 0;
+}
+
+/*
+ * record how the ports changed from prev_metrics to cur_metrics; prev_metrics may be NULL. the
+ * attributes are compared as the integers and interned ids the snapshots hold
+ */
+int event_log_update(struct event_log *input_log, const struct infiniband_metrics *cur_metrics, const struct infiniband_metrics *prev_metrics) {
+    if (prev_metrics == NULL) {
+        return 0;
+    }
+
+    if (infiniband_metrics_positions(prev_metrics, &input_log->prev_positions, &input_log->prev_positions_size) < 0 ||
+        infiniband_metrics_positions(cur_metrics, &input_log->cur_positions, &input_log->cur_positions_size) < 0) {
+        fprintf(stderr, "ERROR: failed to allocate interface index\n");
+        return -1;
+    }
+
+    input_log->buffer.length = 0;
+    int ret = 0;
+
+    for (int i = 0; i < cur_metrics->interface_count && ret == 0; ++i) {
+        const struct interface *cur_interface = &cur_metrics->infiniband[i];
+        int j = input_log->prev_positions[cur_interface->name_id];
+
+        if (j < 0) {
+            ret = add_event(input_log, cur_metrics, cur_interface->name_id, PORT_ATTRIBUTE_PRESENCE, 0, 1);
+            continue;
+        }
+
+        const struct interface *prev_interface = &prev_metrics->infiniband[j];
+        if (ret == 0 && cur_interface->state != prev_interface->state) {
+            ret = add_event(input_log, cur_metrics, cur_interface->name_id, PORT_ATTRIBUTE_STATE, prev_interface->state, cur_interface->state);
+        }
+        if (ret == 0 && cur_interface->phys_state != prev_interface->phys_state) {
+            ret = add_event(input_log, cur_metrics, cur_interface->name_id, PORT_ATTRIBUTE_PHYS_STATE, prev_interface->phys_state, cur_interface->phys_state);
+        }
+        if (ret == 0 && cur_interface->rate_id != prev_interface->rate_id) {
+            ret = add_event(input_log, cur_metrics, cur_interface->name_id, PORT_ATTRIBUTE_RATE, prev_interface->rate_id, cur_interface->rate_id);
+        }
+        if (ret == 0 && cur_interface->lid != prev_interface->lid) {
+            ret = add_event(input_log, cur_metrics, cur_interface->name_id, PORT_ATTRIBUTE_LID, prev_interface->lid, cur_interface->lid);
+        }
+    }
+
+    /* a port gone since the previous sample (e.g.: a device unbound, an agent disconnected) */
+    for (int j = 0; j < prev_metrics->interface_count && ret == 0; ++j) {
+        uint16_t name_id = prev_metrics->infiniband[j].name_id;
+        if (input_log->cur_positions[name_id] < 0) {
+            ret = add_event(input_log, cur_metrics, name_id, PORT_ATTRIBUTE_PRESENCE, 1, 0);
+        }
+    }
+
+    if (ret < 0) {
+        fprintf(stderr, "ERROR: failed to format port event\n");
+        return -1;
+    }
+
+    if (input_log->buffer.length > 0 && write_full(input_log->fd, input_log->buffer.data, input_log->buffer.length) < 0) {
+        fprintf(stderr, "ERROR: failed to write port event: %s\n", strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+size_t event_log_count(const struct event_log *input_log) {
+    return input_log->count;
+}
+
+/* the event age events before the newest one; age is below event_log_count() */
+const struct port_event *event_log_recent(const struct event_log *input_log, size_t age) {
+    return &input_log->events[(input_log->next + EVENT_LOG_LENGTH - 1 - age) % EVENT_LOG_LENGTH];
+}
+
+void event_log_close(struct event_log *input_log) {
+    if (input_log == NULL) {
+        return;
+    }
+
+    if (input_log->fd >= 0) {
+        close(input_log->fd);
+    }
+
+    string_buffer_free(&input_log->buffer);
+    free(input_log->prev_positions);
+    free(input_log->cur_positions);
+    free(input_log);
+}
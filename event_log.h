@@ -0,0 +1,64 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2025 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "infiniband.h"
+
+/* events kept in memory; older ones are only in the file given to event_log_open() */
+#define EVENT_LOG_LENGTH 1024
+
+/* port attributes whose changes are events */
+enum port_attribute {
+    /* 1 while the port is found, 0 once it is gone */
+    PORT_ATTRIBUTE_PRESENCE,
+    PORT_ATTRIBUTE_STATE,
+    PORT_ATTRIBUTE_PHYS_STATE,
+    PORT_ATTRIBUTE_RATE,
+    PORT_ATTRIBUTE_LID,
+    PORT_ATTRIBUTE_COUNT
+};
+
+/*
+ * a port attribute changing between two samples; from and to hold the attribute as struct interface
+ * does (e.g.: the interned rate id), resolved with port_event_value()
+ */
+struct port_event {
+    /* CLOCK_MONOTONIC and CLOCK_REALTIME time of the sample the change was seen in */
+    uint64_t timestamp_ns;
+    uint64_t realtime_ns;
+
+    uint32_t from;
+    uint32_t to;
+    uint16_t name_id;
+    uint8_t attribute;
+};
+
+struct event_log;
+
+extern struct event_log *event_log_open(const char *path);
+extern int event_log_update(struct event_log *input_log, const struct infiniband_metrics *cur_metrics, const struct infiniband_metrics *prev_metrics);
+extern size_t event_log_count(const struct event_log *input_log);
+extern const struct port_event *event_log_recent(const struct event_log *input_log, size_t age);
+extern const char *port_attribute_name(enum port_attribute attribute);
+extern const char *port_event_value(const struct port_event *event, uint32_t value, char *buffer, size_t buffer_size);
+extern void event_log_close(struct event_log *input_log);
+
+#endif /* EVENT_LOG_H */
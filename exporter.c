@@ -0,0 +1,599 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2025 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "alert.h"
+#include "delta.h"
+#include "exporter.h"
+#include "infiniband.h"
+#include "stats.h"
+#include "utils.h"
+
+/* rates exported next to the raw counters; data counters count 4 byte words */
+static const struct {
+    enum infiniband_counter counter;
+    const char *name;
+    uint64_t scale;
+} export_rates[] = {
+    {IB_COUNTER_PORT_RCV_PACKETS, "rx_packets_per_second", 1},
+    {IB_COUNTER_PORT_RCV_DATA, "rx_bytes_per_second", 4},
+    {IB_COUNTER_PORT_XMIT_PACKETS, "tx_packets_per_second", 1},
+    {IB_COUNTER_PORT_XMIT_DATA, "tx_bytes_per_second", 4},
+    {IB_COUNTER_UNICAST_RCV_PACKETS, "unicast_rx_packets_per_second", 1},
+    {IB_COUNTER_UNICAST_XMIT_PACKETS, "unicast_tx_packets_per_second", 1},
+    {IB_COUNTER_MULTICAST_RCV_PACKETS, "multicast_rx_packets_per_second", 1},
+    {IB_COUNTER_MULTICAST_XMIT_PACKETS, "multicast_tx_packets_per_second", 1},
+};
+
+struct exporter {
+    enum exporter_format format;
+    int fd;
+    int close_flag;
+    char hostname[256];
+
+    /* one sample is formatted here and written with a single write */
+    struct string_buffer buffer;
+
+    /* CSV columns are fixed by the first sample, which carries the header if the stream needs one */
+    int csv_header_flag;
+    size_t csv_counter_count;
+
+    /* position of every interface name id in the previous snapshot */
+    int *prev_positions;
+    size_t prev_positions_size;
+
+    /* statistics of the exported rates, written after them if not NULL */
+    const struct stats *rate_stats;
+
+    /* alert rules whose events are written after each sample if not NULL; the CSV columns have no room for them */
+    const struct alerts *alert_rules;
+};
+
+/* statistics exported per window, in the order export_statistic() returns them; the moving average is written once per rate */
+static const char *export_statistics[] = {"min", "mean", "max", "p50", "p99"};
+
+static double export_statistic(const struct stats_summary *summary, size_t statistic_index, uint64_t scale) {
+    double values[] = {summary->min, summary->mean, summary->max, summary->p50, summary->p99};
+
+    return values[statistic_index] * (double)scale;
+}
+
+/*
+ * store in *rate the per-second value of export_rates[rate_index] between position i of cur_metrics
+ * and j of prev_metrics; return the delta_flag bits of the underlying delta
+ */
+static unsigned int export_rate(const struct infiniband_metrics *cur_metrics, const struct infiniband_metrics *prev_metrics, size_t rate_index, int i, int j, uint64_t elapsed_ns, double *rate) {
+    enum infiniband_counter counter = export_rates[rate_index].counter;
+    uint64_t delta;
+    unsigned int flags = counter_delta(counter, cur_metrics->counters[counter][i], prev_metrics->counters[counter][j], elapsed_ns,
+                                       infiniband_rate_gbps(cur_metrics->infiniband[i].rate_id), &delta);
+
+    *rate = (double)delta * (double)export_rates[rate_index].scale / ((double)elapsed_ns / 1e9);
+
+    return flags;
+}
+
+int exporter_parse_format(const char *name, enum exporter_format *format) {
+    if (strcmp(name, "csv") == 0) {
+        *format = EXPORTER_FORMAT_CSV;
+    } else if (strcmp(name, "json") == 0) {
+        *format = EXPORTER_FORMAT_JSON;
+    } else if (strcmp(name, "influx") == 0) {
+        *format = EXPORTER_FORMAT_INFLUX;
+    } else {
+        return -1;
+    }
+
+    return 0;
+}
+
+/* append value as a JSON string body; sysfs names never need more than quote and backslash escaping */
+static int append_json_string(struct string_buffer *buffer, const char *value) {
+    for (const char *p = value; *p != '\0'; ++p) {
+        if ((*p == '"' || *p == '\\') && string_buffer_append(buffer, "\\", 1) < 0) {
+            return -1;
+        }
+        if (string_buffer_append(buffer, p, 1) < 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/* append value as an InfluxDB tag value; commas, equal signs and spaces are escaped */
+static int append_influx_tag(struct string_buffer *buffer, const char *value) {
+    for (const char *p = value; *p != '\0'; ++p) {
+        if ((*p == ',' || *p == '=' || *p == ' ') && string_buffer_append(buffer, "\\", 1) < 0) {
+            return -1;
+        }
+        if (string_buffer_append(buffer, p, 1) < 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int format_csv_header(struct exporter *input_exporter) {
+    struct string_buffer *buffer = &input_exporter->buffer;
+
+    int ret = string_buffer_printf(buffer, "monotonic_ns,realtime_ns,interface,link_layer,state,phys_state,rate,lid");
+    for (size_t i = 0; i < input_exporter->csv_counter_count && ret == 0; ++i) {
+        ret = string_buffer_printf(buffer, ",%s", infiniband_counter_name((enum infiniband_counter)i));
+    }
+    for (size_t i = 0; i < SIZEOF(export_rates) && ret == 0; ++i) {
+        ret = string_buffer_printf(buffer, ",%s", export_rates[i].name);
+    }
+    if (ret == 0) {
+        ret = string_buffer_printf(buffer, ",delta_flags,dropped_samples");
+    }
+
+    /* e.g.: rx_bytes_per_second_ewma, rx_bytes_per_second_10s_p99 */
+    for (size_t i = 0; input_exporter->rate_stats != NULL && i < SIZEOF(export_rates) && ret == 0; ++i) {
+        ret = string_buffer_printf(buffer, ",%s_ewma", export_rates[i].name);
+        for (size_t w = 0; w < stats_window_count(input_exporter->rate_stats) && ret == 0; ++w) {
+            for (size_t k = 0; k < SIZEOF(export_statistics) && ret == 0; ++k) {
+                ret = string_buffer_printf(buffer, ",%s_%s_%s", export_rates[i].name, stats_window_label(input_exporter->rate_stats, w), export_statistics[k]);
+            }
+        }
+    }
+    if (ret == 0) {
+        ret = string_buffer_append(buffer, "\n", 1);
+    }
+
+    return ret;
+}
+
+/* append the statistics of every exported rate of the interface with name_id; windows without a rate stay empty */
+static int format_csv_stats(struct exporter *input_exporter, uint16_t name_id) {
+    struct string_buffer *buffer = &input_exporter->buffer;
+    const struct stats *rate_stats = input_exporter->rate_stats;
+
+    for (size_t i = 0; i < SIZEOF(export_rates); ++i) {
+        for (size_t w = 0; w < stats_window_count(rate_stats); ++w) {
+            struct stats_summary summary;
+            int ret = 0;
+
+            stats_summary(rate_stats, name_id, export_rates[i].counter, w, &summary);
+            if (w == 0) {
+                ret = summary.count == 0 ? string_buffer_append(buffer, ",", 1) : string_buffer_printf(buffer, ",%.3f", summary.ewma * (double)export_rates[i].scale);
+            }
+            for (size_t k = 0; k < SIZEOF(export_statistics) && ret == 0; ++k) {
+                ret = summary.count == 0 ? string_buffer_append(buffer, ",", 1) :
+                    string_buffer_printf(buffer, ",%.3f", export_statistic(&summary, k, export_rates[i].scale));
+            }
+            if (ret < 0) {
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/* append a "stats" member holding the statistics of every exported rate; a rate without any is null */
+static int format_json_stats(struct exporter *input_exporter, uint16_t name_id) {
+    struct string_buffer *buffer = &input_exporter->buffer;
+    const struct stats *rate_stats = input_exporter->rate_stats;
+
+    if (string_buffer_printf(buffer, ",\"stats\":{") < 0) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < SIZEOF(export_rates); ++i) {
+        struct stats_summary summary;
+
+        /* every window holds the newest rate, so the first one tells if there is any */
+        stats_summary(rate_stats, name_id, export_rates[i].counter, 0, &summary);
+        if (summary.count == 0) {
+            if (string_buffer_printf(buffer, "%s\"%s\":null", i > 0 ? "," : "", export_rates[i].name) < 0) {
+                return -1;
+            }
+            continue;
+        }
+
+        if (string_buffer_printf(buffer, "%s\"%s\":{\"ewma\":%.3f", i > 0 ? "," : "", export_rates[i].name, summary.ewma * (double)export_rates[i].scale) < 0) {
+            return -1;
+        }
+
+        for (size_t w = 0; w < stats_window_count(rate_stats); ++w) {
+            stats_summary(rate_stats, name_id, export_rates[i].counter, w, &summary);
+            if (string_buffer_printf(buffer, ",\"%s\":{", stats_window_label(rate_stats, w)) < 0) {
+                return -1;
+            }
+            for (size_t k = 0; k < SIZEOF(export_statistics); ++k) {
+                if (string_buffer_printf(buffer, "%s\"%s\":%.3f", k > 0 ? "," : "", export_statistics[k], export_statistic(&summary, k, export_rates[i].scale)) < 0) {
+                    return -1;
+                }
+            }
+            if (string_buffer_append(buffer, "}", 1) < 0) {
+                return -1;
+            }
+        }
+
+        if (string_buffer_append(buffer, "}", 1) < 0) {
+            return -1;
+        }
+    }
+
+    return string_buffer_append(buffer, "}", 1);
+}
+
+/* append the statistics of every exported rate as fields; windows without a rate are omitted */
+static int format_influx_stats(struct exporter *input_exporter, uint16_t name_id) {
+    struct string_buffer *buffer = &input_exporter->buffer;
+    const struct stats *rate_stats = input_exporter->rate_stats;
+
+    for (size_t i = 0; i < SIZEOF(export_rates); ++i) {
+        for (size_t w = 0; w < stats_window_count(rate_stats); ++w) {
+            struct stats_summary summary;
+
+            stats_summary(rate_stats, name_id, export_rates[i].counter, w, &summary);
+            if (summary.count == 0) {
+                continue;
+            }
+
+            if (w == 0 && string_buffer_printf(buffer, ",%s_ewma=%.3f", export_rates[i].name, summary.ewma * (double)export_rates[i].scale) < 0) {
+                return -1;
+            }
+            for (size_t k = 0; k < SIZEOF(export_statistics); ++k) {
+                if (string_buffer_printf(buffer, ",%s_%s_%s=%.3f", export_rates[i].name, stats_window_label(rate_stats, w), export_statistics[k],
+                                         export_statistic(&summary, k, export_rates[i].scale)) < 0) {
+                    return -1;
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+/* rate_stats, if not NULL, must outlive the exporter */
+struct exporter *exporter_open(const char *path, enum exporter_format format, const struct stats *rate_stats, const struct alerts *alert_rules) {
+    struct exporter *new_exporter = calloc(1, sizeof(*new_exporter));
+    if (new_exporter == NULL) {
+        fprintf(stderr, "ERROR: failed to allocate exporter\n");
+        return NULL;
+    }
+
+    new_exporter->format = format;
+    new_exporter->fd = STDOUT_FILENO;
+    new_exporter->rate_stats = rate_stats;
+    new_exporter->alert_rules = alert_rules;
+
+    if (gethostname(new_exporter->hostname, sizeof(new_exporter->hostname) - 1) < 0) {
+        strcpy(new_exporter->hostname, "localhost");
+    }
+
+    /* files are appended to so a restarted service continues the same stream */
+    if (path != NULL && strcmp(path, "-") != 0) {
+        new_exporter->fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (new_exporter->fd < 0) {
+            fprintf(stderr, "ERROR: unable to open %s: %s\n", path, strerror(errno));
+            free(new_exporter);
+            return NULL;
+        }
+        new_exporter->close_flag = 1;
+    }
+
+    /* a CSV header is written once per stream; appended files already have one */
+    struct stat file_stat;
+    new_exporter->csv_header_flag = format == EXPORTER_FORMAT_CSV &&
+        (new_exporter->close_flag == 0 || (fstat(new_exporter->fd, &file_stat) == 0 && file_stat.st_size == 0));
+
+    return new_exporter;
+}
+
+static int format_csv(struct exporter *input_exporter, const struct infiniband_metrics *cur_metrics, const struct infiniband_metrics *prev_metrics, uint64_t realtime_ns, uint64_t elapsed_ns) {
+    struct string_buffer *buffer = &input_exporter->buffer;
+
+    if (input_exporter->csv_counter_count == 0) {
+        input_exporter->csv_counter_count = cur_metrics->counter_count;
+        if (input_exporter->csv_header_flag > 0 && format_csv_header(input_exporter) < 0) {
+            return -1;
+        }
+    }
+
+    for (int i = 0; i < cur_metrics->interface_count; ++i) {
+        const struct interface *cur_interface = &cur_metrics->infiniband[i];
+        int j = prev_metrics != NULL ? input_exporter->prev_positions[cur_interface->name_id] : -1;
+
+        if (string_buffer_printf(buffer, "%" PRIu64 ",%" PRIu64 ",%s,%s,%s,%s,%s,%" PRIu32, cur_metrics->timestamp_ns, realtime_ns,
+                                 infiniband_interface_name(cur_interface->name_id), infiniband_link_layer_name(cur_interface->link_layer),
+                                 infiniband_state_name(cur_interface->state), infiniband_phys_state_name(cur_interface->phys_state),
+                                 infiniband_rate_name(cur_interface->rate_id), cur_interface->lid) < 0) {
+            return -1;
+        }
+
+        /* counters found after the first sample have no column; ones gone since read as 0 */
+        for (size_t k = 0; k < input_exporter->csv_counter_count; ++k) {
+            if (string_buffer_printf(buffer, ",%" PRIu64, k < cur_metrics->counter_count ? cur_metrics->counters[k][i] : 0) < 0) {
+                return -1;
+            }
+        }
+
+        /* rates stay empty until the interface has a previous sample, and when their delta is unusable */
+        unsigned int delta_flags = j < 0 ? 0 : port_delta_flags(cur_metrics, prev_metrics, i, j);
+        for (size_t k = 0; k < SIZEOF(export_rates); ++k) {
+            double rate = 0.0;
+            unsigned int flags = j < 0 ? DELTA_UNUSABLE : delta_flags | export_rate(cur_metrics, prev_metrics, k, i, j, elapsed_ns, &rate);
+            int ret = flags & DELTA_UNUSABLE ? string_buffer_append(buffer, ",", 1) : string_buffer_printf(buffer, ",%.3f", rate);
+            if (ret < 0) {
+                return -1;
+            }
+            delta_flags |= flags;
+        }
+
+        int ret = j < 0 ? string_buffer_append(buffer, ",", 1) : string_buffer_printf(buffer, ",%u", delta_flags);
+        if (ret < 0 || string_buffer_printf(buffer, ",%" PRIu64, cur_metrics->dropped_count) < 0) {
+            return -1;
+        }
+
+        if (input_exporter->rate_stats != NULL && format_csv_stats(input_exporter, cur_interface->name_id) < 0) {
+            return -1;
+        }
+
+        if (string_buffer_append(buffer, "\n", 1) < 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int format_json(struct exporter *input_exporter, const struct infiniband_metrics *cur_metrics, const struct infiniband_metrics *prev_metrics, uint64_t realtime_ns, uint64_t elapsed_ns) {
+    struct string_buffer *buffer = &input_exporter->buffer;
+
+    if (string_buffer_printf(buffer, "{\"monotonic_ns\":%" PRIu64 ",\"realtime_ns\":%" PRIu64 ",\"dropped_samples\":%" PRIu64 ",\"host\":\"", cur_metrics->timestamp_ns, realtime_ns,
+                             cur_metrics->dropped_count) < 0 ||
+        append_json_string(buffer, input_exporter->hostname) < 0 ||
+        string_buffer_printf(buffer, "\",\"interfaces\":[") < 0) {
+        return -1;
+    }
+
+    for (int i = 0; i < cur_metrics->interface_count; ++i) {
+        const struct interface *cur_interface = &cur_metrics->infiniband[i];
+        int j = prev_metrics != NULL ? input_exporter->prev_positions[cur_interface->name_id] : -1;
+
+        if (string_buffer_printf(buffer, "%s{\"name\":\"", i > 0 ? "," : "") < 0 ||
+            append_json_string(buffer, infiniband_interface_name(cur_interface->name_id)) < 0 ||
+            string_buffer_printf(buffer, "\",\"link_layer\":\"%s\",\"state\":\"%s\",\"phys_state\":\"%s\",\"rate\":\"",
+                                 infiniband_link_layer_name(cur_interface->link_layer), infiniband_state_name(cur_interface->state),
+                                 infiniband_phys_state_name(cur_interface->phys_state)) < 0 ||
+            append_json_string(buffer, infiniband_rate_name(cur_interface->rate_id)) < 0 ||
+            string_buffer_printf(buffer, "\",\"lid\":%" PRIu32 ",\"counters\":{", cur_interface->lid) < 0) {
+            return -1;
+        }
+
+        for (size_t k = 0; k < cur_metrics->counter_count; ++k) {
+            if (string_buffer_printf(buffer, "%s\"%s\":%" PRIu64, k > 0 ? "," : "", infiniband_counter_name((enum infiniband_counter)k), cur_metrics->counters[k][i]) < 0) {
+                return -1;
+            }
+        }
+
+        if (string_buffer_append(buffer, "}", 1) < 0) {
+            return -1;
+        }
+
+        /* rates are omitted until the interface has a previous sample */
+        if (j >= 0) {
+            if (string_buffer_printf(buffer, ",\"rates\":{") < 0) {
+                return -1;
+            }
+
+            /* a rate whose delta is unusable is null */
+            unsigned int delta_flags = port_delta_flags(cur_metrics, prev_metrics, i, j);
+            for (size_t k = 0; k < SIZEOF(export_rates); ++k) {
+                double rate;
+                unsigned int flags = delta_flags | export_rate(cur_metrics, prev_metrics, k, i, j, elapsed_ns, &rate);
+                int ret = flags & DELTA_UNUSABLE ? string_buffer_printf(buffer, "%s\"%s\":null", k > 0 ? "," : "", export_rates[k].name) :
+                    string_buffer_printf(buffer, "%s\"%s\":%.3f", k > 0 ? "," : "", export_rates[k].name, rate);
+                if (ret < 0) {
+                    return -1;
+                }
+                delta_flags |= flags;
+            }
+
+            if (string_buffer_printf(buffer, "},\"delta_flags\":%u", delta_flags) < 0) {
+                return -1;
+            }
+        }
+
+        if (input_exporter->rate_stats != NULL && format_json_stats(input_exporter, cur_interface->name_id) < 0) {
+            return -1;
+        }
+
+        if (string_buffer_append(buffer, "}", 1) < 0) {
+            return -1;
+        }
+    }
+
+    return string_buffer_append(buffer, "]}\n", 3);
+}
+
+static int format_influx(struct exporter *input_exporter, const struct infiniband_metrics *cur_metrics, const struct infiniband_metrics *prev_metrics, uint64_t realtime_ns, uint64_t elapsed_ns) {
+    struct string_buffer *buffer = &input_exporter->buffer;
+
+    for (int i = 0; i < cur_metrics->interface_count; ++i) {
+        const struct interface *cur_interface = &cur_metrics->infiniband[i];
+        int j = prev_metrics != NULL ? input_exporter->prev_positions[cur_interface->name_id] : -1;
+
+        if (string_buffer_printf(buffer, "infiniband,host=") < 0 ||
+            append_influx_tag(buffer, input_exporter->hostname) < 0 ||
+            string_buffer_printf(buffer, ",interface=") < 0 ||
+            append_influx_tag(buffer, infiniband_interface_name(cur_interface->name_id)) < 0 ||
+            string_buffer_printf(buffer, ",link_layer=") < 0 ||
+            append_influx_tag(buffer, infiniband_link_layer_name(cur_interface->link_layer)) < 0 ||
+            string_buffer_printf(buffer, " monotonic_ns=%" PRIu64 "u,dropped_samples=%" PRIu64 "u,lid=%" PRIu32 "u,state=\"%s\",phys_state=\"%s\"", cur_metrics->timestamp_ns,
+                                 cur_metrics->dropped_count, cur_interface->lid, infiniband_state_name(cur_interface->state), infiniband_phys_state_name(cur_interface->phys_state)) < 0) {
+            return -1;
+        }
+
+        for (size_t k = 0; k < cur_metrics->counter_count; ++k) {
+            if (string_buffer_printf(buffer, ",%s=%" PRIu64 "u", infiniband_counter_name((enum infiniband_counter)k), cur_metrics->counters[k][i]) < 0) {
+                return -1;
+            }
+        }
+
+        /* rates are omitted until the interface has a previous sample, and when their delta is unusable */
+        unsigned int delta_flags = j < 0 ? 0 : port_delta_flags(cur_metrics, prev_metrics, i, j);
+        for (size_t k = 0; j >= 0 && k < SIZEOF(export_rates); ++k) {
+            double rate;
+            unsigned int flags = delta_flags | export_rate(cur_metrics, prev_metrics, k, i, j, elapsed_ns, &rate);
+            if ((flags & DELTA_UNUSABLE) == 0 && string_buffer_printf(buffer, ",%s=%.3f", export_rates[k].name, rate) < 0) {
+                return -1;
+            }
+            delta_flags |= flags;
+        }
+
+        if (j >= 0 && string_buffer_printf(buffer, ",delta_flags=%uu", delta_flags) < 0) {
+            return -1;
+        }
+
+        if (input_exporter->rate_stats != NULL && format_influx_stats(input_exporter, cur_interface->name_id) < 0) {
+            return -1;
+        }
+
+        if (string_buffer_printf(buffer, " %" PRIu64 "\n", realtime_ns) < 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/* one JSON object per alert event of the sample, told from a sample by its "alert" member */
+static int format_json_alerts(struct exporter *input_exporter) {
+    struct string_buffer *buffer = &input_exporter->buffer;
+
+    for (size_t e = 0; e < alerts_event_count(input_exporter->alert_rules); ++e) {
+        const struct alert_event *event = alerts_event(input_exporter->alert_rules, e);
+
+        if (string_buffer_printf(buffer, "{\"monotonic_ns\":%" PRIu64 ",\"realtime_ns\":%" PRIu64 ",\"host\":\"", event->timestamp_ns, event->realtime_ns) < 0 ||
+            append_json_string(buffer, input_exporter->hostname) < 0 ||
+            string_buffer_printf(buffer, "\",\"alert\":{\"rule\":\"") < 0 ||
+            append_json_string(buffer, event->rule) < 0 ||
+            string_buffer_printf(buffer, "\",\"state\":\"%s\",\"interface\":\"", event->active_flag > 0 ? "raised" : "cleared") < 0 ||
+            append_json_string(buffer, infiniband_interface_name(event->name_id)) < 0 ||
+            string_buffer_printf(buffer, "\",\"condition\":\"") < 0 ||
+            append_json_string(buffer, event->condition) < 0 ||
+            string_buffer_printf(buffer, "\",\"value\":%.3f}}\n", event->value) < 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/* one ib_alert point per alert event of the sample; the condition string field is escaped like a JSON string */
+static int format_influx_alerts(struct exporter *input_exporter) {
+    struct string_buffer *buffer = &input_exporter->buffer;
+
+    for (size_t e = 0; e < alerts_event_count(input_exporter->alert_rules); ++e) {
+        const struct alert_event *event = alerts_event(input_exporter->alert_rules, e);
+
+        if (string_buffer_printf(buffer, "ib_alert,host=") < 0 ||
+            append_influx_tag(buffer, input_exporter->hostname) < 0 ||
+            string_buffer_printf(buffer, ",interface=") < 0 ||
+            append_influx_tag(buffer, infiniband_interface_name(event->name_id)) < 0 ||
+            string_buffer_printf(buffer, ",rule=") < 0 ||
+            append_influx_tag(buffer, event->rule) < 0 ||
+            string_buffer_printf(buffer, " monotonic_ns=%" PRIu64 "u,active=%s,value=%.3f,condition=\"", event->timestamp_ns, event->active_flag > 0 ? "true" : "false",
+                                 event->value) < 0 ||
+            append_json_string(buffer, event->condition) < 0 ||
+            string_buffer_printf(buffer, "\" %" PRIu64 "\n", event->realtime_ns) < 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/* format one sample and write it with a single flush; rates need prev_metrics, which may be NULL */
+int exporter_write(struct exporter *input_exporter, const struct infiniband_metrics *cur_metrics, const struct infiniband_metrics *prev_metrics) {
+    int ret;
+
+    /* rates only make sense over a positive interval */
+    if (prev_metrics != NULL && cur_metrics->timestamp_ns <= prev_metrics->timestamp_ns) {
+        prev_metrics = NULL;
+    }
+
+    if (prev_metrics != NULL && infiniband_metrics_positions(prev_metrics, &input_exporter->prev_positions, &input_exporter->prev_positions_size) < 0) {
+        fprintf(stderr, "ERROR: failed to allocate interface index\n");
+        return -1;
+    }
+
+    uint64_t elapsed_ns = prev_metrics != NULL ? cur_metrics->timestamp_ns - prev_metrics->timestamp_ns : 0;
+
+    uint64_t realtime_ns = cur_metrics->realtime_ns;
+
+    input_exporter->buffer.length = 0;
+
+    switch (input_exporter->format) {
+        case EXPORTER_FORMAT_JSON:
+            ret = format_json(input_exporter, cur_metrics, prev_metrics, realtime_ns, elapsed_ns);
+            break;
+        case EXPORTER_FORMAT_INFLUX:
+            ret = format_influx(input_exporter, cur_metrics, prev_metrics, realtime_ns, elapsed_ns);
+            break;
+        default:
+            ret = format_csv(input_exporter, cur_metrics, prev_metrics, realtime_ns, elapsed_ns);
+            break;
+    }
+
+    if (ret == 0 && input_exporter->alert_rules != NULL) {
+        if (input_exporter->format == EXPORTER_FORMAT_JSON) {
+            ret = format_json_alerts(input_exporter);
+        } else if (input_exporter->format == EXPORTER_FORMAT_INFLUX) {
+            ret = format_influx_alerts(input_exporter);
+        }
+    }
+
+    if (ret < 0) {
+        fprintf(stderr, "ERROR: failed to format sample\n");
+        return -1;
+    }
+
+    if (write_full(input_exporter->fd, input_exporter->buffer.data, input_exporter->buffer.length) < 0) {
+        fprintf(stderr, "ERROR: failed to write sample: %s\n", strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+void exporter_close(struct exporter *input_exporter) {
+    if (input_exporter == NULL) {
+        return;
+    }
+
+    if (input_exporter->close_flag > 0) {
+        close(input_exporter->fd);
+    }
+
+    string_buffer_free(&input_exporter->buffer);
+    free(input_exporter->prev_positions);
+    free(input_exporter);
+}
@@ -0,0 +1,38 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2025 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef EXPORTER_H
+#define EXPORTER_H
+
+#include "alert.h"
+#include "infiniband.h"
+#include "stats.h"
+
+enum exporter_format {
+    EXPORTER_FORMAT_CSV,
+    EXPORTER_FORMAT_JSON,
+    EXPORTER_FORMAT_INFLUX
+};
+
+struct exporter;
+
+extern int exporter_parse_format(const char *name, enum exporter_format *format);
+extern struct exporter *exporter_open(const char *path, enum exporter_format format, const struct stats *rate_stats, const struct alerts *alert_rules);
+extern int exporter_write(struct exporter *input_exporter, const struct infiniband_metrics *cur_metrics, const struct infiniband_metrics *prev_metrics);
+extern void exporter_close(struct exporter *input_exporter);
+
+#endif /* EXPORTER_H */
@@ -0,0 +1,183 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2025 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "delta.h"
+#include "history.h"
+#include "infiniband.h"
+
+/* counter of each direction */
+static const enum infiniband_counter history_counters[HISTORY_DIRECTION_COUNT] = {
+    [HISTORY_RX] = IB_COUNTER_PORT_RCV_DATA,
+    [HISTORY_TX] = IB_COUNTER_PORT_XMIT_DATA,
+};
+
+/* data rates of one port in bit per second, -1 where the delta did not describe the interval */
+struct port_history {
+    /* timestamp of the newest rate; an older one (e.g.: a replay seeking back) starts over */
+    uint64_t timestamp_ns;
+
+    /* slot the next rate goes to, and how many slots hold one */
+    size_t head;
+    size_t count;
+
+    /* rates[direction * length + slot] */
+    float rates[];
+};
+
+struct history {
+    size_t length;
+
+    /* per interface name id, allocated when the port first has a rate; never resized after */
+    struct port_history **ports;
+    size_t port_capacity;
+
+    /* position of every interface name id in the previous snapshot */
+    int *prev_positions;
+    size_t prev_positions_size;
+};
+
+struct history *history_create(size_t length) {
+    struct history *new_history = calloc(1, sizeof(*new_history));
+    if (new_history == NULL) {
+        fprintf(stderr, "ERROR: failed to allocate rate history\n");
+        return NULL;
+    }
+
+    new_history->length = length < HISTORY_MAX_LENGTH ? length : HISTORY_MAX_LENGTH;
+
+    return new_history;
+}
+
+size_t history_length(const struct history *input_history) {
+    return input_history->length;
+}
+
+static size_t port_history_size(const struct history *input_history) {
+    return sizeof(struct port_history) + HISTORY_DIRECTION_COUNT * input_history->length * sizeof(float);
+}
+
+static struct port_history *port_history_get(struct history *input_history, uint16_t name_id) {
+    if (name_id >= input_history->port_capacity) {
+        size_t new_capacity = infiniband_interface_id_count();
+        if (name_id >= new_capacity) {
+            return NULL;
+        }
+
+        struct port_history **new_ports = realloc(input_history->ports, new_capacity * sizeof(*new_ports));
+        if (new_ports == NULL) {
+            return NULL;
+        }
+
+        memset(new_ports + input_history->port_capacity, 0, (new_capacity - input_history->port_capacity) * sizeof(*new_ports));
+        input_history->ports = new_ports;
+        input_history->port_capacity = new_capacity;
+    }
+
+    if (input_history->ports[name_id] == NULL) {
+        input_history->ports[name_id] = calloc(1, port_history_size(input_history));
+    }
+
+    return input_history->ports[name_id];
+}
+
+/* append the data rates between prev_metrics and cur_metrics, dropping the oldest; prev_metrics may be NULL */
+int history_update(struct history *input_history, const struct infiniband_metrics *cur_metrics, const struct infiniband_metrics *prev_metrics) {
+    if (prev_metrics == NULL || cur_metrics->timestamp_ns <= prev_metrics->timestamp_ns || input_history->length == 0) {
+        return 0;
+    }
+
+    if (infiniband_metrics_positions(prev_metrics, &input_history->prev_positions, &input_history->prev_positions_size) < 0) {
+        return -1;
+    }
+
+    uint64_t now_ns = cur_metrics->timestamp_ns;
+    uint64_t elapsed_ns = now_ns - prev_metrics->timestamp_ns;
+
+    for (int i = 0; i < cur_metrics->interface_count; ++i) {
+        int j = input_history->prev_positions[cur_metrics->infiniband[i].name_id];
+        if (j < 0) {
+            continue;
+        }
+
+        struct port_history *port = port_history_get(input_history, cur_metrics->infiniband[i].name_id);
+        if (port == NULL) {
+            return -1;
+        }
+
+        if (now_ns < port->timestamp_ns) {
+            memset(port, 0, port_history_size(input_history));
+        }
+        port->timestamp_ns = now_ns;
+
+        double link_gbps = infiniband_rate_gbps(cur_metrics->infiniband[i].rate_id);
+        unsigned int port_flags = port_delta_flags(cur_metrics, prev_metrics, i, j);
+
+        for (size_t d = 0; d < HISTORY_DIRECTION_COUNT; ++d) {
+            enum infiniband_counter counter = history_counters[d];
+            uint64_t delta;
+            unsigned int flags = port_flags | counter_delta(counter, cur_metrics->counters[counter][i], prev_metrics->counters[counter][j], elapsed_ns, link_gbps, &delta);
+
+            /* data counters count 4-byte words */
+            double rate = (double)delta * 4 * 8 / ((double)elapsed_ns / 1e9);
+            port->rates[d * input_history->length + port->head] = flags & DELTA_UNUSABLE ? -1.0f : (float)rate;
+        }
+
+        port->head = (port->head + 1) % input_history->length;
+        if (port->count < input_history->length) {
+            ++port->count;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * copy the newest count data rates in direction of the interface with name_id into rates, oldest
+ * first, and return how many there were
+ */
+size_t history_read(const struct history *input_history, uint16_t name_id, enum history_direction direction, float *rates, size_t count) {
+    if (name_id >= input_history->port_capacity || input_history->ports[name_id] == NULL) {
+        return 0;
+    }
+
+    const struct port_history *port = input_history->ports[name_id];
+    const float *ring = &port->rates[(size_t)direction * input_history->length];
+
+    count = count < port->count ? count : port->count;
+    for (size_t k = 0; k < count; ++k) {
+        rates[k] = ring[(port->head + input_history->length - count + k) % input_history->length];
+    }
+
+    return count;
+}
+
+void history_free(struct history *input_history) {
+    if (input_history == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; i < input_history->port_capacity; ++i) {
+        free(input_history->ports[i]);
+    }
+
+    free(input_history->ports);
+    free(input_history->prev_positions);
+    free(input_history);
+}
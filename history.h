@@ -0,0 +1,46 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2025 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "infiniband.h"
+
+/* samples kept per port unless --graph is given */
+#define HISTORY_DEFAULT_LENGTH 60
+
+/* at most this many samples can be kept per port */
+#define HISTORY_MAX_LENGTH 1024
+
+/* directions whose data rate is kept */
+enum history_direction {
+    HISTORY_RX,
+    HISTORY_TX,
+    HISTORY_DIRECTION_COUNT
+};
+
+struct history;
+
+extern struct history *history_create(size_t length);
+extern int history_update(struct history *input_history, const struct infiniband_metrics *cur_metrics, const struct infiniband_metrics *prev_metrics);
+extern size_t history_length(const struct history *input_history);
+extern size_t history_read(const struct history *input_history, uint16_t name_id, enum history_direction direction, float *rates, size_t count);
+extern void history_free(struct history *input_history);
+
+#endif /* HISTORY_H */
@@ -0,0 +1,486 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2025 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <ncurses.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "codec.h"
+#include "infiniband.h"
+#include "ncurses_utils.h"
+#include "sysfs_generator.h"
+#include "utils.h"
+
+/* port counts benchmarked unless -p is given */
+static const unsigned int default_port_counts[] = {1, 16, 64, 256};
+
+/* ports are spread over devices with this many ports each, like a multi-port HCA */
+#define BENCH_PORTS_PER_DEVICE 8
+
+/* samples taken before measuring so discovery and first-touch costs are excluded */
+#define BENCH_WARMUP_COUNT 16
+
+/* file descriptors per port: the generator's counter files plus the monitor's */
+#define BENCH_FDS_PER_PORT (2 * IB_COUNTER_COUNT + 8)
+
+#define MAX_PORT_COUNTS 16
+
+/* define usage function */
+static void usage(void) {
+    printf(
+        "InfiniBand Traffic Monitor Benchmark\n"
+        "usage: ib-bench [-i|--iterations <count>] [-p|--ports <count>[,<count>...]]\n"
+        "                [-n|--netlink]\n"
+        "                [-h|--help]\n"
+    );
+}
+
+/*
+ * allocation counting: malloc and friends are interposed and forwarded to glibc.
+ * only calls made while allocation_counting is set are counted
+ */
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *pointer, size_t size);
+extern void __libc_free(void *pointer);
+
+static int allocation_counting = 0;
+static uint64_t allocation_count = 0;
+
+void *malloc(size_t size) {
+    allocation_count += (uint64_t)allocation_counting;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+    allocation_count += (uint64_t)allocation_counting;
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *pointer, size_t size) {
+    allocation_count += (uint64_t)allocation_counting;
+    return __libc_realloc(pointer, size);
+}
+
+void free(void *pointer) {
+    __libc_free(pointer);
+}
+
+/* read and write syscalls issued by this process so far, from /proc/self/io kept open */
+static int io_fd = -1;
+static int read_syscall_count(uint64_t *output_count) {
+    char buffer[512];
+    uint64_t syscr = 0;
+    uint64_t syscw = 0;
+
+    if (io_fd < 0) {
+        return -1;
+    }
+
+    ssize_t ret_pread = pread(io_fd, buffer, sizeof(buffer) - 1, 0);
+    if (ret_pread <= 0) {
+        return -1;
+    }
+    buffer[ret_pread] = '\0';
+
+    char *field = strstr(buffer, "syscr:");
+    if (field != NULL) {
+        syscr = strtoull(field + 6, NULL, 10);
+    }
+
+    field = strstr(buffer, "syscw:");
+    if (field != NULL) {
+        syscw = strtoull(field + 6, NULL, 10);
+    }
+
+    *output_count = syscr + syscw;
+    return 0;
+}
+
+/* syscalls counted between two back-to-back read_syscall_count calls, i.e. the probe itself */
+static uint64_t syscall_probe_cost(void) {
+    uint64_t first;
+    uint64_t second;
+
+    if (read_syscall_count(&first) < 0 || read_syscall_count(&second) < 0) {
+        return 0;
+    }
+
+    return second - first;
+}
+
+static int compare_uint64(const void *a, const void *b) {
+    uint64_t value_a = *(const uint64_t *)a;
+    uint64_t value_b = *(const uint64_t *)b;
+
+    return (value_a > value_b) - (value_a < value_b);
+}
+
+/* nearest-rank percentile of sorted samples */
+static uint64_t percentile(const uint64_t *sorted_samples, size_t sample_count, unsigned int rank) {
+    size_t index = (sample_count * rank + 99) / 100;
+
+    return sorted_samples[index > 0 ? index - 1 : 0];
+}
+
+static void print_percentiles(const char *label, uint64_t *samples, size_t sample_count) {
+    qsort(samples, sample_count, sizeof(*samples), compare_uint64);
+    printf("  %-22s p50 %10" PRIu64 "  p90 %10" PRIu64 "  p99 %10" PRIu64 "  max %10" PRIu64 " ns\n", label,
+           percentile(samples, sample_count, 50), percentile(samples, sample_count, 90),
+           percentile(samples, sample_count, 99), samples[sample_count - 1]);
+}
+
+/* measure sampling and rendering against a synthetic fabric of port_count ports */
+/* code consecutive samples as the record file and agent stream do, then decode them all back */
+static int bench_codec(struct sysfs_generator *generator, struct infiniband_metrics *input_infiniband_metrics, uint64_t *encode_ns, size_t iteration_count) {
+    struct sample_codec encoder = {0};
+    struct sample_codec decoder = {0};
+    struct string_buffer coded = {0};
+    size_t port_count = (size_t)input_infiniband_metrics->interface_count;
+    size_t counter_count = input_infiniband_metrics->counter_count;
+    int ret = -1;
+
+    if (codec_init(&encoder, port_count, counter_count) < 0 || codec_init(&decoder, port_count, counter_count) < 0) {
+        goto handle_error;
+    }
+
+    for (size_t i = 0; i < iteration_count; ++i) {
+        sysfs_generator_update(generator, get_monotonic_ns());
+        input_infiniband_metrics->interface_count = get_infiniband_metrics(input_infiniband_metrics, 0);
+        if ((size_t)input_infiniband_metrics->interface_count != port_count) {
+            goto handle_error;
+        }
+
+        encoder.next_realtime_ns = input_infiniband_metrics->timestamp_ns;
+        for (size_t j = 0; j < port_count; ++j) {
+            encoder.next_states[2 * j] = input_infiniband_metrics->infiniband[j].state;
+            encoder.next_states[2 * j + 1] = input_infiniband_metrics->infiniband[j].phys_state;
+        }
+        for (size_t k = 0; k < counter_count; ++k) {
+            memcpy(encoder.next_values + k * port_count, input_infiniband_metrics->counters[k], port_count * sizeof(uint64_t));
+        }
+
+        uint64_t start_ns = get_monotonic_ns();
+        if (codec_encode(&encoder, &coded) < 0) {
+            goto handle_error;
+        }
+        encode_ns[i] = get_monotonic_ns() - start_ns;
+    }
+
+    struct wire_reader reader = {(const unsigned char *)coded.data, coded.length, 0};
+    uint64_t start_ns = get_monotonic_ns();
+    for (size_t i = 0; i < iteration_count; ++i) {
+        if (codec_decode(&decoder, &reader) < 0) {
+            goto handle_error;
+        }
+    }
+    uint64_t decode_ns = get_monotonic_ns() - start_ns;
+
+    if (memcmp(decoder.values, encoder.values, port_count * counter_count * sizeof(uint64_t)) != 0) {
+        fprintf(stderr, "ERROR: decoded samples differ from the encoded ones\n");
+        goto handle_error;
+    }
+
+    print_percentiles("encode sample", encode_ns, iteration_count);
+    printf("  %-22s %.0f ns\n", "decode sample", (double)decode_ns / (double)iteration_count);
+    printf("  %-22s %.1f (raw %zu)\n", "coded bytes/sample", (double)coded.length / (double)iteration_count, port_count * (2 + counter_count * sizeof(uint64_t)));
+
+    ret = 0;
+
+handle_error:
+    codec_free(&encoder);
+    codec_free(&decoder);
+    string_buffer_free(&coded);
+
+    return ret;
+}
+
+static int bench_port_count(const char *root, unsigned int port_count, size_t iteration_count) {
+    int ret = -1;
+    struct sysfs_generator *generator = NULL;
+    struct infiniband_metrics *cur_metrics = NULL;
+    struct infiniband_metrics *prev_metrics = NULL;
+    struct infiniband_metrics *swap_metrics;
+    struct render_state render = {0};
+    uint64_t *sample_ns = NULL;
+    uint64_t *render_ns = NULL;
+    FILE *null_handle = NULL;
+    FILE *terminal_handle = NULL;
+    SCREEN *screen = NULL;
+    WINDOW *window = NULL;
+
+    unsigned int ports_per_device = port_count < BENCH_PORTS_PER_DEVICE ? port_count : BENCH_PORTS_PER_DEVICE;
+    struct sysfs_generator_config config = {
+        .root = root,
+        .device_count = (port_count + ports_per_device - 1) / ports_per_device,
+        .port_count = ports_per_device,
+        .data_bytes_per_second = 10ULL * 1000 * 1000 * 1000,
+        .packets_per_second = 2 * 1000 * 1000,
+        .errors_per_second = 10,
+        .counter_bits = 64,
+        .reset_interval_ns = 0,
+        .ethernet_flag = 0,
+    };
+
+    generator = sysfs_generator_create(&config);
+    cur_metrics = infiniband_metrics_alloc(0);
+    prev_metrics = infiniband_metrics_alloc(0);
+    sample_ns = malloc(iteration_count * sizeof(*sample_ns));
+    render_ns = malloc(iteration_count * sizeof(*render_ns));
+    if (generator == NULL || cur_metrics == NULL || prev_metrics == NULL || sample_ns == NULL || render_ns == NULL) {
+        fprintf(stderr, "ERROR: failed to set up %u port benchmark\n", port_count);
+        goto handle_error;
+    }
+
+    /* warm up: discovery, fd opening and snapshot growth happen here */
+    for (int i = 0; i < BENCH_WARMUP_COUNT; ++i) {
+        sysfs_generator_update(generator, get_monotonic_ns());
+        prev_metrics->interface_count = get_infiniband_metrics(prev_metrics, 0);
+        if (prev_metrics->interface_count <= 0) {
+            fprintf(stderr, "ERROR: no ports discovered under %s\n", root);
+            goto handle_error;
+        }
+    }
+
+    /* sampling; syscalls are counted around each call only, so the generator's writes are excluded */
+    uint64_t probe_cost = syscall_probe_cost();
+    uint64_t syscall_total = 0;
+    uint64_t allocation_total;
+    int syscall_ret = 0;
+
+    allocation_count = 0;
+    for (size_t i = 0; i < iteration_count; ++i) {
+        uint64_t syscall_start = 0;
+        uint64_t syscall_end = 0;
+
+        sysfs_generator_update(generator, get_monotonic_ns());
+
+        syscall_ret |= read_syscall_count(&syscall_start);
+        allocation_counting = 1;
+        uint64_t start_ns = get_monotonic_ns();
+        cur_metrics->interface_count = get_infiniband_metrics(cur_metrics, 0);
+        sample_ns[i] = get_monotonic_ns() - start_ns;
+        allocation_counting = 0;
+        syscall_ret |= read_syscall_count(&syscall_end);
+
+        syscall_total += syscall_end - syscall_start - probe_cost;
+    }
+    allocation_total = allocation_count;
+
+    printf("%u ports (%u devices x %u ports), %zu iterations\n", port_count, config.device_count, config.port_count, iteration_count);
+    print_percentiles("get_infiniband_metrics", sample_ns, iteration_count);
+    if (syscall_ret == 0) {
+        printf("  %-22s %.1f\n", "read/write syscalls", (double)syscall_total / (double)iteration_count);
+    } else {
+        printf("  %-22s unavailable\n", "read/write syscalls");
+    }
+    printf("  %-22s %.2f\n", "allocations", (double)allocation_total / (double)iteration_count);
+
+    if (bench_codec(generator, cur_metrics, sample_ns, iteration_count) < 0) {
+        fprintf(stderr, "ERROR: failed to benchmark the sample codec\n");
+        goto handle_error;
+    }
+
+    /* rendering into a terminal backed by a temporary file, which tells what frames send; rows past the screen are not drawn */
+    setenv("LINES", "60", 1);
+    setenv("COLUMNS", "160", 1);
+
+    null_handle = fopen("/dev/null", "r");
+    terminal_handle = tmpfile();
+    if (null_handle != NULL && terminal_handle != NULL) {
+        screen = newterm("xterm", terminal_handle, null_handle);
+    }
+    if (screen == NULL || (window = newwin(0, 0, 0, 0)) == NULL) {
+        printf("  %-22s unavailable\n\n", "render");
+        ret = 0;
+        goto handle_error;
+    }
+
+    struct stat terminal_stat;
+    off_t terminal_start = fstat(fileno(terminal_handle), &terminal_stat) == 0 ? terminal_stat.st_size : 0;
+
+    allocation_count = 0;
+    for (size_t i = 0; i < iteration_count; ++i) {
+        sysfs_generator_update(generator, get_monotonic_ns());
+        cur_metrics->interface_count = get_infiniband_metrics(cur_metrics, 0);
+
+        allocation_counting = 1;
+        uint64_t start_ns = get_monotonic_ns();
+        if (render_infiniband_metrics(window, &render, cur_metrics, prev_metrics, NULL, NULL, NULL, NULL, NULL) < 0) {
+            allocation_counting = 0;
+            fprintf(stderr, "ERROR: failed to render frame\n");
+            goto handle_error;
+        }
+        wrefresh(window);
+        render_ns[i] = get_monotonic_ns() - start_ns;
+        allocation_counting = 0;
+
+        swap_metrics = prev_metrics;
+        prev_metrics = cur_metrics;
+        cur_metrics = swap_metrics;
+    }
+    allocation_total = allocation_count;
+
+    off_t terminal_end = fstat(fileno(terminal_handle), &terminal_stat) == 0 ? terminal_stat.st_size : 0;
+
+    print_percentiles("render frame", render_ns, iteration_count);
+    printf("  %-22s %.2f\n", "allocations per frame", (double)allocation_total / (double)iteration_count);
+    printf("  %-22s %.0f\n\n", "terminal bytes/frame", (double)(terminal_end - terminal_start) / (double)iteration_count);
+
+    ret = 0;
+
+handle_error:
+    if (window != NULL) {
+        delwin(window);
+    }
+    if (screen != NULL) {
+        endwin();
+        delscreen(screen);
+    }
+    if (null_handle != NULL) {
+        fclose(null_handle);
+    }
+    if (terminal_handle != NULL) {
+        fclose(terminal_handle);
+    }
+
+    /* drop the ports so the next port count is discovered from scratch */
+    close_infiniband_metrics();
+    render_state_free(&render);
+    infiniband_metrics_free(cur_metrics);
+    infiniband_metrics_free(prev_metrics);
+    free(sample_ns);
+    free(render_ns);
+    if (generator != NULL) {
+        sysfs_generator_destroy(generator, 1);
+    }
+
+    return ret;
+}
+
+int main(int argc, char *argv[]) {
+    /* define command-line options */
+    char *short_opts = "i:p:nh";
+    struct option long_opts[] = {
+        {"iterations", required_argument, NULL, 'i'},
+        {"ports", required_argument, NULL, 'p'},
+        {"netlink", no_argument, NULL, 'n'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+
+    size_t iteration_count = 1000;
+    unsigned int port_counts[MAX_PORT_COUNTS];
+    size_t port_count_size = 0;
+    int exit_code = EXIT_SUCCESS;
+    int c;
+
+    for (size_t i = 0; i < SIZEOF(default_port_counts); ++i) {
+        port_counts[port_count_size++] = default_port_counts[i];
+    }
+
+    /* suppress default getopt error messages */
+    opterr = 0;
+
+    while ((c = getopt_long(argc, argv, short_opts, long_opts, NULL)) != -1) {
+        char *end;
+
+        switch (c) {
+            case 'i':
+                errno = 0;
+                iteration_count = strtoul(optarg, &end, 10);
+                if (errno != 0 || end == optarg || *end != '\0' || iteration_count == 0) {
+                    fprintf(stderr, "ERROR: invalid iteration count: %s\n\n", optarg);
+                    usage();
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'p':
+                port_count_size = 0;
+                for (char *token = strtok(optarg, ","); token != NULL; token = strtok(NULL, ",")) {
+                    unsigned long value = strtoul(token, &end, 10);
+                    if (end == token || *end != '\0' || value == 0 || value > UINT16_MAX || port_count_size == MAX_PORT_COUNTS) {
+                        fprintf(stderr, "ERROR: invalid port count: %s\n\n", token);
+                        usage();
+                        exit(EXIT_FAILURE);
+                    }
+                    port_counts[port_count_size++] = (unsigned int)value;
+                }
+                break;
+            case 'n':
+                infiniband_set_backend(IB_BACKEND_NETLINK);
+                break;
+            case 'h':
+                usage();
+                exit(EXIT_SUCCESS);
+            default:
+                fprintf(stderr, "ERROR: Unknown option\n\n");
+                usage();
+                exit(EXIT_FAILURE);
+        }
+    }
+
+    /* every port keeps its files open; use all the descriptors the hard limit allows */
+    struct rlimit file_limit = {RLIM_INFINITY, RLIM_INFINITY};
+    if (getrlimit(RLIMIT_NOFILE, &file_limit) == 0) {
+        file_limit.rlim_cur = file_limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &file_limit);
+        getrlimit(RLIMIT_NOFILE, &file_limit);
+    }
+
+    io_fd = open("/proc/self/io", O_RDONLY | O_CLOEXEC);
+
+    char root[] = "/tmp/ib-bench.XXXXXX";
+    if (mkdtemp(root) == NULL) {
+        fprintf(stderr, "ERROR: failed to create temporary directory: %s\n", strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    char fabric_root[sizeof(root) + 16];
+    snprintf(fabric_root, sizeof(fabric_root), "%s/fabric", root);
+    if (infiniband_set_sysfs_root(fabric_root) < 0) {
+        rmdir(root);
+        exit(EXIT_FAILURE);
+    }
+
+    for (size_t i = 0; i < port_count_size; ++i) {
+        if ((rlim_t)port_counts[i] * BENCH_FDS_PER_PORT + 64 > file_limit.rlim_cur) {
+            printf("%u ports: skipped, needs more than %ju file descriptors\n\n", port_counts[i], (uintmax_t)file_limit.rlim_cur);
+            continue;
+        }
+
+        if (bench_port_count(fabric_root, port_counts[i], iteration_count) < 0) {
+            exit_code = EXIT_FAILURE;
+            break;
+        }
+    }
+
+    rmdir(root);
+    if (io_fd >= 0) {
+        close(io_fd);
+    }
+
+    exit(exit_code);
+}
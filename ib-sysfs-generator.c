@@ -0,0 +1,213 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2025 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "sysfs_generator.h"
+#include "utils.h"
+
+/* define usage function */
+static void usage(void) {
+    printf(
+        "InfiniBand Synthetic Fabric Generator\n"
+        "usage: ib-sysfs-generator -o|--output <directory>\n"
+        "                          [-d|--devices <count>] [-p|--ports <count>]\n"
+        "                          [-i|--interval <second(s)>|<n>ms]\n"
+        "                          [-b|--bytes <bytes per second>] [-k|--packets <packets per second>]\n"
+        "                          [-x|--errors <errors per second>]\n"
+        "                          [-w|--wrap-bits <bits>] [-R|--reset <second(s)>]\n"
+        "                          [-e|--ethernet] [-H|--hw-counters] [-P|--processes <count>]\n"
+        "                          [-1|--once] [-K|--keep]\n"
+        "                          [-h|--help]\n"
+    );
+}
+
+/* define SIGINT / SIGTERM signal handler */
+static volatile sig_atomic_t break_flag = 0;
+static void stop_handler(int signo) {
+    (void)signo;
+
+    break_flag = 1;
+}
+
+static unsigned long long parse_count(const char *input, const char *name) {
+    char *end;
+    unsigned long long value;
+
+    errno = 0;
+    value = strtoull(input, &end, 10);
+    if (errno != 0 || end == input || *end != '\0') {
+        fprintf(stderr, "ERROR: invalid %s value: %s\n\n", name, input);
+        usage();
+        exit(EXIT_FAILURE);
+    }
+
+    return value;
+}
+
+int main(int argc, char *argv[]) {
+    /* define command-line options */
+    char *short_opts = "o:d:p:i:b:k:x:w:R:eHP:1Kh";
+    struct option long_opts[] = {
+        {"output", required_argument, NULL, 'o'},
+        {"devices", required_argument, NULL, 'd'},
+        {"ports", required_argument, NULL, 'p'},
+        {"interval", required_argument, NULL, 'i'},
+        {"bytes", required_argument, NULL, 'b'},
+        {"packets", required_argument, NULL, 'k'},
+        {"errors", required_argument, NULL, 'x'},
+        {"wrap-bits", required_argument, NULL, 'w'},
+        {"reset", required_argument, NULL, 'R'},
+        {"ethernet", no_argument, NULL, 'e'},
+        {"hw-counters", no_argument, NULL, 'H'},
+        {"processes", required_argument, NULL, 'P'},
+        {"once", no_argument, NULL, '1'},
+        {"keep", no_argument, NULL, 'K'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+
+    struct sysfs_generator_config config = {
+        .root = NULL,
+        .device_count = 1,
+        .port_count = 1,
+        .data_bytes_per_second = 10ULL * 1000 * 1000 * 1000,
+        .packets_per_second = 2 * 1000 * 1000,
+        .errors_per_second = 0,
+        .counter_bits = 64,
+        .reset_interval_ns = 0,
+        .ethernet_flag = 0,
+        .hw_counters_flag = 0,
+        .process_count = 0,
+    };
+    uint64_t interval_ns = NSEC_PER_SEC;
+    int once_flag = 0;
+    int keep_flag = 0;
+    int c;
+
+    /* suppress default getopt error messages */
+    opterr = 0;
+
+    while ((c = getopt_long(argc, argv, short_opts, long_opts, NULL)) != -1) {
+        switch (c) {
+            case 'o':
+                config.root = optarg;
+                break;
+            case 'd':
+                config.device_count = (unsigned int)parse_count(optarg, "device count");
+                break;
+            case 'p':
+                config.port_count = (unsigned int)parse_count(optarg, "port count");
+                break;
+            case 'i':
+                if (parse_duration_ns(optarg, &interval_ns) < 0 || interval_ns == 0) {
+                    fprintf(stderr, "ERROR: invalid interval value: %s\n\n", optarg);
+                    usage();
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'b':
+                config.data_bytes_per_second = parse_count(optarg, "bytes per second");
+                break;
+            case 'k':
+                config.packets_per_second = parse_count(optarg, "packets per second");
+                break;
+            case 'x':
+                config.errors_per_second = parse_count(optarg, "errors per second");
+                break;
+            case 'w':
+                config.counter_bits = (unsigned int)parse_count(optarg, "wrap bits");
+                break;
+            case 'R':
+                if (parse_duration_ns(optarg, &config.reset_interval_ns) < 0) {
+                    fprintf(stderr, "ERROR: invalid reset value: %s\n\n", optarg);
+                    usage();
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'e':
+                config.ethernet_flag = 1;
+                break;
+            case 'H':
+                config.hw_counters_flag = 1;
+                break;
+            case 'P':
+                config.process_count = (unsigned int)parse_count(optarg, "process count");
+                break;
+            case '1':
+                once_flag = 1;
+                break;
+            case 'K':
+                keep_flag = 1;
+                break;
+            case 'h':
+                usage();
+                exit(EXIT_SUCCESS);
+            default:
+                fprintf(stderr, "ERROR: Unknown option\n\n");
+                usage();
+                exit(EXIT_FAILURE);
+        }
+    }
+
+    if (config.root == NULL) {
+        fprintf(stderr, "ERROR: output directory is required\n\n");
+        usage();
+        exit(EXIT_FAILURE);
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = stop_handler;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    struct sysfs_generator *generator = sysfs_generator_create(&config);
+    if (generator == NULL) {
+        exit(EXIT_FAILURE);
+    }
+
+    /* a one-shot tree stays in place for later runs */
+    if (once_flag > 0) {
+        sysfs_generator_destroy(generator, 0);
+        exit(EXIT_SUCCESS);
+    }
+
+    uint64_t next_update_ns = get_monotonic_ns();
+    while (break_flag == 0) {
+        if (sysfs_generator_update(generator, get_monotonic_ns()) < 0) {
+            fprintf(stderr, "ERROR: failed to update synthetic counters: %s\n", strerror(errno));
+            break;
+        }
+
+        next_update_ns += interval_ns;
+        struct timespec ts = ns_to_timespec(next_update_ns);
+        while (break_flag == 0 && clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+        }
+    }
+
+    sysfs_generator_destroy(generator, keep_flag > 0 ? 0 : 1);
+
+    exit(EXIT_SUCCESS);
+}
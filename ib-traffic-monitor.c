@@ -17,31 +17,70 @@
 
 #include <errno.h>
 #include <getopt.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <locale.h>
 #include <ncurses.h>
 #include <signal.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/ioctl.h>
 #include <sys/select.h>
 #include <sys/types.h>
 #include <time.h>
 #include <unistd.h>
+#include "agent.h"
+#include "aggregator.h"
+#include "alert.h"
+#include "collector.h"
+#include "event_log.h"
+#include "exporter.h"
+#include "history.h"
 #include "infiniband.h"
+#include "metrics_server.h"
 #include "ncurses_utils.h"
+#include "recorder.h"
+#include "replay.h"
+#include "resources.h"
+#include "stats.h"
 #include "utils.h"
 
-#define VERSION "1.3.3"
+#define VERSION "1.28.0"
 
 /* define usage function */
 static void usage(void) {
     printf(
         "InfiniBand Traffic Monitor - Version %s\n"
-        "usage: ib-traffic-monitor [-r|--refresh <second(s)>]\n"
+        "usage: ib-traffic-monitor [-r|--refresh <second(s)>|<n>ms|<n>us]\n"
         "                          [-e|--ethernet]\n"
+        "                          [-n|--netlink] [-M|--netlink-recording <file>]\n"
+        "                          [-s|--sysfs-root <path>]\n"
+        "                          [-c|--counters <pattern>[,<pattern>...]|all|none]\n"
+        "                          [-b|--batch] [-o|--output <file>] [-f|--format csv|json|influx]\n"
+        "                          [-l|--listen <address>:<port>]\n"
+        "                          [-w|--record <file>] [-W|--record-size <n>[K|M|G]]\n"
+        "                          [-p|--replay <file>] [-x|--speed <factor>]\n"
+        "                          [-S|--stats <window>[,<window>...]]\n"
+        "                          [-k|--sort rx|tx|rx-packets|tx-packets|errors] [-t|--top <n>]\n"
+        "                          [-F|--filter <regex>] [-G|--graph <samples>]\n"
+        "                          [-A|--agent <address>:<port>] [-N|--agent-name <name>]\n"
+        "                          [-a|--aggregate <address>:<port>]\n"
+        "                          [-R|--rules <file>] [-E|--alert-exec <command>]\n"
+        "                          [-L|--event-log <file>] [-P|--resources]\n"
         "                          [-h|--help]\n", VERSION
     );
 }
 
-/* define SIGINT signal handler */
+/* lower bound of the refresh period */
+#define MIN_REFRESH_NS (NSEC_PER_MSEC)
+
+/* the UI redraws at most this often no matter how fast samples arrive */
+#define UI_FRAME_NS (50 * NSEC_PER_MSEC)
+
+/* size of the circular record file unless --record-size is given */
+#define DEFAULT_RECORD_SIZE (1ULL << 30)
+
+/* define SIGINT / SIGTERM signal handler */
 static volatile sig_atomic_t break_flag = 0;
 static void sigint_handler(int signo) {
     (void)signo;
@@ -49,18 +88,552 @@ static void sigint_handler(int signo) {
     break_flag = 1;
 }
 
+/* define SIGWINCH signal handler; the window is resized by the UI loop */
+static volatile sig_atomic_t resize_flag = 0;
+static void sigwinch_handler(int signo) {
+    (void)signo;
+
+    resize_flag = 1;
+}
+
+/*
+ * read a key from stdin; the escape sequences of the arrow, page, home and end keys are decoded
+ * into their ncurses key codes. return -1 if stdin is closed
+ */
+static int read_key(void) {
+    char input_c;
+
+    if (read(STDIN_FILENO, &input_c, 1) != 1) {
+        return -1;
+    }
+
+    if (input_c != '\033') {
+        return (unsigned char)input_c;
+    }
+
+    /* the rest of an escape sequence arrives along with the escape itself */
+    char sequence[8] = {0};
+    struct timeval tv = {0, 0};
+    fd_set readfds;
+    FD_ZERO(&readfds);
+    FD_SET(STDIN_FILENO, &readfds);
+    if (select(STDIN_FILENO + 1, &readfds, NULL, NULL, &tv) <= 0 || read(STDIN_FILENO, sequence, sizeof(sequence) - 1) < 2) {
+        return '\033';
+    }
+
+    static const struct {
+        const char *sequence;
+        int key;
+    } keys[] = {
+        {"[A", KEY_UP}, {"[B", KEY_DOWN}, {"[5~", KEY_PPAGE}, {"[6~", KEY_NPAGE},
+        {"[H", KEY_HOME}, {"[F", KEY_END}, {"OH", KEY_HOME}, {"OF", KEY_END}, {"[1~", KEY_HOME}, {"[4~", KEY_END},
+    };
+    for (size_t i = 0; i < SIZEOF(keys); ++i) {
+        if (strcmp(sequence, keys[i].sequence) == 0) {
+            return keys[i].key;
+        }
+    }
+
+    return '\033';
+}
+
+/*
+ * wait until deadline_ns (UINT64_MAX waits forever) or until event_fd becomes readable,
+ * watching stdin if stdin_flag is set; return 1 if 'q' / 'Q' is pressed or SIGINT / SIGTERM is caught
+ * and 2 with the key in *input_key if another key is pressed, or with KEY_RESIZE if the terminal is
+ * resized. with stdin_flag 2 text is typed, so 'q' / 'Q' are keys as well
+ */
+static int wait_for_deadline(uint64_t deadline_ns, int event_fd, int stdin_flag, const sigset_t *signal_mask, int *input_key) {
+    while (1) {
+        uint64_t now_ns = get_monotonic_ns();
+        struct timespec ts;
+        fd_set readfds;
+        int ret_pselect;
+
+        if (now_ns >= deadline_ns) {
+            return 0;
+        }
+
+        /* clear readfds and add the optional stdin and event descriptors */
+        FD_ZERO(&readfds);
+        if (stdin_flag > 0) {
+            FD_SET(STDIN_FILENO, &readfds);
+        }
+        if (event_fd >= 0) {
+            FD_SET(event_fd, &readfds);
+        }
+
+        /* sleep for the remaining time only */
+        ts = ns_to_timespec(deadline_ns - now_ns);
+
+        ret_pselect = pselect((event_fd > STDIN_FILENO ? event_fd : STDIN_FILENO) + 1, &readfds, NULL, NULL, deadline_ns == UINT64_MAX ? NULL : &ts, signal_mask);
+
+        /* consume the event; return to the caller once stdin is handled */
+        int event_flag = 0;
+        if (ret_pselect > 0 && event_fd >= 0 && FD_ISSET(event_fd, &readfds)) {
+            uint64_t event_value;
+            if (read(event_fd, &event_value, sizeof(event_value)) < 0) {
+                /* nothing pending; another wakeup already consumed it */
+            }
+
+            event_flag = 1;
+        }
+
+        /* exit the loop if q / Q is pressed */
+        if (ret_pselect > 0 && stdin_flag > 0 && FD_ISSET(STDIN_FILENO, &readfds)) {
+            int key = read_key();
+            if (key < 0 || (stdin_flag == 1 && (key == 'Q' || key == 'q'))) {
+                return 1;
+            }
+
+            if (input_key != NULL) {
+                *input_key = key;
+                return 2;
+            }
+        }
+
+        /* exit the loop if SIGINT / SIGTERM is caught; report SIGWINCH to a caller taking keys */
+        if (ret_pselect < 0 && errno == EINTR) {
+            if (break_flag > 0) {
+                return 1;
+            }
+
+            if (resize_flag > 0 && input_key != NULL) {
+                resize_flag = 0;
+                *input_key = KEY_RESIZE;
+                return 2;
+            }
+        }
+
+        if (event_flag > 0) {
+            return 0;
+        }
+    }
+}
+
+/* read the local ports; ctx points to the show_ethernet_flag */
+static int read_local_sample(struct infiniband_metrics *input_infiniband_metrics, void *ctx) {
+    const int *show_ethernet_flag = ctx;
+
+    input_infiniband_metrics->interface_count = get_infiniband_metrics(input_infiniband_metrics, *show_ethernet_flag);
+
+    return 1;
+}
+
+/* consumers fed on the collector thread with every sample */
+struct sample_sinks {
+    struct metrics_server *server;
+    struct recorder *recorder;
+    struct agent *agent;
+};
+
+static void publish_sample(const struct infiniband_metrics *input_infiniband_metrics, void *ctx) {
+    struct sample_sinks *sinks = ctx;
+
+    if (sinks->server != NULL) {
+        metrics_server_publish(input_infiniband_metrics, sinks->server);
+    }
+
+    if (sinks->recorder != NULL) {
+        recorder_write(input_infiniband_metrics, sinks->recorder);
+    }
+
+    if (sinks->agent != NULL) {
+        agent_publish(input_infiniband_metrics, sinks->agent);
+    }
+}
+
+/* snapshots owned by the consumer side; exchanged with the collector ring and each other by pointer */
+struct snapshot_buffers {
+    struct infiniband_metrics *cur;
+    struct infiniband_metrics *prev;
+    struct infiniband_metrics *spare;
+};
+
+static void swap_snapshots(struct infiniband_metrics **a, struct infiniband_metrics **b) {
+    struct infiniband_metrics *swap_infiniband_metrics = *a;
+
+    *a = *b;
+    *b = swap_infiniband_metrics;
+}
+
+/* where samples come from: the live collector or a record file */
+struct sample_source {
+    struct collector *collector;
+    struct replay *replay;
+};
+
+/* move the next sample into *input_infiniband_metrics; latest_flag lets a replay skip to the newest due record */
+static int source_take(struct sample_source *source, struct infiniband_metrics **input_infiniband_metrics, int latest_flag) {
+    if (source->collector != NULL) {
+        return collector_take(source->collector, input_infiniband_metrics);
+    }
+
+    return replay_take(source->replay, *input_infiniband_metrics, latest_flag) > 0;
+}
+
+/* copy a failed sample's reason into error_msg; return -1 if the sample holds no interface */
+static int check_sample(const struct infiniband_metrics *input_infiniband_metrics, char *error_msg) {
+    if (input_infiniband_metrics->interface_count < 0) {
+        strcpy(error_msg, "ERROR: unable to retrieve InfiniBand metrics");
+        return -1;
+    }
+
+    if (input_infiniband_metrics->interface_count == 0) {
+        strcpy(error_msg, "ERROR: no InfiniBand device found");
+        return -1;
+    }
+
+    return 0;
+}
+
+/* stream every sample through the exporter, if any, until SIGINT / SIGTERM is caught or a replay ends */
+static int run_batch(struct sample_source *source, struct snapshot_buffers *buffers, struct exporter *metrics_exporter, struct stats *rate_stats, struct alerts *alert_rules,
+                     struct event_log *port_events, const sigset_t *signal_mask, char *error_msg) {
+    /* previous data copy state flag */
+    int prev_data_flag = 0;
+
+    while (1) {
+        /* stdin is not watched; under a service manager it is usually /dev/null */
+        if (source->collector != NULL && wait_for_deadline(UINT64_MAX, collector_event_fd(source->collector), 0, signal_mask, NULL) > 0) {
+            return 0;
+        }
+
+        /* unlike frames, samples are never skipped */
+        while (source_take(source, &buffers->spare, 0) > 0) {
+            swap_snapshots(&buffers->cur, &buffers->spare);
+
+            if (check_sample(buffers->cur, error_msg) < 0) {
+                return -1;
+            }
+
+            if (rate_stats != NULL && stats_update(rate_stats, buffers->cur, prev_data_flag > 0 ? buffers->prev : NULL) < 0) {
+                strcpy(error_msg, "ERROR: failed to allocate rate statistics");
+                return -1;
+            }
+
+            if (alert_rules != NULL && alerts_update(alert_rules, buffers->cur, prev_data_flag > 0 ? buffers->prev : NULL) < 0) {
+                strcpy(error_msg, "ERROR: failed to allocate alert state");
+                return -1;
+            }
+
+            if (port_events != NULL && event_log_update(port_events, buffers->cur, prev_data_flag > 0 ? buffers->prev : NULL) < 0) {
+                strcpy(error_msg, "ERROR: unable to log port events");
+                return -1;
+            }
+
+            if (metrics_exporter != NULL && exporter_write(metrics_exporter, buffers->cur, prev_data_flag > 0 ? buffers->prev : NULL) < 0) {
+                strcpy(error_msg, "ERROR: unable to export InfiniBand metrics");
+                return -1;
+            }
+
+            /* keep the current metrics as previous ones for next calculation */
+            swap_snapshots(&buffers->prev, &buffers->cur);
+            prev_data_flag = 1;
+        }
+
+        /* an unpaced replay hands out every record at once */
+        if (source->replay != NULL) {
+            return 0;
+        }
+    }
+}
+
+/*
+ * replay controls: space pauses, + / - double or halve the speed, < / > seek one minute,
+ * g / G jump to the first / last record. after a seek, the record before the target
+ * becomes the previous sample so the first frame already shows rates. return 1 after a seek
+ */
+static int handle_replay_key(struct replay *input_replay, int input_key, struct snapshot_buffers *buffers, int *prev_data_flag) {
+    int ret_seek;
+
+    switch (input_key) {
+        case ' ':
+            replay_toggle_pause(input_replay);
+            return 0;
+        case '+':
+            replay_scale_speed(input_replay, 2.0);
+            return 0;
+        case '-':
+            replay_scale_speed(input_replay, 0.5);
+            return 0;
+        case '<':
+            ret_seek = replay_seek(input_replay, -(int64_t)(60 * NSEC_PER_SEC));
+            break;
+        case '>':
+            ret_seek = replay_seek(input_replay, (int64_t)(60 * NSEC_PER_SEC));
+            break;
+        case 'g':
+            ret_seek = replay_seek_edge(input_replay, 0);
+            break;
+        case 'G':
+            ret_seek = replay_seek_edge(input_replay, 1);
+            break;
+        default:
+            return 0;
+    }
+
+    *prev_data_flag = ret_seek > 0 && replay_take(input_replay, buffers->prev, 0) > 0;
+
+    return 1;
+}
+
+/* resize main_window to the terminal, whose size ncurses only learns from SIGWINCH on its own */
+static void resize_window(WINDOW *main_window) {
+    struct winsize ws;
+
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_row > 0 && ws.ws_col > 0) {
+        resizeterm(ws.ws_row, ws.ws_col);
+    }
+
+    wresize(main_window, LINES, COLS);
+}
+
+/*
+ * draw the newest sample at most every UI_FRAME_NS until q / Q is pressed or SIGINT / SIGTERM is caught.
+ * scrolling and resizing draw the last sample again right away
+ */
+static int run_tui(struct sample_source *source, struct snapshot_buffers *buffers, struct stats *rate_stats, struct history *rate_history, struct alerts *alert_rules,
+                   struct event_log *port_events, struct resources *process_resources, struct render_view *view, const sigset_t *signal_mask, char *error_msg) {
+    int ret = 0;
+
+    /* rendering state carried across frames */
+    struct render_state render = {0};
+    render.view = view;
+
+    /* previous data copy state flag */
+    int prev_data_flag = 0;
+
+    /* buffers->cur holds the newest sample, and it is on screen as of the last key */
+    int cur_data_flag = 0;
+    int drawn_flag = 0;
+
+    /* frames are throttled to UI_FRAME_NS independently of the sampling cadence */
+    uint64_t next_frame_ns = get_monotonic_ns();
+
+    /* initialize ncurses window struct */
+    WINDOW *main_window;
+    main_window = NULL;
+
+    /* the data rate history is drawn with block elements if the locale's character set has them */
+    setlocale(LC_CTYPE, "");
+
+    /* initialize screen */
+    initscr();
+
+    /* disable line buffering */
+    cbreak();
+
+    /* set cursor state to invisiable */
+    curs_set(0);
+
+    /* create window */
+    main_window = newwin(0, 0, 0, 0);
+
+    if (main_window == NULL) {
+        endwin();
+        strcpy(error_msg, "ERROR: failed to create ncurses window");
+        return -1;
+    }
+
+    /* enable non-blocking input */
+    nodelay(main_window, TRUE);
+
+    /* data collection and refresh logic */
+    while (1) {
+        int input_key = 0;
+
+        /*
+         * throttle frames, then sleep until the collector publishes a snapshot; a replay is
+         * polled once per frame instead. exit if q / Q is pressed or a signal is caught
+         */
+        int stdin_flag = render.filter_edit_flag > 0 ? 2 : 1;
+        int ret_wait = wait_for_deadline(next_frame_ns, -1, stdin_flag, signal_mask, &input_key);
+        if (ret_wait == 0 && source->collector != NULL) {
+            ret_wait = wait_for_deadline(UINT64_MAX, collector_event_fd(source->collector), stdin_flag, signal_mask, &input_key);
+        }
+
+        if (ret_wait == 1) {
+            break;
+        }
+
+        if (ret_wait == 2) {
+            if (input_key == KEY_RESIZE) {
+                resize_window(main_window);
+                drawn_flag = 0;
+            } else if (render_view_key(&render, input_key) > 0 || render_scroll_key(&render, input_key) > 0) {
+                drawn_flag = 0;
+            } else if (source->replay != NULL && handle_replay_key(source->replay, input_key, buffers, &prev_data_flag) > 0) {
+                /* the sample on screen is no longer the one before the next */
+                cur_data_flag = 0;
+            } else if (source->replay == NULL) {
+                continue;
+            }
+        }
+
+        next_frame_ns = get_monotonic_ns() + UI_FRAME_NS;
+
+        /*
+         * drain every queued snapshot; rates span from the previous frame to the newest one, while
+         * statistics see the rate between each snapshot and the one before it
+         */
+        int taken_count = 0;
+        while (source_take(source, &buffers->spare, 1) > 0) {
+            /* keep the current metrics as previous ones for next calculation */
+            if (taken_count == 0 && cur_data_flag > 0) {
+                swap_snapshots(&buffers->prev, &buffers->cur);
+                prev_data_flag = 1;
+            }
+
+            const struct infiniband_metrics *before_metrics = taken_count > 0 ? buffers->cur : prev_data_flag > 0 ? buffers->prev : NULL;
+
+            swap_snapshots(&buffers->cur, &buffers->spare);
+            cur_data_flag = 1;
+            ++taken_count;
+
+            /* stop at the first failed sample so the error is reported */
+            if (buffers->cur->interface_count <= 0) {
+                break;
+            }
+
+            if (stats_update(rate_stats, buffers->cur, before_metrics) < 0) {
+                strcpy(error_msg, "ERROR: failed to allocate rate statistics");
+                ret = -1;
+                break;
+            }
+
+            if (history_update(rate_history, buffers->cur, before_metrics) < 0) {
+                strcpy(error_msg, "ERROR: failed to allocate rate history");
+                ret = -1;
+                break;
+            }
+
+            if (alert_rules != NULL && alerts_update(alert_rules, buffers->cur, before_metrics) < 0) {
+                strcpy(error_msg, "ERROR: failed to allocate alert state");
+                ret = -1;
+                break;
+            }
+
+            if (event_log_update(port_events, buffers->cur, before_metrics) < 0) {
+                strcpy(error_msg, "ERROR: unable to log port events");
+                ret = -1;
+                break;
+            }
+        }
+
+        if (ret < 0) {
+            break;
+        }
+
+        if (taken_count == 0 && (drawn_flag > 0 || cur_data_flag == 0)) {
+            /* keep the replay clock on screen moving, unless a filter is typed there */
+            if (source->replay != NULL && prev_data_flag > 0 && render.filter_edit_flag == 0) {
+                char status[128];
+                replay_status(source->replay, status, sizeof(status));
+                mvwprintw(main_window, LINES - 1, 30, " %-60s", status);
+                wrefresh(main_window);
+            }
+            continue;
+        }
+
+        /* report a failed sample and exit */
+        if (check_sample(buffers->cur, error_msg) < 0) {
+            ret = -1;
+            break;
+        }
+
+        /* the resource thread follows the ports on screen; show the rows it built last */
+        if (process_resources != NULL && resources_update(process_resources, buffers->cur) < 0) {
+            strcpy(error_msg, "ERROR: failed to allocate RDMA resource cache");
+            ret = -1;
+            break;
+        }
+
+        if (render_infiniband_metrics(main_window, &render, buffers->cur, prev_data_flag > 0 ? buffers->prev : NULL, rate_stats, rate_history, alert_rules, port_events,
+                                      process_resources) < 0) {
+            strcpy(error_msg, "ERROR: failed to allocate interface index");
+            ret = -1;
+            break;
+        }
+
+        if (source->replay != NULL && render.filter_edit_flag == 0) {
+            char status[128];
+            replay_status(source->replay, status, sizeof(status));
+            mvwprintw(main_window, LINES - 1, 30, " %-60s", status);
+        }
+
+        wrefresh(main_window);
+
+        drawn_flag = 1;
+    }
+
+    /* terminate ncurses window */
+    wstandend(main_window);
+    delwin(main_window);
+    endwin();
+
+    render_state_free(&render);
+
+    return ret;
+}
+
 int main(int argc, char *argv[]) {
     /* define command-line options */
-    char *short_opts = "r:eh";
+    char *short_opts = "r:enM:s:c:bo:f:l:w:W:p:x:S:k:t:F:G:A:N:a:R:E:L:Ph";
     struct option long_opts[] = {
         {"refresh", required_argument, NULL, 'r'},
         {"ethernet", no_argument, NULL, 'e'},
+        {"netlink", no_argument, NULL, 'n'},
+        {"netlink-recording", required_argument, NULL, 'M'},
+        {"sysfs-root", required_argument, NULL, 's'},
+        {"counters", required_argument, NULL, 'c'},
+        {"batch", no_argument, NULL, 'b'},
+        {"output", required_argument, NULL, 'o'},
+        {"format", required_argument, NULL, 'f'},
+        {"listen", required_argument, NULL, 'l'},
+        {"record", required_argument, NULL, 'w'},
+        {"record-size", required_argument, NULL, 'W'},
+        {"replay", required_argument, NULL, 'p'},
+        {"speed", required_argument, NULL, 'x'},
+        {"stats", required_argument, NULL, 'S'},
+        {"sort", required_argument, NULL, 'k'},
+        {"top", required_argument, NULL, 't'},
+        {"filter", required_argument, NULL, 'F'},
+        {"graph", required_argument, NULL, 'G'},
+        {"agent", required_argument, NULL, 'A'},
+        {"agent-name", required_argument, NULL, 'N'},
+        {"aggregate", required_argument, NULL, 'a'},
+        {"rules", required_argument, NULL, 'R'},
+        {"alert-exec", required_argument, NULL, 'E'},
+        {"event-log", required_argument, NULL, 'L'},
+        {"resources", no_argument, NULL, 'P'},
         {"help", no_argument, NULL, 'h'},
         {NULL, 0, NULL, 0}
     };
 
-    long int refresh_second = 5;
+    uint64_t refresh_ns = 5 * NSEC_PER_SEC;
     int ethernet_flag = 0;
+    int netlink_flag = 0;
+    int batch_flag = 0;
+    const char *output_path = NULL;
+    enum exporter_format output_format = EXPORTER_FORMAT_CSV;
+    const char *listen_address = NULL;
+    const char *record_path = NULL;
+    uint64_t record_size = DEFAULT_RECORD_SIZE;
+    const char *replay_path = NULL;
+    double replay_speed = 1.0;
+    uint64_t stats_window_ns[STATS_WINDOW_MAX];
+    size_t stats_windows = 0;
+    struct render_view view = {0};
+    size_t history_samples = HISTORY_DEFAULT_LENGTH;
+    const char *agent_address = NULL;
+    const char *agent_name = NULL;
+    const char *aggregate_address = NULL;
+    const char *rules_path = NULL;
+    const char *alert_command = NULL;
+    const char *event_log_path = NULL;
+    const char *netlink_recording_path = NULL;
+    int resources_flag = 0;
     int error_flag = 0;
     char error_msg[BUFSIZ];
     int exit_code = EXIT_SUCCESS;
@@ -79,16 +652,14 @@ int main(int argc, char *argv[]) {
 
         switch (c) {
             case 'r':
-                errno = 0;
-                refresh_second = strtol(optarg, NULL, 10);
-
-                if (errno != 0) {
-                    fprintf(stderr, "ERROR: failed to convert refresh second value\n\n");
+                if (parse_duration_ns(optarg, &refresh_ns) < 0) {
+                    fprintf(stderr, "ERROR: failed to convert refresh period value\n\n");
+                    usage();
                     exit(EXIT_FAILURE);
                 }
 
-                if (refresh_second <= 0) {
-                    fprintf(stderr, "ERROR: refresh second must be an integer and greater than 0\n\n");
+                if (refresh_ns < MIN_REFRESH_NS) {
+                    fprintf(stderr, "ERROR: refresh period must be at least 1ms\n\n");
                     usage();
                     exit(EXIT_FAILURE);
                 }
@@ -97,6 +668,139 @@ int main(int argc, char *argv[]) {
             case 'e':
                 ethernet_flag = 1;
                 break;
+            case 'n':
+                infiniband_set_backend(IB_BACKEND_NETLINK);
+                netlink_flag = 1;
+                break;
+            case 'M':
+                if (infiniband_set_netlink_recording(optarg) < 0) {
+                    usage();
+                    exit(EXIT_FAILURE);
+                }
+                netlink_recording_path = optarg;
+                break;
+            case 's':
+                if (infiniband_set_sysfs_root(optarg) < 0) {
+                    usage();
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'c':
+                if (infiniband_set_counter_selection(optarg) < 0) {
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'b':
+                batch_flag = 1;
+                break;
+            case 'o':
+                /* an output file implies batch mode */
+                output_path = optarg;
+                batch_flag = 1;
+                break;
+            case 'f':
+                if (exporter_parse_format(optarg, &output_format) < 0) {
+                    fprintf(stderr, "ERROR: unknown output format: %s\n\n", optarg);
+                    usage();
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'l':
+                listen_address = optarg;
+                break;
+            case 'w':
+                record_path = optarg;
+                break;
+            case 'W':
+                if (parse_size_bytes(optarg, &record_size) < 0) {
+                    fprintf(stderr, "ERROR: invalid record file size: %s\n\n", optarg);
+                    usage();
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'p':
+                replay_path = optarg;
+                break;
+            case 'x': {
+                char *end;
+                replay_speed = strtod(optarg, &end);
+                if (end == optarg || *end != '\0' || !(replay_speed > 0.0)) {
+                    fprintf(stderr, "ERROR: invalid replay speed: %s\n\n", optarg);
+                    usage();
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            }
+            case 'S':
+                if (stats_parse_windows(optarg, stats_window_ns, &stats_windows) < 0) {
+                    fprintf(stderr, "ERROR: invalid statistics windows: %s\n\n", optarg);
+                    usage();
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'k':
+                if (render_parse_sort(optarg, &view.sort) < 0) {
+                    fprintf(stderr, "ERROR: unknown sort order: %s\n\n", optarg);
+                    usage();
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 't': {
+                char *end;
+                long int top = strtol(optarg, &end, 10);
+                if (end == optarg || *end != '\0' || top <= 0 || top > INT_MAX) {
+                    fprintf(stderr, "ERROR: invalid number of ports: %s\n\n", optarg);
+                    usage();
+                    exit(EXIT_FAILURE);
+                }
+                view.top = (int)top;
+                break;
+            }
+            case 'F':
+                if (render_view_set_filter(&view, optarg) < 0) {
+                    fprintf(stderr, "ERROR: invalid filter: %s\n\n", optarg);
+                    usage();
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'G': {
+                char *end;
+                long int samples = strtol(optarg, &end, 10);
+                if (end == optarg || *end != '\0' || samples <= 0 || samples > HISTORY_MAX_LENGTH) {
+                    fprintf(stderr, "ERROR: invalid number of history samples: %s\n\n", optarg);
+                    usage();
+                    exit(EXIT_FAILURE);
+                }
+                history_samples = (size_t)samples;
+                view.graph_flag = 1;
+                break;
+            }
+            case 'A':
+                agent_address = optarg;
+                break;
+            case 'N':
+                if (optarg[0] == '\0' || strlen(optarg) >= AGENT_HOST_NAME_MAX || strchr(optarg, '/') != NULL) {
+                    fprintf(stderr, "ERROR: agent name must be 1 to %d characters without '/': %s\n\n", AGENT_HOST_NAME_MAX - 1, optarg);
+                    usage();
+                    exit(EXIT_FAILURE);
+                }
+                agent_name = optarg;
+                break;
+            case 'a':
+                aggregate_address = optarg;
+                break;
+            case 'R':
+                rules_path = optarg;
+                break;
+            case 'E':
+                alert_command = optarg;
+                break;
+            case 'L':
+                event_log_path = optarg;
+                break;
+            case 'P':
+                resources_flag = 1;
+                break;
             case 'h':
                 usage();
                 exit(EXIT_SUCCESS);
@@ -111,27 +815,155 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    /* a replay reads a record file instead of the devices */
+    if (replay_path != NULL && (listen_address != NULL || record_path != NULL || agent_address != NULL || aggregate_address != NULL)) {
+        fprintf(stderr, "ERROR: --replay cannot be combined with --listen, --record, --agent or --aggregate\n\n");
+        usage();
+        exit(EXIT_FAILURE);
+    }
+
+    /* an aggregator shows the ports of its agents instead of its own */
+    if (aggregate_address != NULL && agent_address != NULL) {
+        fprintf(stderr, "ERROR: --aggregate cannot be combined with --agent\n\n");
+        usage();
+        exit(EXIT_FAILURE);
+    }
+
+    /* a hook command runs on the events of alert rules */
+    if (alert_command != NULL && rules_path == NULL) {
+        fprintf(stderr, "ERROR: --alert-exec needs --rules\n\n");
+        usage();
+        exit(EXIT_FAILURE);
+    }
+
+    /* the processes behind the local ports are only listed on the screen */
+    if (resources_flag > 0 && (replay_path != NULL || aggregate_address != NULL || batch_flag > 0 || listen_address != NULL || agent_address != NULL)) {
+        fprintf(stderr, "ERROR: --resources cannot be combined with --replay, --aggregate, --batch, --output, --listen or --agent\n\n");
+        usage();
+        exit(EXIT_FAILURE);
+    }
+
     /* check if host OS is Linux */
     if (is_linux() != 1) {
         fprintf(stderr, "ERROR: InfiniBand Traffic Monitor can be only running on Linux operating system\n");
         exit(EXIT_FAILURE);
     }
 
-    /* initialize metric structs */
-    struct infiniband_metrics cur_infiniband_metrics;
-    struct infiniband_metrics prev_infiniband_metrics;
+    /* initialize metric structs; snapshots are exchanged with the collector ring by pointer */
+    struct snapshot_buffers buffers;
+    buffers.cur = infiniband_metrics_alloc(0);
+    buffers.prev = infiniband_metrics_alloc(0);
+    buffers.spare = infiniband_metrics_alloc(0);
 
-    /* delimiter positions */
-    int interface_status_positions[] = {17, 27, 44, 62, 81};
-    int interface_io_positions[] = {17, 31, 43, 57, 69, 86, 103, 120};
-    int interface_error_positions[] = {17, 26, 35, 51, 69, 81, 93, 110, 123};
-    int interface_link_error_positions[] = {17, 39, 62};
+    if (buffers.cur == NULL || buffers.prev == NULL || buffers.spare == NULL) {
+        fprintf(stderr, "ERROR: failed to allocate metric structs\n");
+        exit(EXIT_FAILURE);
+    }
 
-    /* previous data copy state flag */
-    int prev_data_flag = 0;
+    /*
+     * rate statistics are always shown in the TUI; batch output only carries them when --stats
+     * is given, so the default stream stays the same; the screen shows only the data rates, so
+     * only those get histograms there
+     */
+    struct stats *rate_stats;
+    rate_stats = NULL;
+
+    if (batch_flag == 0 || stats_windows > 0) {
+        if (stats_windows == 0 && stats_parse_windows(STATS_DEFAULT_WINDOWS, stats_window_ns, &stats_windows) < 0) {
+            exit(EXIT_FAILURE);
+        }
 
-    /* initialize previous infiniband interface return value */
-    int prev_ret_get_infiniband_metrics;
+        rate_stats = stats_create(stats_window_ns, stats_windows, batch_flag > 0 ? STATS_ALL_COUNTERS : RENDER_STATS_COUNTERS);
+        if (rate_stats == NULL) {
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    /* the screen keeps a short data rate history of every port, shown with --graph or on demand */
+    struct history *rate_history;
+    rate_history = NULL;
+
+    if (batch_flag == 0) {
+        rate_history = history_create(history_samples);
+        if (rate_history == NULL) {
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    /* alert rules are evaluated on every sample in any mode, loaded first so a bad rule fails early */
+    struct alerts *alert_rules;
+    alert_rules = NULL;
+
+    if (rules_path != NULL) {
+        alert_rules = alerts_load(rules_path, alert_command);
+        if (alert_rules == NULL) {
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    /* the screen lists recent port state changes; they are only tracked headless when logged to a file */
+    struct event_log *port_events;
+    port_events = NULL;
+
+    if (batch_flag == 0 || event_log_path != NULL) {
+        port_events = event_log_open(event_log_path);
+        if (port_events == NULL) {
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    /* the RDMA resources of the local ports come from the kernel resource tracker, or from the recording given with --netlink-recording */
+    struct resources *process_resources;
+    process_resources = NULL;
+
+    if (resources_flag > 0) {
+        process_resources = resources_open(netlink_recording_path);
+        if (process_resources == NULL) {
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    /* open the output stream before sampling so a bad path fails early */
+    struct exporter *metrics_exporter;
+    metrics_exporter = NULL;
+
+    if (batch_flag > 0) {
+        metrics_exporter = exporter_open(output_path, output_format, rate_stats, alert_rules);
+        if (metrics_exporter == NULL) {
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    /* the /metrics endpoint, the record file and the agent stream are fed on the collector thread once per sample */
+    struct sample_sinks sinks = {NULL, NULL, NULL};
+
+    if (listen_address != NULL) {
+        sinks.server = metrics_server_start(listen_address);
+        if (sinks.server == NULL) {
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (record_path != NULL) {
+        sinks.recorder = recorder_open(record_path, record_size);
+        if (sinks.recorder == NULL) {
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (agent_address != NULL) {
+        sinks.agent = agent_open(agent_address, agent_name, refresh_ns);
+        if (sinks.agent == NULL) {
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    /* collector thread sampling the counters, or a record file played back */
+    struct sample_source source = {NULL, NULL};
+
+    /* agents reporting to this instance; the collector samples their merged ports */
+    struct aggregator *fabric_aggregator;
+    fabric_aggregator = NULL;
 
     /* initialize signal-related variables */
     struct sigaction sa;
@@ -148,15 +980,15 @@ int main(int argc, char *argv[]) {
         exit(EXIT_FAILURE);
     }
 
-    /* add SIGINT signal in signal_block_set */
-    if (sigaddset(&signal_block_set, SIGINT) < 0) {
-        fprintf(stderr, "ERROR: failed to add SIGINT signal in signal_block_set\n");
+    /* add SIGINT, SIGTERM and SIGWINCH signals in signal_block_set */
+    if (sigaddset(&signal_block_set, SIGINT) < 0 || sigaddset(&signal_block_set, SIGTERM) < 0 || sigaddset(&signal_block_set, SIGWINCH) < 0) {
+        fprintf(stderr, "ERROR: failed to add SIGINT / SIGTERM / SIGWINCH signals in signal_block_set\n");
         exit(EXIT_FAILURE);
     }
 
-    /* block SIGINT signal */
+    /* block SIGINT, SIGTERM and SIGWINCH signals */
     if (sigprocmask(SIG_BLOCK, &signal_block_set, NULL) < 0) {
-        fprintf(stderr, "ERROR: failed to block SIGINT signal\n");
+        fprintf(stderr, "ERROR: failed to block SIGINT / SIGTERM / SIGWINCH signals\n");
         exit(EXIT_FAILURE);
     }
 
@@ -169,170 +1001,79 @@ int main(int argc, char *argv[]) {
         exit(EXIT_FAILURE);
     }
 
-    if (sigaction(SIGINT, &sa, NULL) < 0) {
+    if (sigaction(SIGINT, &sa, NULL) < 0 || sigaction(SIGTERM, &sa, NULL) < 0) {
         fprintf(stderr, "ERROR: failed to install signal handler\n");
         exit(EXIT_FAILURE);
     }
 
-    /* initialize ncurses window struct */
-    WINDOW *main_window;
-    main_window = NULL;
-
-    /* initialize screen */
-    initscr();
-
-    /* disable line buffering */
-    cbreak();
-
-    /* set cursor state to invisiable */
-    curs_set(0);
-
-    /* create window */
-    main_window = newwin(0, 0, 0, 0);
-
-    if (main_window == NULL) {
-        fprintf(stderr, "ERROR: failed to create ncurses window\n");
-        endwin();
+    sa.sa_handler = sigwinch_handler;
+    if (sigaction(SIGWINCH, &sa, NULL) < 0) {
+        fprintf(stderr, "ERROR: failed to install SIGWINCH signal handler\n");
         exit(EXIT_FAILURE);
     }
 
-    /* enable non-blocking input */
-    nodelay(main_window, TRUE);
-
-    /* data collection and refresh logic */
-    while (1) {
-        /* clear window */
-        wclear(main_window);
-
-        /* create window boarder */
-        box(main_window, 0, 0);
-
-        /* initialize variables */
-        int ret_get_infiniband_metrics;
-
-        int infiniband_name_found = 0;
-
-        /* pselect() use */
-        struct timespec ts;
-        fd_set readfds;
-        int ret_pselect;
-
-        /* retrieve metrics for infiniband_metrics */
-        ret_get_infiniband_metrics = get_infiniband_metrics(&cur_infiniband_metrics, ethernet_flag);
-        if (ret_get_infiniband_metrics < 0) {
-            strcpy(error_msg, "ERROR: unable to retrieve InfiniBand metrics");
-            ++error_flag;
-            break;
+    /* start sampling; the thread inherits the blocked signal mask. batch replays are not paced */
+    if (replay_path != NULL) {
+        source.replay = replay_open(replay_path, replay_speed, batch_flag == 0);
+        if (source.replay == NULL) {
+            exit(EXIT_FAILURE);
         }
-
-        if (ret_get_infiniband_metrics == 0) {
-            strcpy(error_msg, "ERROR: no InfiniBand device found");
-            ++error_flag;
-            break;
+    } else if (aggregate_address != NULL) {
+        fabric_aggregator = aggregator_start(aggregate_address);
+        if (fabric_aggregator == NULL) {
+            exit(EXIT_FAILURE);
         }
 
-        /* construct window layout */
-        construct_window_layout(main_window, ret_get_infiniband_metrics);
-
-        print_delimiter(main_window, 3 * ret_get_infiniband_metrics + 19, interface_link_error_positions, SIZEOF(interface_link_error_positions));
-
-        /* print available metrics */
-        for (int i = 0; i < ret_get_infiniband_metrics; ++i) {
-            /* print interface status metrics */
-            print_delimiter(main_window, 4 + i, interface_status_positions, SIZEOF(interface_status_positions));
-            mvwprintw(main_window, 4 + i, 1, "%-16s", cur_infiniband_metrics.infiniband[i].interface_name);
-            mvwprintw(main_window, 4 + i, 22, "%5ld", cur_infiniband_metrics.infiniband[i].lid);
-            mvwprintw(main_window, 4 + i, 34, "%10s", cur_infiniband_metrics.infiniband[i].link_layer);
-            mvwprintw(main_window, 4 + i, 47, "%15s", cur_infiniband_metrics.infiniband[i].state);
-            mvwprintw(main_window, 4 + i, 69, "%12s", cur_infiniband_metrics.infiniband[i].phys_state);
-            mvwprintw(main_window, 4 + i, 83, "%22s", cur_infiniband_metrics.infiniband[i].rate);
-
-            /* print error metrics */
-            print_delimiter(main_window, 2 * ret_get_infiniband_metrics + 14 + i, interface_error_positions, SIZEOF(interface_error_positions));
-            mvwprintw(main_window, 2 * ret_get_infiniband_metrics + 14 + i, 1, "%-16s", cur_infiniband_metrics.infiniband[i].interface_name);
-            mvwprintw(main_window, 2 * ret_get_infiniband_metrics + 14 + i, 19, "%7ld", cur_infiniband_metrics.infiniband[i].symbol_error);
-            mvwprintw(main_window, 2 * ret_get_infiniband_metrics + 14 + i, 28, "%7ld", cur_infiniband_metrics.infiniband[i].port_rcv_errors);
-            mvwprintw(main_window, 2 * ret_get_infiniband_metrics + 14 + i, 43, "%8ld", cur_infiniband_metrics.infiniband[i].port_rcv_remote_physical_errors);
-            mvwprintw(main_window, 2 * ret_get_infiniband_metrics + 14 + i, 61, "%8ld", cur_infiniband_metrics.infiniband[i].port_rcv_switch_relay_errors);
-            mvwprintw(main_window, 2 * ret_get_infiniband_metrics + 14 + i, 73, "%8ld", cur_infiniband_metrics.infiniband[i].port_rcv_constraint_errors);
-            mvwprintw(main_window, 2 * ret_get_infiniband_metrics + 14 + i, 85, "%8ld", cur_infiniband_metrics.infiniband[i].port_xmit_constraint_errors);
-            mvwprintw(main_window, 2 * ret_get_infiniband_metrics + 14 + i, 102, "%8ld", cur_infiniband_metrics.infiniband[i].excessive_buffer_overrun_errors);
-            mvwprintw(main_window, 2 * ret_get_infiniband_metrics + 14 + i, 115, "%8ld", cur_infiniband_metrics.infiniband[i].port_xmit_discards);
-            mvwprintw(main_window, 2 * ret_get_infiniband_metrics + 14 + i, 129, "%8ld", cur_infiniband_metrics.infiniband[i].VL15_dropped);
-
-            /* print link error metrics */
-            print_delimiter(main_window, 3 * ret_get_infiniband_metrics + 19 + i, interface_link_error_positions, SIZEOF(interface_link_error_positions));
-            mvwprintw(main_window, 3 * ret_get_infiniband_metrics + 19 + i, 1, "%-16s", cur_infiniband_metrics.infiniband[i].interface_name);
-            mvwprintw(main_window, 3 * ret_get_infiniband_metrics + 19 + i, 29, "%10ld", cur_infiniband_metrics.infiniband[i].link_error_recovery);
-            mvwprintw(main_window, 3 * ret_get_infiniband_metrics + 19 + i, 52, "%10ld", cur_infiniband_metrics.infiniband[i].local_link_integrity_errors);
-            mvwprintw(main_window, 3 * ret_get_infiniband_metrics + 19 + i, 67, "%8ld", cur_infiniband_metrics.infiniband[i].link_downed);
-        }
-
-        /* print interface IO metrics that need time difference calculation */
-        if (prev_data_flag > 0) {
-            for (int i = 0; i < ret_get_infiniband_metrics; ++i) {
-                for (int j = 0; j < prev_ret_get_infiniband_metrics; ++j) {
-                    /* only process if current interface name exists */
-                    if (strcmp(cur_infiniband_metrics.infiniband[i].interface_name, prev_infiniband_metrics.infiniband[j].interface_name) == 0) {
-                        ++infiniband_name_found;
-
-                        /* print IO metrics */
-                        print_delimiter(main_window, ret_get_infiniband_metrics + 8 + infiniband_name_found, interface_io_positions, SIZEOF(interface_io_positions));
-                        mvwprintw(main_window, ret_get_infiniband_metrics + 8 + infiniband_name_found, 1, "%-16s", cur_infiniband_metrics.infiniband[i].interface_name);
-                        mvwprintw(main_window, ret_get_infiniband_metrics + 8 + infiniband_name_found, 21, "%10ld", (cur_infiniband_metrics.infiniband[i].port_rcv_packets - prev_infiniband_metrics.infiniband[j].port_rcv_packets) / refresh_second);
-                        mvwprintw(main_window, ret_get_infiniband_metrics + 8 + infiniband_name_found, 33, "%10ld", (cur_infiniband_metrics.infiniband[i].port_rcv_data - prev_infiniband_metrics.infiniband[j].port_rcv_data) * 4 * 8 / 1024 / 1024 / refresh_second);
-                        mvwprintw(main_window, ret_get_infiniband_metrics + 8 + infiniband_name_found, 47, "%10ld", (cur_infiniband_metrics.infiniband[i].port_xmit_packets - prev_infiniband_metrics.infiniband[j].port_xmit_packets) / refresh_second);
-                        mvwprintw(main_window, ret_get_infiniband_metrics + 8 + infiniband_name_found, 59, "%10ld", (cur_infiniband_metrics.infiniband[i].port_xmit_data - prev_infiniband_metrics.infiniband[j].port_xmit_data) * 4 * 8 / 1024 / 1024 / refresh_second);
-                        mvwprintw(main_window, ret_get_infiniband_metrics + 8 + infiniband_name_found, 76, "%10ld", (cur_infiniband_metrics.infiniband[i].unicast_rcv_packets - prev_infiniband_metrics.infiniband[j].unicast_rcv_packets) / refresh_second);
-                        mvwprintw(main_window, ret_get_infiniband_metrics + 8 + infiniband_name_found, 93, "%10ld", (cur_infiniband_metrics.infiniband[i].unicast_xmit_packets - prev_infiniband_metrics.infiniband[j].unicast_xmit_packets) / refresh_second);
-                        mvwprintw(main_window, ret_get_infiniband_metrics + 8 + infiniband_name_found, 110, "%10ld", (cur_infiniband_metrics.infiniband[i].multicast_rcv_packets - prev_infiniband_metrics.infiniband[j].multicast_rcv_packets) / refresh_second);
-                        mvwprintw(main_window, ret_get_infiniband_metrics + 8 + infiniband_name_found, 125, "%10ld", (cur_infiniband_metrics.infiniband[i].multicast_xmit_packets - prev_infiniband_metrics.infiniband[j].multicast_xmit_packets) / refresh_second);
-
-                        break;
-                    }
-                }
-            }
+        source.collector = collector_start(refresh_ns, aggregator_read, fabric_aggregator, publish_sample, &sinks);
+        if (source.collector == NULL) {
+            exit(EXIT_FAILURE);
         }
-
-        wrefresh(main_window);
-
-        /* clear readfds and only add stdin */
-        FD_ZERO(&readfds);
-        FD_SET(STDIN_FILENO, &readfds);
-
-        /* define sleep time period */
-        ts.tv_sec = refresh_second;
-        ts.tv_nsec = 0;
-
-        ret_pselect = pselect(STDIN_FILENO + 1, &readfds, NULL, NULL, &ts, &signal_empty_set);
-
-        /* sleep and exit the loop if q / Q is pressed */
-        if (ret_pselect > 0) {
-            char input_c;
-            if (read(STDIN_FILENO, &input_c, 1) != 1 || (input_c == 'Q' || input_c == 'q')) {
-                break;
+    } else {
+        /* discover the ports up front, so that a netlink backend left for sysfs is reported before the screen starts */
+        if (netlink_flag > 0) {
+            int ret_discover = get_infiniband_metrics(buffers.spare, ethernet_flag);
+            if (ret_discover < 0) {
+                fprintf(stderr, "ERROR: unable to retrieve InfiniBand metrics\n");
+                exit(EXIT_FAILURE);
             }
-        }
 
-        /* sleep and exit the loop if SIGINT is caught */
-        if (ret_pselect < 0 && errno == EINTR) {
-            if (break_flag > 0) {
-                break;
+            if (ret_discover > 0 && infiniband_active_backend() != IB_BACKEND_NETLINK) {
+                fprintf(stderr, "WARNING: RDMA netlink serves none of the sampled counters, reading them from sysfs\n");
             }
         }
 
-        /* copy the current metrics as previous ones for next calculation */
-        prev_infiniband_metrics = cur_infiniband_metrics;
-        prev_ret_get_infiniband_metrics = ret_get_infiniband_metrics;
+        source.collector = collector_start(refresh_ns, read_local_sample, &ethernet_flag, publish_sample, &sinks);
+        if (source.collector == NULL) {
+            exit(EXIT_FAILURE);
+        }
+    }
 
-        /* set flag once previous data is copied */
-        prev_data_flag = 1;
+    /* serving metrics and feeding an aggregator run headless as well; the stream is only written in batch mode */
+    if (batch_flag > 0 || sinks.server != NULL || sinks.agent != NULL) {
+        error_flag = run_batch(&source, &buffers, metrics_exporter, rate_stats, alert_rules, port_events, &signal_empty_set, error_msg) < 0;
+    } else {
+        error_flag = run_tui(&source, &buffers, rate_stats, rate_history, alert_rules, port_events, process_resources, &view, &signal_empty_set, error_msg) < 0;
     }
 
-    /* terminate ncurses window */
-    wstandend(main_window);
-    delwin(main_window);
-    endwin();
+    /* stop sampling and release sysfs file descriptors */
+    collector_stop(source.collector);
+    replay_close(source.replay);
+    aggregator_stop(fabric_aggregator);
+    close_infiniband_metrics();
+    metrics_server_stop(sinks.server);
+    recorder_close(sinks.recorder);
+    agent_close(sinks.agent);
+    exporter_close(metrics_exporter);
+    stats_free(rate_stats);
+    history_free(rate_history);
+    alerts_free(alert_rules);
+    event_log_close(port_events);
+    resources_close(process_resources);
+    render_view_free(&view);
+
+    infiniband_metrics_free(buffers.cur);
+    infiniband_metrics_free(buffers.prev);
+    infiniband_metrics_free(buffers.spare);
 
     /* print error message if error_flag is set */
     if (error_flag > 0) {
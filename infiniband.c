@@ -17,22 +17,812 @@
 
 #include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <fnmatch.h>
 #include <limits.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <unistd.h>
+#include <linux/netlink.h>
 #include "infiniband.h"
+#include "intern.h"
+#include "rdma_netlink.h"
 #include "utils.h"
 
-int get_infiniband_metrics(struct infiniband_metrics *input_infiniband_metrics, int show_ethernet_flag) {
-    int count = 0;
+/* root of the device tree; overridable to point at a synthetic fabric */
+static char sysfs_root[PATH_MAX] = "/sys/class/infiniband";
+
+/* file of recorded RDMA netlink replies the netlink backend reads instead of asking the kernel; empty for the kernel */
+static char netlink_recording[PATH_MAX] = "";
+
+/* counter files under ports/<port>/counters, indexed by enum infiniband_counter */
+static const char *counter_files[IB_COUNTER_COUNT] = {
+    [IB_COUNTER_SYMBOL_ERROR] = "symbol_error",
+    [IB_COUNTER_PORT_RCV_ERRORS] = "port_rcv_errors",
+    [IB_COUNTER_PORT_RCV_REMOTE_PHYSICAL_ERRORS] = "port_rcv_remote_physical_errors",
+    [IB_COUNTER_PORT_RCV_SWITCH_RELAY_ERRORS] = "port_rcv_switch_relay_errors",
+    [IB_COUNTER_LINK_ERROR_RECOVERY] = "link_error_recovery",
+    [IB_COUNTER_PORT_XMIT_CONSTRAINT_ERRORS] = "port_xmit_constraint_errors",
+    [IB_COUNTER_PORT_RCV_CONSTRAINT_ERRORS] = "port_rcv_constraint_errors",
+    [IB_COUNTER_LOCAL_LINK_INTEGRITY_ERRORS] = "local_link_integrity_errors",
+    [IB_COUNTER_EXCESSIVE_BUFFER_OVERRUN_ERRORS] = "excessive_buffer_overrun_errors",
+    [IB_COUNTER_PORT_XMIT_DATA] = "port_xmit_data",
+    [IB_COUNTER_PORT_RCV_DATA] = "port_rcv_data",
+    [IB_COUNTER_PORT_XMIT_PACKETS] = "port_xmit_packets",
+    [IB_COUNTER_PORT_RCV_PACKETS] = "port_rcv_packets",
+    [IB_COUNTER_UNICAST_RCV_PACKETS] = "unicast_rcv_packets",
+    [IB_COUNTER_UNICAST_XMIT_PACKETS] = "unicast_xmit_packets",
+    [IB_COUNTER_MULTICAST_RCV_PACKETS] = "multicast_rcv_packets",
+    [IB_COUNTER_MULTICAST_XMIT_PACKETS] = "multicast_xmit_packets",
+    [IB_COUNTER_LINK_DOWNED] = "link_downed",
+    [IB_COUNTER_PORT_XMIT_DISCARDS] = "port_xmit_discards",
+    [IB_COUNTER_VL15_DROPPED] = "VL15_dropped",
+};
+
+/* extended counters sampled unless a selection is set: where congestion and RDMA retransmits show up */
+static const char *default_counter_selection =
+    "port_xmit_wait,out_of_buffer,out_of_sequence,packet_seq_err,local_ack_timeout_err,rnr_nak_retry_err,implied_nak_seq_err,"
+    "duplicate_request,np_cnp_sent,np_ecn_marked_roce_packets,rp_cnp_handled,rp_cnp_ignored,rx_write_requests,rx_read_requests";
+
+/* hw_counters entries that are settings rather than counters */
+static const char *counter_excludes[] = {"lifespan"};
+
+/* directory below the port an extended counter is read from */
+enum counter_source {
+    COUNTER_SOURCE_COUNTERS,
+    COUNTER_SOURCE_HW_COUNTERS,
+    COUNTER_SOURCE_COUNT
+};
+
+static const char *counter_source_directories[COUNTER_SOURCE_COUNT] = {
+    [COUNTER_SOURCE_COUNTERS] = "counters",
+    [COUNTER_SOURCE_HW_COUNTERS] = "hw_counters",
+};
+
+/*
+ * counter catalog: the standard counters, then the selected extended counters in the order ports
+ * revealed them. it only grows, from the sampling thread; names are interned so that other threads
+ * can resolve the counter ids of a snapshot
+ */
+static struct intern_table counter_name_table;
+static uint8_t *counter_sources = NULL;
+static size_t counter_source_capacity = 0;
+
+/* comma separated fnmatch() patterns selecting extended counters; NULL uses default_counter_selection */
+static char *counter_selection = NULL;
+
+/* sysfs state and phys_state strings, indexed by their numeric prefix */
+static const char *state_names[] = {"0: NOP", "1: DOWN", "2: INIT", "3: ARMED", "4: ACTIVE", "5: ACTIVE_DEFER"};
+static const char *phys_state_names[] = {"0: <unknown>", "1: Sleep", "2: Polling", "3: Disabled", "4: PortConfigurationTraining", "5: LinkUp", "6: LinkErrorRecovery", "7: Phy Test"};
+static const char *link_layer_names[] = {"Unknown", "InfiniBand", "Ethernet"};
+
+/* attributes are re-read at this cadence; hot-plug is signalled by kernel uevents */
+#define TOPOLOGY_REFRESH_NS (NSEC_PER_SEC)
+
+/* without a uevent socket the whole tree is rescanned at this cadence */
+#define TOPOLOGY_RESCAN_NS (10 * NSEC_PER_SEC)
+
+/* port discovered once and kept open; every sample is one pread() per counter */
+struct infiniband_port {
+    uint16_t name_id;
+    uint8_t link_layer;
+
+    /* attributes cached from the last topology refresh */
+    uint32_t lid;
+    uint16_t rate_id;
+    uint8_t state;
+    uint8_t phys_state;
+
+    int state_fd;
+    int phys_state_fd;
+    int rate_fd;
+    int lid_fd;
+
+    /* one file per catalog counter known when the port was opened; later ones read as 0 */
+    int *counter_fds;
+    size_t counter_count;
+
+    /* netlink backend: port address, counter id of each hwcounter entry position, counters it covers */
+    struct rdma_netlink_port netlink_port;
+    int *netlink_positions;
+    size_t netlink_position_count;
+    uint8_t *netlink_counters;
+};
+
+/* port table grows by doubling during discovery and is reused across rediscoveries */
+static struct infiniband_port *infiniband_ports = NULL;
+static size_t infiniband_port_capacity = 0;
+static int infiniband_port_count = 0;
+static int infiniband_discovered = 0;
+static int infiniband_discovered_ethernet_flag = 0;
+
+/* topology bookkeeping; uevent_fd is -1 if the kernel uevent socket is unavailable */
+static uint64_t topology_refresh_ns = 0;
+static uint64_t topology_rescan_ns = 0;
+static int uevent_fd = -1;
+static int uevent_opened = 0;
+
+/* requested backend; netlink_handle is NULL while sysfs is in use */
+static enum infiniband_backend infiniband_backend = IB_BACKEND_SYSFS;
+static struct rdma_netlink *netlink_handle = NULL;
+static struct rdma_netlink_port *netlink_requests = NULL;
+static size_t netlink_request_capacity = 0;
+
+/* interface names and rate strings referenced by snapshots */
+static struct intern_table interface_name_table;
+static struct intern_table rate_name_table;
+
+static int open_port_file(const char *directory_path, const char *file_name) {
+    char file_path[PATH_MAX];
     int ret_snprintf;
-    size_t path_size;
+
+    ret_snprintf = snprintf(file_path, PATH_MAX, "%s/%s", directory_path, file_name);
+    if (ret_snprintf < 0 || ret_snprintf >= PATH_MAX) {
+        return -1;
+    }
+
+    return open(file_path, O_RDONLY | O_CLOEXEC);
+}
+
+static void close_port(struct infiniband_port *port) {
+    int *fds[] = {&port->state_fd, &port->phys_state_fd, &port->rate_fd, &port->lid_fd};
+
+    for (size_t i = 0; i < SIZEOF(fds); ++i) {
+        if (*fds[i] >= 0) {
+            close(*fds[i]);
+            *fds[i] = -1;
+        }
+    }
+
+    for (size_t i = 0; i < port->counter_count; ++i) {
+        if (port->counter_fds[i] >= 0) {
+            close(port->counter_fds[i]);
+        }
+    }
+
+    free(port->counter_fds);
+    port->counter_fds = NULL;
+    free(port->netlink_counters);
+    port->netlink_counters = NULL;
+    port->counter_count = 0;
+
+    free(port->netlink_positions);
+    port->netlink_positions = NULL;
+    port->netlink_position_count = 0;
+}
+
+static void close_ports(void) {
+    for (int i = 0; i < infiniband_port_count; ++i) {
+        close_port(&infiniband_ports[i]);
+    }
+
+    infiniband_port_count = 0;
+    infiniband_discovered = 0;
+}
+
+void close_infiniband_metrics(void) {
+    close_ports();
+
+    if (uevent_fd >= 0) {
+        close(uevent_fd);
+        uevent_fd = -1;
+    }
+    uevent_opened = 0;
+
+    rdma_netlink_close(netlink_handle);
+    netlink_handle = NULL;
+    free(netlink_requests);
+    netlink_requests = NULL;
+    netlink_request_capacity = 0;
+}
+
+int infiniband_set_sysfs_root(const char *path) {
+    size_t length = strlen(path);
+
+    /* leave room for <device>/ports/<port>/counters/<counter> below the root */
+    if (length == 0 || length >= PATH_MAX / 2) {
+        fprintf(stderr, "ERROR: invalid sysfs root: %s\n", path);
+        return -1;
+    }
+
+    memcpy(sysfs_root, path, length + 1);
+    return 0;
+}
+
+/* path of recorded replies, e.g.: the rdma_res.nl of a tree written by ib-sysfs-generator; NULL asks the kernel again */
+int infiniband_set_netlink_recording(const char *path) {
+    size_t length = path != NULL ? strlen(path) : 0;
+
+    if (path != NULL && (length == 0 || length >= PATH_MAX)) {
+        fprintf(stderr, "ERROR: invalid netlink recording: %s\n", path);
+        return -1;
+    }
+
+    if (path != NULL) {
+        memcpy(netlink_recording, path, length + 1);
+    } else {
+        netlink_recording[0] = '\0';
+    }
+    return 0;
+}
+
+void infiniband_set_backend(enum infiniband_backend backend) {
+    infiniband_backend = backend;
+}
+
+enum infiniband_backend infiniband_active_backend(void) {
+    return netlink_handle != NULL ? IB_BACKEND_NETLINK : IB_BACKEND_SYSFS;
+}
+
+/* record which catalog counter every hwcounter entry position of a port maps to */
+static void netlink_probe_counter(void *ctx, size_t port, size_t position, const char *name, uint64_t value) {
+    struct infiniband_port *input_port = &infiniband_ports[port];
+    (void)ctx;
+    (void)value;
+
+    if (position >= input_port->netlink_position_count) {
+        int *new_positions = realloc(input_port->netlink_positions, (position + 1) * sizeof(*new_positions));
+        if (new_positions == NULL) {
+            return;
+        }
+
+        for (size_t i = input_port->netlink_position_count; i <= position; ++i) {
+            new_positions[i] = -1;
+        }
+
+        input_port->netlink_positions = new_positions;
+        input_port->netlink_position_count = position + 1;
+    }
+
+    uint16_t counter_id = intern_lookup(&counter_name_table, name);
+    if (counter_id != INTERN_ID_INVALID && counter_id < input_port->counter_count) {
+        input_port->netlink_positions[position] = counter_id;
+        input_port->netlink_counters[counter_id] = 1;
+    }
+}
+
+static void netlink_sample_counter(void *ctx, size_t port, size_t position, const char *name, uint64_t value) {
+    struct infiniband_metrics *input_infiniband_metrics = ctx;
+    struct infiniband_port *input_port = &infiniband_ports[port];
+    (void)name;
+
+    if (position < input_port->netlink_position_count && input_port->netlink_positions[position] >= 0) {
+        input_infiniband_metrics->counters[input_port->netlink_positions[position]][port] = value;
+    }
+}
+
+/* resolve netlink addresses of all ports and learn which counters netlink provides; fall back to sysfs on failure */
+static void setup_netlink_backend(void) {
+    const char *previous_device = NULL;
+    uint32_t device_index = 0;
+
+    if (netlink_handle == NULL) {
+        netlink_handle = netlink_recording[0] != '\0' ? rdma_netlink_open_recording(netlink_recording) : rdma_netlink_open();
+        if (netlink_handle == NULL) {
+            goto handle_error;
+        }
+    }
+
+    if ((size_t)infiniband_port_count > netlink_request_capacity) {
+        struct rdma_netlink_port *new_requests = realloc(netlink_requests, (size_t)infiniband_port_count * sizeof(*new_requests));
+        if (new_requests == NULL) {
+            goto handle_error;
+        }
+
+        netlink_requests = new_requests;
+        netlink_request_capacity = (size_t)infiniband_port_count;
+    }
+
+    for (int i = 0; i < infiniband_port_count; ++i) {
+        struct infiniband_port *port = &infiniband_ports[i];
+        const char *interface_name = interned_string(&interface_name_table, port->name_id);
+        const char *separator = strrchr(interface_name, ':');
+        char device_name[IB_DEVICE_NAME_MAX];
+        uint64_t port_index;
+
+        if (separator == NULL || parse_uint64(separator + 1, strlen(separator + 1), &port_index) < 0) {
+            goto handle_error;
+        }
+
+        snprintf(device_name, sizeof(device_name), "%.*s", (int)(separator - interface_name), interface_name);
+
+        /* ports of one device are discovered together; dump the device list once per device */
+        if (previous_device == NULL || strncmp(previous_device, interface_name, (size_t)(separator - interface_name) + 1) != 0) {
+            if (rdma_netlink_device_index(netlink_handle, device_name, &device_index) < 0) {
+                goto handle_error;
+            }
+
+            previous_device = interface_name;
+        }
+
+        port->netlink_port.device_index = device_index;
+        port->netlink_port.port_index = (uint32_t)port_index;
+        netlink_requests[i] = port->netlink_port;
+    }
+
+    if (rdma_netlink_stat_get(netlink_handle, netlink_requests, (size_t)infiniband_port_count, netlink_probe_counter, NULL) < 0) {
+        goto handle_error;
+    }
+
+    /* keep the socket only if it saves sysfs reads */
+    for (int i = 0; i < infiniband_port_count; ++i) {
+        for (size_t j = 0; j < infiniband_ports[i].counter_count; ++j) {
+            if (infiniband_ports[i].netlink_counters[j] > 0) {
+                return;
+            }
+        }
+    }
+
+handle_error:
+    for (int i = 0; i < infiniband_port_count; ++i) {
+        memset(infiniband_ports[i].netlink_counters, 0, infiniband_ports[i].counter_count);
+    }
+
+    rdma_netlink_close(netlink_handle);
+    netlink_handle = NULL;
+}
+
+/* subscribe to kernel uevents so device add/remove triggers a rescan */
+static void open_uevent_socket(void) {
+    struct sockaddr_nl address;
+
+    uevent_opened = 1;
+
+    uevent_fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT);
+    if (uevent_fd < 0) {
+        return;
+    }
+
+    memset(&address, 0, sizeof(address));
+    address.nl_family = AF_NETLINK;
+    address.nl_groups = 1;
+
+    if (bind(uevent_fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
+        close(uevent_fd);
+        uevent_fd = -1;
+    }
+}
+
+/* drain queued uevents; return 1 if any concerns an InfiniBand device or port */
+static int uevent_pending(void) {
+    char buffer[BUFSIZ];
+    ssize_t ret_recv;
+    int pending = 0;
+
+    while ((ret_recv = recv(uevent_fd, buffer, sizeof(buffer), 0)) > 0) {
+        /* uevents are NUL separated KEY=VALUE lines; match SUBSYSTEM=infiniband and friends */
+        for (ssize_t i = 0; i < ret_recv; i += (ssize_t)strnlen(buffer + i, (size_t)(ret_recv - i)) + 1) {
+            if (strncmp(buffer + i, "SUBSYSTEM=infiniband", strlen("SUBSYSTEM=infiniband")) == 0) {
+                pending = 1;
+            }
+        }
+    }
+
+    /* an overflowed socket may have lost the event we care about */
+    if (ret_recv < 0 && errno == ENOBUFS) {
+        pending = 1;
+    }
+
+    return pending;
+}
+
+/* re-read state, phys_state, lid and rate of one port */
+static int read_port_attributes(struct infiniband_port *port) {
+    char char_value[BUFSIZ];
+    uint64_t uint64_value;
+
+    if (read_fd_uint64(port->state_fd, &uint64_value) < 0) {
+        return -1;
+    }
+    port->state = (uint8_t)uint64_value;
+
+    if (read_fd_uint64(port->phys_state_fd, &uint64_value) < 0) {
+        return -1;
+    }
+    port->phys_state = (uint8_t)uint64_value;
+
+    if (read_fd_uint64(port->lid_fd, &uint64_value) < 0) {
+        return -1;
+    }
+    port->lid = (uint32_t)uint64_value;
+
+    if (read_fd_char(port->rate_fd, char_value, sizeof(char_value)) < 0) {
+        return -1;
+    }
+    port->rate_id = intern_string(&rate_name_table, char_value);
+
+    return 0;
+}
+
+struct infiniband_metrics *infiniband_metrics_alloc(size_t interface_capacity) {
+    struct infiniband_metrics *input_infiniband_metrics = calloc(1, sizeof(*input_infiniband_metrics));
+
+    if (input_infiniband_metrics == NULL) {
+        return NULL;
+    }
+
+    if (infiniband_metrics_reserve(input_infiniband_metrics, interface_capacity, IB_COUNTER_COUNT) < 0) {
+        free(input_infiniband_metrics);
+        return NULL;
+    }
+
+    return input_infiniband_metrics;
+}
+
+/* make room for interface_capacity interfaces and counter_count counters in one block: interfaces, counter rows, then values */
+int infiniband_metrics_reserve(struct infiniband_metrics *input_infiniband_metrics, size_t interface_capacity, size_t counter_count) {
+    size_t interfaces_size;
+    size_t rows_size;
+    size_t counters_size;
+    char *storage;
+
+    if (input_infiniband_metrics->storage != NULL && interface_capacity <= input_infiniband_metrics->interface_capacity &&
+        counter_count <= input_infiniband_metrics->counter_capacity) {
+        return 0;
+    }
+
+    /* round up so ports trickling in one by one do not reallocate every sample */
+    if (interface_capacity < 16) {
+        interface_capacity = 16;
+    }
+    if (interface_capacity > input_infiniband_metrics->interface_capacity && interface_capacity < input_infiniband_metrics->interface_capacity * 2) {
+        interface_capacity = input_infiniband_metrics->interface_capacity * 2;
+    }
+    if (interface_capacity < input_infiniband_metrics->interface_capacity) {
+        interface_capacity = input_infiniband_metrics->interface_capacity;
+    }
+    if (counter_count < input_infiniband_metrics->counter_capacity) {
+        counter_count = input_infiniband_metrics->counter_capacity;
+    }
+
+    interfaces_size = (interface_capacity * sizeof(struct interface) + sizeof(uint64_t) - 1) / sizeof(uint64_t) * sizeof(uint64_t);
+    rows_size = counter_count * sizeof(uint64_t *);
+    counters_size = interface_capacity * counter_count * sizeof(uint64_t);
+
+    storage = calloc(1, interfaces_size + rows_size + counters_size);
+    if (storage == NULL) {
+        return -1;
+    }
+
+    free(input_infiniband_metrics->storage);
+    input_infiniband_metrics->storage = storage;
+    input_infiniband_metrics->interface_capacity = interface_capacity;
+    input_infiniband_metrics->counter_capacity = counter_count;
+    input_infiniband_metrics->infiniband = (struct interface *)storage;
+    input_infiniband_metrics->counters = (uint64_t **)(storage + interfaces_size);
+    for (size_t i = 0; i < counter_count; ++i) {
+        input_infiniband_metrics->counters[i] = (uint64_t *)(storage + interfaces_size + rows_size) + i * interface_capacity;
+    }
+
+    return 0;
+}
+
+void infiniband_metrics_free(struct infiniband_metrics *input_infiniband_metrics) {
+    if (input_infiniband_metrics == NULL) {
+        return;
+    }
+
+    free(input_infiniband_metrics->storage);
+    free(input_infiniband_metrics);
+}
+
+uint16_t infiniband_interface_id(const char *interface_name) {
+    return intern_lookup(&interface_name_table, interface_name);
+}
+
+/* intern names of ports that are not discovered here, e.g.: ports read back from a record file */
+uint16_t infiniband_intern_interface_name(const char *interface_name) {
+    return intern_string(&interface_name_table, interface_name);
+}
+
+uint16_t infiniband_intern_rate_name(const char *rate_name) {
+    return intern_string(&rate_name_table, rate_name);
+}
+
+size_t infiniband_interface_id_count(void) {
+    return intern_table_count(&interface_name_table);
+}
+
+/* map every interface name id to its position in input_infiniband_metrics, -1 if absent; *positions grows as ids are added */
+int infiniband_metrics_positions(const struct infiniband_metrics *input_infiniband_metrics, int **positions, size_t *positions_size) {
+    size_t id_count = infiniband_interface_id_count();
+
+    if (id_count > *positions_size) {
+        int *new_positions = realloc(*positions, id_count * sizeof(*new_positions));
+        if (new_positions == NULL) {
+            return -1;
+        }
+
+        *positions = new_positions;
+        *positions_size = id_count;
+    }
+
+    for (size_t i = 0; i < *positions_size; ++i) {
+        (*positions)[i] = -1;
+    }
+
+    /* an id the name table did not hand out has no slot */
+    for (int i = 0; i < input_infiniband_metrics->interface_count; ++i) {
+        if (input_infiniband_metrics->infiniband[i].name_id < *positions_size) {
+            (*positions)[input_infiniband_metrics->infiniband[i].name_id] = i;
+        }
+    }
+
+    return 0;
+}
+
+const char *infiniband_interface_name(uint16_t name_id) {
+    return interned_string(&interface_name_table, name_id);
+}
+
+const char *infiniband_rate_name(uint16_t rate_id) {
+    return interned_string(&rate_name_table, rate_id);
+}
+
+/* link speed in Gb/s the rate string starts with (e.g.: "200 Gb/sec (4X HDR)"); 0 if unknown */
+double infiniband_rate_gbps(uint16_t rate_id) {
+    const char *rate_name = infiniband_rate_name(rate_id);
+    char *end;
+    double rate_gbps = strtod(rate_name, &end);
+
+    return end != rate_name && rate_gbps > 0.0 ? rate_gbps : 0.0;
+}
+
+const char *infiniband_link_layer_name(uint8_t link_layer) {
+    return link_layer < SIZEOF(link_layer_names) ? link_layer_names[link_layer] : link_layer_names[IB_LINK_LAYER_UNKNOWN];
+}
+
+const char *infiniband_state_name(uint8_t state) {
+    return state < SIZEOF(state_names) ? state_names[state] : "<unknown>";
+}
+
+const char *infiniband_phys_state_name(uint8_t phys_state) {
+    return phys_state < SIZEOF(phys_state_names) ? phys_state_names[phys_state] : phys_state_names[0];
+}
+
+const char *infiniband_counter_name(enum infiniband_counter counter) {
+    if (counter < IB_COUNTER_COUNT) {
+        return counter_files[counter];
+    }
+
+    return (size_t)counter < INTERN_ID_INVALID ? interned_string(&counter_name_table, (uint16_t)counter) : "";
+}
+
+/* select extended counters by comma separated fnmatch() patterns; "all" selects every counter, "none" none */
+int infiniband_set_counter_selection(const char *selection) {
+    char *new_selection = strdup(strcmp(selection, "all") == 0 ? "*" : strcmp(selection, "none") == 0 ? "" : selection);
+    if (new_selection == NULL) {
+        fprintf(stderr, "ERROR: failed to allocate counter selection\n");
+        return -1;
+    }
+
+    free(counter_selection);
+    counter_selection = new_selection;
+    return 0;
+}
+
+static int counter_selected(const char *counter_name) {
+    const char *selection = counter_selection != NULL ? counter_selection : default_counter_selection;
+
+    for (size_t i = 0; i < SIZEOF(counter_excludes); ++i) {
+        if (strcmp(counter_name, counter_excludes[i]) == 0) {
+            return 0;
+        }
+    }
+
+    while (*selection != '\0') {
+        char pattern[INTERN_STRING_MAX];
+        size_t length = strcspn(selection, ",");
+
+        if (length < sizeof(pattern)) {
+            memcpy(pattern, selection, length);
+            pattern[length] = '\0';
+            if (fnmatch(pattern, counter_name, 0) == 0) {
+                return 1;
+            }
+        }
+
+        selection += length;
+        if (*selection == ',') {
+            ++selection;
+        }
+    }
+
+    return 0;
+}
+
+/* append counter_name read from source to the catalog unless it is known; return its id or INTERN_ID_INVALID */
+static uint16_t add_catalog_counter(const char *counter_name, enum counter_source source) {
+    size_t count = intern_table_count(&counter_name_table);
+    uint16_t counter_id = intern_lookup(&counter_name_table, counter_name);
+    if (counter_id != INTERN_ID_INVALID) {
+        return counter_id;
+    }
+
+    if (count >= counter_source_capacity) {
+        size_t new_capacity = counter_source_capacity == 0 ? 64 : counter_source_capacity * 2;
+        uint8_t *new_sources = realloc(counter_sources, new_capacity * sizeof(*new_sources));
+        if (new_sources == NULL) {
+            return INTERN_ID_INVALID;
+        }
+
+        counter_sources = new_sources;
+        counter_source_capacity = new_capacity;
+    }
+
+    counter_id = intern_string(&counter_name_table, counter_name);
+    if (counter_id != INTERN_ID_INVALID) {
+        counter_sources[counter_id] = (uint8_t)source;
+    }
+
+    return counter_id;
+}
+
+/* intern the standard counters first so that their ids equal enum infiniband_counter */
+static int init_counter_catalog(void) {
+    if (intern_table_count(&counter_name_table) > 0) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < IB_COUNTER_COUNT; ++i) {
+        if (add_catalog_counter(counter_files[i], COUNTER_SOURCE_COUNTERS) != i) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/* number of counters in the catalog, at least the standard ones */
+size_t infiniband_counter_count(void) {
+    size_t count = intern_table_count(&counter_name_table);
+
+    return count > IB_COUNTER_COUNT ? count : IB_COUNTER_COUNT;
+}
+
+/* catalog id of counter_name, adding it if unknown (e.g.: counters read back from a record file); -1 on failure */
+int infiniband_intern_counter_name(const char *counter_name) {
+    if (init_counter_catalog() < 0) {
+        return -1;
+    }
+
+    uint16_t counter_id = add_catalog_counter(counter_name, COUNTER_SOURCE_COUNTERS);
+
+    return counter_id != INTERN_ID_INVALID ? counter_id : -1;
+}
+
+/* add the selected extended counters found below port_path to the catalog */
+static void scan_port_counters(const char *port_path) {
+    for (size_t i = 0; i < COUNTER_SOURCE_COUNT; ++i) {
+        char source_path[PATH_MAX];
+        int ret_snprintf = snprintf(source_path, PATH_MAX, "%s/%s", port_path, counter_source_directories[i]);
+        if (ret_snprintf < 0 || ret_snprintf >= PATH_MAX) {
+            continue;
+        }
+
+        /* hw_counters only exists on some drivers; sorted so the catalog order is stable */
+        struct dirent **source_entries;
+        int source_entry_count = scandir(source_path, &source_entries, NULL, alphasort);
+        if (source_entry_count < 0) {
+            continue;
+        }
+
+        for (int j = 0; j < source_entry_count; ++j) {
+            const struct dirent *source_entry = source_entries[j];
+
+            if (source_entry->d_name[0] != '.' && source_entry->d_type != DT_DIR &&
+                intern_lookup(&counter_name_table, source_entry->d_name) == INTERN_ID_INVALID && counter_selected(source_entry->d_name) > 0) {
+                add_catalog_counter(source_entry->d_name, (enum counter_source)i);
+            }
+
+            free(source_entries[j]);
+        }
+
+        free(source_entries);
+    }
+}
+
+/* open every attribute and counter file of one port; return -1 if the port should be skipped */
+static int open_port(struct infiniband_port *port, const char *device_name, const char *port_name, const char *port_path, int show_ethernet_flag) {
+    char counters_path[PATH_MAX];
     char char_value[BUFSIZ];
-    long int long_int_value;
-    int ret_read_file;
+    char interface_name[IB_DEVICE_NAME_MAX];
+    int ret_snprintf;
+    struct stat sb;
+
+    port->state_fd = -1;
+    port->phys_state_fd = -1;
+    port->rate_fd = -1;
+    port->lid_fd = -1;
+    port->counter_fds = NULL;
+    port->counter_count = 0;
+    port->netlink_counters = NULL;
+    port->netlink_positions = NULL;
+    port->netlink_position_count = 0;
+
+    /* link layer never changes for a port, read it once */
+    char link_layer_file_path[PATH_MAX];
+    ret_snprintf = snprintf(link_layer_file_path, PATH_MAX, "%s/link_layer", port_path);
+    if (ret_snprintf < 0 || ret_snprintf >= PATH_MAX || read_file_char(link_layer_file_path, char_value) < 0) {
+        return -1;
+    }
 
+    if (strcmp(char_value, "InfiniBand") == 0) {
+        port->link_layer = IB_LINK_LAYER_INFINIBAND;
+    } else if (strcmp(char_value, "Ethernet") == 0) {
+        port->link_layer = IB_LINK_LAYER_ETHERNET;
+    } else {
+        port->link_layer = IB_LINK_LAYER_UNKNOWN;
+    }
+
+    if (show_ethernet_flag <= 0) {
+        /* if link layer is not InfiniBand, skip port */
+        if (port->link_layer != IB_LINK_LAYER_INFINIBAND) {
+            return -1;
+        }
+    }
+
+    /* if "counters" directory does not exist(e.g.: soft RoCE device), skip port */
+    ret_snprintf = snprintf(counters_path, PATH_MAX, "%s/counters", port_path);
+    if (ret_snprintf < 0 || ret_snprintf >= PATH_MAX) {
+        return -1;
+    }
+
+    if (stat(counters_path, &sb) != 0 || !S_ISDIR(sb.st_mode)) {
+        return -1;
+    }
+
+    ret_snprintf = snprintf(interface_name, IB_DEVICE_NAME_MAX, "%s:%s", device_name, port_name);
+    if (ret_snprintf < 0 || ret_snprintf >= IB_DEVICE_NAME_MAX) {
+        return -1;
+    }
+
+    port->name_id = intern_string(&interface_name_table, interface_name);
+    if (port->name_id == INTERN_ID_INVALID) {
+        return -1;
+    }
+
+    port->state_fd = open_port_file(port_path, "state");
+    port->phys_state_fd = open_port_file(port_path, "phys_state");
+    port->rate_fd = open_port_file(port_path, "rate");
+    port->lid_fd = open_port_file(port_path, "lid");
+
+    if (port->state_fd < 0 || port->phys_state_fd < 0 || port->rate_fd < 0 || port->lid_fd < 0 || read_port_attributes(port) < 0) {
+        close_port(port);
+        return -1;
+    }
+
+    /* extended counters of this port join the catalog before the counter files are opened */
+    if (init_counter_catalog() < 0) {
+        close_port(port);
+        return -1;
+    }
+    scan_port_counters(port_path);
+
+    size_t counter_count = infiniband_counter_count();
+    port->counter_fds = malloc(counter_count * sizeof(*port->counter_fds));
+    port->netlink_counters = calloc(counter_count, sizeof(*port->netlink_counters));
+    if (port->counter_fds == NULL || port->netlink_counters == NULL) {
+        close_port(port);
+        return -1;
+    }
+
+    /* a missing counter file is reported as 0 */
+    for (size_t i = 0; i < counter_count; ++i) {
+        char source_path[PATH_MAX];
+        ret_snprintf = snprintf(source_path, PATH_MAX, "%s/%s", port_path, counter_source_directories[counter_sources[i]]);
+        port->counter_fds[i] = ret_snprintf < 0 || ret_snprintf >= PATH_MAX ? -1 : open_port_file(source_path, infiniband_counter_name((enum infiniband_counter)i));
+    }
+    port->counter_count = counter_count;
+
+    return 0;
+}
+
+static int discover_infiniband_ports(int show_ethernet_flag) {
     DIR *sysfs_dir_handle;
     sysfs_dir_handle = NULL;
     struct dirent *sysfs_entry;
@@ -41,10 +831,19 @@ int get_infiniband_metrics(struct infiniband_metrics *input_infiniband_metrics,
     device_dir_handle = NULL;
     struct dirent *device_entry;
 
+    close_ports();
+
+    if (uevent_opened == 0) {
+        open_uevent_socket();
+    }
+
+    topology_refresh_ns = get_monotonic_ns();
+    topology_rescan_ns = topology_refresh_ns;
+
     /* return error if /sys/class/infiniband does not exist or is failed to open */
-    sysfs_dir_handle = opendir("/sys/class/infiniband");
+    sysfs_dir_handle = opendir(sysfs_root);
     if (sysfs_dir_handle == NULL) {
-        fprintf(stderr, "ERROR: unable to open /sys/class/infiniband: %s\n", strerror(errno));
+        fprintf(stderr, "ERROR: unable to open %s: %s\n", sysfs_root, strerror(errno));
         return -1;
     }
 
@@ -54,12 +853,9 @@ int get_infiniband_metrics(struct infiniband_metrics *input_infiniband_metrics,
             continue;
         }
 
-        /* construct device path */
-        path_size = strlen("/sys/class/infiniband/") + strlen(sysfs_entry->d_name) + strlen("/ports") + 1;
-        char sysfs_device_path[path_size];
-
-        ret_snprintf = snprintf(sysfs_device_path, path_size, "/sys/class/infiniband/%s/ports", sysfs_entry->d_name);
-        if (ret_snprintf < 0) {
+        char sysfs_device_path[PATH_MAX];
+        int ret_snprintf = snprintf(sysfs_device_path, PATH_MAX, "%s/%s/ports", sysfs_root, sysfs_entry->d_name);
+        if (ret_snprintf < 0 || ret_snprintf >= PATH_MAX) {
             continue;
         }
 
@@ -75,281 +871,150 @@ int get_infiniband_metrics(struct infiniband_metrics *input_infiniband_metrics,
                 continue;
             }
 
-            /* construct device + port path */
-            path_size = strlen(sysfs_device_path) + strlen("/") + strlen(device_entry->d_name) + 1;
-            char sysfs_device_port_path[path_size];
-
-            ret_snprintf = snprintf(sysfs_device_port_path, path_size, "%s/%s", sysfs_device_path, device_entry->d_name);
-            if (ret_snprintf < 0) {
+            char sysfs_device_port_path[PATH_MAX];
+            ret_snprintf = snprintf(sysfs_device_port_path, PATH_MAX, "%s/%s", sysfs_device_path, device_entry->d_name);
+            if (ret_snprintf < 0 || ret_snprintf >= PATH_MAX) {
                 continue;
             }
 
-            /* read interface link layer in each port */
-            path_size = strlen(sysfs_device_port_path) + strlen("/link_layer") + 1;
-            char link_layer_file_path[path_size];
-
-            ret_snprintf = snprintf(link_layer_file_path, path_size, "%s/link_layer", sysfs_device_port_path);
-            ret_read_file = read_file_char(link_layer_file_path, char_value);
-            if (ret_snprintf < 0 || ret_read_file < 0) {
-                continue;
-            }
-
-            if (show_ethernet_flag <= 0) {
-                /* if link layer is not InfiniBand, quit loop */
-                if (strcmp(char_value, "InfiniBand") != 0) {
-                    continue;
+            /* grow the port table */
+            if ((size_t)infiniband_port_count >= infiniband_port_capacity) {
+                size_t new_capacity = infiniband_port_capacity == 0 ? 16 : infiniband_port_capacity * 2;
+                struct infiniband_port *new_ports = realloc(infiniband_ports, new_capacity * sizeof(*new_ports));
+                if (new_ports == NULL) {
+                    fprintf(stderr, "ERROR: failed to allocate InfiniBand port table\n");
+                    closedir(device_dir_handle);
+                    closedir(sysfs_dir_handle);
+                    return -1;
                 }
-            }
-
-            /* if "counters" directory does not exist(e.g.: soft RoCE device), quit loop */
-            size_t sysfs_device_port_path_size = strlen(sysfs_device_port_path);
-            path_size = sysfs_device_port_path_size + strlen("/counters") + 1;
-            char sysfs_device_port_counters[path_size];
 
-            ret_snprintf = snprintf(sysfs_device_port_counters, path_size, "%s/counters", sysfs_device_port_path);
-            if (ret_snprintf < 0) {
-                continue;
+                infiniband_ports = new_ports;
+                infiniband_port_capacity = new_capacity;
             }
 
-            struct stat sb;
-            if (stat(sysfs_device_port_counters, &sb) != 0 || !S_ISDIR(sb.st_mode)) {
+            if (open_port(&infiniband_ports[infiniband_port_count], sysfs_entry->d_name, device_entry->d_name, sysfs_device_port_path, show_ethernet_flag) < 0) {
                 continue;
             }
 
-            /* construct each interface information on each port */
-            size_t interface_name_length = strlen(sysfs_entry->d_name) + strlen(device_entry->d_name) + strlen(":") + 1;
-            char interface_name[interface_name_length];
-            ret_snprintf = snprintf(interface_name, interface_name_length, "%s:%s", sysfs_entry->d_name, device_entry->d_name);
-            if (ret_snprintf < 0) {
-                continue;
-            }
-
-            strcpy(input_infiniband_metrics->infiniband[count].interface_name, interface_name); /* interface_name:port_name */
-            strcpy(input_infiniband_metrics->infiniband[count].link_layer, char_value); /* link_layer */
-
-            /* state */
-            path_size = sysfs_device_port_path_size + strlen("/state") + 1;
-            char state_file_path[path_size];
-
-            ret_snprintf = snprintf(state_file_path, path_size, "%s/state", sysfs_device_port_path);
-            ret_read_file = read_file_char(state_file_path, char_value);
-            if (ret_snprintf < 0 || ret_read_file < 0) {
-                continue;
-            }
-
-            strcpy(input_infiniband_metrics->infiniband[count].state, char_value);
-
-            /* phys_state */
-            path_size = sysfs_device_port_path_size + strlen("/phys_state") + 1;
-            char phys_state_file_path[path_size];
-
-            ret_snprintf = snprintf(phys_state_file_path, path_size, "%s/phys_state", sysfs_device_port_path);
-            ret_read_file = read_file_char(phys_state_file_path, char_value);
-            if (ret_snprintf < 0 || ret_read_file < 0) {
-                continue;
-            }
-
-            strcpy(input_infiniband_metrics->infiniband[count].phys_state, char_value);
-
-            /* rate */
-            path_size = sysfs_device_port_path_size + strlen("/rate") + 1;
-            char rate_file_path[path_size];
-
-            ret_snprintf = snprintf(rate_file_path, path_size, "%s/rate", sysfs_device_port_path);
-            ret_read_file = read_file_char(rate_file_path, char_value);
-            if (ret_snprintf < 0 || ret_read_file < 0) {
-                continue;
-            }
-
-            strcpy(input_infiniband_metrics->infiniband[count].rate, char_value);
-
-            /* lid */
-            path_size = sysfs_device_port_path_size + strlen("/lid") + 1;
-            char lid_file_path[path_size];
-
-            ret_snprintf = snprintf(lid_file_path, path_size, "%s/lid", sysfs_device_port_path);
-            ret_read_file = read_file_long_int(lid_file_path, &long_int_value);
-            if (ret_snprintf < 0 || ret_read_file < 0) {
-                continue;
-            }
+            ++infiniband_port_count;
+        }
 
-            input_infiniband_metrics->infiniband[count].lid = long_int_value;
+        closedir(device_dir_handle);
+    }
 
-            /* construct counter metrics */
-            char counter_metric_file_path[PATH_MAX];
+    closedir(sysfs_dir_handle);
 
-            ret_snprintf = snprintf(counter_metric_file_path, PATH_MAX, "%s/symbol_error", sysfs_device_port_counters);
-            ret_read_file = read_file_long_int(counter_metric_file_path, &long_int_value);
-            if (ret_snprintf < 0 || ret_read_file < 0) {
-                input_infiniband_metrics->infiniband[count].symbol_error = 0;
-            } else {
-                input_infiniband_metrics->infiniband[count].symbol_error = long_int_value;
-            }
+    if (infiniband_backend == IB_BACKEND_NETLINK) {
+        setup_netlink_backend();
+    }
 
-            ret_snprintf = snprintf(counter_metric_file_path, PATH_MAX, "%s/port_rcv_errors", sysfs_device_port_counters);
-            ret_read_file = read_file_long_int(counter_metric_file_path, &long_int_value);
-            if (ret_snprintf < 0 || ret_read_file < 0) {
-                input_infiniband_metrics->infiniband[count].port_rcv_errors = 0;
-            } else {
-                input_infiniband_metrics->infiniband[count].port_rcv_errors = long_int_value;
-            }
+    infiniband_discovered = 1;
+    infiniband_discovered_ethernet_flag = show_ethernet_flag;
 
-            ret_snprintf = snprintf(counter_metric_file_path, PATH_MAX, "%s/port_rcv_remote_physical_errors", sysfs_device_port_counters);
-            ret_read_file = read_file_long_int(counter_metric_file_path, &long_int_value);
-            if (ret_snprintf < 0 || ret_read_file < 0) {
-                input_infiniband_metrics->infiniband[count].port_rcv_remote_physical_errors = 0;
-            } else {
-                input_infiniband_metrics->infiniband[count].port_rcv_remote_physical_errors = long_int_value;
-            }
+    return 0;
+}
 
-            ret_snprintf = snprintf(counter_metric_file_path, PATH_MAX, "%s/port_rcv_switch_relay_errors", sysfs_device_port_counters);
-            ret_read_file = read_file_long_int(counter_metric_file_path, &long_int_value);
-            if (ret_snprintf < 0 || ret_read_file < 0) {
-                input_infiniband_metrics->infiniband[count].port_rcv_switch_relay_errors = 0;
-            } else {
-                input_infiniband_metrics->infiniband[count].port_rcv_switch_relay_errors = long_int_value;
-            }
+/*
+ * keep the topology current without touching it on every sample:
+ * rescan on uevents (or periodically without them) and re-read attributes at TOPOLOGY_REFRESH_NS
+ */
+static int refresh_infiniband_topology(int show_ethernet_flag) {
+    uint64_t now_ns = get_monotonic_ns();
 
-            ret_snprintf = snprintf(counter_metric_file_path, PATH_MAX, "%s/link_error_recovery", sysfs_device_port_counters);
-            ret_read_file = read_file_long_int(counter_metric_file_path, &long_int_value);
-            if (ret_snprintf < 0 || ret_read_file < 0) {
-                input_infiniband_metrics->infiniband[count].link_error_recovery = 0;
-            } else {
-                input_infiniband_metrics->infiniband[count].link_error_recovery = long_int_value;
-            }
+    if (infiniband_discovered == 0 || infiniband_discovered_ethernet_flag != show_ethernet_flag) {
+        return discover_infiniband_ports(show_ethernet_flag);
+    }
 
-            ret_snprintf = snprintf(counter_metric_file_path, PATH_MAX, "%s/port_xmit_constraint_errors", sysfs_device_port_counters);
-            ret_read_file = read_file_long_int(counter_metric_file_path, &long_int_value);
-            if (ret_snprintf < 0 || ret_read_file < 0) {
-                input_infiniband_metrics->infiniband[count].port_xmit_constraint_errors = 0;
-            } else {
-                input_infiniband_metrics->infiniband[count].port_xmit_constraint_errors = long_int_value;
-            }
+    if (now_ns - topology_refresh_ns < TOPOLOGY_REFRESH_NS) {
+        return 0;
+    }
 
-            ret_snprintf = snprintf(counter_metric_file_path, PATH_MAX, "%s/port_rcv_constraint_errors", sysfs_device_port_counters);
-            ret_read_file = read_file_long_int(counter_metric_file_path, &long_int_value);
-            if (ret_snprintf < 0 || ret_read_file < 0) {
-                input_infiniband_metrics->infiniband[count].port_rcv_constraint_errors = 0;
-            } else {
-                input_infiniband_metrics->infiniband[count].port_rcv_constraint_errors = long_int_value;
-            }
+    topology_refresh_ns = now_ns;
 
-            ret_snprintf = snprintf(counter_metric_file_path, PATH_MAX, "%s/local_link_integrity_errors", sysfs_device_port_counters);
-            ret_read_file = read_file_long_int(counter_metric_file_path, &long_int_value);
-            if (ret_snprintf < 0 || ret_read_file < 0) {
-                input_infiniband_metrics->infiniband[count].local_link_integrity_errors = 0;
-            } else {
-                input_infiniband_metrics->infiniband[count].local_link_integrity_errors = long_int_value;
-            }
+    if (uevent_fd >= 0 ? uevent_pending() > 0 : now_ns - topology_rescan_ns >= TOPOLOGY_RESCAN_NS) {
+        return discover_infiniband_ports(show_ethernet_flag);
+    }
 
-            ret_snprintf = snprintf(counter_metric_file_path, PATH_MAX, "%s/excessive_buffer_overrun_errors", sysfs_device_port_counters);
-            ret_read_file = read_file_long_int(counter_metric_file_path, &long_int_value);
-            if (ret_snprintf < 0 || ret_read_file < 0) {
-                input_infiniband_metrics->infiniband[count].excessive_buffer_overrun_errors = 0;
-            } else {
-                input_infiniband_metrics->infiniband[count].excessive_buffer_overrun_errors = long_int_value;
-            }
+    for (int i = 0; i < infiniband_port_count; ++i) {
+        /* a failed attribute read means the port went away, e.g.: driver reload */
+        if (read_port_attributes(&infiniband_ports[i]) < 0) {
+            return discover_infiniband_ports(show_ethernet_flag);
+        }
+    }
 
-            ret_snprintf = snprintf(counter_metric_file_path, PATH_MAX, "%s/port_xmit_data", sysfs_device_port_counters);
-            ret_read_file = read_file_long_int(counter_metric_file_path, &long_int_value);
-            if (ret_snprintf < 0 || ret_read_file < 0) {
-                input_infiniband_metrics->infiniband[count].port_xmit_data = 0;
-            } else {
-                input_infiniband_metrics->infiniband[count].port_xmit_data = long_int_value;
-            }
+    return 0;
+}
 
-            ret_snprintf = snprintf(counter_metric_file_path, PATH_MAX, "%s/port_rcv_data", sysfs_device_port_counters);
-            ret_read_file = read_file_long_int(counter_metric_file_path, &long_int_value);
-            if (ret_snprintf < 0 || ret_read_file < 0) {
-                input_infiniband_metrics->infiniband[count].port_rcv_data = 0;
-            } else {
-                input_infiniband_metrics->infiniband[count].port_rcv_data = long_int_value;
-            }
+int get_infiniband_metrics(struct infiniband_metrics *input_infiniband_metrics, int show_ethernet_flag) {
+    int count = 0;
+    int rediscover_flag = 0;
+    uint64_t uint64_value;
 
-            ret_snprintf = snprintf(counter_metric_file_path, PATH_MAX, "%s/port_xmit_packets", sysfs_device_port_counters);
-            ret_read_file = read_file_long_int(counter_metric_file_path, &long_int_value);
-            if (ret_snprintf < 0 || ret_read_file < 0) {
-                input_infiniband_metrics->infiniband[count].port_xmit_packets = 0;
-            } else {
-                input_infiniband_metrics->infiniband[count].port_xmit_packets = long_int_value;
-            }
+    /* the hot path below only reads counters */
+    if (refresh_infiniband_topology(show_ethernet_flag) < 0) {
+        return -1;
+    }
 
-            ret_snprintf = snprintf(counter_metric_file_path, PATH_MAX, "%s/port_rcv_packets", sysfs_device_port_counters);
-            ret_read_file = read_file_long_int(counter_metric_file_path, &long_int_value);
-            if (ret_snprintf < 0 || ret_read_file < 0) {
-                input_infiniband_metrics->infiniband[count].port_rcv_packets = 0;
-            } else {
-                input_infiniband_metrics->infiniband[count].port_rcv_packets = long_int_value;
-            }
+    size_t counter_count = infiniband_counter_count();
+    if (infiniband_metrics_reserve(input_infiniband_metrics, (size_t)infiniband_port_count, counter_count) < 0) {
+        fprintf(stderr, "ERROR: failed to allocate InfiniBand metrics\n");
+        return -1;
+    }
 
-            ret_snprintf = snprintf(counter_metric_file_path, PATH_MAX, "%s/unicast_rcv_packets", sysfs_device_port_counters);
-            ret_read_file = read_file_long_int(counter_metric_file_path, &long_int_value);
-            if (ret_snprintf < 0 || ret_read_file < 0) {
-                input_infiniband_metrics->infiniband[count].unicast_rcv_packets = 0;
-            } else {
-                input_infiniband_metrics->infiniband[count].unicast_rcv_packets = long_int_value;
-            }
+    input_infiniband_metrics->counter_count = counter_count;
 
-            ret_snprintf = snprintf(counter_metric_file_path, PATH_MAX, "%s/unicast_xmit_packets", sysfs_device_port_counters);
-            ret_read_file = read_file_long_int(counter_metric_file_path, &long_int_value);
-            if (ret_snprintf < 0 || ret_read_file < 0) {
-                input_infiniband_metrics->infiniband[count].unicast_xmit_packets = 0;
-            } else {
-                input_infiniband_metrics->infiniband[count].unicast_xmit_packets = long_int_value;
-            }
+    input_infiniband_metrics->timestamp_ns = get_monotonic_ns();
+    input_infiniband_metrics->realtime_ns = get_realtime_ns();
 
-            ret_snprintf = snprintf(counter_metric_file_path, PATH_MAX, "%s/multicast_rcv_packets", sysfs_device_port_counters);
-            ret_read_file = read_file_long_int(counter_metric_file_path, &long_int_value);
-            if (ret_snprintf < 0 || ret_read_file < 0) {
-                input_infiniband_metrics->infiniband[count].multicast_rcv_packets = 0;
-            } else {
-                input_infiniband_metrics->infiniband[count].multicast_rcv_packets = long_int_value;
+    /* one batched netlink round trip covers the counters it provides; sysfs serves the rest */
+    if (netlink_handle != NULL) {
+        if (rdma_netlink_stat_get(netlink_handle, netlink_requests, (size_t)infiniband_port_count, netlink_sample_counter, input_infiniband_metrics) < 0) {
+            /* fall back to sysfs for good; the next discovery does not retry netlink */
+            infiniband_backend = IB_BACKEND_SYSFS;
+            rdma_netlink_close(netlink_handle);
+            netlink_handle = NULL;
+            for (int i = 0; i < infiniband_port_count; ++i) {
+                memset(infiniband_ports[i].netlink_counters, 0, infiniband_ports[i].counter_count);
             }
+            input_infiniband_metrics->timestamp_ns = get_monotonic_ns();
+            input_infiniband_metrics->realtime_ns = get_realtime_ns();
+        }
+    }
 
-            ret_snprintf = snprintf(counter_metric_file_path, PATH_MAX, "%s/multicast_xmit_packets", sysfs_device_port_counters);
-            ret_read_file = read_file_long_int(counter_metric_file_path, &long_int_value);
-            if (ret_snprintf < 0 || ret_read_file < 0) {
-                input_infiniband_metrics->infiniband[count].multicast_xmit_packets = 0;
-            } else {
-                input_infiniband_metrics->infiniband[count].multicast_xmit_packets = long_int_value;
-            }
+    for (int i = 0; i < infiniband_port_count; ++i) {
+        struct infiniband_port *port = &infiniband_ports[i];
+        struct interface *output = &input_infiniband_metrics->infiniband[count];
 
-            ret_snprintf = snprintf(counter_metric_file_path, PATH_MAX, "%s/link_downed", sysfs_device_port_counters);
-            ret_read_file = read_file_long_int(counter_metric_file_path, &long_int_value);
-            if (ret_snprintf < 0 || ret_read_file < 0) {
-                input_infiniband_metrics->infiniband[count].link_downed = 0;
-            } else {
-                input_infiniband_metrics->infiniband[count].link_downed = long_int_value;
-            }
+        output->name_id = port->name_id; /* interface_name:port_name */
+        output->link_layer = port->link_layer;
+        output->lid = port->lid;
+        output->rate_id = port->rate_id;
+        output->state = port->state;
+        output->phys_state = port->phys_state;
 
-            ret_snprintf = snprintf(counter_metric_file_path, PATH_MAX, "%s/port_xmit_discards", sysfs_device_port_counters);
-            ret_read_file = read_file_long_int(counter_metric_file_path, &long_int_value);
-            if (ret_snprintf < 0 || ret_read_file < 0) {
-                input_infiniband_metrics->infiniband[count].port_xmit_discards = 0;
-            } else {
-                input_infiniband_metrics->infiniband[count].port_xmit_discards = long_int_value;
+        for (size_t j = 0; j < counter_count; ++j) {
+            if (j < port->counter_count && port->netlink_counters[j] > 0) {
+                continue;
             }
 
-            ret_snprintf = snprintf(counter_metric_file_path, PATH_MAX, "%s/VL15_dropped", sysfs_device_port_counters);
-            ret_read_file = read_file_long_int(counter_metric_file_path, &long_int_value);
-            if (ret_snprintf < 0 || ret_read_file < 0) {
-                input_infiniband_metrics->infiniband[count].VL15_dropped = 0;
-            } else {
-                input_infiniband_metrics->infiniband[count].VL15_dropped = long_int_value;
+            /* a missing counter file reads as 0; a failing open one means the port went away */
+            if (j >= port->counter_count || port->counter_fds[j] < 0) {
+                uint64_value = 0;
+            } else if (read_fd_uint64(port->counter_fds[j], &uint64_value) < 0) {
+                uint64_value = 0;
+                rediscover_flag = 1;
             }
 
-            ++count;
-
-            /* stop processing if number of interfaces is greater than INTERFACE_COUNT */
-            if (count >= INTERFACE_COUNT) {
-                break;
-            }
+            input_infiniband_metrics->counters[j][count] = uint64_value;
         }
 
-        closedir(device_dir_handle);
+        ++count;
     }
 
-    closedir(sysfs_dir_handle);
+    /* pick up removed or re-created ports on the next sample */
+    if (rediscover_flag > 0) {
+        infiniband_discovered = 0;
+    }
 
     return count;
 }
@@ -18,45 +18,120 @@
 #ifndef INFINIBAND_H
 #define INFINIBAND_H
 
+#include <stdint.h>
 #include <stdio.h>
 
-#define INTERFACE_COUNT 32
 #define IB_DEVICE_NAME_MAX 64
 
+/*
+ * standard counters sampled from ports/<port>/counters; the value indexes the counters array.
+ * counter ids from IB_COUNTER_COUNT on are extended counters the catalog found at run time
+ */
+enum infiniband_counter {
+    IB_COUNTER_SYMBOL_ERROR,
+    IB_COUNTER_PORT_RCV_ERRORS,
+    IB_COUNTER_PORT_RCV_REMOTE_PHYSICAL_ERRORS,
+    IB_COUNTER_PORT_RCV_SWITCH_RELAY_ERRORS,
+    IB_COUNTER_LINK_ERROR_RECOVERY,
+    IB_COUNTER_PORT_XMIT_CONSTRAINT_ERRORS,
+    IB_COUNTER_PORT_RCV_CONSTRAINT_ERRORS,
+    IB_COUNTER_LOCAL_LINK_INTEGRITY_ERRORS,
+    IB_COUNTER_EXCESSIVE_BUFFER_OVERRUN_ERRORS,
+    IB_COUNTER_PORT_XMIT_DATA,
+    IB_COUNTER_PORT_RCV_DATA,
+    IB_COUNTER_PORT_XMIT_PACKETS,
+    IB_COUNTER_PORT_RCV_PACKETS,
+    IB_COUNTER_UNICAST_RCV_PACKETS,
+    IB_COUNTER_UNICAST_XMIT_PACKETS,
+    IB_COUNTER_MULTICAST_RCV_PACKETS,
+    IB_COUNTER_MULTICAST_XMIT_PACKETS,
+    IB_COUNTER_LINK_DOWNED,
+    IB_COUNTER_PORT_XMIT_DISCARDS,
+    IB_COUNTER_VL15_DROPPED,
+    IB_COUNTER_COUNT
+};
+
+/* where counters are sampled from; netlink falls back to sysfs for counters it does not cover */
+enum infiniband_backend {
+    IB_BACKEND_SYSFS,
+    IB_BACKEND_NETLINK
+};
+
+enum infiniband_link_layer {
+    IB_LINK_LAYER_UNKNOWN,
+    IB_LINK_LAYER_INFINIBAND,
+    IB_LINK_LAYER_ETHERNET
+};
+
+/*
+ * port attributes of one snapshot
+ * state and phys_state keep the number sysfs prefixes them with (e.g.: "4: ACTIVE");
+ * interface name and rate are interned ids resolved with infiniband_*_name()
+ */
 struct interface {
-    char interface_name[IB_DEVICE_NAME_MAX];
-    char link_layer[BUFSIZ];
-    char state[BUFSIZ];
-    char phys_state[BUFSIZ];
-    char rate[BUFSIZ];
-    long int lid;
-    long int symbol_error;
-    long int port_rcv_errors;
-    long int port_rcv_remote_physical_errors;
-    long int port_rcv_switch_relay_errors;
-    long int link_error_recovery;
-    long int port_xmit_constraint_errors;
-    long int port_rcv_constraint_errors;
-    long int local_link_integrity_errors;
-    long int excessive_buffer_overrun_errors;
-    long int port_xmit_data;
-    long int port_rcv_data;
-    long int port_xmit_packets;
-    long int port_rcv_packets;
-    long int unicast_rcv_packets;
-    long int unicast_xmit_packets;
-    long int multicast_rcv_packets;
-    long int multicast_xmit_packets;
-    long int link_downed;
-    long int port_xmit_discards;
-    long int VL15_dropped;
+    uint32_t lid;
+    uint16_t name_id;
+    uint16_t rate_id;
+    uint8_t link_layer;
+    uint8_t state;
+    uint8_t phys_state;
 };
 
 struct infiniband_metrics {
+    /* CLOCK_MONOTONIC time the sample was taken at */
+    uint64_t timestamp_ns;
+
+    /* CLOCK_REALTIME time of the same instant, for output that needs wall-clock time */
+    uint64_t realtime_ns;
+
+    /* samples the collector dropped so far because the consumer fell a full ring behind */
+    uint64_t dropped_count;
+
+    /* get_infiniband_metrics() return value the snapshot was taken with */
+    int interface_count;
+
+    /* number of interfaces the storage below has room for */
+    size_t interface_capacity;
+
     /* interface metrics */
-    struct interface infiniband[INTERFACE_COUNT];
+    struct interface *infiniband;
+
+    /* counters held per interface: the standard ones, then the extended ones known when sampled */
+    size_t counter_count;
+
+    /* number of counters the storage below has room for */
+    size_t counter_capacity;
+
+    /* counter values as structure of arrays: counters[counter][interface] */
+    uint64_t **counters;
+
+    /* single allocation backing infiniband and counters */
+    void *storage;
 };
 
+extern struct infiniband_metrics *infiniband_metrics_alloc(size_t interface_capacity);
+extern int infiniband_metrics_reserve(struct infiniband_metrics *input_infiniband_metrics, size_t interface_capacity, size_t counter_count);
+extern void infiniband_metrics_free(struct infiniband_metrics *input_infiniband_metrics);
 extern int get_infiniband_metrics(struct infiniband_metrics *input_infiniband_metrics, int show_ethernet_flag);
+extern void close_infiniband_metrics(void);
+extern int infiniband_set_sysfs_root(const char *path);
+extern int infiniband_set_netlink_recording(const char *path);
+extern void infiniband_set_backend(enum infiniband_backend backend);
+extern enum infiniband_backend infiniband_active_backend(void);
+extern const char *infiniband_interface_name(uint16_t name_id);
+extern uint16_t infiniband_interface_id(const char *interface_name);
+extern size_t infiniband_interface_id_count(void);
+extern uint16_t infiniband_intern_interface_name(const char *interface_name);
+extern uint16_t infiniband_intern_rate_name(const char *rate_name);
+extern int infiniband_metrics_positions(const struct infiniband_metrics *input_infiniband_metrics, int **positions, size_t *positions_size);
+extern const char *infiniband_rate_name(uint16_t rate_id);
+extern double infiniband_rate_gbps(uint16_t rate_id);
+extern const char *infiniband_link_layer_name(uint8_t link_layer);
+extern const char *infiniband_state_name(uint8_t state);
+extern const char *infiniband_phys_state_name(uint8_t phys_state);
+extern const char *infiniband_counter_name(enum infiniband_counter counter);
+extern int infiniband_set_counter_selection(const char *selection);
+extern size_t infiniband_counter_count(void);
+extern int infiniband_intern_counter_name(const char *counter_name);
 
 #endif /* INFINIBAND_H */
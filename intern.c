@@ -0,0 +1,154 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2025 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include "intern.h"
+
+/* FNV-1a over at most INTERN_STRING_MAX - 1 characters */
+static uint32_t intern_hash(const char *string) {
+    uint32_t hash = 2166136261U;
+
+    for (size_t i = 0; i < INTERN_STRING_MAX - 1 && string[i] != '\0'; ++i) {
+        hash ^= (uint8_t)string[i];
+        hash *= 16777619U;
+    }
+
+    return hash;
+}
+
+static char *intern_slot(struct intern_table *table, size_t id) {
+    char (*chunk)[INTERN_STRING_MAX] = atomic_load_explicit(&table->chunks[id / INTERN_CHUNK_SIZE], memory_order_acquire);
+
+    return chunk[id % INTERN_CHUNK_SIZE];
+}
+
+/* find the index position holding string, or the empty position it would go to */
+static size_t intern_probe(struct intern_table *table, const char *string) {
+    size_t mask = table->index_size - 1;
+    size_t position = intern_hash(string) & mask;
+
+    while (table->index[position] != INTERN_ID_INVALID) {
+        if (strncmp(intern_slot(table, table->index[position]), string, INTERN_STRING_MAX - 1) == 0) {
+            break;
+        }
+
+        position = (position + 1) & mask;
+    }
+
+    return position;
+}
+
+/* keep the index at most half full */
+static int intern_grow_index(struct intern_table *table) {
+    size_t count = atomic_load_explicit(&table->count, memory_order_relaxed);
+    size_t new_size = table->index_size == 0 ? 64 : table->index_size * 2;
+    uint16_t *new_index;
+
+    new_index = malloc(new_size * sizeof(*new_index));
+    if (new_index == NULL) {
+        return -1;
+    }
+
+    memset(new_index, 0xff, new_size * sizeof(*new_index));
+
+    free(table->index);
+    table->index = new_index;
+    table->index_size = new_size;
+
+    for (size_t id = 0; id < count; ++id) {
+        table->index[intern_probe(table, intern_slot(table, id))] = (uint16_t)id;
+    }
+
+    return 0;
+}
+
+void intern_table_free(struct intern_table *table) {
+    for (size_t i = 0; i < INTERN_CHUNK_COUNT; ++i) {
+        free(atomic_load(&table->chunks[i]));
+        atomic_store(&table->chunks[i], NULL);
+    }
+
+    free(table->index);
+    table->index = NULL;
+    table->index_size = 0;
+    atomic_store(&table->count, 0);
+}
+
+/* return the id of string if it is interned, INTERN_ID_INVALID otherwise */
+uint16_t intern_lookup(struct intern_table *table, const char *string) {
+    if (table->index_size == 0) {
+        return INTERN_ID_INVALID;
+    }
+
+    return table->index[intern_probe(table, string)];
+}
+
+/* return the id of string, adding it if unseen; INTERN_ID_INVALID if the table is full */
+uint16_t intern_string(struct intern_table *table, const char *string) {
+    size_t count = atomic_load_explicit(&table->count, memory_order_relaxed);
+    size_t position;
+    char *slot;
+
+    uint16_t id = intern_lookup(table, string);
+    if (id != INTERN_ID_INVALID) {
+        return id;
+    }
+
+    if (count >= INTERN_ID_INVALID) {
+        return INTERN_ID_INVALID;
+    }
+
+    if ((count + 1) * 2 > table->index_size && intern_grow_index(table) < 0) {
+        return INTERN_ID_INVALID;
+    }
+
+    /* chunks are allocated on first use and never freed while the table is alive */
+    if (count % INTERN_CHUNK_SIZE == 0 && atomic_load_explicit(&table->chunks[count / INTERN_CHUNK_SIZE], memory_order_relaxed) == NULL) {
+        char (*chunk)[INTERN_STRING_MAX] = calloc(INTERN_CHUNK_SIZE, INTERN_STRING_MAX);
+        if (chunk == NULL) {
+            return INTERN_ID_INVALID;
+        }
+
+        atomic_store_explicit(&table->chunks[count / INTERN_CHUNK_SIZE], chunk, memory_order_release);
+    }
+
+    slot = intern_slot(table, count);
+    strncpy(slot, string, INTERN_STRING_MAX - 1);
+    slot[INTERN_STRING_MAX - 1] = '\0';
+
+    position = intern_probe(table, slot);
+    table->index[position] = (uint16_t)count;
+
+    /* publish the entry only after it is written */
+    atomic_store_explicit(&table->count, count + 1, memory_order_release);
+
+    return (uint16_t)count;
+}
+
+const char *interned_string(struct intern_table *table, uint16_t id) {
+    if (id >= atomic_load_explicit(&table->count, memory_order_acquire)) {
+        return "";
+    }
+
+    return intern_slot(table, id);
+}
+
+size_t intern_table_count(struct intern_table *table) {
+    return atomic_load_explicit(&table->count, memory_order_acquire);
+}
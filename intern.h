@@ -0,0 +1,51 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2025 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INTERN_H
+#define INTERN_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define INTERN_STRING_MAX 64
+#define INTERN_ID_INVALID UINT16_MAX
+
+/* strings are stored in fixed chunks so published entries never move */
+#define INTERN_CHUNK_SIZE 256
+#define INTERN_CHUNK_COUNT (INTERN_ID_INVALID / INTERN_CHUNK_SIZE + 1)
+
+/*
+ * append-only table mapping strings to small dense ids
+ * one thread interns through the hash index while others may resolve ids they have been handed
+ */
+struct intern_table {
+    char (*_Atomic chunks[INTERN_CHUNK_COUNT])[INTERN_STRING_MAX];
+    _Atomic size_t count;
+
+    /* open addressing index of ids, only touched by the interning thread */
+    uint16_t *index;
+    size_t index_size;
+};
+
+extern void intern_table_free(struct intern_table *table);
+extern uint16_t intern_string(struct intern_table *table, const char *string);
+extern uint16_t intern_lookup(struct intern_table *table, const char *string);
+extern const char *interned_string(struct intern_table *table, uint16_t id);
+extern size_t intern_table_count(struct intern_table *table);
+
+#endif /* INTERN_H */
@@ -0,0 +1,548 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2025 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include "infiniband.h"
+#include "metrics_server.h"
+#include "utils.h"
+
+/* concurrent connections; further clients are closed right after accept */
+#define MAX_CONNECTIONS 256
+
+/* requests larger than this are rejected */
+#define MAX_REQUEST_SIZE 4096
+
+/* connections that do not complete within this time are closed */
+#define CONNECTION_TIMEOUT_NS (10 * NSEC_PER_SEC)
+
+/* markers stored in epoll data for the two non-connection descriptors */
+#define LISTEN_MARKER ((void *)1)
+#define WAKE_MARKER ((void *)2)
+
+/*
+ * a complete HTTP response rendered once per sample; connections that are
+ * still sending an older page keep it alive through the reference count
+ */
+struct metrics_page {
+    _Atomic unsigned int refs;
+    size_t header_length;
+    size_t length;
+    char data[];
+};
+
+struct metrics_connection {
+    int fd;
+    uint64_t accepted_ns;
+    char request[MAX_REQUEST_SIZE];
+    size_t request_length;
+
+    /* response being sent; page is NULL for the static responses */
+    struct metrics_page *page;
+    const char *response;
+    size_t response_length;
+    size_t sent;
+
+    struct metrics_connection *prev;
+    struct metrics_connection *next;
+};
+
+struct metrics_server {
+    int listen_fd;
+    int epoll_fd;
+    int wake_fd;
+    pthread_t thread;
+
+    /* newest page; swapped by the collector thread, referenced by the server thread */
+    pthread_mutex_t page_mutex;
+    struct metrics_page *page;
+
+    /* render scratch space, only touched by the collector thread */
+    struct string_buffer body;
+
+    struct metrics_connection *connections;
+    int connection_count;
+};
+
+static const char response_not_ready[] =
+    "HTTP/1.1 503 Service Unavailable\r\nContent-Type: text/plain\r\nContent-Length: 20\r\nConnection: close\r\n\r\nno sample taken yet\n";
+static const char response_not_found[] =
+    "HTTP/1.1 404 Not Found\r\nContent-Type: text/plain\r\nContent-Length: 10\r\nConnection: close\r\n\r\nnot found\n";
+static const char response_bad_method[] =
+    "HTTP/1.1 405 Method Not Allowed\r\nAllow: GET, HEAD\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+static const char response_bad_request[] =
+    "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+
+static void page_release(struct metrics_page *page) {
+    if (page != NULL && atomic_fetch_sub_explicit(&page->refs, 1, memory_order_acq_rel) == 1) {
+        free(page);
+    }
+}
+
+static struct metrics_page *page_acquire(struct metrics_server *server) {
+    struct metrics_page *page;
+
+    pthread_mutex_lock(&server->page_mutex);
+    page = server->page;
+    if (page != NULL) {
+        atomic_fetch_add_explicit(&page->refs, 1, memory_order_relaxed);
+    }
+    pthread_mutex_unlock(&server->page_mutex);
+
+    return page;
+}
+
+/* append a label value, escaping backslash, double quote and newline */
+static int append_label_value(struct string_buffer *buffer, const char *value) {
+    for (const char *p = value; *p != '\0'; ++p) {
+        int ret;
+
+        if (*p == '\\' || *p == '"') {
+            char escaped[2] = {'\\', *p};
+            ret = string_buffer_append(buffer, escaped, 2);
+        } else if (*p == '\n') {
+            ret = string_buffer_append(buffer, "\\n", 2);
+        } else {
+            ret = string_buffer_append(buffer, p, 1);
+        }
+
+        if (ret < 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/* append {interface="mlx5_0:1",device="mlx5_0",port="1" without the closing brace */
+static int append_port_labels(struct string_buffer *buffer, const char *interface_name) {
+    const char *separator = strrchr(interface_name, ':');
+    int device_length = separator != NULL ? (int)(separator - interface_name) : (int)strlen(interface_name);
+
+    if (string_buffer_append(buffer, "{interface=\"", 12) < 0 ||
+        append_label_value(buffer, interface_name) < 0 ||
+        string_buffer_printf(buffer, "\",device=\"%.*s\",port=\"%s\"", device_length, interface_name, separator != NULL ? separator + 1 : "") < 0) {
+        return -1;
+    }
+
+    return 0;
+}
+
+static int render_body(struct string_buffer *buffer, const struct infiniband_metrics *input_infiniband_metrics) {
+    int interface_count = input_infiniband_metrics->interface_count;
+
+    if (string_buffer_printf(buffer,
+                             "# HELP infiniband_up Whether the last sample read the InfiniBand counters.\n"
+                             "# TYPE infiniband_up gauge\n"
+                             "infiniband_up %d\n", interface_count > 0) < 0) {
+        return -1;
+    }
+
+    if (interface_count <= 0) {
+        return 0;
+    }
+
+    uint64_t realtime_ns = input_infiniband_metrics->realtime_ns;
+    if (string_buffer_printf(buffer,
+                             "# HELP infiniband_sample_timestamp_seconds Wall-clock time the counters were read.\n"
+                             "# TYPE infiniband_sample_timestamp_seconds gauge\n"
+                             "infiniband_sample_timestamp_seconds %" PRIu64 ".%09" PRIu64 "\n", (uint64_t)(realtime_ns / NSEC_PER_SEC), (uint64_t)(realtime_ns % NSEC_PER_SEC)) < 0) {
+        return -1;
+    }
+
+    if (string_buffer_printf(buffer,
+                             "# HELP infiniband_dropped_samples_total Samples the collector dropped because the screen or stream fell behind.\n"
+                             "# TYPE infiniband_dropped_samples_total counter\n"
+                             "infiniband_dropped_samples_total %" PRIu64 "\n", input_infiniband_metrics->dropped_count) < 0) {
+        return -1;
+    }
+
+    if (string_buffer_printf(buffer,
+                             "# HELP infiniband_port_info Port attributes.\n"
+                             "# TYPE infiniband_port_info gauge\n") < 0) {
+        return -1;
+    }
+
+    for (int i = 0; i < interface_count; ++i) {
+        const struct interface *port = &input_infiniband_metrics->infiniband[i];
+
+        if (string_buffer_printf(buffer, "infiniband_port_info") < 0 ||
+            append_port_labels(buffer, infiniband_interface_name(port->name_id)) < 0 ||
+            string_buffer_printf(buffer, ",link_layer=\"%s\",state=\"%s\",phys_state=\"%s\",rate=\"", infiniband_link_layer_name(port->link_layer),
+                                 infiniband_state_name(port->state), infiniband_phys_state_name(port->phys_state)) < 0 ||
+            append_label_value(buffer, infiniband_rate_name(port->rate_id)) < 0 ||
+            string_buffer_printf(buffer, "\",lid=\"%" PRIu32 "\"} 1\n", port->lid) < 0) {
+            return -1;
+        }
+    }
+
+    for (size_t k = 0; k < input_infiniband_metrics->counter_count; ++k) {
+        /* metric names are lower case (the sysfs file name is VL15_dropped); driver counters may use other characters */
+        char metric_name[IB_DEVICE_NAME_MAX];
+        const char *counter_name = infiniband_counter_name((enum infiniband_counter)k);
+        size_t length = 0;
+
+        for (; counter_name[length] != '\0' && length < sizeof(metric_name) - 1; ++length) {
+            char c = counter_name[length];
+            metric_name[length] = (char)(c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') ? c : '_');
+        }
+        metric_name[length] = '\0';
+
+        if (string_buffer_printf(buffer,
+                                 "# HELP infiniband_%s_total Port counter %s.\n"
+                                 "# TYPE infiniband_%s_total counter\n", metric_name, counter_name, metric_name) < 0) {
+            return -1;
+        }
+
+        for (int i = 0; i < interface_count; ++i) {
+            if (string_buffer_printf(buffer, "infiniband_%s_total", metric_name) < 0 ||
+                append_port_labels(buffer, infiniband_interface_name(input_infiniband_metrics->infiniband[i].name_id)) < 0 ||
+                string_buffer_printf(buffer, "} %" PRIu64 "\n", input_infiniband_metrics->counters[k][i]) < 0) {
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/* render the sample into a new page and make it current; runs on the collector thread */
+void metrics_server_publish(const struct infiniband_metrics *input_infiniband_metrics, void *server) {
+    struct metrics_server *input_server = server;
+    struct string_buffer *body = &input_server->body;
+    char header[256];
+
+    body->length = 0;
+    if (render_body(body, input_infiniband_metrics) < 0) {
+        return;
+    }
+
+    int header_length = snprintf(header, sizeof(header),
+                                 "HTTP/1.1 200 OK\r\n"
+                                 "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                                 "Content-Length: %zu\r\n"
+                                 "Connection: close\r\n\r\n", body->length);
+    if (header_length < 0 || (size_t)header_length >= sizeof(header)) {
+        return;
+    }
+
+    struct metrics_page *page = malloc(sizeof(*page) + (size_t)header_length + body->length);
+    if (page == NULL) {
+        return;
+    }
+
+    atomic_init(&page->refs, 1);
+    page->header_length = (size_t)header_length;
+    page->length = (size_t)header_length + body->length;
+    memcpy(page->data, header, (size_t)header_length);
+    memcpy(page->data + header_length, body->data, body->length);
+
+    pthread_mutex_lock(&input_server->page_mutex);
+    struct metrics_page *old_page = input_server->page;
+    input_server->page = page;
+    pthread_mutex_unlock(&input_server->page_mutex);
+
+    page_release(old_page);
+}
+
+static void close_connection(struct metrics_server *server, struct metrics_connection *connection) {
+    if (connection->prev != NULL) {
+        connection->prev->next = connection->next;
+    } else {
+        server->connections = connection->next;
+    }
+    if (connection->next != NULL) {
+        connection->next->prev = connection->prev;
+    }
+
+    close(connection->fd);
+    page_release(connection->page);
+    free(connection);
+    --server->connection_count;
+}
+
+static void accept_connections(struct metrics_server *server) {
+    while (1) {
+        int fd = accept4(server->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            return;
+        }
+
+        struct metrics_connection *connection = NULL;
+        if (server->connection_count < MAX_CONNECTIONS) {
+            connection = calloc(1, sizeof(*connection));
+        }
+        if (connection == NULL) {
+            close(fd);
+            continue;
+        }
+
+        connection->fd = fd;
+        connection->accepted_ns = get_monotonic_ns();
+
+        struct epoll_event event = {.events = EPOLLIN | EPOLLRDHUP, .data.ptr = connection};
+        if (epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) {
+            close(fd);
+            free(connection);
+            continue;
+        }
+
+        connection->next = server->connections;
+        if (server->connections != NULL) {
+            server->connections->prev = connection;
+        }
+        server->connections = connection;
+        ++server->connection_count;
+    }
+}
+
+/* pick the response once the request head is complete */
+static void prepare_response(struct metrics_server *server, struct metrics_connection *connection) {
+    char *request = connection->request;
+    int head_flag = 0;
+
+    if (strncmp(request, "GET ", 4) == 0) {
+        request += 4;
+    } else if (strncmp(request, "HEAD ", 5) == 0) {
+        request += 5;
+        head_flag = 1;
+    } else {
+        connection->response = response_bad_method;
+        connection->response_length = sizeof(response_bad_method) - 1;
+        return;
+    }
+
+    size_t path_length = strcspn(request, " ?\r\n");
+    if (path_length != 8 || strncmp(request, "/metrics", 8) != 0) {
+        connection->response = response_not_found;
+        connection->response_length = sizeof(response_not_found) - 1;
+        return;
+    }
+
+    connection->page = page_acquire(server);
+    if (connection->page == NULL) {
+        connection->response = response_not_ready;
+        connection->response_length = sizeof(response_not_ready) - 1;
+        return;
+    }
+
+    connection->response = connection->page->data;
+    connection->response_length = head_flag > 0 ? connection->page->header_length : connection->page->length;
+}
+
+/* return 1 when the connection is finished and should be closed */
+static int send_response(struct metrics_connection *connection) {
+    while (connection->sent < connection->response_length) {
+        ssize_t ret_send = send(connection->fd, connection->response + connection->sent, connection->response_length - connection->sent, MSG_NOSIGNAL);
+        if (ret_send < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : 1;
+        }
+
+        connection->sent += (size_t)ret_send;
+    }
+
+    return 1;
+}
+
+/* return 1 when the connection is finished and should be closed */
+static int handle_connection(struct metrics_server *server, struct metrics_connection *connection, uint32_t events) {
+    if (connection->response == NULL) {
+        while (1) {
+            ssize_t ret_recv = recv(connection->fd, connection->request + connection->request_length, sizeof(connection->request) - 1 - connection->request_length, 0);
+            if (ret_recv < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    break;
+                }
+                return 1;
+            }
+            if (ret_recv == 0) {
+                return 1;
+            }
+
+            connection->request_length += (size_t)ret_recv;
+            connection->request[connection->request_length] = '\0';
+
+            if (strstr(connection->request, "\r\n\r\n") != NULL || strstr(connection->request, "\n\n") != NULL) {
+                prepare_response(server, connection);
+                break;
+            }
+
+            if (connection->request_length == sizeof(connection->request) - 1) {
+                connection->response = response_bad_request;
+                connection->response_length = sizeof(response_bad_request) - 1;
+                break;
+            }
+        }
+
+        if (connection->response == NULL) {
+            return (events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) != 0;
+        }
+    }
+
+    if (send_response(connection) > 0) {
+        return 1;
+    }
+
+    /* the socket buffer is full; continue when it drains */
+    struct epoll_event event = {.events = EPOLLOUT, .data.ptr = connection};
+    epoll_ctl(server->epoll_fd, EPOLL_CTL_MOD, connection->fd, &event);
+
+    return 0;
+}
+
+static void *metrics_server_main(void *arg) {
+    struct metrics_server *server = arg;
+    struct epoll_event events[64];
+
+    while (1) {
+        int ret_epoll = epoll_wait(server->epoll_fd, events, SIZEOF(events), 1000);
+        if (ret_epoll < 0 && errno != EINTR) {
+            break;
+        }
+
+        for (int i = 0; i < ret_epoll; ++i) {
+            if (events[i].data.ptr == WAKE_MARKER) {
+                return NULL;
+            }
+
+            if (events[i].data.ptr == LISTEN_MARKER) {
+                accept_connections(server);
+                continue;
+            }
+
+            struct metrics_connection *connection = events[i].data.ptr;
+            if (handle_connection(server, connection, events[i].events) > 0) {
+                close_connection(server, connection);
+            }
+        }
+
+        /* drop clients that stall */
+        uint64_t now_ns = get_monotonic_ns();
+        struct metrics_connection *connection = server->connections;
+        while (connection != NULL) {
+            struct metrics_connection *next = connection->next;
+            if (now_ns - connection->accepted_ns > CONNECTION_TIMEOUT_NS) {
+                close_connection(server, connection);
+            }
+            connection = next;
+        }
+    }
+
+    return NULL;
+}
+
+static void metrics_server_free(struct metrics_server *server) {
+    while (server->connections != NULL) {
+        close_connection(server, server->connections);
+    }
+
+    if (server->listen_fd >= 0) {
+        close(server->listen_fd);
+    }
+    if (server->epoll_fd >= 0) {
+        close(server->epoll_fd);
+    }
+    if (server->wake_fd >= 0) {
+        close(server->wake_fd);
+    }
+
+    page_release(server->page);
+    string_buffer_free(&server->body);
+    free(server);
+}
+
+struct metrics_server *metrics_server_start(const char *listen_address) {
+    struct metrics_server *server = calloc(1, sizeof(*server));
+    if (server == NULL) {
+        fprintf(stderr, "ERROR: failed to allocate metrics server\n");
+        return NULL;
+    }
+
+    server->epoll_fd = -1;
+    server->wake_fd = -1;
+
+    server->listen_fd = open_listen_socket(listen_address);
+    if (server->listen_fd < 0) {
+        goto handle_error;
+    }
+
+    server->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    server->wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (server->epoll_fd < 0 || server->wake_fd < 0) {
+        fprintf(stderr, "ERROR: failed to create metrics server descriptors: %s\n", strerror(errno));
+        goto handle_error;
+    }
+
+    struct epoll_event listen_event = {.events = EPOLLIN, .data.ptr = LISTEN_MARKER};
+    struct epoll_event wake_event = {.events = EPOLLIN, .data.ptr = WAKE_MARKER};
+    if (epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, server->listen_fd, &listen_event) < 0 ||
+        epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, server->wake_fd, &wake_event) < 0) {
+        fprintf(stderr, "ERROR: failed to register metrics server descriptors: %s\n", strerror(errno));
+        goto handle_error;
+    }
+
+    pthread_mutex_init(&server->page_mutex, NULL);
+
+    if (pthread_create(&server->thread, NULL, metrics_server_main, server) != 0) {
+        fprintf(stderr, "ERROR: failed to create metrics server thread\n");
+        pthread_mutex_destroy(&server->page_mutex);
+        goto handle_error;
+    }
+
+    return server;
+
+handle_error:
+    metrics_server_free(server);
+
+    return NULL;
+}
+
+/* stop serving; the collector feeding metrics_server_publish must be stopped first */
+void metrics_server_stop(struct metrics_server *server) {
+    uint64_t event_value = 1;
+
+    if (server == NULL) {
+        return;
+    }
+
+    if (write(server->wake_fd, &event_value, sizeof(event_value)) < 0) {
+        /* the counter is already non-zero, so the thread is woken anyway */
+    }
+
+    pthread_join(server->thread, NULL);
+    pthread_mutex_destroy(&server->page_mutex);
+
+    metrics_server_free(server);
+}
@@ -15,49 +15,737 @@
  * limitations under the License.
  */
 
+#include <inttypes.h>
+#include <langinfo.h>
+#include <limits.h>
 #include <ncurses.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "alert.h"
+#include "delta.h"
+#include "event_log.h"
+#include "history.h"
+#include "infiniband.h"
 #include "ncurses_utils.h"
+#include "stats.h"
+#include "utils.h"
 
-void construct_window_layout(WINDOW *input_window, int interface_count) {
-    /* layour constants */
-    char *interface_status_banner = "Interface Status";
-    char *interface_status_layout = "Interface Name  |   LID   |   Link Layer   |      State      |  Physical State  |     Rate";
+/* delimiter positions */
+static int interface_status_positions[] = {17, 27, 44, 62, 81};
+static int interface_event_positions[] = {17, 43, 56, 81};
+static int interface_io_positions[] = {17, 31, 43, 57, 69, 86, 103, 120};
+static int interface_graph_positions[] = {17, 23, 33, 42};
+static int interface_resource_positions[] = {17, 27, 45, 53, 61, 69, 79, 93, 107};
+static int interface_error_positions[] = {17, 26, 35, 51, 69, 81, 93, 110, 123};
+static int interface_link_error_positions[] = {17, 39, 62};
+static int interface_extended_positions[] = {17, 52, 75};
+static int interface_stats_positions[] = {17, 26, 36, 46, 56, 66, 76, 86, 96, 106, 116, 126, 136};
 
-    char *interface_io_banner = "Interface I/O (per second)";
-    char *interface_io_layout = "Interface Name  |  RX Packet  |   RX Mbit |  TX Packet  |   TX Mbit |  UC RX Packet  |  UC TX Packet  |  MC RX Packet  |  MC TX Packet";
+/* banner, column headers and delimiter positions of every section, in screen order; optional sections are left out when empty */
+static const struct {
+    const char *banner;
+    const char *layout;
+    int *positions;
+    size_t position_count;
+    int optional_flag;
+} sections[RENDER_SECTION_COUNT] = {
+    [RENDER_SECTION_STATUS] = {
+        "Interface Status",
+        "Interface Name  |   LID   |   Link Layer   |      State      |  Physical State  |     Rate",
+        interface_status_positions, SIZEOF(interface_status_positions)
+    },
+    [RENDER_SECTION_EVENTS] = {
+        "Port Events (newest first)",
+        "Interface Name  | Time                    | Attribute  | From                   | To",
+        interface_event_positions, SIZEOF(interface_event_positions), 1
+    },
+    [RENDER_SECTION_IO] = {
+        "Interface I/O (per second)",
+        "Interface Name  |  RX Packet  |   RX Mbit |  TX Packet  |   TX Mbit |  UC RX Packet  |  UC TX Packet  |  MC RX Packet  |  MC TX Packet",
+        interface_io_positions, SIZEOF(interface_io_positions)
+    },
+    [RENDER_SECTION_GRAPH] = {
+        "Interface Data Rate History",
+        "Interface Name  | Dir |    Mbit |   Util | Oldest to newest sample, height is the share of the link rate",
+        interface_graph_positions, SIZEOF(interface_graph_positions), 1
+    },
+    [RENDER_SECTION_RESOURCES] = {
+        "RDMA Resources per Process (QP counter set rates per second)",
+        "Interface Name  |     PID | Command         |    QP |    CQ |    MR |  MR MiB |  RX Write/s |   RX Read/s | RX Atomic/s",
+        interface_resource_positions, SIZEOF(interface_resource_positions), 1
+    },
+    [RENDER_SECTION_ERROR] = {
+        "Interface Error (cumulative)",
+        "Interface Name  | Symbol |   RX   | RX Remote PHY | RX Switch Relay | RX Const. | TX Const. | Buffer Overrun | TX Discard | VL15 Dropped",
+        interface_error_positions, SIZEOF(interface_error_positions)
+    },
+    [RENDER_SECTION_LINK_ERROR] = {
+        "Interface Link Error (cumulative)",
+        "Interface Name  | Link Error Recovery | Local Link Integrity | Link Downed",
+        interface_link_error_positions, SIZEOF(interface_link_error_positions)
+    },
+    [RENDER_SECTION_EXTENDED] = {
+        "Interface Extended Counters",
+        "Interface Name  | Counter                          |                Total | Per Second",
+        interface_extended_positions, SIZEOF(interface_extended_positions), 1
+    },
+    [RENDER_SECTION_STATS] = {
+        "Interface Statistics (Mbit per second)",
+        "Interface Name  | Window | RX EWMA |  RX Min | RX Mean |  RX Max |  RX p50 |  RX p99 | TX EWMA |  TX Min | TX Mean |  TX Max |  TX p50 |  TX p99",
+        interface_stats_positions, SIZEOF(interface_stats_positions), 1
+    },
+};
 
-    char *interface_error_banner = "Interface Error (cumulative)";
-    char *interface_error_layout = "Interface Name  | Symbol |   RX   | RX Remote PHY | RX Switch Relay | RX Const. | TX Const. | Buffer Overrun | TX Discard | VL15 Dropped";
+/* data counters count 4-byte words; rates are shown in Mbit */
+#define WORDS_TO_MBIT (4.0 * 8 / 1024 / 1024)
 
-    char *interface_link_error_banner = "Interface Link Error (cumulative)";
-    char *interface_link_error_layout = "Interface Name  | Link Error Recovery | Local Link Integrity | Link Downed";
+/* I/O rates: counter, column and scale */
+static const struct {
+    enum infiniband_counter counter;
+    int column;
+    double scale;
+} interface_io_rates[] = {
+    {IB_COUNTER_PORT_RCV_PACKETS, 21, 1.0},
+    {IB_COUNTER_PORT_RCV_DATA, 33, WORDS_TO_MBIT},
+    {IB_COUNTER_PORT_XMIT_PACKETS, 47, 1.0},
+    {IB_COUNTER_PORT_XMIT_DATA, 59, WORDS_TO_MBIT},
+    {IB_COUNTER_UNICAST_RCV_PACKETS, 76, 1.0},
+    {IB_COUNTER_UNICAST_XMIT_PACKETS, 93, 1.0},
+    {IB_COUNTER_MULTICAST_RCV_PACKETS, 110, 1.0},
+    {IB_COUNTER_MULTICAST_XMIT_PACKETS, 125, 1.0},
+};
 
-    /* move curser and print layout 
+/* sort orders: option name, label and the counter whose rate is sorted by */
+static const struct {
+    const char *name;
+    const char *label;
+    enum infiniband_counter counter;
+} render_sorts[RENDER_SORT_COUNT] = {
+    [RENDER_SORT_NONE] = {"none", NULL, IB_COUNTER_COUNT},
+    [RENDER_SORT_RX_MBIT] = {"rx", "RX Mbit", IB_COUNTER_PORT_RCV_DATA},
+    [RENDER_SORT_TX_MBIT] = {"tx", "TX Mbit", IB_COUNTER_PORT_XMIT_DATA},
+    [RENDER_SORT_RX_PACKETS] = {"rx-packets", "RX Packet", IB_COUNTER_PORT_RCV_PACKETS},
+    [RENDER_SORT_TX_PACKETS] = {"tx-packets", "TX Packet", IB_COUNTER_PORT_XMIT_PACKETS},
+    [RENDER_SORT_ERRORS] = {"errors", "errors", IB_COUNTER_COUNT},
+};
+
+/* counters whose rates add up to the error rate */
+static const enum infiniband_counter error_counters[] = {
+    IB_COUNTER_SYMBOL_ERROR,
+    IB_COUNTER_PORT_RCV_ERRORS,
+    IB_COUNTER_PORT_RCV_REMOTE_PHYSICAL_ERRORS,
+    IB_COUNTER_PORT_RCV_SWITCH_RELAY_ERRORS,
+    IB_COUNTER_LINK_ERROR_RECOVERY,
+    IB_COUNTER_PORT_XMIT_CONSTRAINT_ERRORS,
+    IB_COUNTER_PORT_RCV_CONSTRAINT_ERRORS,
+    IB_COUNTER_LOCAL_LINK_INTEGRITY_ERRORS,
+    IB_COUNTER_EXCESSIVE_BUFFER_OVERRUN_ERRORS,
+    IB_COUNTER_LINK_DOWNED,
+    IB_COUNTER_PORT_XMIT_DISCARDS,
+    IB_COUNTER_VL15_DROPPED,
+};
+
+/* history levels: idle, then up to each eighth of the link rate */
+static const char *const graph_blocks[] = {" ", "\u2581", "\u2582", "\u2583", "\u2584", "\u2585", "\u2586", "\u2587", "\u2588"};
+static const char graph_characters[] = " .:-=+*%#";
+
+/* data rate history rows of a port, the first is RX */
+static const char *const graph_directions[HISTORY_DIRECTION_COUNT] = {
+    [HISTORY_RX] = "RX",
+    [HISTORY_TX] = "TX",
+};
+
+/* column the history starts at */
+#define GRAPH_COLUMN 44
+
+/*
+ * the content is a column of rows scrolled behind the border: content row state->scroll is shown
+ * on screen row 1, and lines - 2 rows fit. return the screen row of content row, -1 if it is not shown
+ */
+static int screen_row(const struct render_state *state, int row) {
+    int shown_row = row - state->scroll;
+
+    if (shown_row < 0 || shown_row > state->lines - 3) {
+        return -1;
+    }
+
+    return shown_row + 1;
+}
+
+/*
+ * print the formatted text at content row and column unless it is scrolled out or the cells there
+ * already hold it, so unchanged values cost neither a window update nor terminal output. text is
+ * clipped at the right border
+ */
+static void print_cell(WINDOW *input_window, struct render_state *state, int row, int column, const char *format, ...) __attribute__((format(printf, 5, 6)));
+static void print_cell(WINDOW *input_window, struct render_state *state, int row, int column, const char *format, ...) {
+    char text[128];
+    va_list args;
+    int line = screen_row(state, row);
+
+    if (line < 0 || column < 0 || column >= state->columns - 1) {
+        return;
+    }
+
+    va_start(args, format);
+    int length = vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+
+    if (length < 0) {
+        return;
+    }
+
+    size_t text_length = (size_t)length < sizeof(text) ? (size_t)length : sizeof(text) - 1;
+    if (text_length > (size_t)(state->columns - 1 - column)) {
+        text_length = (size_t)(state->columns - 1 - column);
+    }
+
+    char *cells = state->cells + (size_t)line * (size_t)state->columns + (size_t)column;
+    if (memcmp(cells, text, text_length) == 0) {
+        return;
+    }
+
+    memcpy(cells, text, text_length);
+    mvwaddnstr(input_window, line, column, text, (int)text_length);
+}
+
+/* print the name of the interface at position i of cur_metrics at the start of row; a port with a raised alert is marked and highlighted */
+static void print_port_name(WINDOW *input_window, struct render_state *state, int row, const struct infiniband_metrics *cur_metrics, int i) {
+    uint16_t name_id = cur_metrics->infiniband[i].name_id;
+
+    /* the mark changes the cell's text, so the name is drawn again when the alert is raised or cleared */
+    if (state->alert_rules != NULL && alerts_port_active(state->alert_rules, name_id) > 0) {
+        wattron(input_window, A_STANDOUT);
+        print_cell(input_window, state, row, 1, "!%-15s", infiniband_interface_name(name_id));
+        wattroff(input_window, A_STANDOUT);
+    } else {
+        print_cell(input_window, state, row, 1, "%-16s", infiniband_interface_name(name_id));
+    }
+}
+
+/*
+ * print how fast counter advanced between position i of cur_metrics and j of prev_metrics,
+ * multiplied by scale, in the 10 columns at (row, column). a delta that does not describe the
+ * interval is replaced by its label, a lower bound is marked with a trailing '+'
+ */
+static void print_rate(WINDOW *input_window, struct render_state *state, int row, int column, const struct infiniband_metrics *cur_metrics,
+                       const struct infiniband_metrics *prev_metrics, enum infiniband_counter counter, int i, int j, double link_gbps, unsigned int port_flags, double scale) {
+    uint64_t elapsed_ns = cur_metrics->timestamp_ns - prev_metrics->timestamp_ns;
+    uint64_t delta;
+    unsigned int flags = port_flags | counter_delta(counter, cur_metrics->counters[counter][i], prev_metrics->counters[counter][j], elapsed_ns, link_gbps, &delta);
+    const char *label = delta_flag_label(flags);
+
+    if (label != NULL) {
+        print_cell(input_window, state, row, column, "%10s", label);
+        return;
+    }
+
+    long int rate = (long int)((double)delta * scale / ((double)elapsed_ns / 1e9));
+    if (flags & DELTA_LOWER_BOUND) {
+        print_cell(input_window, state, row, column, "%9ld+", rate);
+    } else {
+        print_cell(input_window, state, row, column, "%10ld", rate);
+    }
+}
+
+/*
+ * draw rates in bit per second, oldest first, at content row and column in at most width cells, the
+ * newest at the right end: each is a block whose height is its share of capacity, or of the highest
+ * rate if the link rate is unknown; idle is blank and unknown rates are '?'. block elements need a
+ * UTF-8 locale, other ones get characters of increasing weight. like print_cell, only cells whose
+ * level changes are drawn
+ */
+static void print_graph(WINDOW *input_window, struct render_state *state, int row, int column, const float *rates, size_t rate_count, size_t width, double capacity) {
+    int line = screen_row(state, row);
+
+    if (line < 0 || column >= state->columns - 1) {
+        return;
+    }
+
+    if (width > (size_t)(state->columns - 1 - column)) {
+        width = (size_t)(state->columns - 1 - column);
+    }
+
+    if (!(capacity > 0.0)) {
+        capacity = 0.0;
+        for (size_t k = 0; k < rate_count; ++k) {
+            capacity = (double)rates[k] > capacity ? (double)rates[k] : capacity;
+        }
+    }
+
+    /* the cells hold the level of each block: ' ' before the first rate, '0' - '8' or '?' */
+    char *cells = state->cells + (size_t)line * (size_t)state->columns + (size_t)column;
+    for (size_t k = 0; k < width; ++k) {
+        char level = ' ';
+
+        if (k + rate_count >= width) {
+            double rate = (double)rates[k + rate_count - width];
+            if (rate < 0.0) {
+                level = '?';
+            } else if (rate > 0.0 && capacity > 0.0) {
+                /* anything above idle is at least one eighth high */
+                double eighths = rate / capacity * 8.0;
+                int height = (int)eighths < eighths ? (int)eighths + 1 : (int)eighths;
+                level = (char)('0' + (height < 1 ? 1 : height > 8 ? 8 : height));
+            } else {
+                level = '0';
+            }
+        }
+
+        if (cells[k] == level) {
+            continue;
+        }
+        cells[k] = level;
+
+        if (level >= '0' && level <= '8') {
+            if (state->unicode_flag > 0) {
+                mvwaddstr(input_window, line, column + (int)k, graph_blocks[level - '0']);
+            } else {
+                mvwaddch(input_window, line, column + (int)k, (chtype)graph_characters[level - '0']);
+            }
+        } else {
+            mvwaddch(input_window, line, column + (int)k, (chtype)level);
+        }
+    }
+}
+
+/*
+ * print the newest data rate in direction of the interface at position i of cur_metrics, its share of
+ * the link rate and its history from rate_history
+ */
+static void print_history(WINDOW *input_window, struct render_state *state, int row, const struct history *rate_history, const struct infiniband_metrics *cur_metrics, int i,
+                          enum history_direction direction) {
+    size_t width = history_length(rate_history);
+    double capacity = infiniband_rate_gbps(cur_metrics->infiniband[i].rate_id) * 1e9;
+
+    print_port_name(input_window, state, row, cur_metrics, i);
+    print_cell(input_window, state, row, 19, "%-3s", graph_directions[direction]);
+
+    size_t rate_count = history_read(rate_history, cur_metrics->infiniband[i].name_id, direction, state->graph_rates, width);
+    double rate = rate_count > 0 ? (double)state->graph_rates[rate_count - 1] : -1.0;
+
+    if (rate < 0.0) {
+        print_cell(input_window, state, row, 24, "%8s", "");
+        print_cell(input_window, state, row, 35, "%6s", "");
+    } else {
+        print_cell(input_window, state, row, 24, "%8ld", (long int)(rate / 1024 / 1024));
+        if (capacity > 0.0) {
+            print_cell(input_window, state, row, 35, "%5.1f%%", rate / capacity * 100.0);
+        } else {
+            print_cell(input_window, state, row, 35, "%6s", "-");
+        }
+    }
+
+    print_graph(input_window, state, row, GRAPH_COLUMN, state->graph_rates, rate_count, width, capacity);
+}
+
+/* print the port of event, the local time it was seen at and the attribute's value before and after */
+static void print_event(WINDOW *input_window, struct render_state *state, int row, const struct port_event *event) {
+    time_t seconds = (time_t)(event->realtime_ns / NSEC_PER_SEC);
+    struct tm local_time;
+    char time_text[32] = "";
+    char from_text[16];
+    char to_text[16];
+
+    if (localtime_r(&seconds, &local_time) != NULL) {
+        strftime(time_text, sizeof(time_text), "%Y-%m-%d %H:%M:%S", &local_time);
+    }
+
+    print_cell(input_window, state, row, 1, "%-16s", infiniband_interface_name(event->name_id));
+    print_cell(input_window, state, row, 19, "%s.%03" PRIu64, time_text, (uint64_t)(event->realtime_ns % NSEC_PER_SEC / NSEC_PER_MSEC));
+    print_cell(input_window, state, row, 45, "%-10s", port_attribute_name((enum port_attribute)event->attribute));
+    print_cell(input_window, state, row, 58, "%-22.22s", port_event_value(event, event->from, from_text, sizeof(from_text)));
+    print_cell(input_window, state, row, 83, "%-22.22s", port_event_value(event, event->to, to_text, sizeof(to_text)));
+}
+
+/*
+ * print what the process of row holds on its port: a device row is named after the device, and a
+ * kernel resource owner has no pid. rates are blank until its counter sets were read twice
+ */
+static void print_resource_usage(WINDOW *input_window, struct render_state *state, int row, const struct infiniband_metrics *cur_metrics, const struct render_resource_row *resource_row) {
+    const struct resource_usage *usage = resource_row->usage;
+
+    if (usage->device_flag > 0) {
+        print_cell(input_window, state, row, 1, "%-16s", usage->device_name);
+    } else {
+        print_port_name(input_window, state, row, cur_metrics, resource_row->position);
+    }
+
+    if (usage->pid > 0) {
+        print_cell(input_window, state, row, 19, "%7" PRIu32, usage->pid);
+    } else {
+        print_cell(input_window, state, row, 19, "%7s", "-");
+    }
+
+    print_cell(input_window, state, row, 29, "%-15.15s", usage->command);
+    print_cell(input_window, state, row, 47, "%5" PRIu32, usage->counts[RDMA_NETLINK_RESOURCE_QP]);
+    print_cell(input_window, state, row, 55, "%5" PRIu32, usage->counts[RDMA_NETLINK_RESOURCE_CQ]);
+    print_cell(input_window, state, row, 63, "%5" PRIu32, usage->counts[RDMA_NETLINK_RESOURCE_MR]);
+    print_cell(input_window, state, row, 71, "%7" PRIu64, usage->mr_bytes >> 20);
+
+    for (int k = 0; k < RESOURCE_RATE_COUNT; ++k) {
+        if (usage->rate_flag > 0) {
+            print_cell(input_window, state, row, 81 + k * 14, "%11.0f", usage->rates[k]);
+        } else {
+            print_cell(input_window, state, row, 81 + k * 14, "%11s", "");
+        }
+    }
+}
+
+/* collect the RDMA resource rows of the shown ports, in screen order */
+static int select_resource_rows(struct render_state *state, const struct infiniband_metrics *cur_metrics, const struct resources *process_resources) {
+    state->resource_row_count = 0;
+
+    if (process_resources == NULL) {
+        return 0;
+    }
+
+    for (int row = 0; row < state->shown_count; ++row) {
+        int i = state->shown[row];
+        size_t usage_count;
+        const struct resource_usage *usage = resources_port_usage(process_resources, cur_metrics->infiniband[i].name_id, &usage_count);
+
+        if ((size_t)state->resource_row_count + usage_count > state->resource_rows_size) {
+            size_t new_size = ((size_t)state->resource_row_count + usage_count) * 2;
+            struct render_resource_row *new_rows = realloc(state->resource_rows, new_size * sizeof(*new_rows));
+            if (new_rows == NULL) {
+                return -1;
+            }
+
+            state->resource_rows = new_rows;
+            state->resource_rows_size = new_size;
+        }
+
+        for (size_t u = 0; u < usage_count; ++u) {
+            state->resource_rows[state->resource_row_count].usage = &usage[u];
+            state->resource_rows[state->resource_row_count].position = i;
+            ++state->resource_row_count;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * print window w of the RX and TX data rate statistics of the interface at position i of
+ * cur_metrics; the moving average is only printed on the first window's row
+ */
+static void print_stats(WINDOW *input_window, struct render_state *state, int row, const struct stats *rate_stats, const struct infiniband_metrics *cur_metrics, int i, size_t w) {
+    static const enum infiniband_counter counters[] = {IB_COUNTER_PORT_RCV_DATA, IB_COUNTER_PORT_XMIT_DATA};
+
+    print_port_name(input_window, state, row, cur_metrics, i);
+    print_cell(input_window, state, row, 19, "%6s", stats_window_label(rate_stats, w));
+
+    for (size_t k = 0; k < SIZEOF(counters); ++k) {
+        struct stats_summary summary;
+        int column = 27 + (int)k * 60;
+
+        /* a port without rates (e.g.: after a replay seeks back) shows blanks */
+        stats_summary(rate_stats, cur_metrics->infiniband[i].name_id, counters[k], w, &summary);
+        if (summary.count == 0) {
+            for (int field = 0; field < 6; ++field) {
+                print_cell(input_window, state, row, column + field * 10, "%8s", "");
+            }
+            continue;
+        }
+
+        if (w == 0) {
+            print_cell(input_window, state, row, column, "%8ld", (long int)(summary.ewma * WORDS_TO_MBIT));
+        }
+        print_cell(input_window, state, row, column + 10, "%8ld", (long int)(summary.min * WORDS_TO_MBIT));
+        print_cell(input_window, state, row, column + 20, "%8ld", (long int)(summary.mean * WORDS_TO_MBIT));
+        print_cell(input_window, state, row, column + 30, "%8ld", (long int)(summary.max * WORDS_TO_MBIT));
+        print_cell(input_window, state, row, column + 40, "%8ld", (long int)(summary.p50 * WORDS_TO_MBIT));
+        print_cell(input_window, state, row, column + 50, "%8ld", (long int)(summary.p99 * WORDS_TO_MBIT));
+    }
+}
+
+/*
+ * the per-second rate of the sort counter, or the sum of the error counters, of the port at position i
+ * of cur_metrics; -1 without a usable previous sample, so such ports go last. counters whose delta
+ * does not describe the interval add nothing to the error rate
+ */
+static double port_sort_value(const struct render_state *state, enum render_sort sort, const struct infiniband_metrics *cur_metrics, const struct infiniband_metrics *prev_metrics,
+                              int i, int rate_flag) {
+    int j = rate_flag > 0 ? state->prev_positions[cur_metrics->infiniband[i].name_id] : -1;
+
+    if (j < 0) {
+        return -1.0;
+    }
+
+    uint64_t elapsed_ns = cur_metrics->timestamp_ns - prev_metrics->timestamp_ns;
+    double link_gbps = infiniband_rate_gbps(cur_metrics->infiniband[i].rate_id);
+    unsigned int port_flags = port_delta_flags(cur_metrics, prev_metrics, i, j);
+
+    if (port_flags & DELTA_UNUSABLE) {
+        return -1.0;
+    }
+
+    const enum infiniband_counter *counters = &render_sorts[sort].counter;
+    size_t counter_count = 1;
+    if (sort == RENDER_SORT_ERRORS) {
+        counters = error_counters;
+        counter_count = SIZEOF(error_counters);
+    }
+
+    double value = 0.0;
+    for (size_t k = 0; k < counter_count; ++k) {
+        uint64_t delta;
+        unsigned int flags = counter_delta(counters[k], cur_metrics->counters[counters[k]][i], prev_metrics->counters[counters[k]][j], elapsed_ns, link_gbps, &delta);
+
+        if (flags & DELTA_UNUSABLE) {
+            if (sort != RENDER_SORT_ERRORS) {
+                return -1.0;
+            }
+            continue;
+        }
+
+        value += (double)delta;
+    }
+
+    return value / ((double)elapsed_ns / 1e9);
+}
+
+/* whether rank a goes before rank b: higher value first, then lower position */
+static int rank_before(const struct render_rank *a, const struct render_rank *b) {
+    return a->value > b->value || (a->value == b->value && a->index < b->index);
+}
+
+static int compare_ranks(const void *a, const void *b) {
+    return rank_before(a, b) ? -1 : rank_before(b, a) ? 1 : 0;
+}
+
+static void swap_ranks(struct render_rank *ranks, size_t a, size_t b) {
+    struct render_rank rank = ranks[a];
+    ranks[a] = ranks[b];
+    ranks[b] = rank;
+}
+
+/* move the count first ranks in order to the front of ranks, in any order (quickselect) */
+static void select_ranks(struct render_rank *ranks, size_t rank_count, size_t count) {
+    size_t left = 0;
+    size_t right = rank_count;
+
+    while (right - left > 1) {
+        /* the median of the first, middle and last rank is the pivot, moved to the end */
+        size_t middle = left + (right - left) / 2;
+        size_t last = right - 1;
+        if (rank_before(&ranks[middle], &ranks[left])) {
+            swap_ranks(ranks, middle, left);
+        }
+        if (rank_before(&ranks[last], &ranks[left])) {
+            swap_ranks(ranks, last, left);
+        }
+        if (rank_before(&ranks[middle], &ranks[last])) {
+            swap_ranks(ranks, middle, last);
+        }
+
+        size_t store = left;
+        for (size_t k = left; k < last; ++k) {
+            if (rank_before(&ranks[k], &ranks[last])) {
+                swap_ranks(ranks, k, store++);
+            }
+        }
+        swap_ranks(ranks, store, last);
+
+        if (store == count || store + 1 == count) {
+            return;
+        }
+
+        if (store > count) {
+            right = store;
+        } else {
+            left = store + 1;
+        }
+    }
+}
+
+/*
+ * fill state->shown with the positions in cur_metrics of the ports the view shows: those matching
+ * its filter, highest sort value first, at most its top count. the top ports are picked by
+ * quickselect and only they are sorted, so a frame does not sort every port
+ */
+static int select_ports(struct render_state *state, const struct infiniband_metrics *cur_metrics, const struct infiniband_metrics *prev_metrics, int rate_flag) {
+    const struct render_view *view = state->view;
+    size_t interface_count = (size_t)cur_metrics->interface_count;
+    size_t rank_count = 0;
+
+    if (interface_count > state->shown_size) {
+        int *new_shown = realloc(state->shown, interface_count * sizeof(*new_shown));
+        if (new_shown == NULL) {
+            return -1;
+        }
+        state->shown = new_shown;
+
+        struct render_rank *new_ranks = realloc(state->ranks, interface_count * sizeof(*new_ranks));
+        if (new_ranks == NULL) {
+            return -1;
+        }
+        state->ranks = new_ranks;
+        state->shown_size = interface_count;
+    }
+
+    for (int i = 0; i < (int)interface_count; ++i) {
+        if (view != NULL && view->filter_flag > 0 &&
+            regexec(&view->filter, infiniband_interface_name(cur_metrics->infiniband[i].name_id), 0, NULL, 0) != 0 &&
+            regexec(&view->filter, infiniband_link_layer_name(cur_metrics->infiniband[i].link_layer), 0, NULL, 0) != 0) {
+            continue;
+        }
+
+        state->ranks[rank_count].index = i;
+        state->ranks[rank_count].value = view != NULL && view->sort != RENDER_SORT_NONE ? port_sort_value(state, view->sort, cur_metrics, prev_metrics, i, rate_flag) : 0.0;
+        ++rank_count;
+    }
+
+    size_t shown_count = rank_count;
+    if (view != NULL && view->top > 0 && (size_t)view->top < shown_count) {
+        shown_count = (size_t)view->top;
+    }
+
+    if (view != NULL && view->sort != RENDER_SORT_NONE) {
+        if (shown_count < rank_count) {
+            select_ranks(state->ranks, rank_count, shown_count);
+        }
+        qsort(state->ranks, shown_count, sizeof(*state->ranks), compare_ranks);
+    }
+
+    for (size_t k = 0; k < shown_count; ++k) {
+        state->shown[k] = state->ranks[k].index;
+    }
+    state->shown_count = (int)shown_count;
+
+    return 0;
+}
+
+/*
+ * print how the view picks the ports, how many alert and how many samples were dropped, next to the first banner;
+ * nothing if it shows them all as found, none alerts and none was dropped
+ */
+static void print_view(WINDOW *input_window, struct render_state *state, int interface_count, uint64_t dropped_count) {
+    const struct render_view *view = state->view;
+    char summary[256] = "";
+    int length = 0;
+
+    if (view != NULL && view->sort != RENDER_SORT_NONE) {
+        length += snprintf(summary + length, sizeof(summary) - (size_t)length, "sorted by %s, ", render_sorts[view->sort].label);
+    }
+    if (view != NULL && view->top > 0) {
+        length += snprintf(summary + length, sizeof(summary) - (size_t)length, "top %d, ", view->top);
+    }
+    if (view != NULL && view->filter_flag > 0) {
+        length += snprintf(summary + length, sizeof(summary) - (size_t)length, "filter /%s/, ", view->filter_text);
+    }
+    if (length > 0) {
+        length += snprintf(summary + length, sizeof(summary) - (size_t)length, "%d of %d ports", state->shown_count, interface_count);
+    }
+    if (state->alert_rules != NULL && alerts_active_port_count(state->alert_rules) > 0) {
+        length += snprintf(summary + length, sizeof(summary) - (size_t)length, "%s%zu ports alerting", length > 0 ? ", " : "", alerts_active_port_count(state->alert_rules));
+    }
+    if (dropped_count > 0) {
+        snprintf(summary + length, sizeof(summary) - (size_t)length, "%s%" PRIu64 " samples dropped", length > 0 ? ", " : "", dropped_count);
+    }
+
+    print_cell(input_window, state, state->section_rows[RENDER_SECTION_STATUS], 20, "%-100.100s", summary);
+}
+
+/*
+ * place the sections one below the other: banner, blank row, column headers, one row per item, blank
+ * row and the line separating the next section. the port events, history, RDMA resources, extended
+ * counters and statistics get a section only if there are any. the scroll position is kept within the content
+ */
+static void plan_sections(struct render_state *state, int interface_count, int extended_count, int stats_rows, int graph_rows, int event_rows, int resource_rows) {
+    int item_counts[RENDER_SECTION_COUNT] = {
+        [RENDER_SECTION_STATUS] = interface_count,
+        [RENDER_SECTION_EVENTS] = event_rows,
+        [RENDER_SECTION_IO] = interface_count,
+        [RENDER_SECTION_GRAPH] = interface_count * graph_rows,
+        [RENDER_SECTION_RESOURCES] = resource_rows,
+        [RENDER_SECTION_ERROR] = interface_count,
+        [RENDER_SECTION_LINK_ERROR] = interface_count,
+        [RENDER_SECTION_EXTENDED] = interface_count * extended_count,
+        [RENDER_SECTION_STATS] = interface_count * stats_rows,
+    };
+    int row = 0;
+
+    for (int s = 0; s < RENDER_SECTION_COUNT; ++s) {
+        if (sections[s].optional_flag > 0 && item_counts[s] == 0) {
+            state->section_rows[s] = -1;
+            state->section_items[s] = 0;
+            continue;
+        }
+
+        state->section_rows[s] = row;
+        state->section_items[s] = item_counts[s];
+        row += item_counts[s] + 5;
+    }
+
+    state->content_rows = row - 1;
+
+    int last_scroll = state->content_rows - (state->lines - 2);
+    if (state->scroll > last_scroll) {
+        state->scroll = last_scroll;
+    }
+    if (state->scroll < 0) {
+        state->scroll = 0;
+    }
+}
+
+/* store in [*first, *last) the items of section that are on screen */
+static void visible_items(const struct render_state *state, enum render_section section, int *first, int *last) {
+    int item_row = state->section_rows[section] + 3;
+    int item_count = state->section_items[section];
+
+    *first = state->scroll - item_row;
+    *last = state->scroll + state->lines - 2 - item_row;
+
+    *first = *first < 0 ? 0 : *first > item_count ? item_count : *first;
+    *last = *last < *first ? *first : *last > item_count ? item_count : *last;
+
+    if (state->section_rows[section] < 0) {
+        *first = 0;
+        *last = 0;
+    }
+}
+
+void construct_window_layout(WINDOW *input_window, const struct render_state *state) {
+    /* move curser and print layout
      * banner should have A_STANDOUT attribute; metric names should have A_BOLD attribute
     */
-    wattron(input_window, A_STANDOUT);
-    mvwprintw(input_window, 1, 1, interface_status_banner);
-    mvwprintw(input_window, interface_count + 6, 1, interface_io_banner);
-    mvwprintw(input_window, 2 * interface_count + 11, 1, interface_error_banner);
-    mvwprintw(input_window, 3 * interface_count + 16, 1, interface_link_error_banner);
-    wattroff(input_window, A_STANDOUT);
+    for (int s = 0; s < RENDER_SECTION_COUNT; ++s) {
+        int banner_row = state->section_rows[s];
+        int line;
 
-    wattron(input_window, A_BOLD);
-    mvwprintw(input_window, 3, 1, interface_status_layout);
-    mvwprintw(input_window, interface_count + 8, 1, interface_io_layout);
-    mvwprintw(input_window, 2 * interface_count + 13, 1, interface_error_layout);
-    mvwprintw(input_window, 3 * interface_count + 18, 1, interface_link_error_layout);
-    wattroff(input_window, A_BOLD);
+        if (banner_row < 0) {
+            continue;
+        }
+
+        if (s > 0 && (line = screen_row(state, banner_row - 1)) >= 0) {
+            mvwhline(input_window, line, 1, ACS_HLINE, state->columns - 2);
+        }
 
-    mvwhline(input_window, interface_count + 5, 1, ACS_HLINE, COLS - 2);
-    mvwhline(input_window, 2 * interface_count + 10, 1, ACS_HLINE, COLS - 2);
-    mvwhline(input_window, 3 * interface_count + 15, 1, ACS_HLINE, COLS - 2);
+        if ((line = screen_row(state, banner_row)) >= 0) {
+            wattron(input_window, A_STANDOUT);
+            mvwaddnstr(input_window, line, 1, sections[s].banner, state->columns - 2);
+            wattroff(input_window, A_STANDOUT);
+        }
+
+        if ((line = screen_row(state, banner_row + 2)) >= 0) {
+            wattron(input_window, A_BOLD);
+            mvwaddnstr(input_window, line, 1, sections[s].layout, state->columns - 2);
+            wattroff(input_window, A_BOLD);
+        }
+    }
 
-    /* print footer */
-    mvwprintw(input_window, LINES - 1, 10, "press 'Q' to exit");
+    /* print footer and, when the content does not fit, the rows shown */
+    mvwprintw(input_window, state->lines - 1, 10, "press 'Q' to exit");
 
-    /* refresh window */
-    wrefresh(input_window);
+    if (state->content_rows > state->lines - 2) {
+        int last_row = state->scroll + state->lines - 2;
+        mvwprintw(input_window, state->lines - 1, state->columns - 28, " rows %d-%d of %d ", state->scroll + 1,
+                  last_row < state->content_rows ? last_row : state->content_rows, state->content_rows);
+    }
 }
 
 void print_delimiter(WINDOW *input_window, int row_number, int *column_positions, size_t column_size) {
@@ -69,3 +757,428 @@ void print_delimiter(WINDOW *input_window, int row_number, int *column_positions
     }
     wattroff(input_window, A_BOLD);
 }
+
+/*
+ * draw the static part of the screen: border, banners, headers and the column delimiters of the rows
+ * on screen. the cell cache is emptied so every value is printed again, and a new window size repaints
+ * the terminal
+ */
+static int draw_layout(WINDOW *input_window, struct render_state *state, int lines, int columns) {
+    size_t cells_size = (size_t)lines * (size_t)columns;
+    if (cells_size > state->cells_size) {
+        char *new_cells = realloc(state->cells, cells_size);
+        if (new_cells == NULL) {
+            return -1;
+        }
+
+        state->cells = new_cells;
+        state->cells_size = cells_size;
+    }
+    memset(state->cells, 0, state->cells_size);
+
+    if (state->layout_flag == 0 || lines != state->drawn_lines || columns != state->drawn_columns) {
+        clearok(input_window, TRUE);
+    }
+
+    /* the history is drawn with block elements where the locale has them */
+    state->unicode_flag = strcmp(nl_langinfo(CODESET), "UTF-8") == 0;
+
+    werase(input_window);
+    box(input_window, 0, 0);
+    construct_window_layout(input_window, state);
+
+    for (int s = 0; s < RENDER_SECTION_COUNT; ++s) {
+        int first;
+        int last;
+
+        visible_items(state, (enum render_section)s, &first, &last);
+        for (int item = first; item < last; ++item) {
+            print_delimiter(input_window, screen_row(state, state->section_rows[s] + 3 + item), sections[s].positions, sections[s].position_count);
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * move the view for input_key: up / down arrow or k / j by a row, page up / down by a screen,
+ * home / end to the top / bottom, 1-9 to the n-th section and tab to the next one. the position is
+ * kept within the content when the next frame is drawn. return 1 if input_key moves the view
+ */
+int render_scroll_key(struct render_state *state, int input_key) {
+    int page = state->lines > 3 ? state->lines - 2 : 1;
+
+    switch (input_key) {
+        case KEY_UP:
+        case 'k':
+            state->scroll -= 1;
+            break;
+        case KEY_DOWN:
+        case 'j':
+            state->scroll += 1;
+            break;
+        case KEY_PPAGE:
+            state->scroll -= page;
+            break;
+        case KEY_NPAGE:
+            state->scroll += page;
+            break;
+        case KEY_HOME:
+            state->scroll = 0;
+            break;
+        case KEY_END:
+            state->scroll = INT_MAX / 2;
+            break;
+        case '\t': {
+            /* the first section starting below the top row, or back to the first */
+            int next_row = 0;
+            for (int s = 0; s < RENDER_SECTION_COUNT; ++s) {
+                if (state->section_rows[s] > state->scroll) {
+                    next_row = state->section_rows[s];
+                    break;
+                }
+            }
+            state->scroll = next_row;
+            break;
+        }
+        default:
+            if (input_key < '1' || input_key > '0' + RENDER_SECTION_COUNT) {
+                return 0;
+            }
+
+            /* sections are numbered as shown, skipping absent ones */
+            for (int s = 0, n = '1'; s < RENDER_SECTION_COUNT; ++s) {
+                if (state->section_rows[s] >= 0 && n++ == input_key) {
+                    state->scroll = state->section_rows[s];
+                    return 1;
+                }
+            }
+            return 0;
+    }
+
+    return 1;
+}
+
+int render_parse_sort(const char *input, enum render_sort *sort) {
+    for (int k = 0; k < RENDER_SORT_COUNT; ++k) {
+        if (strcmp(input, render_sorts[k].name) == 0) {
+            *sort = (enum render_sort)k;
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+/*
+ * show only ports whose name or link layer matches pattern, an extended case insensitive regular
+ * expression; an empty pattern shows every port. return -1 and keep the filter if pattern is invalid
+ */
+int render_view_set_filter(struct render_view *view, const char *pattern) {
+    regex_t filter;
+
+    if (strlen(pattern) >= sizeof(view->filter_text)) {
+        return -1;
+    }
+
+    if (pattern[0] != '\0' && regcomp(&filter, pattern, REG_EXTENDED | REG_NOSUB | REG_ICASE) != 0) {
+        return -1;
+    }
+
+    if (view->filter_flag > 0) {
+        regfree(&view->filter);
+        view->filter_flag = 0;
+    }
+
+    if (pattern[0] != '\0') {
+        view->filter = filter;
+        view->filter_flag = 1;
+    }
+    strcpy(view->filter_text, pattern);
+
+    return 0;
+}
+
+/*
+ * change the view for input_key: s cycles through the sort orders, h shows or hides the data rate
+ * history and / starts typing a filter on
+ * the bottom line, which enter applies and escape abandons. while a filter is typed every key goes
+ * to it. return 1 if input_key was taken
+ */
+int render_view_key(struct render_state *state, int input_key) {
+    struct render_view *view = state->view;
+
+    if (view == NULL) {
+        return 0;
+    }
+
+    if (state->filter_edit_flag == 0) {
+        switch (input_key) {
+            case 's':
+                view->sort = (enum render_sort)((view->sort + 1) % RENDER_SORT_COUNT);
+                return 1;
+            case 'h':
+                view->graph_flag = !view->graph_flag;
+                return 1;
+            case '/':
+                strcpy(state->filter_input, view->filter_text);
+                state->filter_edit_flag = 1;
+                state->filter_error_flag = 0;
+                return 1;
+            default:
+                return 0;
+        }
+    }
+
+    size_t length = strlen(state->filter_input);
+
+    switch (input_key) {
+        case '\n':
+        case '\r':
+        case KEY_ENTER:
+            if (render_view_set_filter(view, state->filter_input) < 0) {
+                state->filter_error_flag = 1;
+                return 1;
+            }
+
+            /* draw the bottom line again */
+            state->filter_edit_flag = 0;
+            state->layout_flag = 0;
+            return 1;
+        case '\033':
+            state->filter_edit_flag = 0;
+            state->layout_flag = 0;
+            return 1;
+        case KEY_BACKSPACE:
+        case '\b':
+        case 127:
+            if (length > 0) {
+                state->filter_input[length - 1] = '\0';
+            }
+            break;
+        default:
+            if (input_key >= ' ' && input_key <= '~' && length + 1 < sizeof(state->filter_input)) {
+                state->filter_input[length] = (char)input_key;
+                state->filter_input[length + 1] = '\0';
+            }
+            break;
+    }
+
+    state->filter_error_flag = 0;
+
+    return 1;
+}
+
+void render_view_free(struct render_view *view) {
+    if (view->filter_flag > 0) {
+        regfree(&view->filter);
+    }
+
+    memset(view, 0, sizeof(*view));
+}
+
+/*
+ * draw one frame of cur_metrics into input_window; I/O rates are computed against prev_metrics
+ * when it is not NULL and older than cur_metrics, statistics are drawn from rate_stats when it is
+ * not NULL, and the data rate history from rate_history when it is not NULL and the view shows it.
+ * ports with a rule of alert_rules raised are highlighted when it is not NULL, and the most recent
+ * events of port_events are listed when it is not NULL and holds any. the processes holding RDMA
+ * resources on the shown ports are listed from process_resources when it is not NULL. the view of state
+ * picks and orders the ports. only rows on screen are drawn, so a frame costs the same on any
+ * number of ports. the static layout is only drawn when it, the scroll position or the window size
+ * changes, and values only when they differ from the ones on screen. the caller refreshes the window
+ */
+int render_infiniband_metrics(WINDOW *input_window, struct render_state *state, const struct infiniband_metrics *cur_metrics, const struct infiniband_metrics *prev_metrics,
+                              const struct stats *rate_stats, const struct history *rate_history, const struct alerts *alert_rules,
+                              const struct event_log *port_events, const struct resources *process_resources) {
+    int interface_count = cur_metrics->interface_count;
+    int extended_count = (int)(cur_metrics->counter_count - IB_COUNTER_COUNT);
+    int stats_rows = rate_stats != NULL ? (int)stats_window_count(rate_stats) : 0;
+    int graph_rows = rate_history != NULL && state->view != NULL && state->view->graph_flag > 0 ? HISTORY_DIRECTION_COUNT : 0;
+    int event_rows = port_events != NULL ? (int)(event_log_count(port_events) < RENDER_EVENT_ROWS ? event_log_count(port_events) : RENDER_EVENT_ROWS) : 0;
+    int first;
+    int last;
+    int lines;
+    int columns;
+
+    getmaxyx(input_window, lines, columns);
+
+    /* rates need an older previous snapshot, indexed by interface name id */
+    int rate_flag = prev_metrics != NULL && cur_metrics->timestamp_ns > prev_metrics->timestamp_ns;
+    if (rate_flag > 0 && infiniband_metrics_positions(prev_metrics, &state->prev_positions, &state->prev_positions_size) < 0) {
+        return -1;
+    }
+
+    if (select_ports(state, cur_metrics, prev_metrics, rate_flag) < 0 || select_resource_rows(state, cur_metrics, process_resources) < 0) {
+        return -1;
+    }
+
+    state->lines = lines;
+    state->columns = columns;
+    state->alert_rules = alert_rules;
+    plan_sections(state, state->shown_count, extended_count, stats_rows, graph_rows, event_rows, state->resource_row_count);
+
+    if (state->layout_flag == 0 || state->shown_count != state->interface_count || extended_count != state->extended_count || stats_rows != state->stats_rows || graph_rows != state->graph_rows ||
+        event_rows != state->event_rows || state->resource_row_count != state->resource_rows_drawn || lines != state->drawn_lines || columns != state->drawn_columns || state->scroll != state->drawn_scroll) {
+        if (draw_layout(input_window, state, lines, columns) < 0) {
+            return -1;
+        }
+
+        state->layout_flag = 1;
+        state->interface_count = state->shown_count;
+        state->extended_count = extended_count;
+        state->stats_rows = stats_rows;
+        state->graph_rows = graph_rows;
+        state->event_rows = event_rows;
+        state->resource_rows_drawn = state->resource_row_count;
+        state->drawn_lines = lines;
+        state->drawn_columns = columns;
+        state->drawn_scroll = state->scroll;
+    }
+
+    print_view(input_window, state, interface_count, cur_metrics->dropped_count);
+
+    /* typing a filter takes the bottom line */
+    if (state->filter_edit_flag > 0) {
+        char prompt[RENDER_FILTER_MAX + 32];
+        int width = columns - 31 < (int)sizeof(prompt) ? columns - 31 : (int)sizeof(prompt);
+
+        snprintf(prompt, sizeof(prompt), " %s: %s_", state->filter_error_flag > 0 ? "invalid filter" : "filter", state->filter_input);
+        mvwprintw(input_window, lines - 1, 30, "%-*.*s", width, width, prompt);
+    }
+
+    /* print interface status metrics */
+    visible_items(state, RENDER_SECTION_STATUS, &first, &last);
+    for (int row = first; row < last; ++row) {
+        int i = state->shown[row];
+        int status_row = state->section_rows[RENDER_SECTION_STATUS] + 3 + row;
+        print_port_name(input_window, state, status_row, cur_metrics, i);
+        print_cell(input_window, state, status_row, 22, "%5" PRIu32, cur_metrics->infiniband[i].lid);
+        print_cell(input_window, state, status_row, 34, "%10s", infiniband_link_layer_name(cur_metrics->infiniband[i].link_layer));
+        print_cell(input_window, state, status_row, 47, "%15s", infiniband_state_name(cur_metrics->infiniband[i].state));
+        print_cell(input_window, state, status_row, 69, "%12s", infiniband_phys_state_name(cur_metrics->infiniband[i].phys_state));
+        print_cell(input_window, state, status_row, 83, "%22s", infiniband_rate_name(cur_metrics->infiniband[i].rate_id));
+    }
+
+    /* print the most recent port events */
+    visible_items(state, RENDER_SECTION_EVENTS, &first, &last);
+    for (int item = first; item < last; ++item) {
+        print_event(input_window, state, state->section_rows[RENDER_SECTION_EVENTS] + 3 + item, event_log_recent(port_events, (size_t)item));
+    }
+
+    /* print IO metrics; interfaces without a previous sample have blank rates */
+    visible_items(state, RENDER_SECTION_IO, &first, &last);
+    for (int row = first; row < last; ++row) {
+        int i = state->shown[row];
+        int io_row = state->section_rows[RENDER_SECTION_IO] + 3 + row;
+        int j = rate_flag > 0 ? state->prev_positions[cur_metrics->infiniband[i].name_id] : -1;
+
+        print_port_name(input_window, state, io_row, cur_metrics, i);
+
+        if (j < 0) {
+            for (size_t k = 0; k < SIZEOF(interface_io_rates); ++k) {
+                print_cell(input_window, state, io_row, interface_io_rates[k].column, "%10s", "");
+            }
+            continue;
+        }
+
+        double link_gbps = infiniband_rate_gbps(cur_metrics->infiniband[i].rate_id);
+        unsigned int port_flags = port_delta_flags(cur_metrics, prev_metrics, i, j);
+        for (size_t k = 0; k < SIZEOF(interface_io_rates); ++k) {
+            print_rate(input_window, state, io_row, interface_io_rates[k].column, cur_metrics, prev_metrics, interface_io_rates[k].counter, i, j, link_gbps, port_flags,
+                       interface_io_rates[k].scale);
+        }
+    }
+
+    /* print the data rate history, one row per interface and direction */
+    if (graph_rows > 0 && history_length(rate_history) > state->graph_rates_size) {
+        float *new_rates = realloc(state->graph_rates, history_length(rate_history) * sizeof(*new_rates));
+        if (new_rates == NULL) {
+            return -1;
+        }
+
+        state->graph_rates = new_rates;
+        state->graph_rates_size = history_length(rate_history);
+    }
+
+    visible_items(state, RENDER_SECTION_GRAPH, &first, &last);
+    for (int item = first; item < last; ++item) {
+        print_history(input_window, state, state->section_rows[RENDER_SECTION_GRAPH] + 3 + item, rate_history, cur_metrics, state->shown[item / graph_rows],
+                      (enum history_direction)(item % graph_rows));
+    }
+
+    /* print the processes holding RDMA resources on the shown ports */
+    visible_items(state, RENDER_SECTION_RESOURCES, &first, &last);
+    for (int item = first; item < last; ++item) {
+        print_resource_usage(input_window, state, state->section_rows[RENDER_SECTION_RESOURCES] + 3 + item, cur_metrics, &state->resource_rows[item]);
+    }
+
+    /* print error metrics */
+    visible_items(state, RENDER_SECTION_ERROR, &first, &last);
+    for (int row = first; row < last; ++row) {
+        int i = state->shown[row];
+        int error_row = state->section_rows[RENDER_SECTION_ERROR] + 3 + row;
+        print_port_name(input_window, state, error_row, cur_metrics, i);
+        print_cell(input_window, state, error_row, 19, "%7" PRIu64, cur_metrics->counters[IB_COUNTER_SYMBOL_ERROR][i]);
+        print_cell(input_window, state, error_row, 28, "%7" PRIu64, cur_metrics->counters[IB_COUNTER_PORT_RCV_ERRORS][i]);
+        print_cell(input_window, state, error_row, 43, "%8" PRIu64, cur_metrics->counters[IB_COUNTER_PORT_RCV_REMOTE_PHYSICAL_ERRORS][i]);
+        print_cell(input_window, state, error_row, 61, "%8" PRIu64, cur_metrics->counters[IB_COUNTER_PORT_RCV_SWITCH_RELAY_ERRORS][i]);
+        print_cell(input_window, state, error_row, 73, "%8" PRIu64, cur_metrics->counters[IB_COUNTER_PORT_RCV_CONSTRAINT_ERRORS][i]);
+        print_cell(input_window, state, error_row, 85, "%8" PRIu64, cur_metrics->counters[IB_COUNTER_PORT_XMIT_CONSTRAINT_ERRORS][i]);
+        print_cell(input_window, state, error_row, 102, "%8" PRIu64, cur_metrics->counters[IB_COUNTER_EXCESSIVE_BUFFER_OVERRUN_ERRORS][i]);
+        print_cell(input_window, state, error_row, 115, "%8" PRIu64, cur_metrics->counters[IB_COUNTER_PORT_XMIT_DISCARDS][i]);
+        print_cell(input_window, state, error_row, 129, "%8" PRIu64, cur_metrics->counters[IB_COUNTER_VL15_DROPPED][i]);
+    }
+
+    /* print link error metrics */
+    visible_items(state, RENDER_SECTION_LINK_ERROR, &first, &last);
+    for (int row = first; row < last; ++row) {
+        int i = state->shown[row];
+        int link_error_row = state->section_rows[RENDER_SECTION_LINK_ERROR] + 3 + row;
+        print_port_name(input_window, state, link_error_row, cur_metrics, i);
+        print_cell(input_window, state, link_error_row, 29, "%10" PRIu64, cur_metrics->counters[IB_COUNTER_LINK_ERROR_RECOVERY][i]);
+        print_cell(input_window, state, link_error_row, 52, "%10" PRIu64, cur_metrics->counters[IB_COUNTER_LOCAL_LINK_INTEGRITY_ERRORS][i]);
+        print_cell(input_window, state, link_error_row, 67, "%8" PRIu64, cur_metrics->counters[IB_COUNTER_LINK_DOWNED][i]);
+    }
+
+    /* print extended counters, one row per interface and counter */
+    visible_items(state, RENDER_SECTION_EXTENDED, &first, &last);
+    for (int item = first; item < last; ++item) {
+        int extended_row = state->section_rows[RENDER_SECTION_EXTENDED] + 3 + item;
+        int i = state->shown[item / extended_count];
+        int k = item % extended_count;
+        enum infiniband_counter counter = (enum infiniband_counter)(IB_COUNTER_COUNT + k);
+        int j = rate_flag > 0 ? state->prev_positions[cur_metrics->infiniband[i].name_id] : -1;
+
+        print_port_name(input_window, state, extended_row, cur_metrics, i);
+        print_cell(input_window, state, extended_row, 19, "%-32.32s", infiniband_counter_name(counter));
+        print_cell(input_window, state, extended_row, 54, "%20" PRIu64, cur_metrics->counters[counter][i]);
+
+        /* counters added to the catalog since the previous sample have no rate yet */
+        if (j < 0 || (size_t)counter >= prev_metrics->counter_count) {
+            print_cell(input_window, state, extended_row, 77, "%10s", "");
+            continue;
+        }
+
+        print_rate(input_window, state, extended_row, 77, cur_metrics, prev_metrics, counter, i, j, infiniband_rate_gbps(cur_metrics->infiniband[i].rate_id),
+                   port_delta_flags(cur_metrics, prev_metrics, i, j), 1.0);
+    }
+
+    /* print rate statistics, which cover every sample rather than only the drawn ones */
+    visible_items(state, RENDER_SECTION_STATS, &first, &last);
+    for (int item = first; item < last; ++item) {
+        print_stats(input_window, state, state->section_rows[RENDER_SECTION_STATS] + 3 + item, rate_stats, cur_metrics, state->shown[item / stats_rows], (size_t)(item % stats_rows));
+    }
+
+    return 0;
+}
+
+void render_state_free(struct render_state *state) {
+    free(state->prev_positions);
+    free(state->shown);
+    free(state->ranks);
+    free(state->graph_rates);
+    free(state->resource_rows);
+    free(state->cells);
+    memset(state, 0, sizeof(*state));
+}
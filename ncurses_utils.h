@@ -19,8 +19,149 @@
 #define NCURSES_UTILS_H
 
 #include <ncurses.h>
+#include <regex.h>
+#include <stddef.h>
+#include "alert.h"
+#include "event_log.h"
+#include "history.h"
+#include "infiniband.h"
+#include "resources.h"
+#include "stats.h"
 
-extern void construct_window_layout(WINDOW *input_window, int interface_count);
+/* sections of the screen, top to bottom */
+enum render_section {
+    RENDER_SECTION_STATUS,
+    RENDER_SECTION_EVENTS,
+    RENDER_SECTION_IO,
+    RENDER_SECTION_GRAPH,
+    RENDER_SECTION_RESOURCES,
+    RENDER_SECTION_ERROR,
+    RENDER_SECTION_LINK_ERROR,
+    RENDER_SECTION_EXTENDED,
+    RENDER_SECTION_STATS,
+    RENDER_SECTION_COUNT
+};
+
+/* what the ports on screen are ordered by, highest first */
+enum render_sort {
+    RENDER_SORT_NONE,
+    RENDER_SORT_RX_MBIT,
+    RENDER_SORT_TX_MBIT,
+    RENDER_SORT_RX_PACKETS,
+    RENDER_SORT_TX_PACKETS,
+    RENDER_SORT_ERRORS,
+    RENDER_SORT_COUNT
+};
+
+/* counters the statistics section shows */
+#define RENDER_STATS_COUNTERS (STATS_COUNTER_BIT(IB_COUNTER_PORT_RCV_DATA) | STATS_COUNTER_BIT(IB_COUNTER_PORT_XMIT_DATA))
+
+/* most recent port events listed on screen */
+#define RENDER_EVENT_ROWS 10
+
+/* longest filter pattern */
+#define RENDER_FILTER_MAX 64
+
+/* which ports the screen shows and in which order */
+struct render_view {
+    enum render_sort sort;
+
+    /* show at most this many ports, 0 for all */
+    int top;
+
+    /* show only ports whose name or link layer matches filter, if filter_flag is set */
+    regex_t filter;
+    int filter_flag;
+    char filter_text[RENDER_FILTER_MAX];
+
+    /* show the data rate history of the ports */
+    int graph_flag;
+};
+
+/* a row of the RDMA resources section and the position of its port in the current snapshot */
+struct render_resource_row {
+    const struct resource_usage *usage;
+    int position;
+};
+
+/* a port and the value it is sorted by */
+struct render_rank {
+    double value;
+    int index;
+};
+
+/* state kept across frames by render_infiniband_metrics */
+struct render_state {
+    /* view of the ports, owned by the caller */
+    struct render_view *view;
+
+    /* positions of the shown ports in the current snapshot, in screen order, and the ranks they are picked from */
+    int *shown;
+    struct render_rank *ranks;
+    size_t shown_size;
+    int shown_count;
+
+    /* filter being typed on the bottom line, and whether the last one entered was invalid */
+    int filter_edit_flag;
+    int filter_error_flag;
+    char filter_input[RENDER_FILTER_MAX];
+
+    /* rates of the port whose history is drawn, and whether the locale can draw block elements */
+    float *graph_rates;
+    size_t graph_rates_size;
+    int unicode_flag;
+
+    /* position of every interface name id in the previous snapshot, -1 if absent */
+    int *prev_positions;
+    size_t prev_positions_size;
+
+    /* content row of every section's banner, -1 if the section is not shown, and its item rows */
+    int section_rows[RENDER_SECTION_COUNT];
+    int section_items[RENDER_SECTION_COUNT];
+    int content_rows;
+
+    /* content row shown at the top of the window */
+    int scroll;
+
+    /* window size of the current frame */
+    int lines;
+    int columns;
+
+    /* RDMA resource rows of the shown ports, in screen order */
+    struct render_resource_row *resource_rows;
+    size_t resource_rows_size;
+    int resource_row_count;
+
+    /* alert rules of the current frame, NULL if there are none */
+    const struct alerts *alert_rules;
+
+    /* layout, window size and scroll position the static part of the screen was drawn for; a change draws it again */
+    int layout_flag;
+    int interface_count;
+    int extended_count;
+    int stats_rows;
+    int graph_rows;
+    int event_rows;
+    int resource_rows_drawn;
+    int drawn_lines;
+    int drawn_columns;
+    int drawn_scroll;
+
+    /* text last printed into each cell of the window, lines x columns; 0 where none was since the layout was drawn */
+    char *cells;
+    size_t cells_size;
+};
+
+extern void construct_window_layout(WINDOW *input_window, const struct render_state *state);
 extern void print_delimiter(WINDOW *input_window, int row_number, int *column_positions, size_t column_size);
+extern int render_scroll_key(struct render_state *state, int input_key);
+extern int render_parse_sort(const char *input, enum render_sort *sort);
+extern int render_view_set_filter(struct render_view *view, const char *pattern);
+extern int render_view_key(struct render_state *state, int input_key);
+extern void render_view_free(struct render_view *view);
+extern int render_infiniband_metrics(WINDOW *input_window, struct render_state *state, const struct infiniband_metrics *cur_metrics, const struct infiniband_metrics *prev_metrics,
+                                     const struct stats *rate_stats, const struct history *rate_history, const struct alerts *alert_rules,
+                                     const struct event_log *port_events, const struct resources *process_resources);
+extern void render_state_free(struct render_state *state);
 
 #endif /* NCURSES_UTILS_H */
@@ -0,0 +1,734 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2025 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <linux/netlink.h>
+#include <rdma/rdma_netlink.h>
+#include "rdma_netlink.h"
+
+/* unsigned counterparts of NL_ATTR_HEADER_SIZE / NL_ATTR_ALIGN() */
+#define NL_ATTR_HEADER_SIZE (sizeof(struct nlattr))
+#define NL_ATTR_ALIGN(length) (((size_t)(length) + 3U) & ~(size_t)3U)
+
+/* room for one STAT_GET reply; mlx5 ports report well under 4 KB of counters */
+#define RDMA_NETLINK_REPLY_SIZE 8192
+
+/* request: header plus device index and port index attributes */
+#define RDMA_NETLINK_REQUEST_SIZE (NLMSG_LENGTH(2 * NL_ATTR_HEADER_SIZE + 2 * NL_ATTR_ALIGN(sizeof(uint32_t))))
+
+/* the kernel fills dump replies up to the largest receive buffer seen, at most 32 KB */
+#define RDMA_NETLINK_DUMP_SIZE 32768
+
+/* nested table, entry and id attribute of every resource kind, and the command dumping it */
+static const struct {
+    uint8_t command;
+    uint16_t table;
+    uint16_t entry;
+    uint16_t id;
+} resource_tables[RDMA_NETLINK_RESOURCE_KIND_COUNT] = {
+    [RDMA_NETLINK_RESOURCE_QP] = {RDMA_NLDEV_CMD_RES_QP_GET, RDMA_NLDEV_ATTR_RES_QP, RDMA_NLDEV_ATTR_RES_QP_ENTRY, RDMA_NLDEV_ATTR_RES_LQPN},
+    [RDMA_NETLINK_RESOURCE_CQ] = {RDMA_NLDEV_CMD_RES_CQ_GET, RDMA_NLDEV_ATTR_RES_CQ, RDMA_NLDEV_ATTR_RES_CQ_ENTRY, RDMA_NLDEV_ATTR_RES_CQN},
+    [RDMA_NETLINK_RESOURCE_MR] = {RDMA_NLDEV_CMD_RES_MR_GET, RDMA_NLDEV_ATTR_RES_MR, RDMA_NLDEV_ATTR_RES_MR_ENTRY, RDMA_NLDEV_ATTR_RES_MRN},
+    [RDMA_NETLINK_RESOURCE_COUNTER] = {RDMA_NLDEV_CMD_STAT_GET, RDMA_NLDEV_ATTR_STAT_COUNTER, RDMA_NLDEV_ATTR_STAT_COUNTER_ENTRY, RDMA_NLDEV_ATTR_STAT_COUNTER_ID},
+};
+
+/* called for every message of a dump */
+typedef void (*rdma_netlink_message_cb)(void *ctx, const struct nlmsghdr *message);
+
+struct rdma_netlink {
+    int fd;
+    uint32_t seq;
+
+    /* file of recorded replies answering dumps instead of the kernel, NULL for the socket */
+    char *recording_path;
+
+    /* receive buffer of dumps, or the recorded replies read back */
+    char *dump_buffer;
+    size_t dump_buffer_size;
+
+    /* send buffer holding one request per port, receive buffers holding one reply per port */
+    char *request_buffer;
+    char *reply_buffer;
+    struct mmsghdr *reply_headers;
+    struct iovec *reply_iovecs;
+    size_t port_capacity;
+};
+
+static const struct nlattr *nl_attr_first(const void *data, size_t length, size_t *remaining) {
+    *remaining = length;
+
+    if (length < NL_ATTR_HEADER_SIZE) {
+        return NULL;
+    }
+
+    return data;
+}
+
+/* walk attributes of one nesting level, validating lengths */
+static const struct nlattr *nl_attr_next(const struct nlattr *attr, size_t *remaining) {
+    size_t aligned_length = NL_ATTR_ALIGN(attr->nla_len);
+
+    if (aligned_length >= *remaining) {
+        *remaining = 0;
+        return NULL;
+    }
+
+    *remaining -= aligned_length;
+    attr = (const struct nlattr *)((const char *)attr + aligned_length);
+
+    if (*remaining < NL_ATTR_HEADER_SIZE || attr->nla_len < NL_ATTR_HEADER_SIZE || attr->nla_len > *remaining) {
+        return NULL;
+    }
+
+    return attr;
+}
+
+static int nl_attr_valid(const struct nlattr *attr, size_t remaining) {
+    return attr != NULL && attr->nla_len >= NL_ATTR_HEADER_SIZE && attr->nla_len <= remaining;
+}
+
+static const void *nl_attr_data(const struct nlattr *attr) {
+    return (const char *)attr + NL_ATTR_HEADER_SIZE;
+}
+
+static size_t nl_attr_length(const struct nlattr *attr) {
+    return (size_t)attr->nla_len - NL_ATTR_HEADER_SIZE;
+}
+
+static uint16_t nl_attr_type(const struct nlattr *attr) {
+    return (uint16_t)(attr->nla_type & ~(unsigned int)(NLA_F_NESTED | NLA_F_NET_BYTEORDER));
+}
+
+/* u64 attributes are only 4 byte aligned */
+static uint64_t nl_attr_u64(const struct nlattr *attr) {
+    uint64_t value = 0;
+
+    if (nl_attr_length(attr) >= sizeof(value)) {
+        memcpy(&value, nl_attr_data(attr), sizeof(value));
+    }
+
+    return value;
+}
+
+static uint32_t nl_attr_u32(const struct nlattr *attr) {
+    uint32_t value = 0;
+
+    if (nl_attr_length(attr) >= sizeof(value)) {
+        memcpy(&value, nl_attr_data(attr), sizeof(value));
+    }
+
+    return value;
+}
+
+/* copy of a string attribute, or NULL if it is not terminated */
+static const char *nl_attr_string(const struct nlattr *attr) {
+    size_t length = nl_attr_length(attr);
+
+    if (length == 0 || ((const char *)nl_attr_data(attr))[length - 1] != '\0') {
+        return NULL;
+    }
+
+    return nl_attr_data(attr);
+}
+
+static char *nl_put_u32(char *buffer, uint16_t type, uint32_t value) {
+    struct nlattr *attr = (struct nlattr *)buffer;
+
+    attr->nla_type = type;
+    attr->nla_len = (uint16_t)(NL_ATTR_HEADER_SIZE + sizeof(value));
+    memcpy(buffer + NL_ATTR_HEADER_SIZE, &value, sizeof(value));
+
+    return buffer + NL_ATTR_ALIGN(attr->nla_len);
+}
+
+struct rdma_netlink *rdma_netlink_open(void) {
+    struct rdma_netlink *nl;
+    struct sockaddr_nl address;
+    struct timeval timeout = {1, 0};
+    int receive_buffer_size = 1 << 20;
+
+    nl = calloc(1, sizeof(*nl));
+    if (nl == NULL) {
+        return NULL;
+    }
+
+    nl->fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_RDMA);
+    if (nl->fd < 0) {
+        goto handle_error;
+    }
+
+    memset(&address, 0, sizeof(address));
+    address.nl_family = AF_NETLINK;
+
+    if (bind(nl->fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
+        goto handle_error;
+    }
+
+    /* a lost reply must not stall the collector; replies of many ports must fit in the socket */
+    setsockopt(nl->fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(nl->fd, SOL_SOCKET, SO_RCVBUF, &receive_buffer_size, sizeof(receive_buffer_size));
+
+    nl->seq = (uint32_t)getpid() << 16;
+
+    return nl;
+
+handle_error:
+    if (nl->fd >= 0) {
+        close(nl->fd);
+    }
+    free(nl);
+
+    return NULL;
+}
+
+/*
+ * wrap a connected datagram socket answering requests as the kernel does, e.g.: one end of a
+ * socketpair() served by a fake responder; the socket is closed with nl
+ */
+struct rdma_netlink *rdma_netlink_open_socket(int fd) {
+    struct rdma_netlink *nl;
+
+    nl = calloc(1, sizeof(*nl));
+    if (nl == NULL) {
+        return NULL;
+    }
+
+    nl->fd = fd;
+    nl->seq = (uint32_t)getpid() << 16;
+
+    return nl;
+}
+
+/*
+ * answer dumps and STAT_GET requests from a file of reply messages as the kernel sends them, e.g.: written by
+ * ib-sysfs-generator or captured from a live socket; the file is read again on every dump
+ */
+struct rdma_netlink *rdma_netlink_open_recording(const char *path) {
+    struct rdma_netlink *nl;
+
+    if (access(path, R_OK) < 0) {
+        return NULL;
+    }
+
+    nl = calloc(1, sizeof(*nl));
+    if (nl == NULL) {
+        return NULL;
+    }
+
+    nl->fd = -1;
+    nl->recording_path = strdup(path);
+    if (nl->recording_path == NULL) {
+        free(nl);
+        return NULL;
+    }
+
+    return nl;
+}
+
+void rdma_netlink_close(struct rdma_netlink *nl) {
+    if (nl == NULL) {
+        return;
+    }
+
+    if (nl->fd >= 0) {
+        close(nl->fd);
+    }
+    free(nl->recording_path);
+    free(nl->dump_buffer);
+    free(nl->request_buffer);
+    free(nl->reply_buffer);
+    free(nl->reply_headers);
+    free(nl->reply_iovecs);
+    free(nl);
+}
+
+static int rdma_netlink_reserve(struct rdma_netlink *nl, size_t port_count) {
+    if (port_count <= nl->port_capacity) {
+        return 0;
+    }
+
+    free(nl->request_buffer);
+    free(nl->reply_buffer);
+    free(nl->reply_headers);
+    free(nl->reply_iovecs);
+
+    nl->request_buffer = calloc(port_count, RDMA_NETLINK_REQUEST_SIZE);
+    nl->reply_buffer = malloc(port_count * RDMA_NETLINK_REPLY_SIZE);
+    nl->reply_headers = calloc(port_count, sizeof(*nl->reply_headers));
+    nl->reply_iovecs = calloc(port_count, sizeof(*nl->reply_iovecs));
+
+    if (nl->request_buffer == NULL || nl->reply_buffer == NULL || nl->reply_headers == NULL || nl->reply_iovecs == NULL) {
+        nl->port_capacity = 0;
+        return -1;
+    }
+
+    for (size_t i = 0; i < port_count; ++i) {
+        nl->reply_iovecs[i].iov_base = nl->reply_buffer + i * RDMA_NETLINK_REPLY_SIZE;
+        nl->reply_iovecs[i].iov_len = RDMA_NETLINK_REPLY_SIZE;
+        nl->reply_headers[i].msg_hdr.msg_iov = &nl->reply_iovecs[i];
+        nl->reply_headers[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    nl->port_capacity = port_count;
+
+    return 0;
+}
+
+static int rdma_netlink_reserve_dump(struct rdma_netlink *nl, size_t size) {
+    if (size <= nl->dump_buffer_size) {
+        return 0;
+    }
+
+    char *new_buffer = realloc(nl->dump_buffer, size);
+    if (new_buffer == NULL) {
+        return -1;
+    }
+
+    nl->dump_buffer = new_buffer;
+    nl->dump_buffer_size = size;
+
+    return 0;
+}
+
+/* u32 attribute of type at the top level of a message, if it has one */
+static int nl_message_u32(const struct nlmsghdr *message, uint16_t type, uint32_t *value) {
+    size_t remaining;
+
+    for (const struct nlattr *attr = nl_attr_first(NLMSG_DATA(message), message->nlmsg_len - NLMSG_LENGTH(0), &remaining); nl_attr_valid(attr, remaining); attr = nl_attr_next(attr, &remaining)) {
+        if (nl_attr_type(attr) == type) {
+            *value = nl_attr_u32(attr);
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+/* hand the recorded replies of command about device_index, or about any device, to callback */
+static int rdma_netlink_dump_recording(struct rdma_netlink *nl, uint8_t command, uint32_t device_index, int any_device_flag, rdma_netlink_message_cb callback, void *ctx) {
+    FILE *file_handle = fopen(nl->recording_path, "r");
+    size_t length = 0;
+
+    if (file_handle == NULL) {
+        return -1;
+    }
+
+    while (1) {
+        if (length == nl->dump_buffer_size && rdma_netlink_reserve_dump(nl, nl->dump_buffer_size == 0 ? RDMA_NETLINK_DUMP_SIZE : nl->dump_buffer_size * 2) < 0) {
+            fclose(file_handle);
+            return -1;
+        }
+
+        size_t ret_fread = fread(nl->dump_buffer + length, 1, nl->dump_buffer_size - length, file_handle);
+        if (ret_fread == 0) {
+            break;
+        }
+
+        length += ret_fread;
+    }
+
+    fclose(file_handle);
+
+    size_t remaining = length;
+    for (struct nlmsghdr *message = (struct nlmsghdr *)nl->dump_buffer; NLMSG_OK(message, remaining); message = NLMSG_NEXT(message, remaining)) {
+        uint32_t message_device;
+
+        if (message->nlmsg_type != RDMA_NL_GET_TYPE(RDMA_NL_NLDEV, command)) {
+            continue;
+        }
+
+        if (any_device_flag == 0 && (nl_message_u32(message, RDMA_NLDEV_ATTR_DEV_INDEX, &message_device) < 0 || message_device != device_index)) {
+            continue;
+        }
+
+        callback(ctx, message);
+    }
+
+    return 0;
+}
+
+/*
+ * dump command about device_index, or about every device if any_device_flag is set, handing each
+ * reply message to callback. a STAT_GET dump lists the counter sets QPs are bound to
+ */
+static int rdma_netlink_dump(struct rdma_netlink *nl, uint8_t command, uint32_t device_index, int any_device_flag, rdma_netlink_message_cb callback, void *ctx) {
+    char request_buffer[RDMA_NETLINK_REQUEST_SIZE] = {0};
+    struct nlmsghdr *request = (struct nlmsghdr *)request_buffer;
+    char *attr = NLMSG_DATA(request);
+    int ret = 0;
+    int done = 0;
+
+    if (nl->recording_path != NULL) {
+        return rdma_netlink_dump_recording(nl, command, device_index, any_device_flag, callback, ctx);
+    }
+
+    if (rdma_netlink_reserve_dump(nl, RDMA_NETLINK_DUMP_SIZE) < 0) {
+        return -1;
+    }
+
+    if (any_device_flag == 0) {
+        attr = nl_put_u32(attr, RDMA_NLDEV_ATTR_DEV_INDEX, device_index);
+    }
+    if (command == RDMA_NLDEV_CMD_STAT_GET) {
+        attr = nl_put_u32(attr, RDMA_NLDEV_ATTR_STAT_RES, RDMA_NLDEV_ATTR_RES_QP);
+    }
+
+    request->nlmsg_len = (uint32_t)(attr - request_buffer);
+    request->nlmsg_type = (uint16_t)RDMA_NL_GET_TYPE(RDMA_NL_NLDEV, command);
+    request->nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    request->nlmsg_seq = ++nl->seq;
+
+    if (send(nl->fd, request, request->nlmsg_len, 0) < 0) {
+        return -1;
+    }
+
+    while (done == 0) {
+        ssize_t ret_recv = recv(nl->fd, nl->dump_buffer, nl->dump_buffer_size, 0);
+        if (ret_recv <= 0) {
+            return -1;
+        }
+
+        size_t remaining = (size_t)ret_recv;
+        for (struct nlmsghdr *message = (struct nlmsghdr *)nl->dump_buffer; NLMSG_OK(message, remaining); message = NLMSG_NEXT(message, remaining)) {
+            if (message->nlmsg_seq != nl->seq) {
+                continue;
+            }
+
+            /* a dump cut short by an error ends with NLMSG_DONE carrying it */
+            if (message->nlmsg_type == NLMSG_DONE || message->nlmsg_type == NLMSG_ERROR) {
+                int error = 0;
+
+                if (message->nlmsg_len >= NLMSG_LENGTH(sizeof(error))) {
+                    memcpy(&error, NLMSG_DATA(message), sizeof(error));
+                }
+
+                ret = error < 0 ? -1 : 0;
+                done = 1;
+                break;
+            }
+
+            callback(ctx, message);
+        }
+    }
+
+    return ret;
+}
+
+struct device_lookup {
+    const char *device_name;
+    uint32_t device_index;
+    int found;
+};
+
+static void match_device_name(void *ctx, const struct nlmsghdr *message) {
+    struct device_lookup *lookup = ctx;
+    uint32_t index = 0;
+    int index_found = 0;
+    int name_matched = 0;
+    size_t remaining;
+
+    for (const struct nlattr *attr = nl_attr_first(NLMSG_DATA(message), message->nlmsg_len - NLMSG_LENGTH(0), &remaining); nl_attr_valid(attr, remaining); attr = nl_attr_next(attr, &remaining)) {
+        if (nl_attr_type(attr) == RDMA_NLDEV_ATTR_DEV_INDEX) {
+            index = nl_attr_u32(attr);
+            index_found = 1;
+        } else if (nl_attr_type(attr) == RDMA_NLDEV_ATTR_DEV_NAME && strncmp(nl_attr_data(attr), lookup->device_name, nl_attr_length(attr)) == 0) {
+            name_matched = 1;
+        }
+    }
+
+    if (index_found > 0 && name_matched > 0) {
+        lookup->device_index = index;
+        lookup->found = 1;
+    }
+}
+
+/* map a device name to its RDMA_NLDEV_ATTR_DEV_INDEX through a RDMA_NLDEV_CMD_GET dump */
+int rdma_netlink_device_index(struct rdma_netlink *nl, const char *device_name, uint32_t *device_index) {
+    struct device_lookup lookup = {device_name, 0, 0};
+
+    if (rdma_netlink_dump(nl, RDMA_NLDEV_CMD_GET, 0, 1, match_device_name, &lookup) < 0 || lookup.found == 0) {
+        return -1;
+    }
+
+    *device_index = lookup.device_index;
+
+    return 0;
+}
+
+/* hand every RDMA_NLDEV_ATTR_STAT_HWCOUNTER_ENTRY of a RDMA_NLDEV_ATTR_STAT_HWCOUNTERS table to callback */
+static void parse_hwcounters(const struct nlattr *attr, size_t port, rdma_netlink_counter_cb callback, void *ctx) {
+    size_t position = 0;
+    size_t entry_remaining;
+
+    for (const struct nlattr *entry = nl_attr_first(nl_attr_data(attr), nl_attr_length(attr), &entry_remaining); nl_attr_valid(entry, entry_remaining); entry = nl_attr_next(entry, &entry_remaining)) {
+        const char *name = NULL;
+        uint64_t value = 0;
+        size_t field_remaining;
+
+        if (nl_attr_type(entry) != RDMA_NLDEV_ATTR_STAT_HWCOUNTER_ENTRY) {
+            continue;
+        }
+
+        for (const struct nlattr *field = nl_attr_first(nl_attr_data(entry), nl_attr_length(entry), &field_remaining); nl_attr_valid(field, field_remaining); field = nl_attr_next(field, &field_remaining)) {
+            if (nl_attr_type(field) == RDMA_NLDEV_ATTR_STAT_HWCOUNTER_ENTRY_NAME) {
+                name = nl_attr_string(field);
+            } else if (nl_attr_type(field) == RDMA_NLDEV_ATTR_STAT_HWCOUNTER_ENTRY_VALUE) {
+                value = nl_attr_u64(field);
+            }
+        }
+
+        if (name != NULL) {
+            callback(ctx, port, position, name, value);
+        }
+
+        ++position;
+    }
+}
+
+/* hand every RDMA_NLDEV_ATTR_STAT_HWCOUNTER_ENTRY of one STAT_GET reply to callback */
+int rdma_netlink_parse_stat(const void *message, size_t length, size_t port, rdma_netlink_counter_cb callback, void *ctx) {
+    const struct nlmsghdr *header = message;
+    size_t remaining;
+
+    if (length < NLMSG_LENGTH(0) || header->nlmsg_len > length) {
+        return -1;
+    }
+
+    if (header->nlmsg_type == NLMSG_ERROR) {
+        return -1;
+    }
+
+    for (const struct nlattr *attr = nl_attr_first(NLMSG_DATA(header), header->nlmsg_len - NLMSG_LENGTH(0), &remaining); nl_attr_valid(attr, remaining); attr = nl_attr_next(attr, &remaining)) {
+        if (nl_attr_type(attr) == RDMA_NLDEV_ATTR_STAT_HWCOUNTERS) {
+            parse_hwcounters(attr, port, callback, ctx);
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * hand every entry of one resource dump reply to callback: QPs, CQs and MRs of RES_*_GET, or the
+ * counter sets of STAT_GET. entries without an id are skipped
+ */
+int rdma_netlink_parse_resources(const void *message, size_t length, rdma_netlink_resource_cb callback, void *ctx) {
+    const struct nlmsghdr *header = message;
+    const struct nlattr *table = NULL;
+    struct rdma_netlink_resource resource;
+    size_t remaining;
+    int kind;
+
+    if (length < NLMSG_LENGTH(0) || header->nlmsg_len > length || RDMA_NL_GET_CLIENT(header->nlmsg_type) != RDMA_NL_NLDEV) {
+        return -1;
+    }
+
+    for (kind = 0; kind < RDMA_NETLINK_RESOURCE_KIND_COUNT; ++kind) {
+        if (RDMA_NL_GET_OP(header->nlmsg_type) == resource_tables[kind].command) {
+            break;
+        }
+    }
+
+    if (kind == RDMA_NETLINK_RESOURCE_KIND_COUNT) {
+        return -1;
+    }
+
+    memset(&resource, 0, sizeof(resource));
+    resource.kind = (enum rdma_netlink_resource_kind)kind;
+
+    for (const struct nlattr *attr = nl_attr_first(NLMSG_DATA(header), header->nlmsg_len - NLMSG_LENGTH(0), &remaining); nl_attr_valid(attr, remaining); attr = nl_attr_next(attr, &remaining)) {
+        if (nl_attr_type(attr) == RDMA_NLDEV_ATTR_DEV_INDEX) {
+            resource.device_index = nl_attr_u32(attr);
+        } else if (nl_attr_type(attr) == resource_tables[kind].table) {
+            table = attr;
+        }
+    }
+
+    if (table == NULL) {
+        return 0;
+    }
+
+    size_t entry_remaining;
+    for (const struct nlattr *entry = nl_attr_first(nl_attr_data(table), nl_attr_length(table), &entry_remaining); nl_attr_valid(entry, entry_remaining); entry = nl_attr_next(entry, &entry_remaining)) {
+        int id_found = 0;
+        size_t field_remaining;
+
+        if (nl_attr_type(entry) != resource_tables[kind].entry) {
+            continue;
+        }
+
+        resource.port_index = 0;
+        resource.id = 0;
+        resource.pid = 0;
+        resource.kernel_name = NULL;
+        resource.length = 0;
+        resource.counters = NULL;
+
+        for (const struct nlattr *field = nl_attr_first(nl_attr_data(entry), nl_attr_length(entry), &field_remaining); nl_attr_valid(field, field_remaining); field = nl_attr_next(field, &field_remaining)) {
+            uint16_t type = nl_attr_type(field);
+
+            if (type == resource_tables[kind].id) {
+                resource.id = nl_attr_u32(field);
+                id_found = 1;
+            } else if (type == RDMA_NLDEV_ATTR_PORT_INDEX) {
+                resource.port_index = nl_attr_u32(field);
+            } else if (type == RDMA_NLDEV_ATTR_RES_PID) {
+                resource.pid = nl_attr_u32(field);
+            } else if (type == RDMA_NLDEV_ATTR_RES_KERN_NAME) {
+                resource.kernel_name = nl_attr_string(field);
+            } else if (type == RDMA_NLDEV_ATTR_RES_MRLEN) {
+                resource.length = nl_attr_u64(field);
+            } else if (type == RDMA_NLDEV_ATTR_STAT_HWCOUNTERS) {
+                resource.counters = field;
+            }
+        }
+
+        if (id_found > 0) {
+            callback(ctx, &resource);
+        }
+    }
+
+    return 0;
+}
+
+/* hand the hardware counters of a counter set to callback, with its port */
+void rdma_netlink_resource_counters(const struct rdma_netlink_resource *resource, rdma_netlink_counter_cb callback, void *ctx) {
+    if (resource->counters != NULL) {
+        parse_hwcounters(resource->counters, resource->port_index, callback, ctx);
+    }
+}
+
+struct resource_dump {
+    rdma_netlink_resource_cb callback;
+    void *ctx;
+};
+
+static void parse_resource_message(void *ctx, const struct nlmsghdr *message) {
+    struct resource_dump *dump = ctx;
+
+    rdma_netlink_parse_resources(message, message->nlmsg_len, dump->callback, dump->ctx);
+}
+
+/* dump the resources of kind on one device, handing every entry to callback */
+int rdma_netlink_dump_resources(struct rdma_netlink *nl, enum rdma_netlink_resource_kind kind, uint32_t device_index, rdma_netlink_resource_cb callback, void *ctx) {
+    struct resource_dump dump = {callback, ctx};
+
+    return rdma_netlink_dump(nl, resource_tables[kind].command, device_index, 0, parse_resource_message, &dump);
+}
+
+struct recorded_stat {
+    const struct rdma_netlink_port *ports;
+    size_t port_count;
+    rdma_netlink_counter_cb callback;
+    void *ctx;
+};
+
+/* a port's STAT_GET reply carries the port index next to the device index; counter set dumps only carry it in their entries */
+static void answer_recorded_stat(void *ctx, const struct nlmsghdr *message) {
+    struct recorded_stat *stat = ctx;
+    uint32_t device_index;
+    uint32_t port_index;
+
+    if (nl_message_u32(message, RDMA_NLDEV_ATTR_DEV_INDEX, &device_index) < 0 || nl_message_u32(message, RDMA_NLDEV_ATTR_PORT_INDEX, &port_index) < 0) {
+        return;
+    }
+
+    for (size_t i = 0; i < stat->port_count; ++i) {
+        if (stat->ports[i].device_index == device_index && stat->ports[i].port_index == port_index) {
+            rdma_netlink_parse_stat(message, message->nlmsg_len, i, stat->callback, stat->ctx);
+        }
+    }
+}
+
+/*
+ * fetch the hardware counters of every port with one sendmsg() carrying all
+ * STAT_GET requests and as few recvmmsg() calls as the replies allow
+ */
+int rdma_netlink_stat_get(struct rdma_netlink *nl, const struct rdma_netlink_port *ports, size_t port_count, rdma_netlink_counter_cb callback, void *ctx) {
+    uint32_t first_seq;
+    size_t received = 0;
+
+    if (port_count == 0) {
+        return 0;
+    }
+
+    /* a recording answers the ports it holds a reply of */
+    if (nl->recording_path != NULL) {
+        struct recorded_stat stat = {ports, port_count, callback, ctx};
+
+        return rdma_netlink_dump_recording(nl, RDMA_NLDEV_CMD_STAT_GET, 0, 1, answer_recorded_stat, &stat);
+    }
+
+    if (rdma_netlink_reserve(nl, port_count) < 0) {
+        return -1;
+    }
+
+    first_seq = nl->seq + 1;
+
+    for (size_t i = 0; i < port_count; ++i) {
+        char *buffer = nl->request_buffer + i * RDMA_NETLINK_REQUEST_SIZE;
+        struct nlmsghdr *request = (struct nlmsghdr *)buffer;
+        char *attr = NLMSG_DATA(request);
+
+        attr = nl_put_u32(attr, RDMA_NLDEV_ATTR_DEV_INDEX, ports[i].device_index);
+        attr = nl_put_u32(attr, RDMA_NLDEV_ATTR_PORT_INDEX, ports[i].port_index);
+
+        request->nlmsg_len = (uint32_t)(attr - buffer);
+        request->nlmsg_type = (uint16_t)RDMA_NL_GET_TYPE(RDMA_NL_NLDEV, RDMA_NLDEV_CMD_STAT_GET);
+        request->nlmsg_flags = NLM_F_REQUEST;
+        request->nlmsg_seq = first_seq + (uint32_t)i;
+        request->nlmsg_pid = 0;
+    }
+
+    nl->seq += (uint32_t)port_count;
+
+    if (send(nl->fd, nl->request_buffer, port_count * RDMA_NETLINK_REQUEST_SIZE, 0) < 0) {
+        return -1;
+    }
+
+    /* every request is answered by exactly one reply or one NLMSG_ERROR */
+    while (received < port_count) {
+        int ret_recvmmsg = recvmmsg(nl->fd, nl->reply_headers, (unsigned int)(port_count - received), MSG_WAITFORONE, NULL);
+        if (ret_recvmmsg <= 0) {
+            return -1;
+        }
+
+        for (int i = 0; i < ret_recvmmsg; ++i) {
+            size_t remaining = nl->reply_headers[i].msg_len;
+            for (struct nlmsghdr *message = nl->reply_iovecs[i].iov_base; NLMSG_OK(message, remaining); message = NLMSG_NEXT(message, remaining)) {
+                uint32_t port = message->nlmsg_seq - first_seq;
+
+                /* stale reply of a timed out earlier request */
+                if (port >= port_count) {
+                    continue;
+                }
+
+                rdma_netlink_parse_stat(message, message->nlmsg_len, port, callback, ctx);
+                ++received;
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,82 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2025 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef RDMA_NETLINK_H
+#define RDMA_NETLINK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct rdma_netlink;
+
+/* one RDMA_NLDEV_CMD_STAT_GET request */
+struct rdma_netlink_port {
+    uint32_t device_index;
+    uint32_t port_index;
+};
+
+/* called for every hardware counter entry of a reply; position is the entry order within the port */
+typedef void (*rdma_netlink_counter_cb)(void *ctx, size_t port, size_t position, const char *name, uint64_t value);
+
+/* replies a synthetic sysfs root carries in place of the kernel, see rdma_netlink_open_recording() */
+#define RDMA_NETLINK_RECORDING_FILE "rdma_res.nl"
+
+/* tables of the kernel resource tracker (rdma res), and the counter sets QPs are bound to (rdma statistic qp) */
+enum rdma_netlink_resource_kind {
+    RDMA_NETLINK_RESOURCE_QP,
+    RDMA_NETLINK_RESOURCE_CQ,
+    RDMA_NETLINK_RESOURCE_MR,
+    RDMA_NETLINK_RESOURCE_COUNTER,
+    RDMA_NETLINK_RESOURCE_KIND_COUNT
+};
+
+/* one entry of a resource dump; fields its kind does not carry are 0 / NULL */
+struct rdma_netlink_resource {
+    enum rdma_netlink_resource_kind kind;
+    uint32_t device_index;
+
+    /* port of a QP or counter set, 0 if it is not bound to one */
+    uint32_t port_index;
+
+    /* LQPN, CQN, MRN or counter id */
+    uint32_t id;
+
+    /* owning process, or 0 and the owning module for kernel resources */
+    uint32_t pid;
+    const char *kernel_name;
+
+    /* registered length of an MR */
+    uint64_t length;
+
+    /* hardware counters of a counter set, read with rdma_netlink_resource_counters() */
+    const void *counters;
+};
+
+typedef void (*rdma_netlink_resource_cb)(void *ctx, const struct rdma_netlink_resource *resource);
+
+extern struct rdma_netlink *rdma_netlink_open(void);
+extern struct rdma_netlink *rdma_netlink_open_socket(int fd);
+extern struct rdma_netlink *rdma_netlink_open_recording(const char *path);
+extern void rdma_netlink_close(struct rdma_netlink *nl);
+extern int rdma_netlink_device_index(struct rdma_netlink *nl, const char *device_name, uint32_t *device_index);
+extern int rdma_netlink_stat_get(struct rdma_netlink *nl, const struct rdma_netlink_port *ports, size_t port_count, rdma_netlink_counter_cb callback, void *ctx);
+extern int rdma_netlink_parse_stat(const void *message, size_t length, size_t port, rdma_netlink_counter_cb callback, void *ctx);
+extern int rdma_netlink_dump_resources(struct rdma_netlink *nl, enum rdma_netlink_resource_kind kind, uint32_t device_index, rdma_netlink_resource_cb callback, void *ctx);
+extern int rdma_netlink_parse_resources(const void *message, size_t length, rdma_netlink_resource_cb callback, void *ctx);
+extern void rdma_netlink_resource_counters(const struct rdma_netlink_resource *resource, rdma_netlink_counter_cb callback, void *ctx);
+
+#endif /* RDMA_NETLINK_H */
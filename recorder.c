@@ -0,0 +1,951 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2025 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "codec.h"
+#include "infiniband.h"
+#include "recorder.h"
+#include "utils.h"
+#include "wire.h"
+
+#define RECORDER_ALIGN(size, alignment) (((size) + (alignment) - 1) / (alignment) * (alignment))
+
+/* block_number of a view that holds no block */
+#define NO_BLOCK UINT64_MAX
+
+struct recorder {
+    char path[PATH_MAX];
+    uint64_t file_size;
+
+    /* the file is created on the first sample, once the port set is known */
+    int fd;
+    unsigned char *map;
+    size_t map_size;
+    struct recorder_header *header;
+    struct recorder_port *ports;
+    unsigned char *blocks;
+    int failed_flag;
+
+    /* header port slot of every interface name id, -1 if the port is not recorded */
+    int *port_slots;
+    size_t port_slots_size;
+
+    /* realtime minus monotonic clock, sampled once so recorded intervals stay exact */
+    uint64_t realtime_offset_ns;
+
+    /* block records are appended to, NULL until the first one after opening or sealing */
+    struct recorder_block *block;
+    struct sample_codec codec;
+    struct string_buffer sample;
+    struct string_buffer compressed;
+    enum codec_compression compression;
+};
+
+/* a private copy of one block, decompressed, and how far it has been decoded */
+struct block_view {
+    uint64_t block_number;
+    uint64_t first_record;
+    uint64_t record_count;
+    enum codec_compression compression;
+    unsigned char *data;
+    size_t length;
+
+    /* next record to decode and where it starts */
+    uint64_t next_record;
+    size_t position;
+};
+
+/* read-only view of a record file, possibly still being written by a recorder */
+struct recording {
+    int fd;
+    unsigned char *map;
+    size_t map_size;
+    const struct recorder_header *header;
+    const unsigned char *blocks;
+    size_t data_capacity;
+
+    /* interned name and rate ids of every recorded port */
+    uint16_t *name_ids;
+    uint16_t *rate_ids;
+    uint32_t *lids;
+    uint8_t *link_layers;
+
+    /* catalog id of every recorded counter, -1 if it could not be added */
+    int *counter_ids;
+
+    /* records are read through one view and timestamps walked through another, so that seeking does not lose the read position */
+    struct block_view read_view;
+    struct sample_codec codec;
+    struct block_view time_view;
+    uint64_t time_realtime_ns;
+    uint64_t time_realtime_delta_ns;
+
+    /* CLOCK_REALTIME of the first record readable when records were first read; monotonic time in replay counts from it */
+    uint64_t origin_ns;
+    int origin_flag;
+
+    /* compressed data of a block being copied */
+    unsigned char *scratch;
+};
+
+struct recorder *recorder_open(const char *path, uint64_t file_size) {
+    struct recorder *new_recorder;
+
+    if (strlen(path) >= PATH_MAX) {
+        fprintf(stderr, "ERROR: record file path is too long\n");
+        return NULL;
+    }
+
+    new_recorder = calloc(1, sizeof(*new_recorder));
+    if (new_recorder == NULL) {
+        fprintf(stderr, "ERROR: failed to allocate recorder\n");
+        return NULL;
+    }
+
+    strcpy(new_recorder->path, path);
+    new_recorder->file_size = file_size;
+    new_recorder->fd = -1;
+    new_recorder->realtime_offset_ns = get_realtime_ns() - get_monotonic_ns();
+    new_recorder->compression = codec_default_compression();
+
+    return new_recorder;
+}
+
+static size_t header_size_for(size_t port_count, size_t counter_count) {
+    size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    size_t size = sizeof(struct recorder_header) + port_count * sizeof(struct recorder_port) + counter_count * RECORDER_NAME_MAX;
+
+    return RECORDER_ALIGN(size, page_size);
+}
+
+/* room for at least one keyframe of every port and counter */
+static size_t block_size_for(size_t port_count, size_t counter_count) {
+    size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    size_t size = sizeof(struct recorder_block) + WIRE_VARINT_MAX + codec_max_sample_size(port_count, counter_count);
+
+    return size > RECORDER_BLOCK_SIZE ? RECORDER_ALIGN(size, page_size) : RECORDER_BLOCK_SIZE;
+}
+
+/* an existing file is continued only if it was recorded with the same layout, ports and counters */
+static int header_matches(const struct recorder_header *header, const struct infiniband_metrics *input_infiniband_metrics, size_t header_size, size_t block_size, uint64_t block_capacity) {
+    if (memcmp(header->magic, RECORDER_MAGIC, sizeof(RECORDER_MAGIC)) != 0 || header->version != RECORDER_VERSION ||
+        header->header_size != header_size || header->port_count != (uint32_t)input_infiniband_metrics->interface_count ||
+        header->counter_count != input_infiniband_metrics->counter_count || header->block_size != block_size || header->block_capacity != block_capacity) {
+        return 0;
+    }
+
+    const struct recorder_port *ports = (const struct recorder_port *)(header + 1);
+    for (int i = 0; i < input_infiniband_metrics->interface_count; ++i) {
+        if (strncmp(ports[i].name, infiniband_interface_name(input_infiniband_metrics->infiniband[i].name_id), RECORDER_NAME_MAX) != 0) {
+            return 0;
+        }
+    }
+
+    const char (*counter_names)[RECORDER_NAME_MAX] = (const char (*)[RECORDER_NAME_MAX])(ports + header->port_count);
+    for (size_t k = 0; k < input_infiniband_metrics->counter_count; ++k) {
+        if (strncmp(counter_names[k], infiniband_counter_name((enum infiniband_counter)k), RECORDER_NAME_MAX) != 0) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/* create or continue the record file for the ports and counters of the first sample */
+static int recorder_create(struct recorder *input_recorder, const struct infiniband_metrics *input_infiniband_metrics) {
+    size_t port_count = (size_t)input_infiniband_metrics->interface_count;
+    size_t counter_count = input_infiniband_metrics->counter_count;
+    size_t header_size = header_size_for(port_count, counter_count);
+    size_t block_size = block_size_for(port_count, counter_count);
+
+    /* the block being written and the oldest one, which it overwrites next, are not readable */
+    if (input_recorder->file_size < header_size + 3 * block_size) {
+        fprintf(stderr, "ERROR: record file size must be at least %zu bytes for %zu ports\n", header_size + 3 * block_size, port_count);
+        return -1;
+    }
+
+    uint64_t block_capacity = (input_recorder->file_size - header_size) / block_size;
+    size_t map_size = header_size + (size_t)block_capacity * block_size;
+
+    if (codec_init(&input_recorder->codec, port_count, counter_count) < 0) {
+        fprintf(stderr, "ERROR: failed to allocate recorder codec\n");
+        return -1;
+    }
+
+    input_recorder->fd = open(input_recorder->path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (input_recorder->fd < 0) {
+        fprintf(stderr, "ERROR: unable to open %s: %s\n", input_recorder->path, strerror(errno));
+        return -1;
+    }
+
+    /* keep the history of a compatible file; start over otherwise */
+    int resume_flag = 0;
+    struct stat file_stat;
+    if (fstat(input_recorder->fd, &file_stat) == 0 && (size_t)file_stat.st_size == map_size) {
+        struct recorder_header *existing_header = mmap(NULL, header_size, PROT_READ, MAP_SHARED, input_recorder->fd, 0);
+        if (existing_header != MAP_FAILED) {
+            resume_flag = header_matches(existing_header, input_infiniband_metrics, header_size, block_size, block_capacity);
+            munmap(existing_header, header_size);
+        }
+    }
+
+    if (resume_flag == 0) {
+        if (ftruncate(input_recorder->fd, 0) < 0) {
+            fprintf(stderr, "ERROR: unable to truncate %s: %s\n", input_recorder->path, strerror(errno));
+            return -1;
+        }
+
+        /* reserve every block now so writes through the mapping never hit ENOSPC */
+        int ret_fallocate = posix_fallocate(input_recorder->fd, 0, (off_t)map_size);
+        if (ret_fallocate != 0) {
+            fprintf(stderr, "ERROR: unable to allocate %zu bytes for %s: %s\n", map_size, input_recorder->path, strerror(ret_fallocate));
+            return -1;
+        }
+    }
+
+    void *map = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, input_recorder->fd, 0);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "ERROR: unable to map %s: %s\n", input_recorder->path, strerror(errno));
+        return -1;
+    }
+
+    input_recorder->map = map;
+    input_recorder->map_size = map_size;
+    input_recorder->header = map;
+    input_recorder->ports = (struct recorder_port *)(input_recorder->header + 1);
+    input_recorder->blocks = input_recorder->map + header_size;
+
+    if (resume_flag == 0) {
+        struct recorder_header *header = input_recorder->header;
+        char (*counter_names)[RECORDER_NAME_MAX] = (char (*)[RECORDER_NAME_MAX])(input_recorder->ports + port_count);
+
+        for (size_t i = 0; i < port_count; ++i) {
+            const struct interface *port = &input_infiniband_metrics->infiniband[i];
+
+            snprintf(input_recorder->ports[i].name, RECORDER_NAME_MAX, "%s", infiniband_interface_name(port->name_id));
+            snprintf(input_recorder->ports[i].rate, RECORDER_NAME_MAX, "%s", infiniband_rate_name(port->rate_id));
+            input_recorder->ports[i].lid = port->lid;
+            input_recorder->ports[i].link_layer = port->link_layer;
+        }
+
+        for (size_t i = 0; i < counter_count; ++i) {
+            snprintf(counter_names[i], RECORDER_NAME_MAX, "%s", infiniband_counter_name((enum infiniband_counter)i));
+        }
+
+        header->version = RECORDER_VERSION;
+        header->header_size = (uint32_t)header_size;
+        header->port_count = (uint32_t)port_count;
+        header->counter_count = (uint32_t)counter_count;
+        header->block_size = block_size;
+        header->block_capacity = block_capacity;
+        atomic_store_explicit(&header->block_count, 0, memory_order_relaxed);
+        atomic_store_explicit(&header->record_count, 0, memory_order_relaxed);
+
+        /* the magic goes in last so a half-written header is never taken as valid */
+        memcpy(header->magic, RECORDER_MAGIC, sizeof(RECORDER_MAGIC));
+    }
+
+    /* map name ids to header slots */
+    input_recorder->port_slots_size = infiniband_interface_id_count();
+    input_recorder->port_slots = malloc(input_recorder->port_slots_size * sizeof(*input_recorder->port_slots));
+    if (input_recorder->port_slots == NULL) {
+        fprintf(stderr, "ERROR: failed to allocate recorder port index\n");
+        return -1;
+    }
+
+    for (size_t i = 0; i < input_recorder->port_slots_size; ++i) {
+        input_recorder->port_slots[i] = -1;
+    }
+
+    for (size_t i = 0; i < port_count; ++i) {
+        input_recorder->port_slots[input_infiniband_metrics->infiniband[i].name_id] = (int)i;
+    }
+
+    return 0;
+}
+
+static struct recorder_block *recorder_block_at(const struct recorder *input_recorder, uint64_t block_number) {
+    return (struct recorder_block *)(input_recorder->blocks + (block_number % input_recorder->header->block_capacity) * input_recorder->header->block_size);
+}
+
+/* append the coded sample to the open block if it fits; return -1 if it does not */
+static int append_record(struct recorder *input_recorder) {
+    struct recorder_block *block = input_recorder->block;
+    unsigned char *data = (unsigned char *)(block + 1);
+    size_t data_capacity = input_recorder->header->block_size - sizeof(*block);
+    size_t length = atomic_load_explicit(&block->length, memory_order_relaxed);
+    unsigned char length_bytes[WIRE_VARINT_MAX];
+    size_t length_size = wire_encode_varint(length_bytes, input_recorder->sample.length);
+
+    if (data_capacity - length < length_size + input_recorder->sample.length) {
+        return -1;
+    }
+
+    memcpy(data + length, length_bytes, length_size);
+    memcpy(data + length + length_size, input_recorder->sample.data, input_recorder->sample.length);
+
+    atomic_store_explicit(&block->length, (uint32_t)(length + length_size + input_recorder->sample.length), memory_order_relaxed);
+    atomic_store_explicit(&block->record_count, atomic_load_explicit(&block->record_count, memory_order_relaxed) + 1, memory_order_release);
+
+    return 0;
+}
+
+/* close the open block, compressing it in place if that makes it smaller */
+static void seal_block(struct recorder *input_recorder) {
+    struct recorder_block *block = input_recorder->block;
+    unsigned char *data = (unsigned char *)(block + 1);
+    size_t length = atomic_load_explicit(&block->length, memory_order_relaxed);
+    uint64_t sequence = atomic_load_explicit(&block->sequence, memory_order_relaxed);
+
+    input_recorder->block = NULL;
+    input_recorder->compressed.length = 0;
+
+    if (input_recorder->compression == CODEC_COMPRESSION_NONE ||
+        codec_compress(input_recorder->compression, (const char *)data, length, &input_recorder->compressed) < 0 || input_recorder->compressed.length >= length) {
+        return;
+    }
+
+    /* readers drop a copy taken while the sequence is 0 or changed */
+    atomic_store_explicit(&block->sequence, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    memcpy(data, input_recorder->compressed.data, input_recorder->compressed.length);
+    block->raw_length = (uint32_t)length;
+    block->compression = (uint8_t)input_recorder->compression;
+    atomic_store_explicit(&block->length, (uint32_t)input_recorder->compressed.length, memory_order_relaxed);
+
+    atomic_store_explicit(&block->sequence, sequence, memory_order_release);
+}
+
+/* start the next block with the sample as a keyframe, overwriting the oldest block once the file is full */
+static void start_block(struct recorder *input_recorder, uint64_t record_number) {
+    struct recorder_header *header = input_recorder->header;
+    uint64_t block_number = atomic_load_explicit(&header->block_count, memory_order_relaxed);
+    struct recorder_block *block = recorder_block_at(input_recorder, block_number);
+
+    atomic_store_explicit(&block->sequence, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    block->first_record = record_number;
+    block->first_timestamp_ns = input_recorder->codec.next_realtime_ns;
+    block->raw_length = 0;
+    block->compression = CODEC_COMPRESSION_NONE;
+    atomic_store_explicit(&block->record_count, 0, memory_order_relaxed);
+    atomic_store_explicit(&block->length, 0, memory_order_relaxed);
+
+    /* a keyframe always fits an empty block; see block_size_for() */
+    input_recorder->block = block;
+    input_recorder->sample.length = 0;
+    codec_reset(&input_recorder->codec);
+    if (codec_encode(&input_recorder->codec, &input_recorder->sample) < 0 || append_record(input_recorder) < 0) {
+        input_recorder->failed_flag = 1;
+        return;
+    }
+
+    atomic_store_explicit(&block->sequence, block_number + 1, memory_order_release);
+    atomic_store_explicit(&header->block_count, block_number + 1, memory_order_release);
+}
+
+/*
+ * append one sample to the circular file; runs on the collector thread and
+ * only stores into the mapping, so no system call is made per sample.
+ * ports and counters discovered after the file was created are not recorded
+ */
+void recorder_write(const struct infiniband_metrics *input_infiniband_metrics, void *recorder) {
+    struct recorder *input_recorder = recorder;
+
+    if (input_recorder->failed_flag > 0 || input_infiniband_metrics->interface_count <= 0) {
+        return;
+    }
+
+    if (input_recorder->map == NULL && recorder_create(input_recorder, input_infiniband_metrics) < 0) {
+        input_recorder->failed_flag = 1;
+        return;
+    }
+
+    struct recorder_header *header = input_recorder->header;
+    struct sample_codec *codec = &input_recorder->codec;
+    size_t port_count = header->port_count;
+    size_t counter_count = header->counter_count < input_infiniband_metrics->counter_count ? header->counter_count : input_infiniband_metrics->counter_count;
+    uint64_t record_number = atomic_load_explicit(&header->record_count, memory_order_relaxed);
+
+    codec->next_realtime_ns = input_infiniband_metrics->timestamp_ns + input_recorder->realtime_offset_ns;
+    memset(codec->next_states, RECORDER_PORT_ABSENT, 2 * port_count);
+    memset(codec->next_values, 0, header->counter_count * port_count * sizeof(uint64_t));
+
+    for (int i = 0; i < input_infiniband_metrics->interface_count; ++i) {
+        uint16_t name_id = input_infiniband_metrics->infiniband[i].name_id;
+        int slot = name_id < input_recorder->port_slots_size ? input_recorder->port_slots[name_id] : -1;
+
+        if (slot < 0) {
+            continue;
+        }
+
+        codec->next_states[2 * slot] = input_infiniband_metrics->infiniband[i].state;
+        codec->next_states[2 * slot + 1] = input_infiniband_metrics->infiniband[i].phys_state;
+        for (size_t k = 0; k < counter_count; ++k) {
+            codec->next_values[k * port_count + (size_t)slot] = input_infiniband_metrics->counters[k][i];
+        }
+    }
+
+    /* a sample that does not fit the open block is coded again as the keyframe of the next one */
+    if (input_recorder->block != NULL) {
+        input_recorder->sample.length = 0;
+        if (codec_encode(codec, &input_recorder->sample) < 0) {
+            input_recorder->failed_flag = 1;
+            return;
+        }
+
+        if (append_record(input_recorder) < 0) {
+            seal_block(input_recorder);
+        }
+    }
+
+    if (input_recorder->block == NULL) {
+        start_block(input_recorder, record_number);
+        if (input_recorder->failed_flag > 0) {
+            return;
+        }
+    }
+
+    atomic_store_explicit(&header->record_count, record_number + 1, memory_order_release);
+}
+
+void recorder_close(struct recorder *input_recorder) {
+    if (input_recorder == NULL) {
+        return;
+    }
+
+    if (input_recorder->block != NULL) {
+        seal_block(input_recorder);
+    }
+
+    if (input_recorder->map != NULL) {
+        munmap(input_recorder->map, input_recorder->map_size);
+    }
+
+    if (input_recorder->fd >= 0) {
+        close(input_recorder->fd);
+    }
+
+    free(input_recorder->port_slots);
+    codec_free(&input_recorder->codec);
+    string_buffer_free(&input_recorder->sample);
+    string_buffer_free(&input_recorder->compressed);
+    free(input_recorder);
+}
+
+struct recording *recording_open(const char *path) {
+    struct recording *new_recording = calloc(1, sizeof(*new_recording));
+    struct stat file_stat;
+
+    if (new_recording == NULL) {
+        fprintf(stderr, "ERROR: failed to allocate recording\n");
+        return NULL;
+    }
+
+    new_recording->read_view.block_number = NO_BLOCK;
+    new_recording->time_view.block_number = NO_BLOCK;
+
+    new_recording->fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (new_recording->fd < 0) {
+        fprintf(stderr, "ERROR: unable to open %s: %s\n", path, strerror(errno));
+        goto handle_error;
+    }
+
+    if (fstat(new_recording->fd, &file_stat) < 0 || (size_t)file_stat.st_size < sizeof(struct recorder_header)) {
+        fprintf(stderr, "ERROR: %s is not a record file\n", path);
+        goto handle_error;
+    }
+
+    new_recording->map_size = (size_t)file_stat.st_size;
+    void *map = mmap(NULL, new_recording->map_size, PROT_READ, MAP_SHARED, new_recording->fd, 0);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "ERROR: unable to map %s: %s\n", path, strerror(errno));
+        goto handle_error;
+    }
+    new_recording->map = map;
+
+    const struct recorder_header *header = map;
+    size_t port_count = header->port_count;
+    if (memcmp(header->magic, RECORDER_MAGIC, sizeof(RECORDER_MAGIC)) == 0 && header->version != RECORDER_VERSION) {
+        fprintf(stderr, "ERROR: %s is a version %" PRIu32 " record file; only version %d can be read\n", path, header->version, RECORDER_VERSION);
+        goto handle_error;
+    }
+
+    /* the blocks must fit the file; checked by division, as the product of a corrupt header can overflow */
+    if (memcmp(header->magic, RECORDER_MAGIC, sizeof(RECORDER_MAGIC)) != 0 || header->block_capacity < 3 || port_count == 0 ||
+        header->block_size == 0 || header->block_size < block_size_for(port_count, header->counter_count) || header->block_size > UINT32_MAX ||
+        header->header_size < sizeof(*header) + port_count * sizeof(struct recorder_port) + header->counter_count * RECORDER_NAME_MAX ||
+        header->header_size > new_recording->map_size ||
+        header->block_capacity > (new_recording->map_size - header->header_size) / header->block_size) {
+        fprintf(stderr, "ERROR: %s is not a compatible record file\n", path);
+        goto handle_error;
+    }
+
+    new_recording->header = header;
+    new_recording->blocks = new_recording->map + header->header_size;
+    new_recording->data_capacity = header->block_size - sizeof(struct recorder_block);
+
+    new_recording->name_ids = malloc(port_count * sizeof(*new_recording->name_ids));
+    new_recording->rate_ids = malloc(port_count * sizeof(*new_recording->rate_ids));
+    new_recording->lids = malloc(port_count * sizeof(*new_recording->lids));
+    new_recording->link_layers = malloc(port_count * sizeof(*new_recording->link_layers));
+    new_recording->read_view.data = malloc(new_recording->data_capacity);
+    new_recording->time_view.data = malloc(new_recording->data_capacity);
+    new_recording->scratch = malloc(new_recording->data_capacity);
+    if (new_recording->name_ids == NULL || new_recording->rate_ids == NULL || new_recording->lids == NULL || new_recording->link_layers == NULL ||
+        new_recording->read_view.data == NULL || new_recording->time_view.data == NULL || new_recording->scratch == NULL ||
+        codec_init(&new_recording->codec, port_count, header->counter_count) < 0) {
+        fprintf(stderr, "ERROR: failed to allocate recording ports\n");
+        goto handle_error;
+    }
+
+    const struct recorder_port *ports = (const struct recorder_port *)(header + 1);
+    for (size_t i = 0; i < port_count; ++i) {
+        char name[RECORDER_NAME_MAX];
+
+        snprintf(name, sizeof(name), "%.*s", RECORDER_NAME_MAX - 1, ports[i].name);
+        new_recording->name_ids[i] = infiniband_intern_interface_name(name);
+        snprintf(name, sizeof(name), "%.*s", RECORDER_NAME_MAX - 1, ports[i].rate);
+        new_recording->rate_ids[i] = infiniband_intern_rate_name(name);
+        new_recording->lids[i] = ports[i].lid;
+        new_recording->link_layers[i] = ports[i].link_layer;
+    }
+
+    /* counters are matched by name, so files recorded by other versions or hosts still load */
+    new_recording->counter_ids = malloc(header->counter_count * sizeof(*new_recording->counter_ids));
+    if (new_recording->counter_ids == NULL) {
+        fprintf(stderr, "ERROR: failed to allocate recording counters\n");
+        goto handle_error;
+    }
+
+    const char (*counter_names)[RECORDER_NAME_MAX] = (const char (*)[RECORDER_NAME_MAX])(ports + port_count);
+    for (uint32_t j = 0; j < header->counter_count; ++j) {
+        char name[RECORDER_NAME_MAX];
+
+        snprintf(name, sizeof(name), "%.*s", RECORDER_NAME_MAX - 1, counter_names[j]);
+        new_recording->counter_ids[j] = infiniband_intern_counter_name(name);
+    }
+
+    return new_recording;
+
+handle_error:
+    recording_close(new_recording);
+
+    return NULL;
+}
+
+void recording_close(struct recording *input_recording) {
+    if (input_recording == NULL) {
+        return;
+    }
+
+    if (input_recording->map != NULL) {
+        munmap(input_recording->map, input_recording->map_size);
+    }
+
+    if (input_recording->fd >= 0) {
+        close(input_recording->fd);
+    }
+
+    free(input_recording->name_ids);
+    free(input_recording->rate_ids);
+    free(input_recording->lids);
+    free(input_recording->link_layers);
+    free(input_recording->counter_ids);
+    free(input_recording->read_view.data);
+    free(input_recording->time_view.data);
+    free(input_recording->scratch);
+    codec_free(&input_recording->codec);
+    free(input_recording);
+}
+
+static struct recorder_block *block_at(const struct recording *input_recording, uint64_t block_number) {
+    return (struct recorder_block *)(input_recording->blocks + (block_number % input_recording->header->block_capacity) * input_recording->header->block_size);
+}
+
+/* return -1 if the slot holds another block by now, or is being rewritten */
+static int read_block_start(const struct recording *input_recording, uint64_t block_number, uint64_t *first_record, uint64_t *first_timestamp_ns) {
+    struct recorder_block *block = block_at(input_recording, block_number);
+
+    if (atomic_load_explicit(&block->sequence, memory_order_acquire) != block_number + 1) {
+        return -1;
+    }
+
+    *first_record = block->first_record;
+    *first_timestamp_ns = block->first_timestamp_ns;
+
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&block->sequence, memory_order_relaxed) == block_number + 1 ? 0 : -1;
+}
+
+/*
+ * blocks and records that can be read: [*first_block, *end_block) and [*first_record, *end_record).
+ * the oldest block is left out because a live recorder overwrites it next
+ */
+static void recording_blocks(const struct recording *input_recording, uint64_t *first_block, uint64_t *end_block, uint64_t *first_record, uint64_t *end_record) {
+    struct recorder_header *header = (struct recorder_header *)input_recording->header;
+    uint64_t first_timestamp_ns;
+
+    /* blocks are published before the records they hold */
+    *end_record = atomic_load_explicit(&header->record_count, memory_order_acquire);
+    *end_block = atomic_load_explicit(&header->block_count, memory_order_acquire);
+    *first_block = *end_block >= header->block_capacity ? *end_block - header->block_capacity + 1 : 0;
+
+    while (*first_block < *end_block && read_block_start(input_recording, *first_block, first_record, &first_timestamp_ns) < 0) {
+        ++*first_block;
+    }
+
+    if (*first_block == *end_block || *first_record > *end_record) {
+        *first_record = *end_record;
+    }
+}
+
+void recording_range(const struct recording *input_recording, uint64_t *first_record, uint64_t *end_record) {
+    uint64_t first_block;
+    uint64_t end_block;
+
+    recording_blocks(input_recording, &first_block, &end_block, first_record, end_record);
+}
+
+/* the newest readable block whose first record is at or before record_number, NO_BLOCK if there is none */
+static uint64_t find_block(const struct recording *input_recording, uint64_t record_number) {
+    uint64_t low;
+    uint64_t high;
+    uint64_t first_record;
+    uint64_t end_record;
+    uint64_t found = NO_BLOCK;
+
+    recording_blocks(input_recording, &low, &high, &first_record, &end_record);
+    if (record_number < first_record || record_number >= end_record) {
+        return NO_BLOCK;
+    }
+
+    while (low < high) {
+        uint64_t middle = low + (high - low) / 2;
+        uint64_t middle_first_record;
+        uint64_t middle_timestamp_ns;
+
+        /* a block torn by a live recorder only sits at the old end; treat it as too old */
+        if (read_block_start(input_recording, middle, &middle_first_record, &middle_timestamp_ns) < 0) {
+            low = middle + 1;
+        } else if (middle_first_record <= record_number) {
+            found = middle;
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    return found;
+}
+
+/* copy and decompress a block into view; return -1 if it is being rewritten or is corrupt */
+static int load_block(struct recording *input_recording, struct block_view *view, uint64_t block_number) {
+    struct recorder_block *block = block_at(input_recording, block_number);
+
+    view->block_number = NO_BLOCK;
+
+    if (atomic_load_explicit(&block->sequence, memory_order_acquire) != block_number + 1) {
+        return -1;
+    }
+
+    uint64_t first_record = block->first_record;
+    uint64_t record_count = atomic_load_explicit(&block->record_count, memory_order_acquire);
+    size_t length = atomic_load_explicit(&block->length, memory_order_relaxed);
+    size_t raw_length = block->raw_length;
+    enum codec_compression compression = block->compression;
+
+    if (length > input_recording->data_capacity || raw_length > input_recording->data_capacity) {
+        return -1;
+    }
+
+    memcpy(compression == CODEC_COMPRESSION_NONE ? view->data : input_recording->scratch, block + 1, length);
+
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&block->sequence, memory_order_relaxed) != block_number + 1) {
+        return -1;
+    }
+
+    if (compression != CODEC_COMPRESSION_NONE) {
+        if (codec_decompress(compression, (const char *)input_recording->scratch, length, (char *)view->data, raw_length) < 0) {
+            return -1;
+        }
+        length = raw_length;
+    }
+
+    view->block_number = block_number;
+    view->first_record = first_record;
+    view->record_count = record_count;
+    view->compression = compression;
+    view->length = length;
+    view->next_record = first_record;
+    view->position = 0;
+
+    return 0;
+}
+
+/* copy the records appended to the block of an uncompressed view since it was copied */
+static void extend_block(struct recording *input_recording, struct block_view *view) {
+    struct recorder_block *block = block_at(input_recording, view->block_number);
+
+    if (view->compression != CODEC_COMPRESSION_NONE || atomic_load_explicit(&block->sequence, memory_order_acquire) != view->block_number + 1) {
+        return;
+    }
+
+    uint64_t record_count = atomic_load_explicit(&block->record_count, memory_order_acquire);
+    size_t length = atomic_load_explicit(&block->length, memory_order_relaxed);
+
+    if (block->compression != CODEC_COMPRESSION_NONE || length > input_recording->data_capacity || length < view->length) {
+        return;
+    }
+
+    memcpy(view->data + view->length, (const unsigned char *)(block + 1) + view->length, length - view->length);
+
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&block->sequence, memory_order_relaxed) != view->block_number + 1) {
+        return;
+    }
+
+    view->record_count = record_count;
+    view->length = length;
+}
+
+/*
+ * make view hold the block of record_number. return 1 if decoding has to start over at the first
+ * record of the block, 0 if it can go on from the last record decoded, -1 if the record cannot be read
+ */
+static int seek_view(struct recording *input_recording, struct block_view *view, uint64_t record_number) {
+    if (view->block_number != NO_BLOCK && record_number >= view->first_record) {
+        /* the newest block may have grown since it was copied */
+        if (record_number >= view->first_record + view->record_count) {
+            extend_block(input_recording, view);
+        }
+
+        if (record_number < view->first_record + view->record_count) {
+            if (record_number + 1 < view->next_record) {
+                view->next_record = view->first_record;
+                view->position = 0;
+                return 1;
+            }
+            return 0;
+        }
+    }
+
+    uint64_t block_number = find_block(input_recording, record_number);
+    if (block_number == NO_BLOCK || load_block(input_recording, view, block_number) < 0 || record_number >= view->first_record + view->record_count) {
+        return -1;
+    }
+
+    return 1;
+}
+
+/* point sample at the coded sample of the next record of view and move past it */
+static int next_sample(struct block_view *view, struct wire_reader *sample) {
+    struct wire_reader reader = {view->data, view->length, view->position};
+    uint64_t sample_length;
+
+    if (wire_get_varint(&reader, &sample_length) < 0 || sample_length > reader.length - reader.position) {
+        return -1;
+    }
+
+    sample->data = view->data + reader.position;
+    sample->length = (size_t)sample_length;
+    sample->position = 0;
+    view->position = reader.position + (size_t)sample_length;
+    ++view->next_record;
+
+    return 0;
+}
+
+/* return -1 if the record is no longer (or not yet) in the file */
+int recording_timestamp(struct recording *input_recording, uint64_t record_number, uint64_t *timestamp_ns) {
+    struct block_view *view = &input_recording->time_view;
+    int ret_seek = seek_view(input_recording, view, record_number);
+
+    if (ret_seek < 0) {
+        return -1;
+    }
+    if (ret_seek > 0) {
+        input_recording->time_realtime_ns = 0;
+        input_recording->time_realtime_delta_ns = 0;
+    }
+
+    /* only the timestamps are decoded; the counters are skipped by their length */
+    while (view->next_record <= record_number) {
+        struct wire_reader sample;
+        int keyframe_flag = view->next_record == view->first_record;
+
+        if (next_sample(view, &sample) < 0 || codec_decode_realtime(&sample, &input_recording->time_realtime_ns, &input_recording->time_realtime_delta_ns) < 0) {
+            view->block_number = NO_BLOCK;
+            return -1;
+        }
+
+        if (keyframe_flag > 0) {
+            input_recording->time_realtime_delta_ns = 0;
+        }
+    }
+
+    *timestamp_ns = input_recording->time_realtime_ns;
+
+    return 0;
+}
+
+/* first readable record taken at or after timestamp_ns, found by binary search of the blocks; the end record if none */
+uint64_t recording_find(struct recording *input_recording, uint64_t timestamp_ns) {
+    uint64_t first_block;
+    uint64_t end_block;
+    uint64_t first_record;
+    uint64_t end_record;
+
+    recording_blocks(input_recording, &first_block, &end_block, &first_record, &end_record);
+
+    /* the first block starting at or after timestamp_ns */
+    uint64_t low = first_block;
+    uint64_t high = end_block;
+    while (low < high) {
+        uint64_t middle = low + (high - low) / 2;
+        uint64_t middle_first_record;
+        uint64_t middle_timestamp_ns;
+
+        if (read_block_start(input_recording, middle, &middle_first_record, &middle_timestamp_ns) < 0 || middle_timestamp_ns < timestamp_ns) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    /* the record is in the block before it, or is the first record of it */
+    uint64_t found_record = end_record;
+    uint64_t found_timestamp_ns;
+    if (low < end_block && read_block_start(input_recording, low, &found_record, &found_timestamp_ns) < 0) {
+        found_record = end_record;
+    }
+    if (low == first_block) {
+        return found_record < first_record ? first_record : found_record;
+    }
+
+    uint64_t before_timestamp_ns;
+    uint64_t record_number;
+    if (read_block_start(input_recording, low - 1, &record_number, &before_timestamp_ns) < 0) {
+        return found_record;
+    }
+
+    for (; record_number < found_record; ++record_number) {
+        uint64_t record_timestamp_ns;
+
+        if (recording_timestamp(input_recording, record_number, &record_timestamp_ns) == 0 && record_timestamp_ns >= timestamp_ns) {
+            return record_number;
+        }
+    }
+
+    return found_record;
+}
+
+/* fill input_infiniband_metrics with one record; ports absent from it are left out */
+int recording_read(struct recording *input_recording, uint64_t record_number, struct infiniband_metrics *input_infiniband_metrics) {
+    const struct recorder_header *header = input_recording->header;
+    struct block_view *view = &input_recording->read_view;
+    struct sample_codec *codec = &input_recording->codec;
+    size_t port_count = header->port_count;
+    size_t counter_count = infiniband_counter_count();
+    int count = 0;
+
+    if (infiniband_metrics_reserve(input_infiniband_metrics, port_count, counter_count) < 0) {
+        fprintf(stderr, "ERROR: failed to allocate InfiniBand metrics\n");
+        return -1;
+    }
+
+    int ret_seek = seek_view(input_recording, view, record_number);
+    if (ret_seek < 0) {
+        return -1;
+    }
+    if (ret_seek > 0) {
+        codec_reset(codec);
+    }
+
+    /* sequential reads decode one record each */
+    while (view->next_record <= record_number) {
+        struct wire_reader sample;
+
+        if (next_sample(view, &sample) < 0 || codec_decode(codec, &sample) < 0) {
+            view->block_number = NO_BLOCK;
+            return -1;
+        }
+    }
+
+    /*
+     * records only carry CLOCK_REALTIME, taken as the recorder's monotonic time plus a fixed offset; the
+     * monotonic time is rebuilt from the origin, which no record read later can precede
+     */
+    if (input_recording->origin_flag == 0) {
+        uint64_t first_record;
+        uint64_t end_record;
+
+        recording_range(input_recording, &first_record, &end_record);
+        if (recording_timestamp(input_recording, first_record, &input_recording->origin_ns) < 0 || input_recording->origin_ns > codec->realtime_ns) {
+            input_recording->origin_ns = codec->realtime_ns;
+        }
+        input_recording->origin_flag = 1;
+    }
+
+    input_infiniband_metrics->timestamp_ns = codec->realtime_ns > input_recording->origin_ns ? codec->realtime_ns - input_recording->origin_ns : 0;
+    input_infiniband_metrics->realtime_ns = codec->realtime_ns;
+    input_infiniband_metrics->counter_count = counter_count;
+
+    for (size_t i = 0; i < port_count; ++i) {
+        if (codec->states[2 * i] == RECORDER_PORT_ABSENT) {
+            continue;
+        }
+
+        struct interface *port = &input_infiniband_metrics->infiniband[count];
+        port->name_id = input_recording->name_ids[i];
+        port->rate_id = input_recording->rate_ids[i];
+        port->lid = input_recording->lids[i];
+        port->link_layer = input_recording->link_layers[i];
+        port->state = codec->states[2 * i];
+        port->phys_state = codec->states[2 * i + 1];
+
+        /* counters the file does not have read as 0 */
+        for (size_t k = 0; k < counter_count; ++k) {
+            input_infiniband_metrics->counters[k][count] = 0;
+        }
+
+        for (uint32_t j = 0; j < header->counter_count; ++j) {
+            if (input_recording->counter_ids[j] >= 0) {
+                input_infiniband_metrics->counters[input_recording->counter_ids[j]][count] = codec->values[(size_t)j * port_count + i];
+            }
+        }
+
+        ++count;
+    }
+
+    input_infiniband_metrics->interface_count = count;
+
+    return count;
+}
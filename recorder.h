@@ -0,0 +1,102 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2025 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include <stdint.h>
+#include "infiniband.h"
+
+/*
+ * record file layout:
+ *   struct recorder_header
+ *   struct recorder_port ports[port_count]
+ *   char counter_names[counter_count][RECORDER_NAME_MAX]
+ *   padding up to header_size (a multiple of the page size)
+ *   block_capacity blocks of block_size bytes used as a circular buffer
+ *
+ * a block is struct recorder_block, then its records: a varint length and one sample coded as in
+ * codec.h, against the records before it in the block. the first record of a block is a keyframe,
+ * so a block decodes on its own; a full block may be compressed in place. absent ports have the
+ * state RECORDER_PORT_ABSENT and zero counters
+ */
+#define RECORDER_MAGIC "IBTMREC"
+#define RECORDER_VERSION 2
+#define RECORDER_NAME_MAX 64
+
+/* blocks are at least this large, and larger if a keyframe of every port does not fit */
+#define RECORDER_BLOCK_SIZE (64U << 10)
+
+/* state byte of a port that was missing from a sample */
+#define RECORDER_PORT_ABSENT UINT8_MAX
+
+struct recorder_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t port_count;
+    uint32_t counter_count;
+    uint64_t block_size;
+    uint64_t block_capacity;
+
+    /* blocks ever started; block n lives in slot n % block_capacity */
+    _Atomic uint64_t block_count;
+
+    /* records ever written */
+    _Atomic uint64_t record_count;
+};
+
+struct recorder_port {
+    char name[RECORDER_NAME_MAX];
+    char rate[RECORDER_NAME_MAX];
+    uint32_t lid;
+    uint8_t link_layer;
+    uint8_t reserved[3];
+};
+
+struct recorder_block {
+    /* block number + 1; 0 while the block is being started or compressed */
+    _Atomic uint64_t sequence;
+
+    /* number and CLOCK_REALTIME timestamp of the first record, so timestamps keep increasing across restarts */
+    uint64_t first_record;
+    uint64_t first_timestamp_ns;
+
+    /* records in the block and bytes of data they take, published after each record */
+    _Atomic uint64_t record_count;
+    _Atomic uint32_t length;
+
+    /* enum codec_compression of the data once the block is full, and its length decompressed */
+    uint32_t raw_length;
+    uint8_t compression;
+    uint8_t reserved[7];
+};
+
+struct recorder;
+struct recording;
+
+extern struct recorder *recorder_open(const char *path, uint64_t file_size);
+extern void recorder_write(const struct infiniband_metrics *input_infiniband_metrics, void *recorder);
+extern void recorder_close(struct recorder *input_recorder);
+extern struct recording *recording_open(const char *path);
+extern void recording_close(struct recording *input_recording);
+extern void recording_range(const struct recording *input_recording, uint64_t *first_record, uint64_t *end_record);
+extern int recording_timestamp(struct recording *input_recording, uint64_t record_number, uint64_t *timestamp_ns);
+extern uint64_t recording_find(struct recording *input_recording, uint64_t timestamp_ns);
+extern int recording_read(struct recording *input_recording, uint64_t record_number, struct infiniband_metrics *input_infiniband_metrics);
+
+#endif /* RECORDER_H */
@@ -0,0 +1,233 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2025 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "infiniband.h"
+#include "recorder.h"
+#include "replay.h"
+#include "utils.h"
+
+/* playback speed limits for replay_scale_speed */
+#define REPLAY_SPEED_MIN (1.0 / 16.0)
+#define REPLAY_SPEED_MAX 4096.0
+
+/*
+ * playback of a record file on a virtual clock: play_time_ns advances with
+ * CLOCK_MONOTONIC scaled by speed unless paused, and records whose recorded
+ * time has been reached are due. unpaced playback makes every record due
+ */
+struct replay {
+    struct recording *recording;
+    int paced_flag;
+    int paused_flag;
+    double speed;
+
+    /* next record to hand out */
+    uint64_t position;
+
+    uint64_t play_time_ns;
+    uint64_t wall_time_ns;
+};
+
+struct replay *replay_open(const char *path, double speed, int paced_flag) {
+    struct replay *new_replay = calloc(1, sizeof(*new_replay));
+    uint64_t end_record;
+
+    if (new_replay == NULL) {
+        fprintf(stderr, "ERROR: failed to allocate replay\n");
+        return NULL;
+    }
+
+    new_replay->recording = recording_open(path);
+    if (new_replay->recording == NULL) {
+        free(new_replay);
+        return NULL;
+    }
+
+    recording_range(new_replay->recording, &new_replay->position, &end_record);
+    if (new_replay->position == end_record) {
+        fprintf(stderr, "ERROR: %s holds no sample\n", path);
+        replay_close(new_replay);
+        return NULL;
+    }
+
+    new_replay->paced_flag = paced_flag;
+    new_replay->speed = speed;
+    new_replay->wall_time_ns = get_monotonic_ns();
+    recording_timestamp(new_replay->recording, new_replay->position, &new_replay->play_time_ns);
+
+    return new_replay;
+}
+
+void replay_close(struct replay *input_replay) {
+    if (input_replay == NULL) {
+        return;
+    }
+
+    recording_close(input_replay->recording);
+    free(input_replay);
+}
+
+static void advance_clock(struct replay *input_replay) {
+    uint64_t now_ns = get_monotonic_ns();
+
+    if (input_replay->paused_flag == 0) {
+        input_replay->play_time_ns += (uint64_t)((double)(now_ns - input_replay->wall_time_ns) * input_replay->speed);
+    }
+    input_replay->wall_time_ns = now_ns;
+}
+
+/*
+ * read the next due record into input_infiniband_metrics; with latest_flag,
+ * records between the current position and the newest due one are skipped.
+ * return the interface count, or 0 if no record is due
+ */
+int replay_take(struct replay *input_replay, struct infiniband_metrics *input_infiniband_metrics, int latest_flag) {
+    uint64_t first_record;
+    uint64_t end_record;
+
+    recording_range(input_replay->recording, &first_record, &end_record);
+
+    /* a live recorder may have overwritten the position already */
+    if (input_replay->position < first_record) {
+        input_replay->position = first_record;
+    }
+
+    while (input_replay->position < end_record) {
+        uint64_t timestamp_ns;
+
+        if (input_replay->paced_flag > 0) {
+            advance_clock(input_replay);
+
+            if (latest_flag > 0) {
+                /* the newest due record sits right before the first record past the clock */
+                uint64_t due_end = recording_find(input_replay->recording, input_replay->play_time_ns + 1);
+                if (due_end > input_replay->position + 1) {
+                    input_replay->position = due_end - 1;
+                }
+            }
+
+            if (recording_timestamp(input_replay->recording, input_replay->position, &timestamp_ns) == 0 && timestamp_ns > input_replay->play_time_ns) {
+                return 0;
+            }
+        }
+
+        int ret_read = recording_read(input_replay->recording, input_replay->position, input_infiniband_metrics);
+        ++input_replay->position;
+
+        /* skip records that were rewritten while being read and records without any port */
+        if (ret_read > 0) {
+            return ret_read;
+        }
+    }
+
+    /* hold the clock at the last record so the status shows where playback stopped */
+    if (input_replay->paced_flag > 0 && end_record > 0) {
+        uint64_t last_timestamp_ns;
+        if (recording_timestamp(input_replay->recording, end_record - 1, &last_timestamp_ns) == 0 && input_replay->play_time_ns > last_timestamp_ns) {
+            input_replay->play_time_ns = last_timestamp_ns;
+        }
+    }
+
+    return 0;
+}
+
+/* return 1 once every record has been handed out */
+int replay_finished(struct replay *input_replay) {
+    uint64_t first_record;
+    uint64_t end_record;
+
+    recording_range(input_replay->recording, &first_record, &end_record);
+
+    return input_replay->position >= end_record;
+}
+
+void replay_toggle_pause(struct replay *input_replay) {
+    advance_clock(input_replay);
+    input_replay->paused_flag = !input_replay->paused_flag;
+}
+
+void replay_scale_speed(struct replay *input_replay, double factor) {
+    advance_clock(input_replay);
+
+    input_replay->speed *= factor;
+    if (input_replay->speed < REPLAY_SPEED_MIN) {
+        input_replay->speed = REPLAY_SPEED_MIN;
+    } else if (input_replay->speed > REPLAY_SPEED_MAX) {
+        input_replay->speed = REPLAY_SPEED_MAX;
+    }
+}
+
+/*
+ * move the clock by offset_ns within the recording; the position is set one
+ * record before the target so the next two takes give a previous sample and the target.
+ * return 1 if such a previous record exists, 0 if the target is the first record
+ */
+int replay_seek(struct replay *input_replay, int64_t offset_ns) {
+    uint64_t first_record;
+    uint64_t end_record;
+    uint64_t first_timestamp_ns = 0;
+    uint64_t last_timestamp_ns = 0;
+
+    advance_clock(input_replay);
+    recording_range(input_replay->recording, &first_record, &end_record);
+    if (first_record == end_record) {
+        return 0;
+    }
+
+    recording_timestamp(input_replay->recording, first_record, &first_timestamp_ns);
+    recording_timestamp(input_replay->recording, end_record - 1, &last_timestamp_ns);
+
+    uint64_t target_ns = input_replay->play_time_ns;
+    if (offset_ns < 0) {
+        target_ns = target_ns - first_timestamp_ns > (uint64_t)-offset_ns ? target_ns - (uint64_t)-offset_ns : first_timestamp_ns;
+    } else {
+        target_ns = last_timestamp_ns - target_ns > (uint64_t)offset_ns ? target_ns + (uint64_t)offset_ns : last_timestamp_ns;
+    }
+
+    uint64_t target_record = recording_find(input_replay->recording, target_ns);
+    if (target_record >= end_record) {
+        target_record = end_record - 1;
+    }
+
+    recording_timestamp(input_replay->recording, target_record, &input_replay->play_time_ns);
+    input_replay->position = target_record > first_record ? target_record - 1 : target_record;
+
+    return target_record > first_record;
+}
+
+/* jump to the first record, or to the last one if end_flag is set */
+int replay_seek_edge(struct replay *input_replay, int end_flag) {
+    return replay_seek(input_replay, end_flag > 0 ? INT64_MAX : INT64_MIN + 1);
+}
+
+/* e.g.: "REPLAY 2026-10-16 12:00:00.100 x8 PAUSED" */
+void replay_status(struct replay *input_replay, char *status, size_t status_size) {
+    time_t seconds = (time_t)(input_replay->play_time_ns / NSEC_PER_SEC);
+    struct tm local_time;
+    char time_text[32] = "";
+
+    if (localtime_r(&seconds, &local_time) != NULL) {
+        strftime(time_text, sizeof(time_text), "%Y-%m-%d %H:%M:%S", &local_time);
+    }
+
+    snprintf(status, status_size, "REPLAY %s.%03" PRIu64 " x%g%s%s", time_text, (uint64_t)(input_replay->play_time_ns % NSEC_PER_SEC / NSEC_PER_MSEC),
+             input_replay->speed, input_replay->paused_flag > 0 ? " PAUSED" : "", replay_finished(input_replay) > 0 ? " END" : "");
+}
@@ -0,0 +1,37 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2025 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "infiniband.h"
+
+struct replay;
+
+extern struct replay *replay_open(const char *path, double speed, int paced_flag);
+extern void replay_close(struct replay *input_replay);
+extern int replay_take(struct replay *input_replay, struct infiniband_metrics *input_infiniband_metrics, int latest_flag);
+extern int replay_finished(struct replay *input_replay);
+extern void replay_toggle_pause(struct replay *input_replay);
+extern void replay_scale_speed(struct replay *input_replay, double factor);
+extern int replay_seek(struct replay *input_replay, int64_t offset_ns);
+extern int replay_seek_edge(struct replay *input_replay, int end_flag);
+extern void replay_status(struct replay *input_replay, char *status, size_t status_size);
+
+#endif /* REPLAY_H */
@@ -0,0 +1,1043 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2025 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "infiniband.h"
+#include "intern.h"
+#include "rdma_netlink.h"
+#include "resources.h"
+#include "utils.h"
+
+/* counter sets are few and read every second for rates; a pass over the resource tables is spread over RESOURCES_TABLE_PERIOD_NS */
+#define RESOURCES_COUNTER_NS NSEC_PER_SEC
+#define RESOURCES_TABLE_PERIOD_NS (10 * NSEC_PER_SEC)
+
+/* smallest id index of a table */
+#define RESOURCES_INDEX_MIN 64
+
+/* hardware counters of enum resource_rate, as mlx5 names them in QP counter sets */
+static const char *resource_rate_counters[RESOURCE_RATE_COUNT] = {
+    [RESOURCE_RATE_RX_WRITE] = "rx_write_requests",
+    [RESOURCE_RATE_RX_READ] = "rx_read_requests",
+    [RESOURCE_RATE_RX_ATOMIC] = "rx_atomic_requests",
+};
+
+/* a cached resource; the counter values and rates are only used by counter sets */
+struct resource_entry {
+    uint32_t id;
+    uint32_t port_index;
+    uint32_t pid;
+    uint32_t generation;
+    uint64_t length;
+    char kernel_name[RESOURCES_COMMAND_MAX];
+
+    uint64_t values[RESOURCE_RATE_COUNT];
+    uint64_t sample_ns;
+    double rates[RESOURCE_RATE_COUNT];
+    int rate_flag;
+};
+
+/* the cached resources of one kind on one device */
+struct resource_table {
+    struct resource_entry *entries;
+    size_t count;
+    size_t capacity;
+
+    /* open addressing index of entry positions + 1 by id, 0 where empty */
+    uint32_t *index;
+    size_t index_size;
+
+    /* bumped for every dump; entries not seen by the last complete one are gone */
+    uint32_t generation;
+};
+
+/* a port of the current snapshot */
+struct resource_port {
+    uint32_t port_index;
+    uint16_t name_id;
+};
+
+struct resource_device {
+    char name[IB_DEVICE_NAME_MAX];
+
+    /* stable identity of the device for the slots */
+    uint32_t serial;
+
+    /* RDMA_NLDEV_ATTR_DEV_INDEX, looked up until found */
+    uint32_t index;
+    int index_flag;
+
+    /* ports of the device in the snapshot of the last sync round it was seen in */
+    struct resource_port *ports;
+    size_t port_count;
+    size_t port_capacity;
+    uint64_t sync_round;
+
+    struct resource_table tables[RDMA_NETLINK_RESOURCE_KIND_COUNT];
+};
+
+/* resources held by one owner on one port of a device, or on the device itself at port 0 */
+struct resource_slot {
+    uint32_t device_serial;
+    uint32_t port_index;
+    uint32_t pid;
+    char command[RESOURCES_COMMAND_MAX];
+    uint32_t counts[RDMA_NETLINK_RESOURCE_KIND_COUNT];
+    uint64_t mr_bytes;
+};
+
+/*
+ * the dumps block on the kernel for as long as it takes to list every resource, so they run on a
+ * thread of their own; it owns everything up to the rows it hands over
+ */
+struct resources {
+    struct rdma_netlink *nl;
+
+    /* name ids of the ports the refresh follows, copied from the handed over ones */
+    uint16_t *ports;
+    size_t port_count;
+    size_t port_capacity;
+
+    struct resource_device **devices;
+    size_t device_count;
+    size_t device_capacity;
+    uint32_t next_serial;
+    uint64_t sync_round;
+
+    /* owner counts kept up to date entry by entry as dumps add, move and drop resources */
+    struct resource_slot *slots;
+    size_t slot_count;
+    size_t slot_capacity;
+    size_t last_slot;
+
+    /* rows for the screen, sorted by port name id; rebuilt from the slots when dirty, then published */
+    struct resource_usage *usage;
+    size_t usage_count;
+    size_t usage_capacity;
+    int dirty_flag;
+
+    /* refresh schedule; the table cursor walks every kind of every device, one dump per step */
+    uint64_t next_counter_ns;
+    uint64_t next_table_ns;
+    size_t table_cursor;
+
+    pthread_t thread;
+
+    /* guards the fields below, shared between the refresh thread and the screen */
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int stop_flag;
+    int error_flag;
+
+    /* ports of the newest snapshot, handed over by resources_update(); port_flag is set once there are any */
+    uint16_t *shared_ports;
+    size_t shared_port_count;
+    size_t shared_port_capacity;
+    int port_flag;
+
+    /* rows rebuilt since the screen last took them, if published_flag is set */
+    struct resource_usage *published_usage;
+    size_t published_count;
+    size_t published_capacity;
+    int published_flag;
+
+    /* rows the screen shows; only touched by the screen */
+    struct resource_usage *shown_usage;
+    size_t shown_count;
+    size_t shown_capacity;
+};
+
+/* state of one dump into a table */
+struct dump_context {
+    struct resources *res;
+    struct resource_device *device;
+    enum rdma_netlink_resource_kind kind;
+    uint64_t now_ns;
+    int error_flag;
+};
+
+static int same_owner(uint32_t pid, const char *command, uint32_t other_pid, const char *other_command) {
+    return pid == other_pid && (pid != 0 || strcmp(command, other_command) == 0);
+}
+
+/* the comm of a process as /proc has it, or the module owning a kernel resource in brackets like rdma res shows it */
+static void resolve_command(uint32_t pid, const char *kernel_name, char *command) {
+    char path[64];
+    char value[BUFSIZ];
+
+    if (pid == 0) {
+        snprintf(command, RESOURCES_COMMAND_MAX, "[%.*s]", RESOURCES_COMMAND_MAX - 3, kernel_name);
+        return;
+    }
+
+    snprintf(path, sizeof(path), "/proc/%u/comm", pid);
+    if (read_file_char(path, value) < 0) {
+        snprintf(command, RESOURCES_COMMAND_MAX, "-");
+        return;
+    }
+
+    snprintf(command, RESOURCES_COMMAND_MAX, "%.*s", RESOURCES_COMMAND_MAX - 1, value);
+}
+
+/* add sign times entry of kind to its owner's slot; a slot holding nothing is dropped */
+static int slot_update(struct resources *res, const struct resource_device *device, enum rdma_netlink_resource_kind kind, const struct resource_entry *entry, int sign) {
+    uint32_t port_index = kind == RDMA_NETLINK_RESOURCE_QP || kind == RDMA_NETLINK_RESOURCE_COUNTER ? entry->port_index : 0;
+    char command[RESOURCES_COMMAND_MAX] = "";
+    struct resource_slot *slot = NULL;
+
+    if (entry->pid == 0) {
+        resolve_command(0, entry->kernel_name, command);
+    }
+
+    /* the entries of an owner mostly come one after the other */
+    if (res->last_slot < res->slot_count) {
+        slot = &res->slots[res->last_slot];
+        if (slot->device_serial != device->serial || slot->port_index != port_index || !same_owner(slot->pid, slot->command, entry->pid, command)) {
+            slot = NULL;
+        }
+    }
+
+    for (size_t i = 0; slot == NULL && i < res->slot_count; ++i) {
+        if (res->slots[i].device_serial == device->serial && res->slots[i].port_index == port_index && same_owner(res->slots[i].pid, res->slots[i].command, entry->pid, command)) {
+            slot = &res->slots[i];
+        }
+    }
+
+    if (slot == NULL) {
+        if (sign < 0) {
+            return 0;
+        }
+
+        if (res->slot_count == res->slot_capacity) {
+            size_t new_capacity = res->slot_capacity == 0 ? 16 : res->slot_capacity * 2;
+            struct resource_slot *new_slots = realloc(res->slots, new_capacity * sizeof(*new_slots));
+            if (new_slots == NULL) {
+                return -1;
+            }
+
+            res->slots = new_slots;
+            res->slot_capacity = new_capacity;
+        }
+
+        slot = &res->slots[res->slot_count++];
+        memset(slot, 0, sizeof(*slot));
+        slot->device_serial = device->serial;
+        slot->port_index = port_index;
+        slot->pid = entry->pid;
+        resolve_command(entry->pid, entry->kernel_name, slot->command);
+    }
+
+    if (sign > 0) {
+        slot->counts[kind] += 1;
+        slot->mr_bytes += entry->length;
+    } else {
+        slot->counts[kind] -= slot->counts[kind] > 0 ? 1 : 0;
+        slot->mr_bytes -= slot->mr_bytes > entry->length ? entry->length : slot->mr_bytes;
+    }
+
+    res->last_slot = (size_t)(slot - res->slots);
+    res->dirty_flag = 1;
+
+    for (int k = 0; k < RDMA_NETLINK_RESOURCE_KIND_COUNT; ++k) {
+        if (slot->counts[k] > 0) {
+            return 0;
+        }
+    }
+
+    *slot = res->slots[--res->slot_count];
+
+    return 0;
+}
+
+static size_t id_hash(uint32_t id, size_t index_size) {
+    return (size_t)(id * 2654435761U) & (index_size - 1);
+}
+
+/* position of the entry with id, or SIZE_MAX */
+static size_t table_find(const struct resource_table *table, uint32_t id) {
+    if (table->index_size == 0) {
+        return SIZE_MAX;
+    }
+
+    for (size_t slot = id_hash(id, table->index_size);; slot = (slot + 1) & (table->index_size - 1)) {
+        uint32_t position = table->index[slot];
+
+        if (position == 0) {
+            return SIZE_MAX;
+        }
+
+        if (table->entries[position - 1].id == id) {
+            return position - 1;
+        }
+    }
+}
+
+/* index every entry again, in an index at most half full */
+static int table_rebuild_index(struct resource_table *table) {
+    size_t index_size = RESOURCES_INDEX_MIN;
+
+    while (index_size < table->count * 2 + 2) {
+        index_size *= 2;
+    }
+
+    if (index_size != table->index_size) {
+        uint32_t *new_index = malloc(index_size * sizeof(*new_index));
+        if (new_index == NULL) {
+            return -1;
+        }
+
+        free(table->index);
+        table->index = new_index;
+        table->index_size = index_size;
+    }
+
+    memset(table->index, 0, table->index_size * sizeof(*table->index));
+
+    for (size_t i = 0; i < table->count; ++i) {
+        size_t slot = id_hash(table->entries[i].id, table->index_size);
+
+        while (table->index[slot] != 0) {
+            slot = (slot + 1) & (table->index_size - 1);
+        }
+
+        table->index[slot] = (uint32_t)(i + 1);
+    }
+
+    return 0;
+}
+
+/* append entry and return its position, or SIZE_MAX */
+static size_t table_insert(struct resource_table *table, const struct resource_entry *entry) {
+    if (table->count == table->capacity) {
+        size_t new_capacity = table->capacity == 0 ? 64 : table->capacity * 2;
+        struct resource_entry *new_entries = realloc(table->entries, new_capacity * sizeof(*new_entries));
+        if (new_entries == NULL) {
+            return SIZE_MAX;
+        }
+
+        table->entries = new_entries;
+        table->capacity = new_capacity;
+    }
+
+    table->entries[table->count++] = *entry;
+
+    if (table->count * 2 + 2 > table->index_size) {
+        if (table_rebuild_index(table) < 0) {
+            --table->count;
+            return SIZE_MAX;
+        }
+    } else {
+        size_t slot = id_hash(entry->id, table->index_size);
+
+        while (table->index[slot] != 0) {
+            slot = (slot + 1) & (table->index_size - 1);
+        }
+
+        table->index[slot] = (uint32_t)table->count;
+    }
+
+    return table->count - 1;
+}
+
+static void read_rate_counter(void *ctx, size_t port, size_t position, const char *name, uint64_t value) {
+    uint64_t *values = ctx;
+
+    (void)port;
+    (void)position;
+
+    for (size_t k = 0; k < RESOURCE_RATE_COUNT; ++k) {
+        if (strcmp(name, resource_rate_counters[k]) == 0) {
+            values[k] = value;
+        }
+    }
+}
+
+/* add a resource of a dump to the cache, or refresh the cached one; only changed owners or ports touch the slots */
+static void cache_resource(void *ctx, const struct rdma_netlink_resource *resource) {
+    struct dump_context *dump = ctx;
+    struct resource_table *table = &dump->device->tables[dump->kind];
+    struct resource_entry entry;
+    size_t position;
+
+    if (resource->kind != dump->kind || dump->error_flag > 0) {
+        return;
+    }
+
+    /* every port has its own QP0 and QP1; like the kernel, their port goes into the key */
+    memset(&entry, 0, sizeof(entry));
+    entry.id = resource->id;
+    if (dump->kind == RDMA_NETLINK_RESOURCE_QP && resource->id <= 1) {
+        entry.id |= resource->port_index << 24;
+    }
+    entry.port_index = resource->port_index;
+    entry.pid = resource->pid;
+    entry.generation = table->generation;
+    entry.length = resource->length;
+    snprintf(entry.kernel_name, sizeof(entry.kernel_name), "%s", resource->pid == 0 && resource->kernel_name != NULL ? resource->kernel_name : "");
+
+    position = table_find(table, entry.id);
+    if (position == SIZE_MAX) {
+        position = table_insert(table, &entry);
+        if (position == SIZE_MAX || slot_update(dump->res, dump->device, dump->kind, &entry, 1) < 0) {
+            dump->error_flag = 1;
+            return;
+        }
+    } else {
+        struct resource_entry *cached = &table->entries[position];
+
+        if (cached->port_index != entry.port_index || cached->pid != entry.pid || cached->length != entry.length || strcmp(cached->kernel_name, entry.kernel_name) != 0) {
+            if (slot_update(dump->res, dump->device, dump->kind, cached, -1) < 0 || slot_update(dump->res, dump->device, dump->kind, &entry, 1) < 0) {
+                dump->error_flag = 1;
+                return;
+            }
+
+            /* another owner's counter set starts its rates over */
+            if (cached->pid != entry.pid) {
+                cached->sample_ns = 0;
+                cached->rate_flag = 0;
+            }
+
+            cached->port_index = entry.port_index;
+            cached->pid = entry.pid;
+            cached->length = entry.length;
+            memcpy(cached->kernel_name, entry.kernel_name, sizeof(cached->kernel_name));
+        }
+
+        cached->generation = table->generation;
+    }
+
+    if (dump->kind != RDMA_NETLINK_RESOURCE_COUNTER) {
+        return;
+    }
+
+    /* rates since the previous dump; a counter going back restarts them */
+    struct resource_entry *counter = &table->entries[position];
+    uint64_t values[RESOURCE_RATE_COUNT] = {0};
+
+    rdma_netlink_resource_counters(resource, read_rate_counter, values);
+
+    if (counter->sample_ns > 0 && dump->now_ns > counter->sample_ns) {
+        double seconds = (double)(dump->now_ns - counter->sample_ns) / 1e9;
+
+        for (size_t k = 0; k < RESOURCE_RATE_COUNT; ++k) {
+            counter->rates[k] = values[k] >= counter->values[k] ? (double)(values[k] - counter->values[k]) / seconds : 0.0;
+        }
+        counter->rate_flag = 1;
+    }
+
+    memcpy(counter->values, values, sizeof(values));
+    counter->sample_ns = dump->now_ns;
+    dump->res->dirty_flag = 1;
+}
+
+/* dump one kind of resources of device into its table and drop the entries the dump no longer lists */
+static int dump_table(struct resources *res, struct resource_device *device, enum rdma_netlink_resource_kind kind, uint64_t now_ns) {
+    struct resource_table *table = &device->tables[kind];
+    struct dump_context dump = {res, device, kind, now_ns, 0};
+    size_t kept = 0;
+
+    if (device->index_flag == 0) {
+        return -1;
+    }
+
+    /* a failed dump leaves the cache as it is until a complete one */
+    ++table->generation;
+    if (rdma_netlink_dump_resources(res->nl, kind, device->index, cache_resource, &dump) < 0 || dump.error_flag > 0) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < table->count; ++i) {
+        if (table->entries[i].generation != table->generation) {
+            slot_update(res, device, kind, &table->entries[i], -1);
+            continue;
+        }
+
+        table->entries[kept++] = table->entries[i];
+    }
+
+    if (kept == table->count) {
+        return 0;
+    }
+
+    table->count = kept;
+
+    return table_rebuild_index(table);
+}
+
+static void free_device(struct resources *res, struct resource_device *device) {
+    /* the slots of a gone device go with it */
+    for (size_t i = 0; i < res->slot_count;) {
+        if (res->slots[i].device_serial == device->serial) {
+            res->slots[i] = res->slots[--res->slot_count];
+            continue;
+        }
+        ++i;
+    }
+
+    for (int k = 0; k < RDMA_NETLINK_RESOURCE_KIND_COUNT; ++k) {
+        free(device->tables[k].entries);
+        free(device->tables[k].index);
+    }
+
+    free(device->ports);
+    free(device);
+    res->dirty_flag = 1;
+}
+
+/* the device named by the first length characters of name, added if it is new */
+static struct resource_device *find_device(struct resources *res, const char *name, size_t length) {
+    struct resource_device *device;
+
+    for (size_t i = 0; i < res->device_count; ++i) {
+        if (strncmp(res->devices[i]->name, name, length) == 0 && res->devices[i]->name[length] == '\0') {
+            return res->devices[i];
+        }
+    }
+
+    if (res->device_count == res->device_capacity) {
+        size_t new_capacity = res->device_capacity == 0 ? 4 : res->device_capacity * 2;
+        struct resource_device **new_devices = realloc(res->devices, new_capacity * sizeof(*new_devices));
+        if (new_devices == NULL) {
+            return NULL;
+        }
+
+        res->devices = new_devices;
+        res->device_capacity = new_capacity;
+    }
+
+    device = calloc(1, sizeof(*device));
+    if (device == NULL) {
+        return NULL;
+    }
+
+    memcpy(device->name, name, length);
+    device->serial = res->next_serial++;
+    res->devices[res->device_count++] = device;
+
+    return device;
+}
+
+/*
+ * follow the devices and ports of the snapshot, named <device>:<port>; devices gone from it are
+ * dropped, and new ones are looked up and dumped whole so they show up at once
+ */
+static int sync_devices(struct resources *res, uint64_t now_ns) {
+    ++res->sync_round;
+
+    for (size_t i = 0; i < res->port_count; ++i) {
+        uint16_t name_id = res->ports[i];
+        const char *interface_name = infiniband_interface_name(name_id);
+        const char *separator = strrchr(interface_name, ':');
+        char *end;
+
+        if (separator == NULL || separator == interface_name || (size_t)(separator - interface_name) >= IB_DEVICE_NAME_MAX) {
+            continue;
+        }
+
+        unsigned long int port_index = strtoul(separator + 1, &end, 10);
+        if (end == separator + 1 || *end != '\0' || port_index == 0 || port_index > UINT32_MAX) {
+            continue;
+        }
+
+        struct resource_device *device = find_device(res, interface_name, (size_t)(separator - interface_name));
+        if (device == NULL) {
+            return -1;
+        }
+
+        if (device->sync_round != res->sync_round) {
+            device->sync_round = res->sync_round;
+            device->port_count = 0;
+        }
+
+        if (device->port_count == device->port_capacity) {
+            size_t new_capacity = device->port_capacity == 0 ? 4 : device->port_capacity * 2;
+            struct resource_port *new_ports = realloc(device->ports, new_capacity * sizeof(*new_ports));
+            if (new_ports == NULL) {
+                return -1;
+            }
+
+            device->ports = new_ports;
+            device->port_capacity = new_capacity;
+        }
+
+        device->ports[device->port_count].port_index = (uint32_t)port_index;
+        device->ports[device->port_count].name_id = name_id;
+        ++device->port_count;
+    }
+
+    for (size_t i = 0; i < res->device_count;) {
+        struct resource_device *device = res->devices[i];
+
+        if (device->sync_round != res->sync_round) {
+            free_device(res, device);
+            res->devices[i] = res->devices[--res->device_count];
+            continue;
+        }
+
+        if (device->index_flag == 0 && rdma_netlink_device_index(res->nl, device->name, &device->index) == 0) {
+            device->index_flag = 1;
+
+            for (int k = 0; k < RDMA_NETLINK_RESOURCE_COUNTER; ++k) {
+                dump_table(res, device, (enum rdma_netlink_resource_kind)k, now_ns);
+            }
+        }
+
+        ++i;
+    }
+
+    return 0;
+}
+
+static uint16_t port_name_id(const struct resource_device *device, uint32_t port_index) {
+    for (size_t i = 0; i < device->port_count; ++i) {
+        if (device->ports[i].port_index == port_index) {
+            return device->ports[i].name_id;
+        }
+    }
+
+    return INTERN_ID_INVALID;
+}
+
+static const struct resource_device *device_by_serial(const struct resources *res, uint32_t serial) {
+    for (size_t i = 0; i < res->device_count; ++i) {
+        if (res->devices[i]->serial == serial) {
+            return res->devices[i];
+        }
+    }
+
+    return NULL;
+}
+
+static struct resource_usage *append_usage(struct resources *res) {
+    if (res->usage_count == res->usage_capacity) {
+        size_t new_capacity = res->usage_capacity == 0 ? 16 : res->usage_capacity * 2;
+        struct resource_usage *new_usage = realloc(res->usage, new_capacity * sizeof(*new_usage));
+        if (new_usage == NULL) {
+            return NULL;
+        }
+
+        res->usage = new_usage;
+        res->usage_capacity = new_capacity;
+    }
+
+    struct resource_usage *usage = &res->usage[res->usage_count++];
+    memset(usage, 0, sizeof(*usage));
+
+    return usage;
+}
+
+static int compare_usage(const void *a, const void *b) {
+    const struct resource_usage *usage_a = a;
+    const struct resource_usage *usage_b = b;
+
+    if (usage_a->name_id != usage_b->name_id) {
+        return usage_a->name_id < usage_b->name_id ? -1 : 1;
+    }
+
+    if (usage_a->device_flag != usage_b->device_flag) {
+        return usage_a->device_flag - usage_b->device_flag;
+    }
+
+    if (usage_a->pid != usage_b->pid) {
+        return usage_a->pid < usage_b->pid ? -1 : 1;
+    }
+
+    return strcmp(usage_a->command, usage_b->command);
+}
+
+/* the port rows of the slots, with the device wide counts folded in where an owner uses a single port, then the counter set rates */
+static int build_usage(struct resources *res) {
+    res->usage_count = 0;
+
+    for (size_t i = 0; i < res->slot_count; ++i) {
+        const struct resource_slot *slot = &res->slots[i];
+        const struct resource_device *device = device_by_serial(res, slot->device_serial);
+        uint16_t name_id;
+
+        if (slot->port_index == 0 || device == NULL || (name_id = port_name_id(device, slot->port_index)) == INTERN_ID_INVALID) {
+            continue;
+        }
+
+        struct resource_usage *usage = append_usage(res);
+        if (usage == NULL) {
+            return -1;
+        }
+
+        usage->name_id = name_id;
+        memcpy(usage->device_name, device->name, sizeof(usage->device_name));
+        usage->pid = slot->pid;
+        memcpy(usage->command, slot->command, sizeof(usage->command));
+        memcpy(usage->counts, slot->counts, sizeof(usage->counts));
+        usage->mr_bytes = slot->mr_bytes;
+    }
+
+    size_t port_usage_count = res->usage_count;
+
+    for (size_t i = 0; i < res->slot_count; ++i) {
+        const struct resource_slot *slot = &res->slots[i];
+        const struct resource_device *device = device_by_serial(res, slot->device_serial);
+        struct resource_usage *match = NULL;
+        size_t match_count = 0;
+
+        if (slot->port_index != 0 || device == NULL || device->port_count == 0) {
+            continue;
+        }
+
+        for (size_t j = 0; j < port_usage_count; ++j) {
+            if (strcmp(res->usage[j].device_name, device->name) == 0 && same_owner(res->usage[j].pid, res->usage[j].command, slot->pid, slot->command)) {
+                match = &res->usage[j];
+                ++match_count;
+            }
+        }
+
+        if (match_count != 1) {
+            uint32_t lowest_port = UINT32_MAX;
+
+            match = append_usage(res);
+            if (match == NULL) {
+                return -1;
+            }
+
+            for (size_t p = 0; p < device->port_count; ++p) {
+                if (device->ports[p].port_index < lowest_port) {
+                    lowest_port = device->ports[p].port_index;
+                    match->name_id = device->ports[p].name_id;
+                }
+            }
+
+            match->device_flag = 1;
+            memcpy(match->device_name, device->name, sizeof(match->device_name));
+            match->pid = slot->pid;
+            memcpy(match->command, slot->command, sizeof(match->command));
+        }
+
+        for (int k = 0; k < RDMA_NETLINK_RESOURCE_KIND_COUNT; ++k) {
+            match->counts[k] += slot->counts[k];
+        }
+        match->mr_bytes += slot->mr_bytes;
+    }
+
+    /* rates of the counter sets go to the row of their owner on their port */
+    for (size_t d = 0; d < res->device_count; ++d) {
+        const struct resource_device *device = res->devices[d];
+        const struct resource_table *table = &device->tables[RDMA_NETLINK_RESOURCE_COUNTER];
+
+        for (size_t i = 0; i < table->count; ++i) {
+            const struct resource_entry *counter = &table->entries[i];
+            uint16_t name_id = port_name_id(device, counter->port_index);
+            char command[RESOURCES_COMMAND_MAX] = "";
+
+            if (counter->rate_flag == 0 || name_id == INTERN_ID_INVALID) {
+                continue;
+            }
+
+            if (counter->pid == 0) {
+                resolve_command(0, counter->kernel_name, command);
+            }
+
+            for (size_t j = 0; j < port_usage_count; ++j) {
+                struct resource_usage *usage = &res->usage[j];
+
+                if (usage->name_id == name_id && same_owner(usage->pid, usage->command, counter->pid, command)) {
+                    for (size_t k = 0; k < RESOURCE_RATE_COUNT; ++k) {
+                        usage->rates[k] += counter->rates[k];
+                    }
+                    usage->rate_flag = 1;
+                    break;
+                }
+            }
+        }
+    }
+
+    qsort(res->usage, res->usage_count, sizeof(*res->usage), compare_usage);
+    res->dirty_flag = 0;
+
+    return 0;
+}
+
+/*
+ * refresh the cache for the ports followed: the devices and the counter sets every RESOURCES_COUNTER_NS,
+ * and one QP, CQ or MR table per step so a pass over every table is spread over RESOURCES_TABLE_PERIOD_NS.
+ * a device whose resources cannot be dumped keeps its cached ones. return 1 if the rows were rebuilt, 0 if
+ * not, or -1 if memory runs out
+ */
+static int refresh(struct resources *res, uint64_t now_ns) {
+    if (now_ns >= res->next_counter_ns) {
+        res->next_counter_ns = now_ns + RESOURCES_COUNTER_NS;
+
+        if (sync_devices(res, now_ns) < 0) {
+            return -1;
+        }
+
+        for (size_t i = 0; i < res->device_count; ++i) {
+            dump_table(res, res->devices[i], RDMA_NETLINK_RESOURCE_COUNTER, now_ns);
+        }
+    }
+
+    size_t step_count = res->device_count * RDMA_NETLINK_RESOURCE_COUNTER;
+    if (step_count > 0 && now_ns >= res->next_table_ns) {
+        res->next_table_ns = now_ns + RESOURCES_TABLE_PERIOD_NS / step_count;
+        res->table_cursor %= step_count;
+
+        dump_table(res, res->devices[res->table_cursor / RDMA_NETLINK_RESOURCE_COUNTER], (enum rdma_netlink_resource_kind)(res->table_cursor % RDMA_NETLINK_RESOURCE_COUNTER), now_ns);
+        ++res->table_cursor;
+    }
+
+    if (res->dirty_flag == 0) {
+        return 0;
+    }
+
+    return build_usage(res) < 0 ? -1 : 1;
+}
+
+/* copy the rebuilt rows for the screen to take; called with the mutex held */
+static int publish_usage(struct resources *res) {
+    if (res->usage_count > res->published_capacity) {
+        struct resource_usage *new_usage = realloc(res->published_usage, res->usage_count * sizeof(*new_usage));
+        if (new_usage == NULL) {
+            return -1;
+        }
+
+        res->published_usage = new_usage;
+        res->published_capacity = res->usage_count;
+    }
+
+    if (res->usage_count > 0) {
+        memcpy(res->published_usage, res->usage, res->usage_count * sizeof(*res->usage));
+    }
+    res->published_count = res->usage_count;
+    res->published_flag = 1;
+
+    return 0;
+}
+
+/* take the handed over ports; called with the mutex held */
+static int take_ports(struct resources *res) {
+    if (res->shared_port_count > res->port_capacity) {
+        uint16_t *new_ports = realloc(res->ports, res->shared_port_count * sizeof(*new_ports));
+        if (new_ports == NULL) {
+            return -1;
+        }
+
+        res->ports = new_ports;
+        res->port_capacity = res->shared_port_count;
+    }
+
+    if (res->shared_port_count > 0) {
+        memcpy(res->ports, res->shared_ports, res->shared_port_count * sizeof(*res->ports));
+    }
+    res->port_count = res->shared_port_count;
+
+    return 0;
+}
+
+/* run every refresh step when it is due, once the screen handed over ports; stop on error_flag or stop_flag */
+static void *resources_main(void *arg) {
+    struct resources *res = arg;
+
+    pthread_mutex_lock(&res->mutex);
+
+    while (res->stop_flag == 0 && res->error_flag == 0) {
+        uint64_t now_ns = get_monotonic_ns();
+        uint64_t deadline_ns = res->next_counter_ns;
+
+        if (res->device_count > 0 && res->next_table_ns < deadline_ns) {
+            deadline_ns = res->next_table_ns;
+        }
+
+        if (res->port_flag == 0) {
+            pthread_cond_wait(&res->cond, &res->mutex);
+            continue;
+        }
+
+        if (now_ns < deadline_ns) {
+            struct timespec ts = ns_to_timespec(deadline_ns);
+            pthread_cond_timedwait(&res->cond, &res->mutex, &ts);
+            continue;
+        }
+
+        if (take_ports(res) < 0) {
+            res->error_flag = 1;
+            break;
+        }
+
+        pthread_mutex_unlock(&res->mutex);
+        int ret = refresh(res, now_ns);
+        pthread_mutex_lock(&res->mutex);
+
+        if (ret < 0 || (ret > 0 && publish_usage(res) < 0)) {
+            res->error_flag = 1;
+        }
+    }
+
+    pthread_mutex_unlock(&res->mutex);
+
+    return NULL;
+}
+
+/*
+ * attribute RDMA resources to processes through the kernel resource tracker, read over netlink or,
+ * if recording_path is not NULL, from a file of recorded replies; a thread keeps them up to date
+ */
+struct resources *resources_open(const char *recording_path) {
+    struct resources *res;
+    pthread_condattr_t cond_attr;
+
+    res = calloc(1, sizeof(*res));
+    if (res == NULL) {
+        fprintf(stderr, "ERROR: failed to allocate RDMA resource cache\n");
+        return NULL;
+    }
+
+    res->nl = recording_path != NULL ? rdma_netlink_open_recording(recording_path) : rdma_netlink_open();
+    if (res->nl == NULL) {
+        fprintf(stderr, "ERROR: unable to open %s: %s\n", recording_path != NULL ? recording_path : "RDMA netlink socket", strerror(errno));
+        free(res);
+        return NULL;
+    }
+
+    /* the refresh steps are waited for with CLOCK_MONOTONIC deadlines */
+    pthread_mutex_init(&res->mutex, NULL);
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&res->cond, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
+
+    if (pthread_create(&res->thread, NULL, resources_main, res) != 0) {
+        fprintf(stderr, "ERROR: failed to create RDMA resource thread\n");
+        pthread_cond_destroy(&res->cond);
+        pthread_mutex_destroy(&res->mutex);
+        rdma_netlink_close(res->nl);
+        free(res);
+        return NULL;
+    }
+
+    return res;
+}
+
+/*
+ * hand the ports of input_infiniband_metrics over to the refresh thread and take the rows it rebuilt
+ * since, so the screen never waits for a dump. return -1 if memory ran out here or on the thread
+ */
+int resources_update(struct resources *input_resources, const struct infiniband_metrics *input_infiniband_metrics) {
+    struct resources *res = input_resources;
+    size_t port_count = input_infiniband_metrics->interface_count > 0 ? (size_t)input_infiniband_metrics->interface_count : 0;
+    int ret = 0;
+
+    pthread_mutex_lock(&res->mutex);
+
+    if (port_count > res->shared_port_capacity) {
+        uint16_t *new_ports = realloc(res->shared_ports, port_count * sizeof(*new_ports));
+        if (new_ports == NULL) {
+            pthread_mutex_unlock(&res->mutex);
+            return -1;
+        }
+
+        res->shared_ports = new_ports;
+        res->shared_port_capacity = port_count;
+    }
+
+    for (size_t i = 0; i < port_count; ++i) {
+        res->shared_ports[i] = input_infiniband_metrics->infiniband[i].name_id;
+    }
+    res->shared_port_count = port_count;
+
+    /* the first ports start the refresh */
+    if (res->port_flag == 0) {
+        res->port_flag = 1;
+        pthread_cond_signal(&res->cond);
+    }
+
+    /* the published rows and the shown ones trade places */
+    if (res->published_flag > 0) {
+        struct resource_usage *usage = res->shown_usage;
+        size_t capacity = res->shown_capacity;
+
+        res->shown_usage = res->published_usage;
+        res->shown_count = res->published_count;
+        res->shown_capacity = res->published_capacity;
+        res->published_usage = usage;
+        res->published_count = 0;
+        res->published_capacity = capacity;
+        res->published_flag = 0;
+    }
+
+    ret = res->error_flag > 0 ? -1 : 0;
+
+    pthread_mutex_unlock(&res->mutex);
+
+    return ret;
+}
+
+/* the rows of the port with name_id, *count of them */
+const struct resource_usage *resources_port_usage(const struct resources *input_resources, uint16_t name_id, size_t *count) {
+    size_t low = 0;
+    size_t high = input_resources->shown_count;
+
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+
+        if (input_resources->shown_usage[middle].name_id < name_id) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    *count = 0;
+    while (low + *count < input_resources->shown_count && input_resources->shown_usage[low + *count].name_id == name_id) {
+        ++*count;
+    }
+
+    return input_resources->shown_usage + low;
+}
+
+void resources_close(struct resources *input_resources) {
+    if (input_resources == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&input_resources->mutex);
+    input_resources->stop_flag = 1;
+    pthread_cond_signal(&input_resources->cond);
+    pthread_mutex_unlock(&input_resources->mutex);
+
+    pthread_join(input_resources->thread, NULL);
+
+    pthread_cond_destroy(&input_resources->cond);
+    pthread_mutex_destroy(&input_resources->mutex);
+
+    for (size_t i = 0; i < input_resources->device_count; ++i) {
+        free_device(input_resources, input_resources->devices[i]);
+    }
+
+    rdma_netlink_close(input_resources->nl);
+    free(input_resources->devices);
+    free(input_resources->slots);
+    free(input_resources->usage);
+    free(input_resources->ports);
+    free(input_resources->shared_ports);
+    free(input_resources->published_usage);
+    free(input_resources->shown_usage);
+    free(input_resources);
+}
@@ -0,0 +1,67 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2025 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef RESOURCES_H
+#define RESOURCES_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "infiniband.h"
+#include "rdma_netlink.h"
+
+/* longest command name kept: a 15 character comm, or a kernel module name in brackets */
+#define RESOURCES_COMMAND_MAX 24
+
+/* per-QP hardware counters whose rates are summed per process, over the counter sets QPs are bound to */
+enum resource_rate {
+    RESOURCE_RATE_RX_WRITE,
+    RESOURCE_RATE_RX_READ,
+    RESOURCE_RATE_RX_ATOMIC,
+    RESOURCE_RATE_COUNT
+};
+
+/*
+ * what one process holds on one port. CQs and MRs belong to a device rather than a port; they are
+ * counted on the process's port if it uses exactly one of the device, else on a row of the device
+ */
+struct resource_usage {
+    /* port of the row; a device row carries its device's lowest numbered port */
+    uint16_t name_id;
+    int device_flag;
+    char device_name[IB_DEVICE_NAME_MAX];
+
+    /* owning process, or 0 and the bracketed module name for kernel resources */
+    uint32_t pid;
+    char command[RESOURCES_COMMAND_MAX];
+
+    /* QPs, CQs, MRs and counter sets held, and the bytes the MRs register */
+    uint32_t counts[RDMA_NETLINK_RESOURCE_KIND_COUNT];
+    uint64_t mr_bytes;
+
+    /* per second, over the counter sets of the process on the port; rate_flag is set once there are any */
+    double rates[RESOURCE_RATE_COUNT];
+    int rate_flag;
+};
+
+struct resources;
+
+extern struct resources *resources_open(const char *recording_path);
+extern int resources_update(struct resources *input_resources, const struct infiniband_metrics *input_infiniband_metrics);
+extern const struct resource_usage *resources_port_usage(const struct resources *input_resources, uint16_t name_id, size_t *count);
+extern void resources_close(struct resources *input_resources);
+
+#endif /* RESOURCES_H */
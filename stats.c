@@ -0,0 +1,399 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2025 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "delta.h"
+#include "infiniband.h"
+#include "stats.h"
+#include "utils.h"
+#include "window.h"
+
+/* the I/O counters, which are contiguous in enum infiniband_counter, can be tracked */
+#define STATS_FIRST_COUNTER IB_COUNTER_PORT_XMIT_DATA
+#define STATS_COUNTER_COUNT (IB_COUNTER_MULTICAST_XMIT_PACKETS - IB_COUNTER_PORT_XMIT_DATA + 1)
+
+/* shortest window accepted by stats_parse_windows() */
+#define STATS_MIN_WINDOW_NS (NSEC_PER_SEC)
+
+/* time constant of the moving average */
+#define STATS_EWMA_TAU_NS (NSEC_PER_SEC)
+
+/*
+ * quantiles come from a log-linear histogram: bin 0 holds rates below 1, then every power of two
+ * up to 2^STATS_OCTAVE_COUNT is split into STATS_BINS_PER_OCTAVE bins, so an estimate is within
+ * 12.5% of the true rate. faster rates fall into the last bin
+ */
+#define STATS_BINS_PER_OCTAVE 4
+#define STATS_OCTAVE_COUNT 40
+#define STATS_BIN_COUNT (1 + STATS_OCTAVE_COUNT * STATS_BINS_PER_OCTAVE)
+
+struct stats_slot {
+    uint64_t count;
+    double min;
+    double max;
+    double sum;
+    uint32_t bins[STATS_BIN_COUNT];
+};
+
+/* the window's histogram is the sum of its slots' histograms, kept up to date as slots come and go */
+struct window_stats {
+    struct window_ring ring;
+    uint64_t count;
+    uint32_t bins[STATS_BIN_COUNT];
+    struct stats_slot slots[WINDOW_SLOT_COUNT];
+};
+
+struct port_stats {
+    /* timestamp of the newest rate; an older one (e.g.: a replay seeking back) starts over */
+    uint64_t timestamp_ns;
+
+    int ewma_flag[STATS_COUNTER_COUNT];
+    double ewma[STATS_COUNTER_COUNT];
+
+    /* windows[tracked counter * window_count + window] */
+    struct window_stats windows[];
+};
+
+struct stats {
+    size_t window_count;
+    uint64_t window_ns[STATS_WINDOW_MAX];
+    char window_labels[STATS_WINDOW_MAX][24];
+
+    /*
+     * a window costs WINDOW_SLOT_COUNT + 1 histograms, about 7 KB, per port and counter, so only the counters
+     * asked for are tracked: counters[] lists them, counter_positions[] maps an I/O counter to its index there, or -1
+     */
+    enum infiniband_counter counters[STATS_COUNTER_COUNT];
+    int counter_positions[STATS_COUNTER_COUNT];
+    size_t counter_count;
+    size_t port_size;
+
+    /* per interface name id, allocated when the port first has a rate */
+    struct port_stats **ports;
+    size_t port_capacity;
+
+    /* position of every interface name id in the previous snapshot */
+    int *prev_positions;
+    size_t prev_positions_size;
+};
+
+/* parse comma separated durations, e.g.: "10s,1m,5m", into window_ns */
+int stats_parse_windows(const char *input, uint64_t *window_ns, size_t *window_count) {
+    size_t count = 0;
+
+    while (1) {
+        char duration[32];
+        size_t length = strcspn(input, ",");
+
+        if (count == STATS_WINDOW_MAX || length == 0 || length >= sizeof(duration)) {
+            return -1;
+        }
+
+        memcpy(duration, input, length);
+        duration[length] = '\0';
+        if (parse_duration_ns(duration, &window_ns[count]) < 0 || window_ns[count] < STATS_MIN_WINDOW_NS) {
+            return -1;
+        }
+        ++count;
+
+        if (input[length] == '\0') {
+            break;
+        }
+        input += length + 1;
+    }
+
+    *window_count = count;
+
+    return 0;
+}
+
+struct stats *stats_create(const uint64_t *window_ns, size_t window_count, unsigned int counter_mask) {
+    struct stats *new_stats = calloc(1, sizeof(*new_stats));
+    if (new_stats == NULL) {
+        fprintf(stderr, "ERROR: failed to allocate rate statistics\n");
+        return NULL;
+    }
+
+    for (size_t c = 0; c < STATS_COUNTER_COUNT; ++c) {
+        enum infiniband_counter counter = (enum infiniband_counter)(STATS_FIRST_COUNTER + c);
+
+        new_stats->counter_positions[c] = -1;
+        if (counter_mask & STATS_COUNTER_BIT(counter)) {
+            new_stats->counter_positions[c] = (int)new_stats->counter_count;
+            new_stats->counters[new_stats->counter_count++] = counter;
+        }
+    }
+
+    new_stats->window_count = window_count < STATS_WINDOW_MAX ? window_count : STATS_WINDOW_MAX;
+    for (size_t w = 0; w < new_stats->window_count; ++w) {
+        uint64_t ns = window_ns[w];
+        new_stats->window_ns[w] = ns;
+
+        /* label windows in the unit they were most likely given in */
+        if (ns % (60 * NSEC_PER_SEC) == 0) {
+            snprintf(new_stats->window_labels[w], sizeof(new_stats->window_labels[w]), "%llum", (unsigned long long)(ns / (60 * NSEC_PER_SEC)));
+        } else if (ns % NSEC_PER_SEC == 0) {
+            snprintf(new_stats->window_labels[w], sizeof(new_stats->window_labels[w]), "%llus", (unsigned long long)(ns / NSEC_PER_SEC));
+        } else {
+            snprintf(new_stats->window_labels[w], sizeof(new_stats->window_labels[w]), "%llums", (unsigned long long)(ns / NSEC_PER_MSEC));
+        }
+    }
+
+    new_stats->port_size = sizeof(struct port_stats) + new_stats->counter_count * new_stats->window_count * sizeof(struct window_stats);
+
+    return new_stats;
+}
+
+int stats_tracked(const struct stats *input_stats, enum infiniband_counter counter) {
+    return counter >= STATS_FIRST_COUNTER && counter < STATS_FIRST_COUNTER + STATS_COUNTER_COUNT && input_stats->counter_positions[counter - STATS_FIRST_COUNTER] >= 0;
+}
+
+size_t stats_window_count(const struct stats *input_stats) {
+    return input_stats->window_count;
+}
+
+const char *stats_window_label(const struct stats *input_stats, size_t window) {
+    return input_stats->window_labels[window];
+}
+
+static size_t rate_bin(double rate) {
+    if (!(rate >= 1.0)) {
+        return 0;
+    }
+
+    if (rate >= (double)(1ULL << STATS_OCTAVE_COUNT)) {
+        return STATS_BIN_COUNT - 1;
+    }
+
+    uint64_t value = (uint64_t)rate;
+    unsigned int octave = 63 - (unsigned int)__builtin_clzll(value);
+
+    /* the bits below the leading one select the bin within the octave */
+    uint64_t fraction = octave >= 2 ? value >> (octave - 2) : value << (2 - octave);
+
+    return 1 + octave * STATS_BINS_PER_OCTAVE + (size_t)(fraction & (STATS_BINS_PER_OCTAVE - 1));
+}
+
+/* lowest rate bin holds */
+static double bin_floor(size_t bin) {
+    if (bin == 0) {
+        return 0.0;
+    }
+
+    size_t octave = (bin - 1) / STATS_BINS_PER_OCTAVE;
+    size_t fraction = (bin - 1) % STATS_BINS_PER_OCTAVE;
+
+    return (double)(1ULL << octave) * (1.0 + (double)fraction / STATS_BINS_PER_OCTAVE);
+}
+
+/* a window_expire_cb */
+static void expire_slot(void *ctx, size_t k) {
+    struct window_stats *window = ctx;
+    struct stats_slot *slot = &window->slots[k];
+
+    if (slot->count == 0) {
+        return;
+    }
+
+    window->count -= slot->count;
+    for (size_t b = 0; b < STATS_BIN_COUNT; ++b) {
+        window->bins[b] -= slot->bins[b];
+    }
+
+    memset(slot, 0, sizeof(*slot));
+}
+
+/* add rate at now_ns to a window of window_ns */
+static void window_add(struct window_stats *window, uint64_t window_ns, uint64_t now_ns, double rate, size_t bin) {
+    struct stats_slot *slot = &window->slots[window_advance(&window->ring, window_ns, now_ns, expire_slot, window)];
+
+    if (slot->count == 0) {
+        slot->min = rate;
+        slot->max = rate;
+    } else {
+        slot->min = rate < slot->min ? rate : slot->min;
+        slot->max = rate > slot->max ? rate : slot->max;
+    }
+
+    ++slot->count;
+    slot->sum += rate;
+    ++slot->bins[bin];
+
+    ++window->count;
+    ++window->bins[bin];
+}
+
+static struct port_stats *port_stats_get(struct stats *input_stats, uint16_t name_id) {
+    if (name_id >= input_stats->port_capacity) {
+        size_t new_capacity = infiniband_interface_id_count();
+        if (name_id >= new_capacity) {
+            return NULL;
+        }
+
+        struct port_stats **new_ports = realloc(input_stats->ports, new_capacity * sizeof(*new_ports));
+        if (new_ports == NULL) {
+            return NULL;
+        }
+
+        memset(new_ports + input_stats->port_capacity, 0, (new_capacity - input_stats->port_capacity) * sizeof(*new_ports));
+        input_stats->ports = new_ports;
+        input_stats->port_capacity = new_capacity;
+    }
+
+    if (input_stats->ports[name_id] == NULL) {
+        input_stats->ports[name_id] = calloc(1, input_stats->port_size);
+    }
+
+    return input_stats->ports[name_id];
+}
+
+/* add the rates between prev_metrics and cur_metrics; prev_metrics may be NULL */
+int stats_update(struct stats *input_stats, const struct infiniband_metrics *cur_metrics, const struct infiniband_metrics *prev_metrics) {
+    if (prev_metrics == NULL || cur_metrics->timestamp_ns <= prev_metrics->timestamp_ns) {
+        return 0;
+    }
+
+    if (infiniband_metrics_positions(prev_metrics, &input_stats->prev_positions, &input_stats->prev_positions_size) < 0) {
+        return -1;
+    }
+
+    uint64_t now_ns = cur_metrics->timestamp_ns;
+    uint64_t elapsed_ns = now_ns - prev_metrics->timestamp_ns;
+    double alpha = (double)elapsed_ns / (double)(STATS_EWMA_TAU_NS + elapsed_ns);
+
+    for (int i = 0; i < cur_metrics->interface_count; ++i) {
+        int j = input_stats->prev_positions[cur_metrics->infiniband[i].name_id];
+        if (j < 0) {
+            continue;
+        }
+
+        struct port_stats *port = port_stats_get(input_stats, cur_metrics->infiniband[i].name_id);
+        if (port == NULL) {
+            return -1;
+        }
+
+        if (window_starts_over(&port->timestamp_ns, now_ns)) {
+            memset(port, 0, input_stats->port_size);
+            port->timestamp_ns = now_ns;
+        }
+
+        double link_gbps = infiniband_rate_gbps(cur_metrics->infiniband[i].rate_id);
+        unsigned int port_flags = port_delta_flags(cur_metrics, prev_metrics, i, j);
+
+        for (size_t t = 0; t < input_stats->counter_count; ++t) {
+            enum infiniband_counter counter = input_stats->counters[t];
+            size_t c = (size_t)(counter - STATS_FIRST_COUNTER);
+            uint64_t delta;
+            unsigned int flags = port_flags | counter_delta(counter, cur_metrics->counters[counter][i], prev_metrics->counters[counter][j], elapsed_ns, link_gbps, &delta);
+
+            /* a lower bound is still the best rate there is */
+            if (flags & DELTA_UNUSABLE) {
+                continue;
+            }
+
+            double rate = (double)delta / ((double)elapsed_ns / 1e9);
+            size_t bin = rate_bin(rate);
+
+            port->ewma[c] = port->ewma_flag[c] > 0 ? port->ewma[c] + alpha * (rate - port->ewma[c]) : rate;
+            port->ewma_flag[c] = 1;
+
+            for (size_t w = 0; w < input_stats->window_count; ++w) {
+                window_add(&port->windows[t * input_stats->window_count + w], input_stats->window_ns[w], now_ns, rate, bin);
+            }
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * rate below which quantile of the window's rates fall: the bin holding it is narrowed to the rates
+ * actually seen, and the rate is interpolated within it by rank
+ */
+static double window_quantile(const struct window_stats *window, double quantile, double min, double max) {
+    double rank = quantile * (double)window->count;
+    uint64_t seen = 0;
+
+    for (size_t b = 0; b < STATS_BIN_COUNT; ++b) {
+        if (window->bins[b] == 0 || (double)(seen + window->bins[b]) < rank) {
+            seen += window->bins[b];
+            continue;
+        }
+
+        double low = bin_floor(b);
+        double high = b + 1 < STATS_BIN_COUNT ? bin_floor(b + 1) : max;
+        low = low < min ? min : low;
+        high = high > max ? max : high;
+
+        return low + (high - low) * (rank - (double)seen) / (double)window->bins[b];
+    }
+
+    return max;
+}
+
+/* summarize counter of the interface with name_id over window; summary->count is 0 if it has no rate */
+void stats_summary(const struct stats *input_stats, uint16_t name_id, enum infiniband_counter counter, size_t window, struct stats_summary *summary) {
+    memset(summary, 0, sizeof(*summary));
+
+    if (!stats_tracked(input_stats, counter) || name_id >= input_stats->port_capacity || input_stats->ports[name_id] == NULL) {
+        return;
+    }
+
+    const struct port_stats *port = input_stats->ports[name_id];
+    size_t c = (size_t)(counter - STATS_FIRST_COUNTER);
+    const struct window_stats *window_stats = &port->windows[(size_t)input_stats->counter_positions[c] * input_stats->window_count + window];
+
+    if (window_stats->count == 0) {
+        return;
+    }
+
+    double sum = 0.0;
+    int first_flag = 1;
+    for (size_t k = 0; k < WINDOW_SLOT_COUNT; ++k) {
+        const struct stats_slot *slot = &window_stats->slots[k];
+        if (slot->count == 0) {
+            continue;
+        }
+
+        summary->min = first_flag > 0 || slot->min < summary->min ? slot->min : summary->min;
+        summary->max = first_flag > 0 || slot->max > summary->max ? slot->max : summary->max;
+        sum += slot->sum;
+        first_flag = 0;
+    }
+
+    summary->ewma = port->ewma[c];
+    summary->count = window_stats->count;
+    summary->mean = sum / (double)window_stats->count;
+    summary->p50 = window_quantile(window_stats, 0.50, summary->min, summary->max);
+    summary->p99 = window_quantile(window_stats, 0.99, summary->min, summary->max);
+}
+
+void stats_free(struct stats *input_stats) {
+    if (input_stats == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; i < input_stats->port_capacity; ++i) {
+        free(input_stats->ports[i]);
+    }
+
+    free(input_stats->ports);
+    free(input_stats->prev_positions);
+    free(input_stats);
+}
@@ -0,0 +1,61 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2025 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "infiniband.h"
+
+/* at most this many windows can be tracked at once */
+#define STATS_WINDOW_MAX 4
+
+/* windows tracked unless --stats is given */
+#define STATS_DEFAULT_WINDOWS "10s,1m,5m"
+
+/* counters tracked, as a mask of STATS_COUNTER_BIT(counter); only the I/O counters can be */
+#define STATS_COUNTER_BIT(counter) (1U << (counter))
+#define STATS_ALL_COUNTERS (~0U)
+
+/* rate statistics of one port and counter over one window, in counter units per second */
+struct stats_summary {
+    /* exponentially weighted moving average; independent of the window */
+    double ewma;
+
+    double min;
+    double mean;
+    double max;
+    double p50;
+    double p99;
+
+    /* rates the window holds; the other members are 0 when there is none */
+    uint64_t count;
+};
+
+struct stats;
+
+extern int stats_parse_windows(const char *input, uint64_t *window_ns, size_t *window_count);
+extern struct stats *stats_create(const uint64_t *window_ns, size_t window_count, unsigned int counter_mask);
+extern int stats_update(struct stats *input_stats, const struct infiniband_metrics *cur_metrics, const struct infiniband_metrics *prev_metrics);
+extern int stats_tracked(const struct stats *input_stats, enum infiniband_counter counter);
+extern size_t stats_window_count(const struct stats *input_stats);
+extern const char *stats_window_label(const struct stats *input_stats, size_t window);
+extern void stats_summary(const struct stats *input_stats, uint16_t name_id, enum infiniband_counter counter, size_t window, struct stats_summary *summary);
+extern void stats_free(struct stats *input_stats);
+
+#endif /* STATS_H */
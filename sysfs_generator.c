@@ -0,0 +1,724 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2025 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/prctl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <linux/netlink.h>
+#include <rdma/rdma_netlink.h>
+#include "infiniband.h"
+#include "rdma_netlink.h"
+#include "sysfs_generator.h"
+#include "utils.h"
+
+/* values are right aligned to a fixed width so in-place rewrites never leave stale digits */
+#define COUNTER_VALUE_WIDTH 20
+
+/* how each counter advances: with data, with packets, with errors, or never */
+enum counter_kind {
+    COUNTER_KIND_DATA,
+    COUNTER_KIND_PACKETS,
+    COUNTER_KIND_ERRORS,
+    COUNTER_KIND_STATIC
+};
+
+/* hw_counters written when enabled, named as mlx5 names them; lifespan is a setting, not a counter */
+static const struct {
+    const char *name;
+    enum counter_kind kind;
+} hw_counter_files[] = {
+    {"out_of_buffer", COUNTER_KIND_ERRORS},
+    {"out_of_sequence", COUNTER_KIND_ERRORS},
+    {"packet_seq_err", COUNTER_KIND_ERRORS},
+    {"local_ack_timeout_err", COUNTER_KIND_ERRORS},
+    {"np_cnp_sent", COUNTER_KIND_ERRORS},
+    {"rp_cnp_handled", COUNTER_KIND_ERRORS},
+    {"rx_write_requests", COUNTER_KIND_PACKETS},
+    {"rx_read_requests", COUNTER_KIND_PACKETS},
+    {"lifespan", COUNTER_KIND_STATIC},
+};
+
+/* counter files per port: the standard counters, then hw_counter_files */
+#define PORT_COUNTER_COUNT (IB_COUNTER_COUNT + SIZEOF(hw_counter_files))
+
+/* command names of the synthetic processes, reused round robin */
+static const char *process_names[] = {"ib_write_bw", "ib_read_lat", "all_reduce_perf", "nccl_worker"};
+
+/* entries per resource dump message, well below the 64 KB a nested attribute can hold */
+#define RESOURCE_ENTRIES_PER_MESSAGE 32
+
+/* unsigned counterpart of NLA_ALIGN() */
+#define NL_ATTR_ALIGN(length) (((size_t)(length) + 3U) & ~(size_t)3U)
+
+/* IB_QPT_RC and IB_QPS_RTS as rdma res reports them */
+#define RESOURCE_QP_TYPE_RC 2
+#define RESOURCE_QP_STATE_RTS 3
+
+/* netlink messages built in memory; error_flag is set once an append fails */
+struct nl_writer {
+    struct string_buffer buffer;
+    int error_flag;
+};
+
+struct sysfs_generator {
+    struct sysfs_generator_config config;
+    char root[PATH_MAX / 2];
+    uint64_t start_ns;
+    size_t port_total;
+
+    /* counter_fds[port * PORT_COUNTER_COUNT + counter], -1 for files not written */
+    int *counter_fds;
+
+    /* children named after process_names whose pids own the synthetic resources, -1 where none runs */
+    pid_t *process_pids;
+    struct nl_writer replies;
+};
+
+static enum counter_kind counter_kind_of(size_t counter) {
+    if (counter >= IB_COUNTER_COUNT) {
+        return hw_counter_files[counter - IB_COUNTER_COUNT].kind;
+    }
+
+    switch ((enum infiniband_counter)counter) {
+        case IB_COUNTER_PORT_XMIT_DATA:
+        case IB_COUNTER_PORT_RCV_DATA:
+            return COUNTER_KIND_DATA;
+        case IB_COUNTER_PORT_XMIT_PACKETS:
+        case IB_COUNTER_PORT_RCV_PACKETS:
+        case IB_COUNTER_UNICAST_RCV_PACKETS:
+        case IB_COUNTER_UNICAST_XMIT_PACKETS:
+            return COUNTER_KIND_PACKETS;
+        case IB_COUNTER_SYMBOL_ERROR:
+        case IB_COUNTER_PORT_RCV_ERRORS:
+        case IB_COUNTER_PORT_XMIT_DISCARDS:
+            return COUNTER_KIND_ERRORS;
+        default:
+            return COUNTER_KIND_STATIC;
+    }
+}
+
+static int make_directory(const char *path) {
+    if (mkdir(path, 0755) < 0 && errno != EEXIST) {
+        fprintf(stderr, "ERROR: unable to create %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+static int write_text_file(const char *directory_path, const char *file_name, const char *value) {
+    char file_path[PATH_MAX];
+    FILE *file_handle;
+
+    if (snprintf(file_path, PATH_MAX, "%s/%s", directory_path, file_name) >= PATH_MAX) {
+        return -1;
+    }
+
+    file_handle = fopen(file_path, "w");
+    if (file_handle == NULL) {
+        fprintf(stderr, "ERROR: unable to create %s: %s\n", file_path, strerror(errno));
+        return -1;
+    }
+
+    fprintf(file_handle, "%s\n", value);
+    fclose(file_handle);
+
+    return 0;
+}
+
+static int write_counter(int fd, uint64_t value) {
+    char buffer[COUNTER_VALUE_WIDTH + 2];
+    int length = snprintf(buffer, sizeof(buffer), "%*" PRIu64 "\n", COUNTER_VALUE_WIDTH, value);
+
+    if (pwrite(fd, buffer, (size_t)length, 0) != length) {
+        return -1;
+    }
+
+    return 0;
+}
+
+/* create the counter files of one directory, starting at zero */
+static int create_counter(const char *directory_path, const char *file_name, int *fd) {
+    char counter_path[PATH_MAX];
+
+    if (snprintf(counter_path, PATH_MAX, "%s/%s", directory_path, file_name) >= PATH_MAX) {
+        return -1;
+    }
+
+    *fd = open(counter_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (*fd < 0 || write_counter(*fd, 0) < 0) {
+        fprintf(stderr, "ERROR: unable to create %s: %s\n", counter_path, strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+static int create_port(struct sysfs_generator *generator, unsigned int device, unsigned int port, int *fds) {
+    char path[PATH_MAX];
+    char value[64];
+    size_t length;
+
+    snprintf(path, PATH_MAX, "%s/mlx5_%u", generator->root, device);
+    if (make_directory(path) < 0) {
+        return -1;
+    }
+
+    length = strlen(path);
+    snprintf(path + length, PATH_MAX - length, "/ports");
+    if (make_directory(path) < 0) {
+        return -1;
+    }
+
+    length = strlen(path);
+    snprintf(path + length, PATH_MAX - length, "/%u", port + 1);
+    if (make_directory(path) < 0) {
+        return -1;
+    }
+
+    snprintf(value, sizeof(value), "0x%x", device * generator->config.port_count + port + 1);
+    if (write_text_file(path, "link_layer", generator->config.ethernet_flag > 0 ? "Ethernet" : "InfiniBand") < 0 ||
+        write_text_file(path, "state", "4: ACTIVE") < 0 ||
+        write_text_file(path, "phys_state", "5: LinkUp") < 0 ||
+        write_text_file(path, "rate", "200 Gb/sec (4X HDR)") < 0 ||
+        write_text_file(path, "lid", value) < 0) {
+        return -1;
+    }
+
+    length = strlen(path);
+    snprintf(path + length, PATH_MAX - length, "/counters");
+    if (make_directory(path) < 0) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < IB_COUNTER_COUNT; ++i) {
+        if (create_counter(path, infiniband_counter_name((enum infiniband_counter)i), &fds[i]) < 0) {
+            return -1;
+        }
+    }
+
+    if (generator->config.hw_counters_flag <= 0) {
+        return 0;
+    }
+
+    snprintf(path + length, PATH_MAX - length, "/hw_counters");
+    if (make_directory(path) < 0) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < SIZEOF(hw_counter_files); ++i) {
+        if (create_counter(path, hw_counter_files[i].name, &fds[IB_COUNTER_COUNT + i]) < 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/* value a counter advancing at rate per second shows after elapsed_ns, wrapped to counter_bits */
+static uint64_t counter_value(const struct sysfs_generator *generator, uint64_t rate, uint64_t elapsed_ns) {
+    uint64_t value = (uint64_t)((double)rate * ((double)elapsed_ns / 1e9));
+
+    if (generator->config.counter_bits < 64) {
+        value &= (UINT64_C(1) << generator->config.counter_bits) - 1;
+    }
+
+    return value;
+}
+
+/* a child that only carries a pid and a comm; it dies with the generator */
+static pid_t spawn_process(const char *name) {
+    pid_t parent = getpid();
+    pid_t pid = fork();
+
+    if (pid != 0) {
+        return pid;
+    }
+
+    prctl(PR_SET_PDEATHSIG, SIGKILL);
+    prctl(PR_SET_NAME, name);
+    if (getppid() != parent) {
+        _exit(EXIT_SUCCESS);
+    }
+
+    while (1) {
+        pause();
+    }
+}
+
+/* append an attribute padded to 4 bytes and return its offset */
+static size_t nl_put(struct nl_writer *writer, uint16_t type, const void *data, size_t length) {
+    static const char padding[4] = {0};
+    struct nlattr attr = {(uint16_t)(sizeof(attr) + length), type};
+    size_t offset = writer->buffer.length;
+
+    if (string_buffer_append(&writer->buffer, (const char *)&attr, sizeof(attr)) < 0 ||
+        (length > 0 && string_buffer_append(&writer->buffer, data, length) < 0) ||
+        string_buffer_append(&writer->buffer, padding, NL_ATTR_ALIGN(length) - length) < 0) {
+        writer->error_flag = 1;
+    }
+
+    return offset;
+}
+
+static void nl_put_u32(struct nl_writer *writer, uint16_t type, uint32_t value) {
+    nl_put(writer, type, &value, sizeof(value));
+}
+
+static void nl_put_u64(struct nl_writer *writer, uint16_t type, uint64_t value) {
+    nl_put(writer, type, &value, sizeof(value));
+}
+
+static void nl_put_u8(struct nl_writer *writer, uint16_t type, uint8_t value) {
+    nl_put(writer, type, &value, sizeof(value));
+}
+
+static void nl_put_string(struct nl_writer *writer, uint16_t type, const char *value) {
+    nl_put(writer, type, value, strlen(value) + 1);
+}
+
+/* close the nested attribute or message starting at offset; its length field leads either header */
+static void nl_close(struct nl_writer *writer, size_t offset, int message_flag) {
+    size_t length = writer->buffer.length - offset;
+
+    if (writer->error_flag > 0) {
+        return;
+    }
+
+    if (message_flag > 0) {
+        uint32_t message_length = (uint32_t)length;
+        memcpy(writer->buffer.data + offset, &message_length, sizeof(message_length));
+    } else {
+        uint16_t attr_length = (uint16_t)length;
+        memcpy(writer->buffer.data + offset, &attr_length, sizeof(attr_length));
+    }
+}
+
+/* start a dump reply of command about device, carrying its index and name as the kernel does */
+static size_t nl_begin_message(struct nl_writer *writer, uint8_t command, unsigned int device) {
+    struct nlmsghdr header = {0, (uint16_t)RDMA_NL_GET_TYPE(RDMA_NL_NLDEV, command), NLM_F_MULTI, 0, 0};
+    size_t offset = writer->buffer.length;
+    char device_name[32];
+
+    if (string_buffer_append(&writer->buffer, (const char *)&header, sizeof(header)) < 0) {
+        writer->error_flag = 1;
+    }
+
+    snprintf(device_name, sizeof(device_name), "mlx5_%u", device);
+    nl_put_u32(writer, RDMA_NLDEV_ATTR_DEV_INDEX, device + 1);
+    nl_put_string(writer, RDMA_NLDEV_ATTR_DEV_NAME, device_name);
+
+    return offset;
+}
+
+/* QPs a synthetic process holds; they come and go every few seconds */
+static unsigned int process_qp_count(unsigned int process, uint64_t elapsed_ns) {
+    return 2 + (unsigned int)((process + elapsed_ns / NSEC_PER_SEC / 5) % 3);
+}
+
+/* port of the q-th QP of a process: its own, or alternating with the next port of its device for every fourth process */
+static unsigned int process_port(const struct sysfs_generator *generator, unsigned int process, unsigned int q) {
+    unsigned int port = process % (unsigned int)generator->port_total % generator->config.port_count;
+
+    if (process % 4 == 3 && generator->config.port_count > 1 && q % 2 == 1) {
+        port = (port + 1) % generator->config.port_count;
+    }
+
+    return port + 1;
+}
+
+/* one resource dump of command about device, the entries of every process on it in messages of RESOURCE_ENTRIES_PER_MESSAGE */
+static void write_resource_dump(struct sysfs_generator *generator, struct nl_writer *writer, uint8_t command, unsigned int device, uint64_t elapsed_ns) {
+    uint16_t table_type;
+    uint16_t entry_type;
+    size_t message = 0;
+    size_t table = 0;
+    unsigned int entries = RESOURCE_ENTRIES_PER_MESSAGE;
+
+    switch (command) {
+        case RDMA_NLDEV_CMD_RES_QP_GET:
+            table_type = RDMA_NLDEV_ATTR_RES_QP;
+            entry_type = RDMA_NLDEV_ATTR_RES_QP_ENTRY;
+            break;
+        case RDMA_NLDEV_CMD_RES_CQ_GET:
+            table_type = RDMA_NLDEV_ATTR_RES_CQ;
+            entry_type = RDMA_NLDEV_ATTR_RES_CQ_ENTRY;
+            break;
+        case RDMA_NLDEV_CMD_RES_MR_GET:
+            table_type = RDMA_NLDEV_ATTR_RES_MR;
+            entry_type = RDMA_NLDEV_ATTR_RES_MR_ENTRY;
+            break;
+        default:
+            table_type = RDMA_NLDEV_ATTR_STAT_COUNTER;
+            entry_type = RDMA_NLDEV_ATTR_STAT_COUNTER_ENTRY;
+            break;
+    }
+
+    /* the kernel's own GSI QPs and CQ come first, process -1 */
+    for (int process = -1; process < (int)generator->config.process_count; ++process) {
+        unsigned int k = (unsigned int)process;
+        unsigned int count;
+
+        if (process >= 0 && (k % generator->port_total) / generator->config.port_count != device) {
+            continue;
+        }
+
+        switch (command) {
+            case RDMA_NLDEV_CMD_RES_QP_GET:
+                count = process < 0 ? generator->config.port_count : process_qp_count(k, elapsed_ns);
+                break;
+            case RDMA_NLDEV_CMD_RES_CQ_GET:
+                count = process < 0 ? 1 : 2;
+                break;
+            case RDMA_NLDEV_CMD_RES_MR_GET:
+                count = process < 0 ? 0 : 1 + k % 3;
+                break;
+            default:
+                count = process < 0 ? 0 : 1;
+                break;
+        }
+
+        for (unsigned int n = 0; n < count; ++n) {
+            if (entries == RESOURCE_ENTRIES_PER_MESSAGE) {
+                if (message > 0 || table > 0) {
+                    nl_close(writer, table, 0);
+                    nl_close(writer, message, 1);
+                }
+
+                message = nl_begin_message(writer, command, device);
+                table = nl_put(writer, table_type | NLA_F_NESTED, NULL, 0);
+                entries = 0;
+            }
+
+            size_t entry = nl_put(writer, entry_type | NLA_F_NESTED, NULL, 0);
+
+            switch (command) {
+                case RDMA_NLDEV_CMD_RES_QP_GET:
+                    nl_put_u32(writer, RDMA_NLDEV_ATTR_PORT_INDEX, process < 0 ? n + 1 : process_port(generator, k, n));
+                    nl_put_u32(writer, RDMA_NLDEV_ATTR_RES_LQPN, process < 0 ? 1 : 0x100 + k * 8 + n);
+                    nl_put_u8(writer, RDMA_NLDEV_ATTR_RES_TYPE, RESOURCE_QP_TYPE_RC);
+                    nl_put_u8(writer, RDMA_NLDEV_ATTR_RES_STATE, RESOURCE_QP_STATE_RTS);
+                    break;
+                case RDMA_NLDEV_CMD_RES_CQ_GET:
+                    nl_put_u32(writer, RDMA_NLDEV_ATTR_RES_CQE, 4096);
+                    nl_put_u32(writer, RDMA_NLDEV_ATTR_RES_CQN, process < 0 ? 1 : 0x40 + k * 2 + n);
+                    break;
+                case RDMA_NLDEV_CMD_RES_MR_GET:
+                    nl_put_u64(writer, RDMA_NLDEV_ATTR_RES_MRLEN, (uint64_t)(k % 4 + 1) << 24);
+                    nl_put_u32(writer, RDMA_NLDEV_ATTR_RES_MRN, 0x80 + k * 4 + n);
+                    break;
+                default: {
+                    /* a counter set per process, as with rdma statistic qp set ... auto type,pid on */
+                    static const char *counter_names[] = {"rx_write_requests", "rx_read_requests", "rx_atomic_requests", "out_of_sequence"};
+                    uint64_t rates[] = {
+                        generator->config.packets_per_second * (k % 4 + 1) / 8,
+                        generator->config.packets_per_second * (k % 4 + 1) / 32,
+                        generator->config.packets_per_second / 256,
+                        generator->config.errors_per_second,
+                    };
+
+                    nl_put_u32(writer, RDMA_NLDEV_ATTR_PORT_INDEX, process_port(generator, k, 0));
+                    nl_put_u32(writer, RDMA_NLDEV_ATTR_STAT_COUNTER_ID, k + 1);
+
+                    size_t hwcounters = nl_put(writer, RDMA_NLDEV_ATTR_STAT_HWCOUNTERS | NLA_F_NESTED, NULL, 0);
+                    for (size_t c = 0; c < SIZEOF(counter_names); ++c) {
+                        size_t hwcounter = nl_put(writer, RDMA_NLDEV_ATTR_STAT_HWCOUNTER_ENTRY | NLA_F_NESTED, NULL, 0);
+                        nl_put_string(writer, RDMA_NLDEV_ATTR_STAT_HWCOUNTER_ENTRY_NAME, counter_names[c]);
+                        nl_put_u64(writer, RDMA_NLDEV_ATTR_STAT_HWCOUNTER_ENTRY_VALUE, counter_value(generator, rates[c], elapsed_ns));
+                        nl_close(writer, hwcounter, 0);
+                    }
+                    nl_close(writer, hwcounters, 0);
+
+                    size_t qps = nl_put(writer, RDMA_NLDEV_ATTR_RES_QP | NLA_F_NESTED, NULL, 0);
+                    for (unsigned int q = 0; q < process_qp_count(k, elapsed_ns); ++q) {
+                        if (process_port(generator, k, q) == process_port(generator, k, 0)) {
+                            size_t qp = nl_put(writer, RDMA_NLDEV_ATTR_RES_QP_ENTRY | NLA_F_NESTED, NULL, 0);
+                            nl_put_u32(writer, RDMA_NLDEV_ATTR_RES_LQPN, 0x100 + k * 8 + q);
+                            nl_close(writer, qp, 0);
+                        }
+                    }
+                    nl_close(writer, qps, 0);
+                    break;
+                }
+            }
+
+            if (process < 0) {
+                nl_put_string(writer, RDMA_NLDEV_ATTR_RES_KERN_NAME, "ib_core");
+            } else {
+                nl_put_u32(writer, RDMA_NLDEV_ATTR_RES_PID, (uint32_t)generator->process_pids[k]);
+            }
+
+            nl_close(writer, entry, 0);
+            ++entries;
+        }
+    }
+
+    if (message > 0 || table > 0) {
+        nl_close(writer, table, 0);
+        nl_close(writer, message, 1);
+    }
+}
+
+/*
+ * write every reply the resource view asks for: the device list, then the QP, CQ, MR and counter
+ * set dumps of each device. written aside and renamed so a reader never sees half a file
+ */
+static int write_resources(struct sysfs_generator *generator, uint64_t elapsed_ns) {
+    static const uint8_t commands[] = {RDMA_NLDEV_CMD_RES_QP_GET, RDMA_NLDEV_CMD_RES_CQ_GET, RDMA_NLDEV_CMD_RES_MR_GET, RDMA_NLDEV_CMD_STAT_GET};
+    struct nl_writer *writer = &generator->replies;
+    char path[PATH_MAX];
+    char temporary_path[PATH_MAX];
+    FILE *file_handle;
+
+    writer->buffer.length = 0;
+    writer->error_flag = 0;
+
+    for (unsigned int device = 0; device < generator->config.device_count; ++device) {
+        nl_close(writer, nl_begin_message(writer, RDMA_NLDEV_CMD_GET, device), 1);
+
+        for (size_t i = 0; i < SIZEOF(commands); ++i) {
+            write_resource_dump(generator, writer, commands[i], device, elapsed_ns);
+        }
+    }
+
+    if (writer->error_flag > 0) {
+        return -1;
+    }
+
+    snprintf(path, PATH_MAX, "%s/%s", generator->root, RDMA_NETLINK_RECORDING_FILE);
+    snprintf(temporary_path, PATH_MAX, "%s/%s.tmp", generator->root, RDMA_NETLINK_RECORDING_FILE);
+
+    file_handle = fopen(temporary_path, "w");
+    if (file_handle == NULL) {
+        return -1;
+    }
+
+    if (fwrite(writer->buffer.data, 1, writer->buffer.length, file_handle) != writer->buffer.length) {
+        fclose(file_handle);
+        return -1;
+    }
+
+    if (fclose(file_handle) != 0 || rename(temporary_path, path) < 0) {
+        return -1;
+    }
+
+    return 0;
+}
+
+struct sysfs_generator *sysfs_generator_create(const struct sysfs_generator_config *config) {
+    struct sysfs_generator *generator;
+
+    if (config->device_count == 0 || config->port_count == 0 || config->counter_bits == 0 || config->counter_bits > 64 || strlen(config->root) >= PATH_MAX / 2) {
+        fprintf(stderr, "ERROR: invalid synthetic fabric configuration\n");
+        return NULL;
+    }
+
+    generator = calloc(1, sizeof(*generator));
+    if (generator == NULL) {
+        return NULL;
+    }
+
+    generator->config = *config;
+    generator->port_total = (size_t)config->device_count * config->port_count;
+    snprintf(generator->root, sizeof(generator->root), "%s", config->root);
+    generator->config.root = generator->root;
+
+    generator->counter_fds = malloc(generator->port_total * PORT_COUNTER_COUNT * sizeof(int));
+    if (generator->counter_fds == NULL) {
+        free(generator);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < generator->port_total * PORT_COUNTER_COUNT; ++i) {
+        generator->counter_fds[i] = -1;
+    }
+
+    if (config->process_count > 0) {
+        generator->process_pids = malloc(config->process_count * sizeof(pid_t));
+        if (generator->process_pids == NULL) {
+            goto handle_error;
+        }
+
+        for (unsigned int k = 0; k < config->process_count; ++k) {
+            generator->process_pids[k] = -1;
+        }
+    }
+
+    if (make_directory(generator->root) < 0) {
+        goto handle_error;
+    }
+
+    for (unsigned int device = 0; device < config->device_count; ++device) {
+        for (unsigned int port = 0; port < config->port_count; ++port) {
+            size_t index = (size_t)device * config->port_count + port;
+
+            if (create_port(generator, device, port, generator->counter_fds + index * PORT_COUNTER_COUNT) < 0) {
+                goto handle_error;
+            }
+        }
+    }
+
+    for (unsigned int k = 0; k < config->process_count; ++k) {
+        generator->process_pids[k] = spawn_process(process_names[k % SIZEOF(process_names)]);
+        if (generator->process_pids[k] < 0) {
+            fprintf(stderr, "ERROR: unable to start synthetic process: %s\n", strerror(errno));
+            goto handle_error;
+        }
+    }
+
+    generator->start_ns = get_monotonic_ns();
+
+    if (config->process_count > 0 && write_resources(generator, 0) < 0) {
+        fprintf(stderr, "ERROR: unable to write %s/%s: %s\n", generator->root, RDMA_NETLINK_RECORDING_FILE, strerror(errno));
+        goto handle_error;
+    }
+
+    return generator;
+
+handle_error:
+    sysfs_generator_destroy(generator, 1);
+
+    return NULL;
+}
+
+/* rewrite every counter for the time elapsed since creation (or the last reset) */
+int sysfs_generator_update(struct sysfs_generator *generator, uint64_t now_ns) {
+    uint64_t elapsed_ns = now_ns > generator->start_ns ? now_ns - generator->start_ns : 0;
+
+    if (generator->config.reset_interval_ns > 0) {
+        elapsed_ns %= generator->config.reset_interval_ns;
+    }
+
+    for (size_t port = 0; port < generator->port_total; ++port) {
+        uint64_t scale = port % 4 + 1;
+
+        for (size_t i = 0; i < PORT_COUNTER_COUNT; ++i) {
+            int fd = generator->counter_fds[port * PORT_COUNTER_COUNT + i];
+            uint64_t rate;
+
+            if (fd < 0) {
+                continue;
+            }
+
+            switch (counter_kind_of(i)) {
+                case COUNTER_KIND_DATA:
+                    /* port_xmit_data / port_rcv_data count 4 byte words */
+                    rate = generator->config.data_bytes_per_second / 4 * scale / 4;
+                    break;
+                case COUNTER_KIND_PACKETS:
+                    rate = generator->config.packets_per_second * scale / 4;
+                    break;
+                case COUNTER_KIND_ERRORS:
+                    rate = generator->config.errors_per_second * scale / 4;
+                    break;
+                default:
+                    continue;
+            }
+
+            if (write_counter(fd, counter_value(generator, rate, elapsed_ns)) < 0) {
+                return -1;
+            }
+        }
+    }
+
+    if (generator->config.process_count > 0) {
+        return write_resources(generator, elapsed_ns);
+    }
+
+    return 0;
+}
+
+static void remove_tree(struct sysfs_generator *generator) {
+    char path[PATH_MAX];
+
+    for (unsigned int device = 0; device < generator->config.device_count; ++device) {
+        for (unsigned int port = 0; port < generator->config.port_count; ++port) {
+            static const char *attribute_files[] = {"link_layer", "state", "phys_state", "rate", "lid"};
+
+            for (size_t i = 0; i < IB_COUNTER_COUNT; ++i) {
+                snprintf(path, PATH_MAX, "%s/mlx5_%u/ports/%u/counters/%s", generator->root, device, port + 1, infiniband_counter_name((enum infiniband_counter)i));
+                unlink(path);
+            }
+
+            snprintf(path, PATH_MAX, "%s/mlx5_%u/ports/%u/counters", generator->root, device, port + 1);
+            rmdir(path);
+
+            for (size_t i = 0; i < SIZEOF(hw_counter_files); ++i) {
+                snprintf(path, PATH_MAX, "%s/mlx5_%u/ports/%u/hw_counters/%s", generator->root, device, port + 1, hw_counter_files[i].name);
+                unlink(path);
+            }
+
+            snprintf(path, PATH_MAX, "%s/mlx5_%u/ports/%u/hw_counters", generator->root, device, port + 1);
+            rmdir(path);
+
+            for (size_t i = 0; i < SIZEOF(attribute_files); ++i) {
+                snprintf(path, PATH_MAX, "%s/mlx5_%u/ports/%u/%s", generator->root, device, port + 1, attribute_files[i]);
+                unlink(path);
+            }
+
+            snprintf(path, PATH_MAX, "%s/mlx5_%u/ports/%u", generator->root, device, port + 1);
+            rmdir(path);
+        }
+
+        snprintf(path, PATH_MAX, "%s/mlx5_%u/ports", generator->root, device);
+        rmdir(path);
+        snprintf(path, PATH_MAX, "%s/mlx5_%u", generator->root, device);
+        rmdir(path);
+    }
+
+    snprintf(path, PATH_MAX, "%s/%s", generator->root, RDMA_NETLINK_RECORDING_FILE);
+    unlink(path);
+    rmdir(generator->root);
+}
+
+void sysfs_generator_destroy(struct sysfs_generator *generator, int remove_flag) {
+    if (generator == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; i < generator->port_total * PORT_COUNTER_COUNT; ++i) {
+        if (generator->counter_fds[i] >= 0) {
+            close(generator->counter_fds[i]);
+        }
+    }
+
+    for (unsigned int k = 0; generator->process_pids != NULL && k < generator->config.process_count; ++k) {
+        if (generator->process_pids[k] > 0) {
+            kill(generator->process_pids[k], SIGKILL);
+            waitpid(generator->process_pids[k], NULL, 0);
+        }
+    }
+
+    if (remove_flag > 0) {
+        remove_tree(generator);
+    }
+
+    free(generator->process_pids);
+    string_buffer_free(&generator->replies.buffer);
+    free(generator->counter_fds);
+    free(generator);
+}
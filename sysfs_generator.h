@@ -0,0 +1,58 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2025 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SYSFS_GENERATOR_H
+#define SYSFS_GENERATOR_H
+
+#include <stdint.h>
+
+/* synthetic /sys/class/infiniband tree with counters advancing at configurable rates */
+struct sysfs_generator_config {
+    const char *root;
+    unsigned int device_count;
+    unsigned int port_count;
+
+    /* per-port rates; port n runs at (n % 4 + 1) / 4 of them so ports differ */
+    uint64_t data_bytes_per_second;
+    uint64_t packets_per_second;
+    uint64_t errors_per_second;
+
+    /* counters wrap at 2^counter_bits; 64 never wraps */
+    unsigned int counter_bits;
+
+    /* every counter restarts from 0 at this period, like perfquery -R; 0 never resets */
+    uint64_t reset_interval_ns;
+
+    int ethernet_flag;
+
+    /* also write mlx5 style ports/<port>/hw_counters */
+    int hw_counters_flag;
+
+    /*
+     * also answer RDMA resource dumps through RDMA_NETLINK_RECORDING_FILE for this many child
+     * processes holding QPs, CQs, MRs and a QP counter set each; 0 writes none
+     */
+    unsigned int process_count;
+};
+
+struct sysfs_generator;
+
+extern struct sysfs_generator *sysfs_generator_create(const struct sysfs_generator_config *config);
+extern int sysfs_generator_update(struct sysfs_generator *generator, uint64_t now_ns);
+extern void sysfs_generator_destroy(struct sysfs_generator *generator, int remove_flag);
+
+#endif /* SYSFS_GENERATOR_H */
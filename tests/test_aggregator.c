@@ -0,0 +1,284 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2025 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define _GNU_SOURCE
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "agent.h"
+#include "aggregator.h"
+#include "infiniband.h"
+#include "intern.h"
+#include "sysfs_generator.h"
+#include "utils.h"
+
+#define CHECK(condition) check((condition), #condition, __LINE__)
+
+/* packets per second of the synthetic ports; port n of a root runs at (n % 4 + 1) / 4 of it */
+#define TEST_PACKETS_PER_SECOND 80000
+
+#define TEST_INTERVAL_NS (100 * NSEC_PER_MSEC)
+
+/* an agent runs this long, so that the aggregator shows it well past its first batch */
+#define TEST_AGENT_NS (5 * NSEC_PER_SEC)
+
+/* longest wait for the ports of the agents */
+#define TEST_TIMEOUT_NS (4 * NSEC_PER_SEC)
+#define TEST_POLL_US 50000
+
+static int failure_count = 0;
+static int check_count = 0;
+
+static void check(int condition, const char *text, int line) {
+    ++check_count;
+    if (!condition) {
+        fprintf(stderr, "FAIL: %s:%d: %s\n", __FILE__, line, text);
+        ++failure_count;
+    }
+}
+
+/* a loopback port nobody listens on, for the aggregator to take */
+static int pick_address(char *address, size_t address_size) {
+    struct sockaddr_in socket_address = {0};
+    socklen_t socket_address_size = sizeof(socket_address);
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+    if (fd < 0) {
+        return -1;
+    }
+
+    socket_address.sin_family = AF_INET;
+    socket_address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(fd, (struct sockaddr *)&socket_address, sizeof(socket_address)) < 0 ||
+        getsockname(fd, (struct sockaddr *)&socket_address, &socket_address_size) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    close(fd);
+    snprintf(address, address_size, "127.0.0.1:%u", ntohs(socket_address.sin_port));
+
+    return 0;
+}
+
+/* a local agent publishing the ports of its own synthetic root for TEST_AGENT_NS; never returns */
+static void run_agent(const char *address, const char *host_name, uint32_t device_count, uint32_t port_count) {
+    char root[] = "/tmp/ib-test-aggregator-XXXXXX";
+    struct sysfs_generator_config config = {0};
+    struct infiniband_metrics *metrics = infiniband_metrics_alloc(0);
+
+    if (metrics == NULL || mkdtemp(root) == NULL) {
+        _exit(EXIT_FAILURE);
+    }
+
+    config.root = root;
+    config.device_count = device_count;
+    config.port_count = port_count;
+    config.data_bytes_per_second = 1000000;
+    config.packets_per_second = TEST_PACKETS_PER_SECOND;
+    config.errors_per_second = 10;
+    config.counter_bits = 64;
+
+    struct sysfs_generator *generator = sysfs_generator_create(&config);
+    if (generator == NULL || infiniband_set_sysfs_root(root) < 0) {
+        rmdir(root);
+        _exit(EXIT_FAILURE);
+    }
+
+    struct agent *agent = agent_open(address, host_name, TEST_INTERVAL_NS);
+    uint64_t end_ns = get_monotonic_ns() + TEST_AGENT_NS;
+    int ret = agent != NULL ? 0 : -1;
+
+    while (ret == 0 && get_monotonic_ns() < end_ns) {
+        ret = sysfs_generator_update(generator, get_monotonic_ns());
+        metrics->interface_count = get_infiniband_metrics(metrics, 0);
+        if (metrics->interface_count < 0) {
+            ret = -1;
+        } else {
+            agent_publish(metrics, agent);
+        }
+        usleep((useconds_t)(TEST_INTERVAL_NS / 1000));
+    }
+
+    agent_close(agent);
+    close_infiniband_metrics();
+    infiniband_metrics_free(metrics);
+    sysfs_generator_destroy(generator, 1);
+    _exit(ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+static pid_t start_agent(const char *address, const char *host_name, uint32_t device_count, uint32_t port_count) {
+    pid_t pid = fork();
+
+    if (pid == 0) {
+        run_agent(address, host_name, device_count, port_count);
+    }
+
+    return pid;
+}
+
+static int wait_agent(pid_t pid) {
+    int status;
+
+    return pid > 0 && waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS;
+}
+
+/* position of the port named interface_name in the snapshot, or -1 */
+static int find_port(const struct infiniband_metrics *input_infiniband_metrics, const char *interface_name) {
+    for (int i = 0; i < input_infiniband_metrics->interface_count; ++i) {
+        if (strcmp(infiniband_interface_name(input_infiniband_metrics->infiniband[i].name_id), interface_name) == 0) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/* read the aggregator until it shows port_count ports */
+static int wait_ports(struct aggregator *input_aggregator, struct infiniband_metrics *metrics, int port_count) {
+    uint64_t deadline_ns = get_monotonic_ns() + TEST_TIMEOUT_NS;
+
+    while (get_monotonic_ns() < deadline_ns) {
+        if (aggregator_read(metrics, input_aggregator) > 0 && metrics->interface_count == port_count) {
+            return 0;
+        }
+        usleep(TEST_POLL_US);
+    }
+
+    return -1;
+}
+
+/* received packets per second of a port between two snapshots, or -1.0 if either lacks it */
+static double port_rate(const struct infiniband_metrics *before, const struct infiniband_metrics *after, const char *interface_name) {
+    int before_position = find_port(before, interface_name);
+    int after_position = find_port(after, interface_name);
+
+    if (before_position < 0 || after_position < 0 || after->realtime_ns <= before->realtime_ns) {
+        return -1.0;
+    }
+
+    uint64_t delta = after->counters[IB_COUNTER_PORT_RCV_PACKETS][after_position] - before->counters[IB_COUNTER_PORT_RCV_PACKETS][before_position];
+
+    return (double)delta * (double)NSEC_PER_SEC / (double)(after->realtime_ns - before->realtime_ns);
+}
+
+static int check_rate(double rate, uint32_t scale) {
+    double expected = TEST_PACKETS_PER_SECOND * scale / 4.0;
+
+    return rate > expected * 0.9 && rate < expected * 1.1;
+}
+
+/*
+ * two local agents, one with a device of two ports and one with two devices of one port, merge into
+ * one snapshot of host-qualified ports that count at the rates of their synthetic roots
+ */
+static void test_merged_agents(const char *address, struct aggregator *input_aggregator) {
+    struct infiniband_metrics *before = infiniband_metrics_alloc(0);
+    struct infiniband_metrics *after = infiniband_metrics_alloc(0);
+
+    pid_t a_pid = start_agent(address, "a", 1, 2);
+    pid_t b_pid = start_agent(address, "b", 2, 1);
+    CHECK(a_pid > 0 && b_pid > 0 && before != NULL && after != NULL);
+
+    if (before != NULL && after != NULL && a_pid > 0 && b_pid > 0) {
+        CHECK(wait_ports(input_aggregator, before, 4) == 0);
+        CHECK(find_port(before, "a/mlx5_0:1") >= 0);
+        CHECK(find_port(before, "a/mlx5_0:2") >= 0);
+        CHECK(find_port(before, "b/mlx5_0:1") >= 0);
+        CHECK(find_port(before, "b/mlx5_1:1") >= 0);
+
+        /* the first snapshot may still show a host before its oldest point */
+        usleep(500000);
+        CHECK(aggregator_read(before, input_aggregator) == 1 && before->interface_count == 4);
+        usleep(1000000);
+        CHECK(aggregator_read(after, input_aggregator) == 1 && after->interface_count == 4);
+
+        CHECK(check_rate(port_rate(before, after, "a/mlx5_0:1"), 1));
+        CHECK(check_rate(port_rate(before, after, "a/mlx5_0:2"), 2));
+        CHECK(check_rate(port_rate(before, after, "b/mlx5_0:1"), 1));
+        CHECK(check_rate(port_rate(before, after, "b/mlx5_1:1"), 2));
+    }
+
+    CHECK(wait_agent(a_pid));
+    CHECK(wait_agent(b_pid));
+
+    infiniband_metrics_free(before);
+    infiniband_metrics_free(after);
+}
+
+/* an agent whose ports the full name table cannot name is dropped instead of being shown under a bad id */
+static void test_name_table_full(const char *address, struct aggregator *input_aggregator) {
+    struct infiniband_metrics *metrics = infiniband_metrics_alloc(0);
+    char interface_name[32];
+    int shown_flag = 0;
+
+    /* the agent fills its own table, so it forks before the one here runs full */
+    pid_t c_pid = start_agent(address, "c", 1, 1);
+    CHECK(c_pid > 0 && metrics != NULL);
+
+    uint16_t name_id;
+    unsigned int n = 0;
+    do {
+        snprintf(interface_name, sizeof(interface_name), "fill/%u", n++);
+        name_id = infiniband_intern_interface_name(interface_name);
+    } while (name_id != INTERN_ID_INVALID);
+
+    uint64_t end_ns = get_monotonic_ns() + TEST_TIMEOUT_NS;
+    while (metrics != NULL && get_monotonic_ns() < end_ns) {
+        if (aggregator_read(metrics, input_aggregator) > 0 && metrics->interface_count != 0) {
+            shown_flag = 1;
+        }
+        usleep(TEST_POLL_US);
+    }
+    CHECK(shown_flag == 0);
+
+    CHECK(wait_agent(c_pid));
+
+    infiniband_metrics_free(metrics);
+}
+
+int main(void) {
+    char address[64];
+
+    if (pick_address(address, sizeof(address)) < 0) {
+        fprintf(stderr, "test_aggregator: no loopback port to listen on\n");
+        return EXIT_FAILURE;
+    }
+
+    struct aggregator *input_aggregator = aggregator_start(address);
+    CHECK(input_aggregator != NULL);
+    if (input_aggregator != NULL) {
+        test_merged_agents(address, input_aggregator);
+        test_name_table_full(address, input_aggregator);
+        aggregator_stop(input_aggregator);
+    }
+
+    if (failure_count > 0) {
+        fprintf(stderr, "test_aggregator: %d of %d checks failed\n", failure_count, check_count);
+        return EXIT_FAILURE;
+    }
+
+    printf("test_aggregator: %d checks passed\n", check_count);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,264 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2025 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define _GNU_SOURCE
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "codec.h"
+#include "utils.h"
+#include "wire.h"
+
+#define CHECK(condition) check((condition), #condition, __LINE__)
+
+#define TEST_PORT_COUNT 3
+#define TEST_COUNTER_COUNT 4
+#define TEST_VALUE_COUNT (TEST_PORT_COUNT * TEST_COUNTER_COUNT)
+
+/* samples one interval apart */
+#define TEST_INTERVAL_NS (100 * NSEC_PER_MSEC)
+
+static int failure_count = 0;
+static int check_count = 0;
+
+static void check(int condition, const char *text, int line) {
+    ++check_count;
+    if (!condition) {
+        fprintf(stderr, "FAIL: %s:%d: %s\n", __FILE__, line, text);
+        ++failure_count;
+    }
+}
+
+/* the decoder holds the sample the encoder coded last */
+static int same_sample(const struct sample_codec *encoder, const struct sample_codec *decoder) {
+    return decoder->realtime_ns == encoder->realtime_ns && memcmp(decoder->states, encoder->states, 2 * TEST_PORT_COUNT) == 0 &&
+           memcmp(decoder->values, encoder->values, TEST_VALUE_COUNT * sizeof(uint64_t)) == 0;
+}
+
+/* code the next sample of the encoder and decode it; return its coded size, or 0 if it does not round trip */
+static size_t round_trip(struct sample_codec *encoder, struct sample_codec *decoder, struct string_buffer *buffer) {
+    buffer->length = 0;
+    if (codec_encode(encoder, buffer) < 0) {
+        return 0;
+    }
+
+    struct wire_reader reader = {(const unsigned char *)buffer->data, buffer->length, 0};
+    if (codec_decode(decoder, &reader) < 0 || reader.position != buffer->length || !same_sample(encoder, decoder)) {
+        return 0;
+    }
+
+    return buffer->length;
+}
+
+/* advance the sample by one interval, every value by its step */
+static void step_sample(struct sample_codec *encoder, const uint64_t *steps) {
+    encoder->next_realtime_ns += TEST_INTERVAL_NS;
+    for (size_t j = 0; j < TEST_VALUE_COUNT; ++j) {
+        encoder->next_values[j] += steps[j];
+    }
+}
+
+/*
+ * a keyframe, then values at a steady rate, values changing rate, wrapping and going backwards, port
+ * state changes and a reset mid-stream all decode to the samples coded
+ */
+static void test_round_trip(void) {
+    struct sample_codec encoder = {0};
+    struct sample_codec decoder = {0};
+    struct string_buffer buffer = {0};
+    uint64_t steps[TEST_VALUE_COUNT];
+
+    CHECK(codec_init(&encoder, TEST_PORT_COUNT, TEST_COUNTER_COUNT) == 0);
+    CHECK(codec_init(&decoder, TEST_PORT_COUNT, TEST_COUNTER_COUNT) == 0);
+    if (encoder.values == NULL || decoder.values == NULL) {
+        codec_free(&encoder);
+        codec_free(&decoder);
+        return;
+    }
+
+    /* keyframe: large values and active ports, coded against zeroes */
+    encoder.next_realtime_ns = 1700000000ULL * NSEC_PER_SEC;
+    for (size_t j = 0; j < TEST_VALUE_COUNT; ++j) {
+        encoder.next_values[j] = (j + 1) * 1000000007ULL;
+        steps[j] = j % 3 == 0 ? 0 : (j + 1) * 1000;
+    }
+    for (size_t i = 0; i < TEST_PORT_COUNT; ++i) {
+        encoder.next_states[2 * i] = 4;
+        encoder.next_states[2 * i + 1] = 5;
+    }
+    CHECK(round_trip(&encoder, &decoder, &buffer) > 0);
+
+    /* the second sample sets the deltas, after which steady values and time cost their bitmaps only */
+    step_sample(&encoder, steps);
+    CHECK(round_trip(&encoder, &decoder, &buffer) > 0);
+    step_sample(&encoder, steps);
+    size_t steady_size = round_trip(&encoder, &decoder, &buffer);
+    CHECK(steady_size == 1 + (TEST_PORT_COUNT + 7) / 8 + (TEST_VALUE_COUNT + 7) / 8);
+
+    /* a changed rate is coded once, then it is steady again */
+    steps[1] *= 3;
+    step_sample(&encoder, steps);
+    CHECK(round_trip(&encoder, &decoder, &buffer) > steady_size);
+    step_sample(&encoder, steps);
+    CHECK(round_trip(&encoder, &decoder, &buffer) == steady_size);
+
+    /* a value wrapping past UINT64_MAX and one going backwards */
+    encoder.next_values[2] = UINT64_MAX - 5 - steps[2];
+    step_sample(&encoder, steps);
+    CHECK(round_trip(&encoder, &decoder, &buffer) > 0);
+    step_sample(&encoder, steps);
+    CHECK(encoder.next_values[2] < steps[2]);
+    encoder.next_values[4] = 17;
+    CHECK(round_trip(&encoder, &decoder, &buffer) > 0);
+    CHECK(decoder.values[2] == UINT64_MAX - 5 + steps[2] && decoder.values[4] == 17);
+
+    /* a port going down sets its bit in the port bitmap after the timestamp */
+    encoder.next_states[2 * 1] = 1;
+    encoder.next_states[2 * 1 + 1] = 3;
+    step_sample(&encoder, steps);
+    CHECK(round_trip(&encoder, &decoder, &buffer) > 0);
+    CHECK(buffer.length > 1 && (unsigned char)buffer.data[1] == 1U << 1);
+    CHECK(decoder.states[2 * 1] == 1 && decoder.states[2 * 1 + 1] == 3);
+    step_sample(&encoder, steps);
+    CHECK(round_trip(&encoder, &decoder, &buffer) > 0 && buffer.data[1] == 0);
+
+    /* after a reset on both sides the next sample is a keyframe, which a fresh decoder reads as well */
+    codec_reset(&encoder);
+    codec_reset(&decoder);
+    step_sample(&encoder, steps);
+    CHECK(round_trip(&encoder, &decoder, &buffer) > steady_size);
+
+    struct sample_codec fresh_decoder = {0};
+    struct wire_reader reader = {(const unsigned char *)buffer.data, buffer.length, 0};
+    CHECK(codec_init(&fresh_decoder, TEST_PORT_COUNT, TEST_COUNTER_COUNT) == 0);
+    CHECK(fresh_decoder.values != NULL && codec_decode(&fresh_decoder, &reader) == 0 && same_sample(&encoder, &fresh_decoder));
+    codec_free(&fresh_decoder);
+
+    step_sample(&encoder, steps);
+    CHECK(round_trip(&encoder, &decoder, &buffer) > 0);
+
+    string_buffer_free(&buffer);
+    codec_free(&encoder);
+    codec_free(&decoder);
+}
+
+/* every cut of a keyframe fails to decode */
+static void test_truncated(void) {
+    struct sample_codec encoder = {0};
+    struct sample_codec decoder = {0};
+    struct string_buffer buffer = {0};
+    int truncated_flag = 1;
+
+    CHECK(codec_init(&encoder, TEST_PORT_COUNT, TEST_COUNTER_COUNT) == 0);
+    CHECK(codec_init(&decoder, TEST_PORT_COUNT, TEST_COUNTER_COUNT) == 0);
+    if (encoder.values == NULL || decoder.values == NULL) {
+        codec_free(&encoder);
+        codec_free(&decoder);
+        return;
+    }
+
+    encoder.next_realtime_ns = 1700000000ULL * NSEC_PER_SEC;
+    for (size_t j = 0; j < TEST_VALUE_COUNT; ++j) {
+        encoder.next_values[j] = UINT64_MAX / (j + 1);
+    }
+    memset(encoder.next_states, 4, 2 * TEST_PORT_COUNT);
+    CHECK(codec_encode(&encoder, &buffer) == 0);
+
+    for (size_t length = 0; length < buffer.length; ++length) {
+        struct wire_reader reader = {(const unsigned char *)buffer.data, length, 0};
+
+        codec_reset(&decoder);
+        if (codec_decode(&decoder, &reader) != -1) {
+            truncated_flag = 0;
+        }
+    }
+    CHECK(truncated_flag == 1);
+
+    struct wire_reader reader = {(const unsigned char *)buffer.data, buffer.length, 0};
+    codec_reset(&decoder);
+    CHECK(codec_decode(&decoder, &reader) == 0 && same_sample(&encoder, &decoder));
+
+    string_buffer_free(&buffer);
+    codec_free(&encoder);
+    codec_free(&decoder);
+}
+
+/* blocks of coded samples survive the compression built in; without one, compression is refused */
+static void test_compression(void) {
+    struct sample_codec encoder = {0};
+    struct string_buffer block = {0};
+    struct string_buffer compressed = {0};
+    uint64_t steps[TEST_VALUE_COUNT];
+    enum codec_compression compression = codec_default_compression();
+
+    CHECK(codec_init(&encoder, TEST_PORT_COUNT, TEST_COUNTER_COUNT) == 0);
+    if (encoder.values == NULL) {
+        return;
+    }
+
+    encoder.next_realtime_ns = 1700000000ULL * NSEC_PER_SEC;
+    for (size_t j = 0; j < TEST_VALUE_COUNT; ++j) {
+        steps[j] = j * 977;
+    }
+    int ret = 0;
+    for (int n = 0; n < 100 && ret == 0; ++n) {
+        step_sample(&encoder, steps);
+        ret = codec_encode(&encoder, &block);
+    }
+    CHECK(ret == 0);
+
+#if defined(HAVE_LZ4) || defined(HAVE_ZSTD)
+    CHECK(compression != CODEC_COMPRESSION_NONE);
+    CHECK(codec_compress(compression, block.data, block.length, &compressed) == 0);
+    CHECK(compressed.length > 0 && compressed.length < block.length);
+
+    char *output = malloc(block.length);
+    CHECK(output != NULL);
+    if (output != NULL) {
+        CHECK(codec_decompress(compression, compressed.data, compressed.length, output, block.length) == 0);
+        CHECK(memcmp(output, block.data, block.length) == 0);
+
+        /* a block that does not fill the length it was stored with is corrupt */
+        CHECK(codec_decompress(compression, compressed.data, compressed.length, output, block.length - 1) == -1);
+        free(output);
+    }
+#else
+    CHECK(compression == CODEC_COMPRESSION_NONE);
+    CHECK(codec_compress(CODEC_COMPRESSION_LZ4, block.data, block.length, &compressed) == -1);
+    CHECK(codec_compress(CODEC_COMPRESSION_ZSTD, block.data, block.length, &compressed) == -1);
+#endif
+
+    string_buffer_free(&compressed);
+    string_buffer_free(&block);
+    codec_free(&encoder);
+}
+
+int main(void) {
+    test_round_trip();
+    test_truncated();
+    test_compression();
+
+    if (failure_count > 0) {
+        fprintf(stderr, "test_codec: %d of %d checks failed\n", failure_count, check_count);
+        return EXIT_FAILURE;
+    }
+
+    printf("test_codec: %d checks passed\n", check_count);
+
+    return EXIT_SUCCESS;
+}
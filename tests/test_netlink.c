@@ -0,0 +1,483 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2025 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define _GNU_SOURCE
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <linux/netlink.h>
+#include <rdma/rdma_netlink.h>
+#include "infiniband.h"
+#include "rdma_netlink.h"
+#include "sysfs_generator.h"
+#include "utils.h"
+
+#define CHECK(condition) check((condition), #condition, __LINE__)
+
+#define MESSAGE_SIZE 4096
+#define NEST_MAX 4
+
+/* device index the fake kernel gives mlx5_0, and one it answers with an error */
+#define TEST_DEVICE_INDEX 3
+#define TEST_ERROR_DEVICE_INDEX 9
+
+static int failure_count = 0;
+static int check_count = 0;
+
+static void check(int condition, const char *text, int line) {
+    ++check_count;
+    if (!condition) {
+        fprintf(stderr, "FAIL: %s:%d: %s\n", __FILE__, line, text);
+        ++failure_count;
+    }
+}
+
+/* reply message built the way the kernel lays it out */
+struct message {
+    char data[MESSAGE_SIZE];
+    size_t length;
+    size_t nests[NEST_MAX];
+    int depth;
+};
+
+static void message_start(struct message *m, uint16_t type, uint32_t seq) {
+    struct nlmsghdr *header = (struct nlmsghdr *)m->data;
+
+    memset(m, 0, sizeof(*m));
+    header->nlmsg_type = type;
+    header->nlmsg_seq = seq;
+    m->length = NLMSG_LENGTH(0);
+}
+
+static void message_put(struct message *m, uint16_t type, const void *value, size_t length) {
+    struct nlattr *attr = (struct nlattr *)(m->data + m->length);
+
+    attr->nla_type = type;
+    attr->nla_len = (uint16_t)(sizeof(*attr) + length);
+    if (length > 0) {
+        memcpy(attr + 1, value, length);
+    }
+    m->length += (sizeof(*attr) + length + 3U) & ~(size_t)3U;
+}
+
+static void message_put_u32(struct message *m, uint16_t type, uint32_t value) {
+    message_put(m, type, &value, sizeof(value));
+}
+
+static void message_put_u64(struct message *m, uint16_t type, uint64_t value) {
+    message_put(m, type, &value, sizeof(value));
+}
+
+static void message_put_string(struct message *m, uint16_t type, const char *value) {
+    message_put(m, type, value, strlen(value) + 1);
+}
+
+static void message_nest_start(struct message *m, uint16_t type) {
+    m->nests[m->depth++] = m->length;
+    message_put(m, (uint16_t)(type | NLA_F_NESTED), NULL, 0);
+}
+
+static void message_nest_end(struct message *m) {
+    struct nlattr *attr = (struct nlattr *)(m->data + m->nests[--m->depth]);
+
+    attr->nla_len = (uint16_t)(m->length - m->nests[m->depth]);
+}
+
+static struct nlmsghdr *message_end(struct message *m) {
+    struct nlmsghdr *header = (struct nlmsghdr *)m->data;
+
+    header->nlmsg_len = (uint32_t)m->length;
+
+    return header;
+}
+
+/* one hardware counter entry per name; a NULL name stands for an entry the test does not care about */
+static void message_put_hwcounters(struct message *m, const char *const *names, const uint64_t *values, size_t count) {
+    message_nest_start(m, RDMA_NLDEV_ATTR_STAT_HWCOUNTERS);
+    for (size_t i = 0; i < count; ++i) {
+        message_nest_start(m, RDMA_NLDEV_ATTR_STAT_HWCOUNTER_ENTRY);
+        message_put_string(m, RDMA_NLDEV_ATTR_STAT_HWCOUNTER_ENTRY_NAME, names[i]);
+        message_put_u64(m, RDMA_NLDEV_ATTR_STAT_HWCOUNTER_ENTRY_VALUE, values[i]);
+        message_nest_end(m);
+    }
+    message_nest_end(m);
+}
+
+/* a port's STAT_GET reply: device and port index next to the hardware counter table */
+static struct nlmsghdr *stat_reply(struct message *m, uint32_t seq, uint32_t device_index, uint32_t port_index, const char *const *names, const uint64_t *values, size_t count) {
+    message_start(m, (uint16_t)RDMA_NL_GET_TYPE(RDMA_NL_NLDEV, RDMA_NLDEV_CMD_STAT_GET), seq);
+    message_put_u32(m, RDMA_NLDEV_ATTR_DEV_INDEX, device_index);
+    message_put_string(m, RDMA_NLDEV_ATTR_DEV_NAME, "mlx5_0");
+    message_put_u32(m, RDMA_NLDEV_ATTR_PORT_INDEX, port_index);
+    message_put_hwcounters(m, names, values, count);
+
+    return message_end(m);
+}
+
+/* counter entries handed to the callback, in order */
+#define SEEN_MAX 32
+
+struct seen_counter {
+    size_t port;
+    size_t position;
+    char name[64];
+    uint64_t value;
+};
+
+struct seen_counters {
+    struct seen_counter entries[SEEN_MAX];
+    size_t count;
+};
+
+static void record_counter(void *ctx, size_t port, size_t position, const char *name, uint64_t value) {
+    struct seen_counters *seen = ctx;
+
+    if (seen->count < SEEN_MAX) {
+        struct seen_counter *entry = &seen->entries[seen->count++];
+        entry->port = port;
+        entry->position = position;
+        snprintf(entry->name, sizeof(entry->name), "%s", name);
+        entry->value = value;
+    }
+}
+
+static const struct seen_counter *find_counter(const struct seen_counters *seen, size_t port, const char *name) {
+    for (size_t i = 0; i < seen->count; ++i) {
+        if (seen->entries[i].port == port && strcmp(seen->entries[i].name, name) == 0) {
+            return &seen->entries[i];
+        }
+    }
+
+    return NULL;
+}
+
+static const char *const responder_names[] = {"np_cnp_sent", "rp_cnp_handled"};
+
+/* u32 attribute of type in a request, 0 if it has none */
+static uint32_t request_u32(const struct nlmsghdr *request, uint16_t type) {
+    const char *attrs = NLMSG_DATA(request);
+    size_t length = request->nlmsg_len - NLMSG_LENGTH(0);
+    uint32_t value = 0;
+
+    for (size_t offset = 0; offset + sizeof(struct nlattr) <= length;) {
+        const struct nlattr *attr = (const struct nlattr *)(attrs + offset);
+
+        if (attr->nla_len < sizeof(*attr) || offset + attr->nla_len > length) {
+            break;
+        }
+        if (attr->nla_type == type && attr->nla_len >= sizeof(*attr) + sizeof(value)) {
+            memcpy(&value, attr + 1, sizeof(value));
+        }
+
+        offset += ((size_t)attr->nla_len + 3U) & ~(size_t)3U;
+    }
+
+    return value;
+}
+
+/*
+ * fake kernel on the other end of a socketpair: take one batch of STAT_GET requests and answer
+ * them in reverse order, one datagram each, after a reply to a request that was never sent.
+ * the request for TEST_ERROR_DEVICE_INDEX is answered with NLMSG_ERROR
+ */
+static void *responder_main(void *arg) {
+    int fd = *(int *)arg;
+    char request_buffer[MESSAGE_SIZE];
+    struct nlmsghdr *requests[8];
+    size_t request_count = 0;
+    struct message reply;
+
+    ssize_t ret_recv = recv(fd, request_buffer, sizeof(request_buffer), 0);
+    if (ret_recv <= 0) {
+        return NULL;
+    }
+
+    size_t remaining = (size_t)ret_recv;
+    for (struct nlmsghdr *request = (struct nlmsghdr *)request_buffer; NLMSG_OK(request, remaining) && request_count < 8; request = NLMSG_NEXT(request, remaining)) {
+        requests[request_count++] = request;
+    }
+
+    /* stale reply of a timed out earlier request */
+    uint64_t stale_values[] = {99, 99};
+    stat_reply(&reply, requests[0]->nlmsg_seq - 1, TEST_DEVICE_INDEX, 1, responder_names, stale_values, 2);
+    send(fd, reply.data, reply.length, 0);
+
+    for (size_t i = request_count; i-- > 0;) {
+        uint32_t device_index = request_u32(requests[i], RDMA_NLDEV_ATTR_DEV_INDEX);
+        uint32_t port_index = request_u32(requests[i], RDMA_NLDEV_ATTR_PORT_INDEX);
+
+        if (device_index == TEST_ERROR_DEVICE_INDEX) {
+            int error = -19;
+            message_start(&reply, NLMSG_ERROR, requests[i]->nlmsg_seq);
+            memcpy(reply.data + reply.length, &error, sizeof(error));
+            reply.length += sizeof(error);
+            message_end(&reply);
+        } else {
+            uint64_t counter_values[] = {port_index * 100 + 1, port_index * 100 + 2};
+            stat_reply(&reply, requests[i]->nlmsg_seq, device_index, port_index, responder_names, counter_values, 2);
+        }
+
+        send(fd, reply.data, reply.length, 0);
+    }
+
+    return NULL;
+}
+
+/* one batched STAT_GET round trip: replies are matched to ports by sequence number, whatever their order */
+static void test_batched_replies(void) {
+    int fds[2];
+    pthread_t responder;
+    struct seen_counters seen = {0};
+    const struct rdma_netlink_port ports[] = {
+        {TEST_DEVICE_INDEX, 1},
+        {TEST_ERROR_DEVICE_INDEX, 1},
+        {TEST_DEVICE_INDEX, 2},
+    };
+
+    CHECK(socketpair(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0, fds) == 0);
+
+    struct rdma_netlink *nl = rdma_netlink_open_socket(fds[0]);
+    CHECK(nl != NULL);
+    CHECK(pthread_create(&responder, NULL, responder_main, &fds[1]) == 0);
+
+    CHECK(rdma_netlink_stat_get(nl, ports, SIZEOF(ports), record_counter, &seen) == 0);
+    pthread_join(responder, NULL);
+
+    /* two counters of each answered port; nothing from the stale reply or the error */
+    CHECK(seen.count == 4);
+
+    const struct seen_counter *counter = find_counter(&seen, 0, "np_cnp_sent");
+    CHECK(counter != NULL && counter->position == 0 && counter->value == 101);
+    counter = find_counter(&seen, 0, "rp_cnp_handled");
+    CHECK(counter != NULL && counter->position == 1 && counter->value == 102);
+    counter = find_counter(&seen, 2, "np_cnp_sent");
+    CHECK(counter != NULL && counter->position == 0 && counter->value == 201);
+    counter = find_counter(&seen, 2, "rp_cnp_handled");
+    CHECK(counter != NULL && counter->position == 1 && counter->value == 202);
+    CHECK(find_counter(&seen, 1, "np_cnp_sent") == NULL);
+
+    rdma_netlink_close(nl);
+    close(fds[1]);
+}
+
+/*
+ * record the replies of a fake kernel in the sysfs root: mlx5_0 and a STAT_GET reply per port,
+ * whose counter entries are named by names; entry n of port p holds p * 1000 + base + n
+ */
+static int write_recording(const char *root, const char *const *names, size_t count, uint64_t base) {
+    char path[512];
+    struct message m;
+    uint64_t values[8];
+    FILE *file_handle;
+
+    snprintf(path, sizeof(path), "%s/%s", root, RDMA_NETLINK_RECORDING_FILE);
+    file_handle = fopen(path, "w");
+    if (file_handle == NULL) {
+        return -1;
+    }
+
+    message_start(&m, (uint16_t)RDMA_NL_GET_TYPE(RDMA_NL_NLDEV, RDMA_NLDEV_CMD_GET), 0);
+    message_put_u32(&m, RDMA_NLDEV_ATTR_DEV_INDEX, TEST_DEVICE_INDEX);
+    message_put_string(&m, RDMA_NLDEV_ATTR_DEV_NAME, "mlx5_0");
+    message_end(&m);
+    fwrite(m.data, 1, m.length, file_handle);
+
+    for (uint32_t port = 1; port <= 2; ++port) {
+        for (size_t n = 0; n < count; ++n) {
+            values[n] = port * 1000 + base + n;
+        }
+        stat_reply(&m, 0, TEST_DEVICE_INDEX, port, names, values, count);
+        fwrite(m.data, 1, m.length, file_handle);
+    }
+
+    return fclose(file_handle);
+}
+
+static int find_catalog_counter(const char *name) {
+    for (size_t k = 0; k < infiniband_counter_count(); ++k) {
+        if (strcmp(infiniband_counter_name((enum infiniband_counter)k), name) == 0) {
+            return (int)k;
+        }
+    }
+
+    return -1;
+}
+
+/* value of a port's counter file below the synthetic root */
+static uint64_t read_counter_file(const char *root, uint32_t port, const char *directory, const char *name) {
+    char path[512];
+    char text[64] = "";
+    uint64_t value = UINT64_MAX;
+    FILE *file_handle;
+
+    snprintf(path, sizeof(path), "%s/mlx5_0/ports/%" PRIu32 "/%s/%s", root, port, directory, name);
+    file_handle = fopen(path, "r");
+    if (file_handle != NULL) {
+        if (fgets(text, sizeof(text), file_handle) != NULL) {
+            value = strtoull(text, NULL, 10);
+        }
+        fclose(file_handle);
+    }
+
+    return value;
+}
+
+/* position of the port in a snapshot, by name */
+static int find_port(const struct infiniband_metrics *input_infiniband_metrics, uint32_t port) {
+    char interface_name[32];
+
+    snprintf(interface_name, sizeof(interface_name), "mlx5_0:%" PRIu32, port);
+    for (int i = 0; i < input_infiniband_metrics->interface_count; ++i) {
+        if (strcmp(infiniband_interface_name(input_infiniband_metrics->infiniband[i].name_id), interface_name) == 0) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/*
+ * the netlink backend over a synthetic root: counters are mapped by name when ports are
+ * discovered and by entry position afterwards, and the ones netlink lacks are read from sysfs
+ */
+static void test_backend_mapping(void) {
+    char root[] = "/tmp/ib-test-netlink-XXXXXX";
+    struct sysfs_generator_config config = {0};
+    struct infiniband_metrics *metrics = infiniband_metrics_alloc(0);
+    const char *const names[] = {"vendor_only_counter", "np_cnp_sent", "rp_cnp_handled"};
+    const char *const swapped_names[] = {"vendor_only_counter", "rp_cnp_handled", "np_cnp_sent"};
+    const char *const unknown_names[] = {"vendor_only_counter"};
+
+    CHECK(metrics != NULL && mkdtemp(root) != NULL);
+
+    config.root = root;
+    config.device_count = 1;
+    config.port_count = 2;
+    config.data_bytes_per_second = 1000000;
+    config.packets_per_second = 1000;
+    config.errors_per_second = 10;
+    config.counter_bits = 64;
+    config.hw_counters_flag = 1;
+
+    struct sysfs_generator *generator = sysfs_generator_create(&config);
+    CHECK(generator != NULL);
+    if (generator == NULL || metrics == NULL) {
+        return;
+    }
+    CHECK(sysfs_generator_update(generator, get_monotonic_ns() + NSEC_PER_SEC) == 0);
+
+    /* the backend is pointed at the replies explicitly; the root alone does not switch it away from the kernel */
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", root, RDMA_NETLINK_RECORDING_FILE);
+    CHECK(infiniband_set_sysfs_root(root) == 0);
+    CHECK(infiniband_set_netlink_recording(path) == 0);
+    infiniband_set_backend(IB_BACKEND_NETLINK);
+
+    /* mapping by name: the entry netlink has no catalog counter for is skipped */
+    CHECK(write_recording(root, names, SIZEOF(names), 0) == 0);
+    CHECK((metrics->interface_count = get_infiniband_metrics(metrics, 0)) == 2);
+    CHECK(infiniband_active_backend() == IB_BACKEND_NETLINK);
+
+    /* the catalog holds the hw_counters found while discovering */
+    int np_cnp_sent = find_catalog_counter("np_cnp_sent");
+    int rp_cnp_handled = find_catalog_counter("rp_cnp_handled");
+    int out_of_buffer = find_catalog_counter("out_of_buffer");
+    CHECK(np_cnp_sent >= 0 && rp_cnp_handled >= 0 && out_of_buffer >= 0);
+
+    for (uint32_t port = 1; port <= 2 && np_cnp_sent >= 0 && rp_cnp_handled >= 0 && out_of_buffer >= 0; ++port) {
+        int i = find_port(metrics, port);
+        CHECK(i >= 0);
+        if (i < 0) {
+            continue;
+        }
+
+        CHECK(metrics->counters[np_cnp_sent][i] == port * 1000 + 1);
+        CHECK(metrics->counters[rp_cnp_handled][i] == port * 1000 + 2);
+
+        /* netlink lacks them: read from sysfs */
+        CHECK(metrics->counters[IB_COUNTER_PORT_XMIT_DATA][i] == read_counter_file(root, port, "counters", "port_xmit_data"));
+        CHECK(metrics->counters[out_of_buffer][i] == read_counter_file(root, port, "hw_counters", "out_of_buffer"));
+    }
+
+    /* mapping by position: once discovered, entry names are not looked at again */
+    CHECK(write_recording(root, swapped_names, SIZEOF(swapped_names), 500) == 0);
+    CHECK((metrics->interface_count = get_infiniband_metrics(metrics, 0)) == 2);
+    CHECK(infiniband_active_backend() == IB_BACKEND_NETLINK);
+
+    for (uint32_t port = 1; port <= 2 && np_cnp_sent >= 0 && rp_cnp_handled >= 0; ++port) {
+        int i = find_port(metrics, port);
+        if (i >= 0) {
+            CHECK(metrics->counters[np_cnp_sent][i] == port * 1000 + 501);
+            CHECK(metrics->counters[rp_cnp_handled][i] == port * 1000 + 502);
+        }
+    }
+
+    /* replies covering no sampled counter leave every counter to sysfs */
+    close_infiniband_metrics();
+    CHECK(write_recording(root, unknown_names, SIZEOF(unknown_names), 0) == 0);
+    CHECK((metrics->interface_count = get_infiniband_metrics(metrics, 0)) == 2);
+    CHECK(infiniband_active_backend() == IB_BACKEND_SYSFS);
+
+    for (uint32_t port = 1; port <= 2 && np_cnp_sent >= 0; ++port) {
+        int i = find_port(metrics, port);
+        if (i >= 0) {
+            CHECK(metrics->counters[np_cnp_sent][i] == read_counter_file(root, port, "hw_counters", "np_cnp_sent"));
+        }
+    }
+
+    /* a failed round trip falls back to sysfs for good */
+    close_infiniband_metrics();
+    CHECK(write_recording(root, names, SIZEOF(names), 0) == 0);
+    CHECK((metrics->interface_count = get_infiniband_metrics(metrics, 0)) == 2);
+    CHECK(infiniband_active_backend() == IB_BACKEND_NETLINK);
+
+    CHECK(unlink(path) == 0);
+    CHECK((metrics->interface_count = get_infiniband_metrics(metrics, 0)) == 2);
+    CHECK(infiniband_active_backend() == IB_BACKEND_SYSFS);
+
+    for (uint32_t port = 1; port <= 2 && np_cnp_sent >= 0; ++port) {
+        int i = find_port(metrics, port);
+        if (i >= 0) {
+            CHECK(metrics->counters[np_cnp_sent][i] == read_counter_file(root, port, "hw_counters", "np_cnp_sent"));
+        }
+    }
+
+    close_infiniband_metrics();
+    CHECK(infiniband_set_netlink_recording(NULL) == 0);
+    infiniband_metrics_free(metrics);
+    sysfs_generator_destroy(generator, 1);
+}
+
+int main(void) {
+    test_batched_replies();
+    test_backend_mapping();
+
+    if (failure_count > 0) {
+        fprintf(stderr, "test_netlink: %d of %d checks failed\n", failure_count, check_count);
+        return EXIT_FAILURE;
+    }
+
+    printf("test_netlink: %d checks passed\n", check_count);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,218 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2025 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define _GNU_SOURCE
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "infiniband.h"
+#include "rdma_netlink.h"
+#include "resources.h"
+#include "sysfs_generator.h"
+#include "utils.h"
+
+#define CHECK(condition) check((condition), #condition, __LINE__)
+
+/* packets per second of the synthetic ports; the counter set of process k receives writes at (k % 4 + 1) / 8 of it */
+#define TEST_PACKETS_PER_SECOND 80000
+
+/* longest wait for the refresh thread */
+#define TEST_TIMEOUT_NS (5 * NSEC_PER_SEC)
+#define TEST_POLL_US 10000
+
+static int failure_count = 0;
+static int check_count = 0;
+
+static void check(int condition, const char *text, int line) {
+    ++check_count;
+    if (!condition) {
+        fprintf(stderr, "FAIL: %s:%d: %s\n", __FILE__, line, text);
+        ++failure_count;
+    }
+}
+
+/* position of mlx5_0:<port> in the snapshot, or -1 */
+static int find_port(const struct infiniband_metrics *input_infiniband_metrics, uint32_t port) {
+    char interface_name[32];
+
+    snprintf(interface_name, sizeof(interface_name), "mlx5_0:%u", port);
+    for (int i = 0; i < input_infiniband_metrics->interface_count; ++i) {
+        if (strcmp(infiniband_interface_name(input_infiniband_metrics->infiniband[i].name_id), interface_name) == 0) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/* the row of command on the port with name_id, a port row or a device row, or NULL */
+static const struct resource_usage *find_row(const struct resources *process_resources, uint16_t name_id, int device_flag, const char *command) {
+    size_t count;
+    const struct resource_usage *usage = resources_port_usage(process_resources, name_id, &count);
+
+    for (size_t u = 0; u < count; ++u) {
+        if (usage[u].device_flag == device_flag && strcmp(usage[u].command, command) == 0) {
+            return &usage[u];
+        }
+    }
+
+    return NULL;
+}
+
+static int check_row(const struct resource_usage *usage, uint32_t qp_count, uint32_t cq_count, uint32_t mr_count, uint32_t counter_count) {
+    return usage != NULL && usage->counts[RDMA_NETLINK_RESOURCE_QP] == qp_count && usage->counts[RDMA_NETLINK_RESOURCE_CQ] == cq_count &&
+           usage->counts[RDMA_NETLINK_RESOURCE_MR] == mr_count && usage->counts[RDMA_NETLINK_RESOURCE_COUNTER] == counter_count;
+}
+
+/* hand the snapshot over until the row of command on name_id shows up, keeping the synthetic counters current */
+static const struct resource_usage *wait_row(struct resources *process_resources, struct sysfs_generator *generator, const struct infiniband_metrics *metrics,
+                                             uint16_t name_id, const char *command, int rate_flag) {
+    uint64_t deadline_ns = get_monotonic_ns() + TEST_TIMEOUT_NS;
+
+    while (get_monotonic_ns() < deadline_ns) {
+        const struct resource_usage *usage;
+
+        if (sysfs_generator_update(generator, get_monotonic_ns()) < 0 || resources_update(process_resources, metrics) < 0) {
+            return NULL;
+        }
+
+        usage = find_row(process_resources, name_id, 0, command);
+        if (usage != NULL && usage->rate_flag >= rate_flag) {
+            return usage;
+        }
+
+        usleep(TEST_POLL_US);
+    }
+
+    return NULL;
+}
+
+/*
+ * resources of the synthetic processes, answered from the recording a synthetic root carries: the
+ * refresh thread dumps them, and the screen side only takes the rows it built
+ */
+static void test_recorded_resources(void) {
+    char root[] = "/tmp/ib-test-resources-XXXXXX";
+    char recording_path[512];
+    struct sysfs_generator_config config = {0};
+    struct infiniband_metrics *metrics = infiniband_metrics_alloc(0);
+
+    CHECK(metrics != NULL && mkdtemp(root) != NULL);
+
+    /* processes 0 and 2 use port 1, process 1 port 2, and process 3 both */
+    config.root = root;
+    config.device_count = 1;
+    config.port_count = 2;
+    config.data_bytes_per_second = 1000000;
+    config.packets_per_second = TEST_PACKETS_PER_SECOND;
+    config.errors_per_second = 10;
+    config.counter_bits = 64;
+    config.process_count = 4;
+
+    struct sysfs_generator *generator = sysfs_generator_create(&config);
+    CHECK(generator != NULL);
+    if (generator == NULL || metrics == NULL) {
+        return;
+    }
+
+    CHECK(infiniband_set_sysfs_root(root) == 0);
+    CHECK((metrics->interface_count = get_infiniband_metrics(metrics, 0)) == 2);
+
+    int port1 = find_port(metrics, 1);
+    int port2 = find_port(metrics, 2);
+    CHECK(port1 >= 0 && port2 >= 0);
+    if (port1 < 0 || port2 < 0) {
+        sysfs_generator_destroy(generator, 1);
+        return;
+    }
+    uint16_t port1_id = metrics->infiniband[port1].name_id;
+    uint16_t port2_id = metrics->infiniband[port2].name_id;
+
+    snprintf(recording_path, sizeof(recording_path), "%s/%s", root, RDMA_NETLINK_RECORDING_FILE);
+    struct resources *process_resources = resources_open(recording_path);
+    CHECK(process_resources != NULL);
+    if (process_resources == NULL) {
+        sysfs_generator_destroy(generator, 1);
+        return;
+    }
+
+    /* the thread only starts dumping once it has ports, so the first update never has rows */
+    size_t count;
+    CHECK(resources_update(process_resources, metrics) == 0);
+    resources_port_usage(process_resources, port1_id, &count);
+    CHECK(count == 0);
+
+    CHECK(wait_row(process_resources, generator, metrics, port1_id, "ib_write_bw", 0) != NULL);
+
+    /* QPs and counter sets on their port; CQs and MRs on the single port an owner uses, else on the device row */
+    CHECK(check_row(find_row(process_resources, port1_id, 0, "[ib_core]"), 1, 0, 0, 0));
+    CHECK(check_row(find_row(process_resources, port2_id, 0, "[ib_core]"), 1, 0, 0, 0));
+    CHECK(check_row(find_row(process_resources, port1_id, 1, "[ib_core]"), 0, 1, 0, 0));
+    CHECK(check_row(find_row(process_resources, port1_id, 0, "ib_write_bw"), 2, 2, 1, 1));
+    CHECK(check_row(find_row(process_resources, port2_id, 0, "ib_read_lat"), 3, 2, 2, 1));
+    CHECK(check_row(find_row(process_resources, port1_id, 0, "all_reduce_perf"), 4, 2, 3, 1));
+    CHECK(check_row(find_row(process_resources, port1_id, 0, "nccl_worker"), 1, 0, 0, 0));
+    CHECK(check_row(find_row(process_resources, port2_id, 0, "nccl_worker"), 1, 0, 0, 1));
+    CHECK(check_row(find_row(process_resources, port1_id, 1, "nccl_worker"), 0, 2, 1, 0));
+    CHECK(find_row(process_resources, port2_id, 1, "nccl_worker") == NULL);
+
+    size_t port2_count;
+    resources_port_usage(process_resources, port1_id, &count);
+    resources_port_usage(process_resources, port2_id, &port2_count);
+    CHECK(count == 6 && port2_count == 3);
+
+    /* rates follow from two counter set dumps a second apart */
+    const struct resource_usage *usage = wait_row(process_resources, generator, metrics, port1_id, "ib_write_bw", 1);
+    CHECK(usage != NULL);
+    if (usage != NULL) {
+        double expected = TEST_PACKETS_PER_SECOND / 8.0;
+
+        CHECK(usage->rates[RESOURCE_RATE_RX_WRITE] > expected * 0.9 && usage->rates[RESOURCE_RATE_RX_WRITE] < expected * 1.1);
+        CHECK(usage->rates[RESOURCE_RATE_RX_READ] > expected / 4.0 * 0.9 && usage->rates[RESOURCE_RATE_RX_READ] < expected / 4.0 * 1.1);
+    }
+
+    /* the recording is read again for every dump: a gone device takes its rows with it */
+    metrics->interface_count = 0;
+    uint64_t deadline_ns = get_monotonic_ns() + TEST_TIMEOUT_NS;
+    int ret;
+    do {
+        ret = resources_update(process_resources, metrics);
+        resources_port_usage(process_resources, port1_id, &count);
+        usleep(TEST_POLL_US);
+    } while (ret == 0 && count > 0 && get_monotonic_ns() < deadline_ns);
+    CHECK(ret == 0 && count == 0);
+
+    resources_close(process_resources);
+    close_infiniband_metrics();
+    infiniband_metrics_free(metrics);
+    sysfs_generator_destroy(generator, 1);
+}
+
+int main(void) {
+    test_recorded_resources();
+
+    if (failure_count > 0) {
+        fprintf(stderr, "test_resources: %d of %d checks failed\n", failure_count, check_count);
+        return EXIT_FAILURE;
+    }
+
+    printf("test_resources: %d checks passed\n", check_count);
+
+    return EXIT_SUCCESS;
+}
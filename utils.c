@@ -15,10 +15,17 @@
  * limitations under the License.
  */
 
+#include <errno.h>
+#include <math.h>
+#include <netdb.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/socket.h>
+#include <sys/types.h>
 #include <sys/utsname.h>
+#include <unistd.h>
 #include "utils.h"
 
 int is_linux(void) {
@@ -37,24 +44,24 @@ int is_linux(void) {
     }
 }
 
-int read_file_long_int(char *filename, long int *value) {
+int read_file_char(char *filename, char *value) {
     FILE *file_handle;
     file_handle = NULL;
 
-    char line[BUFSIZ];
-
     file_handle = fopen(filename, "r");
     if (file_handle == NULL) {
         goto handle_error;
     }
 
-    int ret_fscanf = fscanf(file_handle, "%s", line);
-    if (ret_fscanf < 1 || ret_fscanf == EOF) {
+    if (fgets(value, BUFSIZ, file_handle) != NULL) {
+        size_t value_length = strlen(value);
+        if (value_length > 0 && value[value_length - 1] == '\n') {
+            value[value_length - 1] = '\0';
+        }
+    } else {
         goto handle_error;
     }
 
-    *value = strtol(line, NULL, 0);
-
     fclose(file_handle);
 
     return 0;
@@ -67,32 +74,398 @@ handle_error:
     return -1;
 }
 
-int read_file_char(char *filename, char *value) {
-    FILE *file_handle;
-    file_handle = NULL;
+int parse_uint64(const char *buffer, size_t length, uint64_t *value) {
+    size_t i = 0;
+    uint64_t result = 0;
+    uint64_t base = 10;
+    int digit_count = 0;
 
-    file_handle = fopen(filename, "r");
-    if (file_handle == NULL) {
-        goto handle_error;
+    /* skip leading whitespace */
+    while (i < length && (buffer[i] == ' ' || buffer[i] == '\t')) {
+        ++i;
     }
 
-    if (fgets(value, BUFSIZ, file_handle) != NULL) {
-        size_t value_length = strlen(value);
-        if (value_length > 0 && value[value_length - 1] == '\n') {
-            value[value_length - 1] = '\0';
+    /* sysfs reports lid in hexadecimal with 0x prefix, counters in decimal */
+    if (i + 1 < length && buffer[i] == '0' && (buffer[i + 1] == 'x' || buffer[i + 1] == 'X')) {
+        base = 16;
+        i += 2;
+    }
+
+    for (; i < length; ++i) {
+        uint64_t digit;
+        char c = buffer[i];
+
+        if (c >= '0' && c <= '9') {
+            digit = (uint64_t)(c - '0');
+        } else if (base == 16 && c >= 'a' && c <= 'f') {
+            digit = (uint64_t)(c - 'a' + 10);
+        } else if (base == 16 && c >= 'A' && c <= 'F') {
+            digit = (uint64_t)(c - 'A' + 10);
+        } else {
+            break;
         }
+
+        /* saturate at UINT64_MAX like strtoull() does */
+        if (result > (UINT64_MAX - digit) / base) {
+            result = UINT64_MAX;
+        } else {
+            result = result * base + digit;
+        }
+
+        ++digit_count;
+    }
+
+    if (digit_count == 0) {
+        return -1;
+    }
+
+    *value = result;
+
+    return 0;
+}
+
+int read_fd_uint64(int fd, uint64_t *value) {
+    char buffer[32];
+    ssize_t ret_pread;
+
+    if (fd < 0) {
+        return -1;
+    }
+
+    ret_pread = pread(fd, buffer, sizeof(buffer), 0);
+    if (ret_pread <= 0) {
+        return -1;
+    }
+
+    return parse_uint64(buffer, (size_t)ret_pread, value);
+}
+
+int read_fd_char(int fd, char *value, size_t value_size) {
+    ssize_t ret_pread;
+    size_t value_length;
+
+    if (fd < 0 || value_size == 0) {
+        return -1;
+    }
+
+    ret_pread = pread(fd, value, value_size - 1, 0);
+    if (ret_pread <= 0) {
+        return -1;
+    }
+
+    value_length = (size_t)ret_pread;
+    if (value[value_length - 1] == '\n') {
+        --value_length;
+    }
+    value[value_length] = '\0';
+
+    return 0;
+}
+
+uint64_t get_monotonic_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * NSEC_PER_SEC + (uint64_t)ts.tv_nsec;
+}
+
+struct timespec ns_to_timespec(uint64_t ns) {
+    struct timespec ts;
+
+    ts.tv_sec = (time_t)(ns / NSEC_PER_SEC);
+    ts.tv_nsec = (long)(ns % NSEC_PER_SEC);
+
+    return ts;
+}
+
+/* parse "<number>[m|s|ms|us]", e.g.: "5", "0.25", "10ms", "5m"; plain numbers are seconds */
+int parse_duration_ns(const char *input, uint64_t *value) {
+    char *end;
+    double number;
+    double scale = 1e9;
+
+    errno = 0;
+    number = strtod(input, &end);
+    if (errno != 0 || end == input || !isfinite(number) || number < 0.0) {
+        return -1;
+    }
+
+    if (strcmp(end, "") == 0 || strcmp(end, "s") == 0) {
+        scale = 1e9;
+    } else if (strcmp(end, "m") == 0) {
+        scale = 60e9;
+    } else if (strcmp(end, "ms") == 0) {
+        scale = 1e6;
+    } else if (strcmp(end, "us") == 0) {
+        scale = 1e3;
     } else {
-        goto handle_error;
+        return -1;
     }
 
-    fclose(file_handle);
+    number *= scale;
+    if (number >= 1.8e19) {
+        return -1;
+    }
+
+    *value = (uint64_t)number;
 
     return 0;
+}
 
-handle_error:
-    if (file_handle != NULL) {
-        fclose(file_handle);
+/* parse "<number>[K|M|G|T]" with binary multiples, e.g.: "4096", "512M", "2G" */
+int parse_size_bytes(const char *input, uint64_t *value) {
+    char *end;
+    unsigned long long number;
+    unsigned int shift = 0;
+
+    errno = 0;
+    number = strtoull(input, &end, 10);
+    if (errno != 0 || end == input || input[0] == '-') {
+        return -1;
     }
 
-    return -1;
+    if (strcmp(end, "") == 0) {
+        shift = 0;
+    } else if (strcmp(end, "K") == 0 || strcmp(end, "k") == 0) {
+        shift = 10;
+    } else if (strcmp(end, "M") == 0 || strcmp(end, "m") == 0) {
+        shift = 20;
+    } else if (strcmp(end, "G") == 0 || strcmp(end, "g") == 0) {
+        shift = 30;
+    } else if (strcmp(end, "T") == 0 || strcmp(end, "t") == 0) {
+        shift = 40;
+    } else {
+        return -1;
+    }
+
+    if (number > (UINT64_MAX >> shift)) {
+        return -1;
+    }
+
+    *value = (uint64_t)number << shift;
+
+    return 0;
+}
+
+uint64_t get_realtime_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+
+    return (uint64_t)ts.tv_sec * NSEC_PER_SEC + (uint64_t)ts.tv_nsec;
+}
+
+/* make room for size more bytes plus a terminating NUL */
+int string_buffer_reserve(struct string_buffer *buffer, size_t size) {
+    if (buffer->length + size < buffer->capacity) {
+        return 0;
+    }
+
+    size_t new_capacity = buffer->capacity > 0 ? buffer->capacity : 4096;
+    while (new_capacity <= buffer->length + size) {
+        new_capacity *= 2;
+    }
+
+    char *new_data = realloc(buffer->data, new_capacity);
+    if (new_data == NULL) {
+        return -1;
+    }
+
+    buffer->data = new_data;
+    buffer->capacity = new_capacity;
+
+    return 0;
+}
+
+int string_buffer_append(struct string_buffer *buffer, const char *data, size_t length) {
+    if (string_buffer_reserve(buffer, length) < 0) {
+        return -1;
+    }
+
+    memcpy(buffer->data + buffer->length, data, length);
+    buffer->length += length;
+    buffer->data[buffer->length] = '\0';
+
+    return 0;
+}
+
+int string_buffer_printf(struct string_buffer *buffer, const char *format, ...) {
+    va_list args;
+    int ret_vsnprintf;
+
+    /* try the space left first; grow and retry only when it does not fit */
+    va_start(args, format);
+    ret_vsnprintf = vsnprintf(buffer->data != NULL ? buffer->data + buffer->length : NULL, buffer->capacity - buffer->length, format, args);
+    va_end(args);
+
+    if (ret_vsnprintf < 0) {
+        return -1;
+    }
+
+    if ((size_t)ret_vsnprintf >= buffer->capacity - buffer->length) {
+        if (string_buffer_reserve(buffer, (size_t)ret_vsnprintf) < 0) {
+            return -1;
+        }
+
+        va_start(args, format);
+        ret_vsnprintf = vsnprintf(buffer->data + buffer->length, buffer->capacity - buffer->length, format, args);
+        va_end(args);
+
+        if (ret_vsnprintf < 0) {
+            return -1;
+        }
+    }
+
+    buffer->length += (size_t)ret_vsnprintf;
+
+    return 0;
+}
+
+void string_buffer_free(struct string_buffer *buffer) {
+    free(buffer->data);
+    buffer->data = NULL;
+    buffer->length = 0;
+    buffer->capacity = 0;
+}
+
+/* write all of data, retrying on short writes and EINTR */
+int write_full(int fd, const char *data, size_t length) {
+    while (length > 0) {
+        ssize_t ret_write = write(fd, data, length);
+        if (ret_write < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+
+        data += ret_write;
+        length -= (size_t)ret_write;
+    }
+
+    return 0;
+}
+
+/*
+ * split "<address>:<port>", "[<ipv6 address>]:<port>" or ":<port>" into host and port;
+ * host is left empty for ":<port>". *port points into address
+ */
+int parse_socket_address(const char *address, char *host, size_t host_size, const char **port) {
+    const char *host_start = address;
+    size_t host_length;
+
+    *port = strrchr(address, ':');
+    if (*port == NULL || (*port)[1] == '\0') {
+        fprintf(stderr, "ERROR: address must be <address>:<port>: %s\n", address);
+        return -1;
+    }
+
+    host_length = (size_t)(*port - address);
+    ++*port;
+
+    if (host_length >= 2 && host_start[0] == '[' && host_start[host_length - 1] == ']') {
+        ++host_start;
+        host_length -= 2;
+    }
+
+    if (host_length >= host_size) {
+        fprintf(stderr, "ERROR: address is too long: %s\n", address);
+        return -1;
+    }
+    memcpy(host, host_start, host_length);
+    host[host_length] = '\0';
+
+    return 0;
+}
+
+/* bind a non-blocking listening socket to listen_address, for all addresses if the host is empty */
+int open_listen_socket(const char *listen_address) {
+    char host[256];
+    const char *port;
+
+    if (parse_socket_address(listen_address, host, sizeof(host), &port) < 0) {
+        return -1;
+    }
+
+    struct addrinfo hints;
+    struct addrinfo *result;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+
+    int ret_getaddrinfo = getaddrinfo(host[0] != '\0' ? host : NULL, port, &hints, &result);
+    if (ret_getaddrinfo != 0) {
+        fprintf(stderr, "ERROR: unable to resolve %s: %s\n", listen_address, gai_strerror(ret_getaddrinfo));
+        return -1;
+    }
+
+    int fd = -1;
+    for (struct addrinfo *entry = result; entry != NULL; entry = entry->ai_next) {
+        int reuse_value = 1;
+
+        fd = socket(entry->ai_family, entry->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, entry->ai_protocol);
+        if (fd < 0) {
+            continue;
+        }
+
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse_value, sizeof(reuse_value));
+        if (bind(fd, entry->ai_addr, entry->ai_addrlen) == 0 && listen(fd, SOMAXCONN) == 0) {
+            break;
+        }
+
+        close(fd);
+        fd = -1;
+    }
+
+    if (fd < 0) {
+        fprintf(stderr, "ERROR: unable to listen on %s: %s\n", listen_address, strerror(errno));
+    }
+
+    freeaddrinfo(result);
+
+    return fd;
+}
+
+/*
+ * start a non-blocking connection to address, which must already have passed parse_socket_address();
+ * the connection may still be in progress. return -1 without a message if it cannot be started
+ */
+int open_connect_socket(const char *address) {
+    char host[256];
+    const char *port;
+
+    if (parse_socket_address(address, host, sizeof(host), &port) < 0) {
+        return -1;
+    }
+
+    struct addrinfo hints;
+    struct addrinfo *result;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    if (getaddrinfo(host[0] != '\0' ? host : NULL, port, &hints, &result) != 0) {
+        return -1;
+    }
+
+    int fd = -1;
+    for (struct addrinfo *entry = result; entry != NULL; entry = entry->ai_next) {
+        fd = socket(entry->ai_family, entry->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, entry->ai_protocol);
+        if (fd < 0) {
+            continue;
+        }
+
+        if (connect(fd, entry->ai_addr, entry->ai_addrlen) == 0 || errno == EINPROGRESS) {
+            break;
+        }
+
+        close(fd);
+        fd = -1;
+    }
+
+    freeaddrinfo(result);
+
+    return fd;
 }
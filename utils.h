@@ -18,10 +18,39 @@
 #ifndef UTILS_H
 #define UTILS_H
 
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
 #define SIZEOF(x) (sizeof(x) / sizeof(x[0]))
 
+#define NSEC_PER_SEC 1000000000ULL
+#define NSEC_PER_MSEC 1000000ULL
+
+/* growable output buffer; zero-initialized buffers are empty and ready to use */
+struct string_buffer {
+    char *data;
+    size_t length;
+    size_t capacity;
+};
+
 extern int is_linux(void);
-extern int read_file_long_int(char *filename, long int *value);
 extern int read_file_char(char *filename, char *value);
+extern int parse_uint64(const char *buffer, size_t length, uint64_t *value);
+extern int read_fd_uint64(int fd, uint64_t *value);
+extern int read_fd_char(int fd, char *value, size_t value_size);
+extern uint64_t get_monotonic_ns(void);
+extern struct timespec ns_to_timespec(uint64_t ns);
+extern int parse_duration_ns(const char *input, uint64_t *value);
+extern int parse_size_bytes(const char *input, uint64_t *value);
+extern uint64_t get_realtime_ns(void);
+extern int string_buffer_reserve(struct string_buffer *buffer, size_t size);
+extern int string_buffer_append(struct string_buffer *buffer, const char *data, size_t length);
+extern int string_buffer_printf(struct string_buffer *buffer, const char *format, ...) __attribute__((format(printf, 2, 3)));
+extern void string_buffer_free(struct string_buffer *buffer);
+extern int write_full(int fd, const char *data, size_t length);
+extern int parse_socket_address(const char *address, char *host, size_t host_size, const char **port);
+extern int open_listen_socket(const char *listen_address);
+extern int open_connect_socket(const char *address);
 
 #endif /* UTILS_H */
@@ -0,0 +1,53 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2025 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "window.h"
+
+/*
+ * move ring to the slot now_ns falls in, expiring the slots time moved past, and return that slot.
+ * slots are only walked when time enters a new one, and at most once each
+ */
+size_t window_advance(struct window_ring *ring, uint64_t window_ns, uint64_t now_ns, window_expire_cb expire, void *ctx) {
+    uint64_t epoch = now_ns / (window_ns / WINDOW_SLOT_COUNT);
+
+    if (epoch != ring->epoch) {
+        /* a clock gone backwards skips the whole ring, like one that moved past every slot */
+        uint64_t steps = epoch - ring->epoch;
+        if (steps > WINDOW_SLOT_COUNT) {
+            steps = WINDOW_SLOT_COUNT;
+        }
+
+        for (uint64_t s = 1; s <= steps; ++s) {
+            expire(ctx, (size_t)((ring->epoch + s) % WINDOW_SLOT_COUNT));
+        }
+        ring->epoch = epoch;
+    }
+
+    return (size_t)(epoch % WINDOW_SLOT_COUNT);
+}
+
+/*
+ * make now_ns the newest timestamp of a set of windows; 1 if it is older than the one before, e.g.: a
+ * replay seeking back, in which case the caller empties the windows and starts over
+ */
+int window_starts_over(uint64_t *timestamp_ns, uint64_t now_ns) {
+    int ret = now_ns < *timestamp_ns;
+
+    *timestamp_ns = now_ns;
+
+    return ret;
+}
@@ -0,0 +1,42 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2025 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef WINDOW_H
+#define WINDOW_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * a sliding window is a ring of slots, each covering 1 / WINDOW_SLOT_COUNT of it; the oldest slot is
+ * dropped as a whole, so a window holds between (WINDOW_SLOT_COUNT - 1) / WINDOW_SLOT_COUNT of its
+ * duration and all of it. the slots are the caller's, e.g.: histograms of rates or sums of increases
+ */
+#define WINDOW_SLOT_COUNT 10
+
+/* called for a slot time moved past, which must be emptied and taken out of the window's totals */
+typedef void (*window_expire_cb)(void *ctx, size_t slot);
+
+struct window_ring {
+    /* slot periods since the clock's origin the newest slot covers */
+    uint64_t epoch;
+};
+
+extern size_t window_advance(struct window_ring *ring, uint64_t window_ns, uint64_t now_ns, window_expire_cb expire, void *ctx);
+extern int window_starts_over(uint64_t *timestamp_ns, uint64_t now_ns);
+
+#endif /* WINDOW_H */
@@ -0,0 +1,125 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2025 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include "utils.h"
+#include "wire.h"
+
+/*
+ * map a difference of two counters, taken modulo 2^64, to an unsigned value that is small when
+ * the difference is small in either direction: 0, -1, 1, -2, ... become 0, 1, 2, 3, ...
+ */
+uint64_t wire_zigzag_encode(uint64_t delta) {
+    return (delta << 1) ^ (0 - (delta >> 63));
+}
+
+uint64_t wire_zigzag_decode(uint64_t value) {
+    return (value >> 1) ^ (0 - (value & 1));
+}
+
+int wire_put_byte(struct string_buffer *buffer, uint8_t value) {
+    if (string_buffer_reserve(buffer, 1) < 0) {
+        return -1;
+    }
+
+    buffer->data[buffer->length++] = (char)value;
+
+    return 0;
+}
+
+/* store value as a LEB128 varint: 7 bits per byte, least significant first, high bit set on all but the last */
+size_t wire_encode_varint(unsigned char *output, uint64_t value) {
+    size_t length = 0;
+
+    while (value >= 0x80) {
+        output[length++] = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    output[length++] = (unsigned char)value;
+
+    return length;
+}
+
+int wire_put_varint(struct string_buffer *buffer, uint64_t value) {
+    if (string_buffer_reserve(buffer, WIRE_VARINT_MAX) < 0) {
+        return -1;
+    }
+
+    buffer->length += wire_encode_varint((unsigned char *)buffer->data + buffer->length, value);
+
+    return 0;
+}
+
+/* append a varint length and the characters of string, without the terminator */
+int wire_put_string(struct string_buffer *buffer, const char *string) {
+    size_t length = strlen(string);
+
+    if (wire_put_varint(buffer, length) < 0 || string_buffer_reserve(buffer, length) < 0) {
+        return -1;
+    }
+
+    memcpy(buffer->data + buffer->length, string, length);
+    buffer->length += length;
+
+    return 0;
+}
+
+int wire_get_byte(struct wire_reader *reader, uint8_t *value) {
+    if (reader->position >= reader->length) {
+        return -1;
+    }
+
+    *value = reader->data[reader->position++];
+
+    return 0;
+}
+
+/* return -1 if the payload ends inside the varint or it is longer than WIRE_VARINT_MAX bytes */
+int wire_get_varint(struct wire_reader *reader, uint64_t *value) {
+    uint64_t result = 0;
+
+    for (unsigned int shift = 0; shift < 7 * WIRE_VARINT_MAX; shift += 7) {
+        if (reader->position >= reader->length) {
+            return -1;
+        }
+
+        unsigned char byte = reader->data[reader->position++];
+        result |= (uint64_t)(byte & 0x7f) << shift;
+
+        if ((byte & 0x80) == 0) {
+            *value = result;
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+/* read a string into string; return -1 if it is truncated or does not fit string_size with its terminator */
+int wire_get_string(struct wire_reader *reader, char *string, size_t string_size) {
+    uint64_t length;
+
+    if (wire_get_varint(reader, &length) < 0 || length >= string_size || length > reader->length - reader->position) {
+        return -1;
+    }
+
+    memcpy(string, reader->data + reader->position, (size_t)length);
+    string[length] = '\0';
+    reader->position += (size_t)length;
+
+    return 0;
+}
@@ -0,0 +1,45 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2025 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef WIRE_H
+#define WIRE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "utils.h"
+
+/* a varint takes at most this many bytes */
+#define WIRE_VARINT_MAX 10
+
+/* bounds-checked cursor over a received payload */
+struct wire_reader {
+    const unsigned char *data;
+    size_t length;
+    size_t position;
+};
+
+extern uint64_t wire_zigzag_encode(uint64_t delta);
+extern uint64_t wire_zigzag_decode(uint64_t value);
+extern size_t wire_encode_varint(unsigned char *output, uint64_t value);
+extern int wire_put_byte(struct string_buffer *buffer, uint8_t value);
+extern int wire_put_varint(struct string_buffer *buffer, uint64_t value);
+extern int wire_put_string(struct string_buffer *buffer, const char *string);
+extern int wire_get_byte(struct wire_reader *reader, uint8_t *value);
+extern int wire_get_varint(struct wire_reader *reader, uint64_t *value);
+extern int wire_get_string(struct wire_reader *reader, char *string, size_t string_size);
+
+#endif /* WIRE_H */